@@ -0,0 +1,61 @@
+/*
+ * Bit-sliced AES using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * aesbs_neon.c is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). This header and the C sources
+ * it declares are also built in user space by tools/crypto, so they must
+ * not depend on anything but the types below.
+ */
+
+#ifndef _ARM_CRYPTO_AESBS_H
+#define _ARM_CRYPTO_AESBS_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+#define AESBS_MAX_ROUNDS	14
+#define AESBS_PARALLEL		8	/* Blocks done by one call */
+
+/* Round keys in the bit-sliced layout, 8 words a round */
+struct aesbs_key {
+	u64 rk[(AESBS_MAX_ROUNDS + 1) * 8];
+	int rounds;
+};
+
+/**
+ * aesbs_convert_key() - Converts an expanded AES encryption key
+ *
+ * @key: The bit-sliced key
+ * @rk: The round keys as in crypto_aes_ctx.key_enc, words loaded little
+ *      endian
+ * @rounds: 10, 12 or 14
+ *
+ * Decryption uses the same key.
+ */
+void aesbs_convert_key(struct aesbs_key *key, const u32 *rk, int rounds);
+
+/**
+ * aesbs_encrypt8() - Encrypts AESBS_PARALLEL blocks
+ *
+ * @dst and @src may be the same and need not be aligned.
+ */
+void aesbs_encrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src);
+
+/**
+ * aesbs_decrypt8() - Decrypts AESBS_PARALLEL blocks
+ */
+void aesbs_decrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src);
+
+#endif /* _ARM_CRYPTO_AESBS_H */
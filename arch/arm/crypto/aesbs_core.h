@@ -0,0 +1,457 @@
+/*
+ * Bit-sliced AES core
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The state of 4 blocks is kept in eight 64-bit words, word i holding
+ * bit i of every byte, so SubBytes becomes a boolean circuit (the one of
+ * Boyar and Peralta) run on all bytes at once, and the other steps
+ * become shifts and masks. Nothing depends on the data, so there is no
+ * table lookup to leak timing. The layout is the one of BearSSL's aes_ct64.
+ *
+ * The includer provides the word type and its operations, which work on
+ * every 64-bit lane of the word:
+ *
+ *   bs_t			word of BS_LANES 64-bit lanes
+ *   bs_xor(), bs_and(), bs_not()
+ *   bs_shl(x, n), bs_shr(x, n)	shift each lane
+ *   bs_rotr16(x), bs_rotr32(x)	rotate each lane right
+ *   bs_const(c)		c in every lane
+ *   bs_load_words(w, p)	w[j] gets, zero extended in lane l, the
+ *				little endian word j of the block at
+ *				p + 64 * l
+ *   bs_store_words(p, w)	the reverse
+ *
+ * so that with two lanes 8 blocks are processed at once, blocks 0-3 in
+ * lane 0 and 4-7 in lane 1. The file is also built by tools/crypto and
+ * must not depend on anything else.
+ */
+
+#ifndef _ARM_CRYPTO_AESBS_CORE_H
+#define _ARM_CRYPTO_AESBS_CORE_H
+
+#define AESBS_BLOCKS	(4 * BS_LANES)
+
+static inline void aesbs_swapmove(bs_t *a, bs_t *b, u64 cl, u64 ch, int s)
+{
+	bs_t x = *a, y = *b;
+
+	*a = bs_xor(bs_and(x, bs_const(cl)), bs_shl(bs_and(y, bs_const(cl)), s));
+	*b = bs_xor(bs_shr(bs_and(x, bs_const(ch)), s), bs_and(y, bs_const(ch)));
+}
+
+/* transposes the bits of the eight words, its own inverse */
+static inline void aesbs_ortho(bs_t *q)
+{
+	const u64 c1 = 0x5555555555555555ULL, c2 = 0x3333333333333333ULL;
+	const u64 c4 = 0x0f0f0f0f0f0f0f0fULL;
+
+	aesbs_swapmove(&q[0], &q[1], c1, ~c1, 1);
+	aesbs_swapmove(&q[2], &q[3], c1, ~c1, 1);
+	aesbs_swapmove(&q[4], &q[5], c1, ~c1, 1);
+	aesbs_swapmove(&q[6], &q[7], c1, ~c1, 1);
+
+	aesbs_swapmove(&q[0], &q[2], c2, ~c2, 2);
+	aesbs_swapmove(&q[1], &q[3], c2, ~c2, 2);
+	aesbs_swapmove(&q[4], &q[6], c2, ~c2, 2);
+	aesbs_swapmove(&q[5], &q[7], c2, ~c2, 2);
+
+	aesbs_swapmove(&q[0], &q[4], c4, ~c4, 4);
+	aesbs_swapmove(&q[1], &q[5], c4, ~c4, 4);
+	aesbs_swapmove(&q[2], &q[6], c4, ~c4, 4);
+	aesbs_swapmove(&q[3], &q[7], c4, ~c4, 4);
+}
+
+/* spreads the bytes of 4 words (zero extended in each lane) over 2 */
+static inline void aesbs_interleave_in(bs_t *q0, bs_t *q1, const bs_t *w)
+{
+	const u64 m16 = 0x0000ffff0000ffffULL, m8 = 0x00ff00ff00ff00ffULL;
+	bs_t x[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		x[i] = bs_and(bs_xor(w[i], bs_shl(w[i], 16)), bs_const(m16));
+		x[i] = bs_and(bs_xor(x[i], bs_shl(x[i], 8)), bs_const(m8));
+	}
+	*q0 = bs_xor(x[0], bs_shl(x[2], 8));
+	*q1 = bs_xor(x[1], bs_shl(x[3], 8));
+}
+
+static inline void aesbs_interleave_out(bs_t *w, bs_t q0, bs_t q1)
+{
+	const u64 m16 = 0x0000ffff0000ffffULL, m8 = 0x00ff00ff00ff00ffULL;
+	const u64 m32 = 0x00000000ffffffffULL;
+	bs_t x[4];
+	int i;
+
+	x[0] = bs_and(q0, bs_const(m8));
+	x[1] = bs_and(q1, bs_const(m8));
+	x[2] = bs_and(bs_shr(q0, 8), bs_const(m8));
+	x[3] = bs_and(bs_shr(q1, 8), bs_const(m8));
+	for (i = 0; i < 4; i++) {
+		x[i] = bs_and(bs_xor(x[i], bs_shr(x[i], 8)), bs_const(m16));
+		w[i] = bs_and(bs_xor(x[i], bs_shr(x[i], 16)), bs_const(m32));
+	}
+}
+
+/* loads AESBS_BLOCKS blocks into bit-sliced form */
+static inline void aesbs_load(bs_t *q, const u8 *in)
+{
+	bs_t w[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		bs_load_words(w, in + 16 * i);
+		aesbs_interleave_in(&q[i], &q[i + 4], w);
+	}
+	aesbs_ortho(q);
+}
+
+static inline void aesbs_store(u8 *out, bs_t *q)
+{
+	bs_t w[4];
+	int i;
+
+	aesbs_ortho(q);
+	for (i = 0; i < 4; i++) {
+		aesbs_interleave_out(w, q[i], q[i + 4]);
+		bs_store_words(out + 16 * i, w);
+	}
+}
+
+/* SubBytes on all bytes, Boyar and Peralta's 113 gate circuit */
+static inline void aesbs_sbox(bs_t *q)
+{
+	bs_t x0, x1, x2, x3, x4, x5, x6, x7;
+	bs_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11;
+	bs_t y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+	bs_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11;
+	bs_t z12, z13, z14, z15, z16, z17;
+	bs_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12;
+	bs_t t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	bs_t t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34;
+	bs_t t35, t36, t37, t38, t39, t40, t41, t42, t43, t44, t45;
+	bs_t t46, t47, t48, t49, t50, t51, t52, t53, t54, t55, t56;
+	bs_t t57, t58, t59, t60, t61, t62, t63, t64, t65, t66, t67;
+	bs_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* top linear transformation */
+	y14 = bs_xor(x3, x5);
+	y13 = bs_xor(x0, x6);
+	y9 = bs_xor(x0, x3);
+	y8 = bs_xor(x0, x5);
+	t0 = bs_xor(x1, x2);
+	y1 = bs_xor(t0, x7);
+	y4 = bs_xor(y1, x3);
+	y12 = bs_xor(y13, y14);
+	y2 = bs_xor(y1, x0);
+	y5 = bs_xor(y1, x6);
+	y3 = bs_xor(y5, y8);
+	t1 = bs_xor(x4, y12);
+	y15 = bs_xor(t1, x5);
+	y20 = bs_xor(t1, x1);
+	y6 = bs_xor(y15, x7);
+	y10 = bs_xor(y15, t0);
+	y11 = bs_xor(y20, y9);
+	y7 = bs_xor(x7, y11);
+	y17 = bs_xor(y10, y11);
+	y19 = bs_xor(y10, y8);
+	y16 = bs_xor(t0, y11);
+	y21 = bs_xor(y13, y16);
+	y18 = bs_xor(x0, y16);
+
+	/* non-linear section */
+	t2 = bs_and(y12, y15);
+	t3 = bs_and(y3, y6);
+	t4 = bs_xor(t3, t2);
+	t5 = bs_and(y4, x7);
+	t6 = bs_xor(t5, t2);
+	t7 = bs_and(y13, y16);
+	t8 = bs_and(y5, y1);
+	t9 = bs_xor(t8, t7);
+	t10 = bs_and(y2, y7);
+	t11 = bs_xor(t10, t7);
+	t12 = bs_and(y9, y11);
+	t13 = bs_and(y14, y17);
+	t14 = bs_xor(t13, t12);
+	t15 = bs_and(y8, y10);
+	t16 = bs_xor(t15, t12);
+	t17 = bs_xor(t4, t14);
+	t18 = bs_xor(t6, t16);
+	t19 = bs_xor(t9, t14);
+	t20 = bs_xor(t11, t16);
+	t21 = bs_xor(t17, y20);
+	t22 = bs_xor(t18, y19);
+	t23 = bs_xor(t19, y21);
+	t24 = bs_xor(t20, y18);
+
+	t25 = bs_xor(t21, t22);
+	t26 = bs_and(t21, t23);
+	t27 = bs_xor(t24, t26);
+	t28 = bs_and(t25, t27);
+	t29 = bs_xor(t28, t22);
+	t30 = bs_xor(t23, t24);
+	t31 = bs_xor(t22, t26);
+	t32 = bs_and(t31, t30);
+	t33 = bs_xor(t32, t24);
+	t34 = bs_xor(t23, t33);
+	t35 = bs_xor(t27, t33);
+	t36 = bs_and(t24, t35);
+	t37 = bs_xor(t36, t34);
+	t38 = bs_xor(t27, t36);
+	t39 = bs_and(t29, t38);
+	t40 = bs_xor(t25, t39);
+
+	t41 = bs_xor(t40, t37);
+	t42 = bs_xor(t29, t33);
+	t43 = bs_xor(t29, t40);
+	t44 = bs_xor(t33, t37);
+	t45 = bs_xor(t42, t41);
+	z0 = bs_and(t44, y15);
+	z1 = bs_and(t37, y6);
+	z2 = bs_and(t33, x7);
+	z3 = bs_and(t43, y16);
+	z4 = bs_and(t40, y1);
+	z5 = bs_and(t29, y7);
+	z6 = bs_and(t42, y11);
+	z7 = bs_and(t45, y17);
+	z8 = bs_and(t41, y10);
+	z9 = bs_and(t44, y12);
+	z10 = bs_and(t37, y3);
+	z11 = bs_and(t33, y4);
+	z12 = bs_and(t43, y13);
+	z13 = bs_and(t40, y5);
+	z14 = bs_and(t29, y2);
+	z15 = bs_and(t42, y9);
+	z16 = bs_and(t45, y14);
+	z17 = bs_and(t41, y8);
+
+	/* bottom linear transformation */
+	t46 = bs_xor(z15, z16);
+	t47 = bs_xor(z10, z11);
+	t48 = bs_xor(z5, z13);
+	t49 = bs_xor(z9, z10);
+	t50 = bs_xor(z2, z12);
+	t51 = bs_xor(z2, z5);
+	t52 = bs_xor(z7, z8);
+	t53 = bs_xor(z0, z3);
+	t54 = bs_xor(z6, z7);
+	t55 = bs_xor(z16, z17);
+	t56 = bs_xor(z12, t48);
+	t57 = bs_xor(t50, t53);
+	t58 = bs_xor(z4, t46);
+	t59 = bs_xor(z3, t54);
+	t60 = bs_xor(t46, t57);
+	t61 = bs_xor(z14, t57);
+	t62 = bs_xor(t52, t58);
+	t63 = bs_xor(t49, t58);
+	t64 = bs_xor(z4, t59);
+	t65 = bs_xor(t61, t62);
+	t66 = bs_xor(z1, t63);
+	s0 = bs_xor(t59, t63);
+	s6 = bs_xor(t56, bs_not(t62));
+	s7 = bs_xor(t48, bs_not(t60));
+	t67 = bs_xor(t64, t65);
+	s3 = bs_xor(t53, t66);
+	s4 = bs_xor(t51, t66);
+	s5 = bs_xor(t47, t65);
+	s1 = bs_xor(t64, bs_not(s3));
+	s2 = bs_xor(t55, bs_not(t67));
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+/*
+ * y ^ 0x63 through the inverse of the linear part of the S-box affine
+ * transformation. Run before and after SubBytes it gives InvSubBytes.
+ */
+static inline void aesbs_inv_affine(bs_t *q)
+{
+	bs_t q0 = bs_not(q[0]), q1 = bs_not(q[1]), q2 = q[2], q3 = q[3];
+	bs_t q4 = q[4], q5 = bs_not(q[5]), q6 = bs_not(q[6]), q7 = q[7];
+
+	q[7] = bs_xor(bs_xor(q1, q4), q6);
+	q[6] = bs_xor(bs_xor(q0, q3), q5);
+	q[5] = bs_xor(bs_xor(q7, q2), q4);
+	q[4] = bs_xor(bs_xor(q6, q1), q3);
+	q[3] = bs_xor(bs_xor(q5, q0), q2);
+	q[2] = bs_xor(bs_xor(q4, q7), q1);
+	q[1] = bs_xor(bs_xor(q3, q6), q0);
+	q[0] = bs_xor(bs_xor(q2, q5), q7);
+}
+
+static inline void aesbs_inv_sbox(bs_t *q)
+{
+	aesbs_inv_affine(q);
+	aesbs_sbox(q);
+	aesbs_inv_affine(q);
+}
+
+static inline bs_t aesbs_mask_shift(bs_t x, u64 mask, int shift)
+{
+	x = bs_and(x, bs_const(mask));
+	return shift > 0 ? bs_shl(x, shift) : bs_shr(x, -shift);
+}
+
+static inline void aesbs_shift_rows(bs_t *q)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		bs_t x = q[i];
+
+		q[i] = bs_xor(bs_xor(bs_xor(
+			bs_and(x, bs_const(0x000000000000ffffULL)),
+			aesbs_mask_shift(x, 0x00000000fff00000ULL, -4)),
+			bs_xor(aesbs_mask_shift(x, 0x00000000000f0000ULL, 12),
+			aesbs_mask_shift(x, 0x0000ff0000000000ULL, -8))),
+			bs_xor(bs_xor(
+			aesbs_mask_shift(x, 0x000000ff00000000ULL, 8),
+			aesbs_mask_shift(x, 0xf000000000000000ULL, -12)),
+			aesbs_mask_shift(x, 0x0fff000000000000ULL, 4)));
+	}
+}
+
+static inline void aesbs_inv_shift_rows(bs_t *q)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		bs_t x = q[i];
+
+		q[i] = bs_xor(bs_xor(bs_xor(
+			bs_and(x, bs_const(0x000000000000ffffULL)),
+			aesbs_mask_shift(x, 0x000000000fff0000ULL, 4)),
+			bs_xor(aesbs_mask_shift(x, 0x00000000f0000000ULL, -12),
+			aesbs_mask_shift(x, 0x000000ff00000000ULL, 8))),
+			bs_xor(bs_xor(
+			aesbs_mask_shift(x, 0x0000ff0000000000ULL, -8),
+			aesbs_mask_shift(x, 0x000f000000000000ULL, 12)),
+			aesbs_mask_shift(x, 0xfff0000000000000ULL, -4)));
+	}
+}
+
+/*
+ * Rows are 16 bits apart in a lane, so rotating a lane by 16 moves every
+ * byte to the next row of its column, and by 32 two rows.
+ */
+static inline void aesbs_mix_columns(bs_t *q)
+{
+	bs_t q0, q1, q2, q3, q4, q5, q6, q7;
+	bs_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+	q0 = q[0];
+	q1 = q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = q[5];
+	q6 = q[6];
+	q7 = q[7];
+	r0 = bs_rotr16(q0);
+	r1 = bs_rotr16(q1);
+	r2 = bs_rotr16(q2);
+	r3 = bs_rotr16(q3);
+	r4 = bs_rotr16(q4);
+	r5 = bs_rotr16(q5);
+	r6 = bs_rotr16(q6);
+	r7 = bs_rotr16(q7);
+
+	q[0] = bs_xor(bs_xor(q7, r7), bs_xor(r0, bs_rotr32(bs_xor(q0, r0))));
+	q[1] = bs_xor(bs_xor(bs_xor(q0, r0), bs_xor(q7, r7)),
+		      bs_xor(r1, bs_rotr32(bs_xor(q1, r1))));
+	q[2] = bs_xor(bs_xor(q1, r1), bs_xor(r2, bs_rotr32(bs_xor(q2, r2))));
+	q[3] = bs_xor(bs_xor(bs_xor(q2, r2), bs_xor(q7, r7)),
+		      bs_xor(r3, bs_rotr32(bs_xor(q3, r3))));
+	q[4] = bs_xor(bs_xor(bs_xor(q3, r3), bs_xor(q7, r7)),
+		      bs_xor(r4, bs_rotr32(bs_xor(q4, r4))));
+	q[5] = bs_xor(bs_xor(q4, r4), bs_xor(r5, bs_rotr32(bs_xor(q5, r5))));
+	q[6] = bs_xor(bs_xor(q5, r5), bs_xor(r6, bs_rotr32(bs_xor(q6, r6))));
+	q[7] = bs_xor(bs_xor(q6, r6), bs_xor(r7, bs_rotr32(bs_xor(q7, r7))));
+}
+
+/*
+ * InvMixColumns is MixColumns after multiplying each column by
+ * {04}x^2 + {05}: every byte gets {04} times itself plus the byte two
+ * rows away added.
+ */
+static inline void aesbs_inv_mix_columns(bs_t *q)
+{
+	bs_t u[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		u[i] = bs_xor(q[i], bs_rotr32(q[i]));
+
+	/* u times {04}, reducing by x^8 = x^4 + x^3 + x + 1 twice */
+	q[0] = bs_xor(q[0], u[6]);
+	q[1] = bs_xor(q[1], bs_xor(u[6], u[7]));
+	q[2] = bs_xor(q[2], bs_xor(u[0], u[7]));
+	q[3] = bs_xor(q[3], bs_xor(u[1], u[6]));
+	q[4] = bs_xor(q[4], bs_xor(bs_xor(u[2], u[6]), u[7]));
+	q[5] = bs_xor(q[5], bs_xor(u[3], u[7]));
+	q[6] = bs_xor(q[6], u[4]);
+	q[7] = bs_xor(q[7], u[5]);
+
+	aesbs_mix_columns(q);
+}
+
+static inline void aesbs_add_round_key(bs_t *q, const u64 *sk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = bs_xor(q[i], bs_const(sk[i]));
+}
+
+static inline void aesbs_encrypt_core(bs_t *q, const u64 *sk, int rounds)
+{
+	int r;
+
+	aesbs_add_round_key(q, sk);
+	for (r = 1; r < rounds; r++) {
+		aesbs_sbox(q);
+		aesbs_shift_rows(q);
+		aesbs_mix_columns(q);
+		aesbs_add_round_key(q, sk + 8 * r);
+	}
+	aesbs_sbox(q);
+	aesbs_shift_rows(q);
+	aesbs_add_round_key(q, sk + 8 * rounds);
+}
+
+static inline void aesbs_decrypt_core(bs_t *q, const u64 *sk, int rounds)
+{
+	int r;
+
+	aesbs_add_round_key(q, sk + 8 * rounds);
+	for (r = rounds - 1; r > 0; r--) {
+		aesbs_inv_shift_rows(q);
+		aesbs_inv_sbox(q);
+		aesbs_add_round_key(q, sk + 8 * r);
+		aesbs_inv_mix_columns(q);
+	}
+	aesbs_inv_shift_rows(q);
+	aesbs_inv_sbox(q);
+	aesbs_add_round_key(q, sk);
+}
+
+#endif /* _ARM_CRYPTO_AESBS_CORE_H */
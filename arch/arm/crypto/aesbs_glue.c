@@ -0,0 +1,470 @@
+/*
+ * AES in CBC, CTR and XTS modes using bit-sliced NEON code
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The bit-sliced code does AESBS_PARALLEL blocks at a time, so only the
+ * modes where blocks are independent gain from it: CBC decryption, CTR
+ * and XTS. CBC encryption is serial and is done one block at a time by
+ * the "aes" cipher, which is also used for everything in interrupt
+ * context where NEON cannot be used.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/hardirq.h>
+#include <linux/crypto.h>
+#include <linux/string.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/b128ops.h>
+#include <crypto/gf128mul.h>
+#include <asm/neon.h>
+
+#include "aesbs.h"
+
+#define AESBS_CHUNK	(AESBS_PARALLEL * AES_BLOCK_SIZE)
+
+struct aesbs_ctx {
+	struct aesbs_key key;
+	struct crypto_cipher *fallback;
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx data;
+	struct crypto_cipher *tweak;
+};
+
+static int aesbs_init_ctx(struct aesbs_ctx *ctx)
+{
+	ctx->fallback = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->fallback)) {
+		pr_err("aesbs: no aes cipher for the fallback\n");
+		return PTR_ERR(ctx->fallback);
+	}
+	return 0;
+}
+
+static int aesbs_set_key_ctx(struct crypto_tfm *tfm, struct aesbs_ctx *ctx,
+		const u8 *in_key, unsigned int key_len)
+{
+	struct crypto_aes_ctx rk;
+	int err;
+
+	err = crypto_aes_expand_key(&rk, in_key, key_len);
+	if (err) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return err;
+	}
+	aesbs_convert_key(&ctx->key, rk.key_enc, 6 + key_len / 4);
+	memset(&rk, 0, sizeof(rk));
+
+	crypto_cipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_cipher_set_flags(ctx->fallback,
+		crypto_tfm_get_flags(tfm) & CRYPTO_TFM_REQ_MASK);
+	return crypto_cipher_setkey(ctx->fallback, in_key, key_len);
+}
+
+/*
+ * En- or decrypts in place the first @blocks of @buf, which has room for
+ * AESBS_PARALLEL blocks. The bit-sliced code always does all of them.
+ */
+static void aesbs_ecb(struct aesbs_ctx *ctx, u8 *buf, unsigned int blocks,
+		bool enc, bool neon)
+{
+	if (neon) {
+		if (enc)
+			aesbs_encrypt8(&ctx->key, buf, buf);
+		else
+			aesbs_decrypt8(&ctx->key, buf, buf);
+		return;
+	}
+
+	for (; blocks; blocks--, buf += AES_BLOCK_SIZE) {
+		if (enc)
+			crypto_cipher_encrypt_one(ctx->fallback, buf, buf);
+		else
+			crypto_cipher_decrypt_one(ctx->fallback, buf, buf);
+	}
+}
+
+static int aesbs_cra_init(struct crypto_tfm *tfm)
+{
+	return aesbs_init_ctx(crypto_tfm_ctx(tfm));
+}
+
+static void aesbs_cra_exit(struct crypto_tfm *tfm)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->fallback);
+}
+
+static int aesbs_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+		unsigned int key_len)
+{
+	return aesbs_set_key_ctx(tfm, crypto_tfm_ctx(tfm), in_key, key_len);
+}
+
+static int aesbs_cbc_encrypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		do {
+			crypto_xor(iv, s, AES_BLOCK_SIZE);
+			crypto_cipher_encrypt_one(ctx->fallback, d, iv);
+			memcpy(iv, d, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_cbc_decrypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	bool neon = !in_interrupt();
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_CHUNK];
+	u8 last[AES_BLOCK_SIZE];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		if (neon)
+			kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, nbytes, AESBS_CHUNK);
+			int i;
+
+			n &= ~(AES_BLOCK_SIZE - 1);
+			memcpy(buf, s, n);
+			memcpy(last, s + n - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+			aesbs_ecb(ctx, buf, n / AES_BLOCK_SIZE, false, neon);
+
+			/* backwards, so that in place s is read before written */
+			for (i = n - AES_BLOCK_SIZE; i > 0; i -= AES_BLOCK_SIZE) {
+				crypto_xor(buf + i, s + i - AES_BLOCK_SIZE,
+					AES_BLOCK_SIZE);
+				memcpy(d + i, buf + i, AES_BLOCK_SIZE);
+			}
+			crypto_xor(buf, walk.iv, AES_BLOCK_SIZE);
+			memcpy(d, buf, AES_BLOCK_SIZE);
+			memcpy(walk.iv, last, AES_BLOCK_SIZE);
+
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		if (neon)
+			kernel_neon_end();
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_ctr_crypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	bool neon = !in_interrupt();
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_CHUNK];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+		unsigned int tail = 0;
+
+		/* a partial block is only done at the very end of the data */
+		if (nbytes < walk.total)
+			tail = nbytes % AES_BLOCK_SIZE;
+		nbytes -= tail;
+
+		if (neon)
+			kernel_neon_begin();
+		while (nbytes) {
+			unsigned int n = min_t(unsigned int, nbytes, AESBS_CHUNK);
+			unsigned int blocks = DIV_ROUND_UP(n, AES_BLOCK_SIZE);
+			unsigned int i;
+
+			for (i = 0; i < blocks; i++) {
+				memcpy(buf + i * AES_BLOCK_SIZE, walk.iv,
+					AES_BLOCK_SIZE);
+				crypto_inc(walk.iv, AES_BLOCK_SIZE);
+			}
+			aesbs_ecb(ctx, buf, blocks, true, neon);
+			crypto_xor(buf, s, n);
+			memcpy(d, buf, n);
+
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		if (neon)
+			kernel_neon_end();
+
+		err = blkcipher_walk_done(desc, &walk, tail);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_cra_init(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	err = aesbs_init_ctx(&ctx->data);
+	if (err)
+		return err;
+
+	ctx->tweak = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->tweak)) {
+		crypto_free_cipher(ctx->data.fallback);
+		return PTR_ERR(ctx->tweak);
+	}
+	return 0;
+}
+
+static void aesbs_xts_cra_exit(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->tweak);
+	crypto_free_cipher(ctx->data.fallback);
+}
+
+static int aesbs_xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+		unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	/* the first half is the data key, the second the tweak key */
+	if (key_len % 2) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	key_len /= 2;
+
+	crypto_cipher_clear_flags(ctx->tweak, CRYPTO_TFM_REQ_MASK);
+	crypto_cipher_set_flags(ctx->tweak,
+		crypto_tfm_get_flags(tfm) & CRYPTO_TFM_REQ_MASK);
+	err = crypto_cipher_setkey(ctx->tweak, in_key + key_len, key_len);
+	if (err) {
+		tfm->crt_flags |= crypto_cipher_get_flags(ctx->tweak) &
+			CRYPTO_TFM_RES_MASK;
+		return err;
+	}
+
+	return aesbs_set_key_ctx(tfm, &ctx->data, in_key, key_len);
+}
+
+static int aesbs_xts_crypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes, bool enc)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	bool neon = !in_interrupt();
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_CHUNK];
+	be128 t[AESBS_PARALLEL];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	/* walk.iv holds the tweak of the next block from here on */
+	crypto_cipher_encrypt_one(ctx->tweak, walk.iv, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr;
+		u8 *d = walk.dst.virt.addr;
+
+		if (neon)
+			kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, nbytes, AESBS_CHUNK);
+			unsigned int blocks = n / AES_BLOCK_SIZE;
+			unsigned int i;
+
+			n = blocks * AES_BLOCK_SIZE;
+			for (i = 0; i < blocks; i++) {
+				memcpy(&t[i], walk.iv, AES_BLOCK_SIZE);
+				gf128mul_x_ble((be128 *)walk.iv, &t[i]);
+			}
+			memcpy(buf, s, n);
+			crypto_xor(buf, (u8 *)t, n);
+			aesbs_ecb(&ctx->data, buf, blocks, enc, neon);
+			crypto_xor(buf, (u8 *)t, n);
+			memcpy(d, buf, n);
+
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		if (neon)
+			kernel_neon_end();
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_encrypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, true);
+}
+
+static int aesbs_xts_decrypt(struct blkcipher_desc *desc,
+		struct scatterlist *dst, struct scatterlist *src,
+		unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, false);
+}
+
+static struct crypto_alg aesbs_algs[] = { {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= aesbs_cra_init,
+	.cra_exit		= aesbs_cra_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_cbc_encrypt,
+			.decrypt	= aesbs_cbc_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= aesbs_cra_init,
+	.cra_exit		= aesbs_cra_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_ctr_crypt,
+			.decrypt	= aesbs_ctr_crypt,
+		},
+	},
+}, {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= aesbs_xts_cra_init,
+	.cra_exit		= aesbs_xts_cra_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_set_key,
+			.encrypt	= aesbs_xts_encrypt,
+			.decrypt	= aesbs_xts_decrypt,
+		},
+	},
+} };
+
+static int __init aesbs_mod_init(void)
+{
+	int i, err;
+
+	if (!cpu_has_neon()) {
+		pr_info("aesbs: no NEON, not registering\n");
+		return -ENODEV;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(aesbs_algs); i++) {
+		INIT_LIST_HEAD(&aesbs_algs[i].cra_list);
+		err = crypto_register_alg(&aesbs_algs[i]);
+		if (err)
+			goto unregister;
+	}
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(&aesbs_algs[i]);
+	return err;
+}
+
+static void __exit aesbs_mod_exit(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aesbs_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(&aesbs_algs[i]);
+}
+
+module_init(aesbs_mod_init);
+module_exit(aesbs_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("AES in CBC, CTR and XTS modes, bit-sliced NEON");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
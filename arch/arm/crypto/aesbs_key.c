@@ -0,0 +1,76 @@
+/*
+ * Bit-sliced AES key conversion
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Plain C, using one 64-bit lane of the core, so keys can be set up
+ * without NEON.
+ */
+
+#include "aesbs.h"
+
+typedef u64 bs_t;
+#define BS_LANES	1
+
+static inline bs_t bs_xor(bs_t a, bs_t b)
+{
+	return a ^ b;
+}
+
+static inline bs_t bs_and(bs_t a, bs_t b)
+{
+	return a & b;
+}
+
+static inline bs_t bs_not(bs_t a)
+{
+	return ~a;
+}
+
+#define bs_shl(x, n)		((x) << (n))
+#define bs_shr(x, n)		((x) >> (n))
+#define bs_rotr16(x)		(((x) >> 16) | ((x) << 48))
+#define bs_rotr32(x)		(((x) >> 32) | ((x) << 32))
+#define bs_const(c)		((bs_t)(c))
+
+/* unused here, but the core expects them */
+static inline void bs_load_words(bs_t *w, const u8 *p)
+{
+	int j;
+
+	for (j = 0; j < 4; j++)
+		w[j] = p[4 * j] | p[4 * j + 1] << 8 | p[4 * j + 2] << 16 |
+			(u32)p[4 * j + 3] << 24;
+}
+
+static inline void bs_store_words(u8 *p, const bs_t *w)
+{
+	int i, j;
+
+	for (j = 0; j < 4; j++)
+		for (i = 0; i < 4; i++)
+			p[4 * j + i] = w[j] >> (8 * i);
+}
+
+#include "aesbs_core.h"
+
+void aesbs_convert_key(struct aesbs_key *key, const u32 *rk, int rounds)
+{
+	bs_t q[8], w[4];
+	int r, i, j;
+
+	/* the same round key for all 4 blocks of the lane */
+	for (r = 0; r <= rounds; r++) {
+		for (i = 0; i < 4; i++) {
+			for (j = 0; j < 4; j++)
+				w[j] = rk[4 * r + j];
+			aesbs_interleave_in(&q[i], &q[i + 4], w);
+		}
+		aesbs_ortho(q);
+		for (i = 0; i < 8; i++)
+			key->rk[8 * r + i] = q[i];
+	}
+	key->rounds = rounds;
+}
@@ -0,0 +1,99 @@
+/*
+ * Bit-sliced AES using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The core runs on two 64-bit lanes of the NEON registers, 8 blocks at a
+ * time. Built with -mfpu=neon, see aesbs.h.
+ */
+
+#include <arm_neon.h>
+
+#include "aesbs.h"
+
+typedef uint64x2_t bs_t;
+#define BS_LANES	2
+
+static inline bs_t bs_xor(bs_t a, bs_t b)
+{
+	return veorq_u64(a, b);
+}
+
+static inline bs_t bs_and(bs_t a, bs_t b)
+{
+	return vandq_u64(a, b);
+}
+
+static inline bs_t bs_not(bs_t a)
+{
+	return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(a)));
+}
+
+/* by register, the shift counts are only constant after inlining */
+static inline bs_t bs_shl(bs_t x, int n)
+{
+	return vshlq_u64(x, vdupq_n_s64(n));
+}
+
+static inline bs_t bs_shr(bs_t x, int n)
+{
+	return vshlq_u64(x, vdupq_n_s64(-n));
+}
+
+static inline bs_t bs_rotr16(bs_t x)
+{
+	return vsliq_n_u64(vshrq_n_u64(x, 16), x, 48);
+}
+
+static inline bs_t bs_rotr32(bs_t x)
+{
+	return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x)));
+}
+
+static inline bs_t bs_const(u64 c)
+{
+	return vdupq_n_u64(c);
+}
+
+static inline void bs_load_words(bs_t *w, const u8 *p)
+{
+	uint32x4x2_t z = vzipq_u32(vreinterpretq_u32_u8(vld1q_u8(p)),
+				   vreinterpretq_u32_u8(vld1q_u8(p + 64)));
+
+	w[0] = vmovl_u32(vget_low_u32(z.val[0]));
+	w[1] = vmovl_u32(vget_high_u32(z.val[0]));
+	w[2] = vmovl_u32(vget_low_u32(z.val[1]));
+	w[3] = vmovl_u32(vget_high_u32(z.val[1]));
+}
+
+static inline void bs_store_words(u8 *p, const bs_t *w)
+{
+	uint32x4x2_t z = vuzpq_u32(
+		vcombine_u32(vmovn_u64(w[0]), vmovn_u64(w[1])),
+		vcombine_u32(vmovn_u64(w[2]), vmovn_u64(w[3])));
+
+	vst1q_u8(p, vreinterpretq_u8_u32(z.val[0]));
+	vst1q_u8(p + 64, vreinterpretq_u8_u32(z.val[1]));
+}
+
+#include "aesbs_core.h"
+
+void aesbs_encrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src)
+{
+	bs_t q[8];
+
+	aesbs_load(q, src);
+	aesbs_encrypt_core(q, key->rk, key->rounds);
+	aesbs_store(dst, q);
+}
+
+void aesbs_decrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src)
+{
+	bs_t q[8];
+
+	aesbs_load(q, src);
+	aesbs_decrypt_core(q, key->rk, key->rounds);
+	aesbs_store(dst, q);
+}
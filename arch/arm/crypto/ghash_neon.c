@@ -0,0 +1,118 @@
+/*
+ * GHASH using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Built with -mfpu=neon, see ghash_neon.h.
+ *
+ * Blocks are byte reversed into 128-bit integers, so that the first bit
+ * of a block, the coefficient of x^0, is the top bit. The carry-less
+ * product of two such integers is then the bit reflection of the
+ * polynomial product, one bit short, which is made up for by a shift
+ * before reducing modulo x^128 + x^7 + x^2 + x + 1 in the reflected
+ * domain (see Gueron and Kounavis, "Intel Carry-Less Multiplication
+ * Instruction and its Usage for Computing the GCM Mode").
+ */
+
+#include <arm_neon.h>
+
+#include "ghash_neon.h"
+
+/*
+ * Lane i of vmull.p8(a, b << 8k) is a_i * b_(i-k), which belongs at bit
+ * 8 * (2i - k): the whole product vector is just k bytes too high. So is
+ * the one of (a << 8k) and b, and together they give all a_i * b_j with
+ * |i - j| = k.
+ */
+#define CLMUL_DIAG(r, a, b, k)						\
+	r = veorq_u8(r, vextq_u8(veorq_u8(				\
+		vreinterpretq_u8_p16(vmull_p8(a,			\
+			vreinterpret_p8_u8(vext_u8(zero, vreinterpret_u8_p8(b), \
+						   8 - (k))))),	\
+		vreinterpretq_u8_p16(vmull_p8(				\
+			vreinterpret_p8_u8(vext_u8(zero, vreinterpret_u8_p8(a), \
+						   8 - (k))), b))),	\
+		zero16, k))
+
+/* 64x64 -> 128 bit carry-less multiply */
+static inline uint64x2_t clmul64(uint64x1_t x, uint64x1_t y)
+{
+	const uint8x8_t zero = vdup_n_u8(0);
+	const uint8x16_t zero16 = vdupq_n_u8(0);
+	poly8x8_t a = vreinterpret_p8_u64(x), b = vreinterpret_p8_u64(y);
+	uint8x16_t r = vreinterpretq_u8_p16(vmull_p8(a, b));
+
+	CLMUL_DIAG(r, a, b, 1);
+	CLMUL_DIAG(r, a, b, 2);
+	CLMUL_DIAG(r, a, b, 3);
+	CLMUL_DIAG(r, a, b, 4);
+	CLMUL_DIAG(r, a, b, 5);
+	CLMUL_DIAG(r, a, b, 6);
+	CLMUL_DIAG(r, a, b, 7);
+
+	return vreinterpretq_u64_u8(r);
+}
+
+/* shifts the 128-bit integer left by n < 64 */
+#define SHL128(x, n)							\
+	vorrq_u64(vshlq_n_u64(x, n),					\
+		  vextq_u64(vdupq_n_u64(0), vshrq_n_u64(x, 64 - (n)), 1))
+
+/* and right */
+#define SHR128(x, n)							\
+	vorrq_u64(vshrq_n_u64(x, n),					\
+		  vextq_u64(vshlq_n_u64(x, 64 - (n)), vdupq_n_u64(0), 1))
+
+static inline uint64x2_t gf128_mul(uint64x2_t x, uint64x2_t h)
+{
+	uint64x1_t xl = vget_low_u64(x), xh = vget_high_u64(x);
+	uint64x1_t hl = vget_low_u64(h), hh = vget_high_u64(h);
+	uint64x2_t lo, hi, mid, t;
+
+	/* Karatsuba */
+	lo = clmul64(xl, hl);
+	hi = clmul64(xh, hh);
+	mid = clmul64(veor_u64(xl, xh), veor_u64(hl, hh));
+	mid = veorq_u64(mid, veorq_u64(lo, hi));
+	lo = veorq_u64(lo, vextq_u64(vdupq_n_u64(0), mid, 1));
+	hi = veorq_u64(hi, vextq_u64(mid, vdupq_n_u64(0), 1));
+
+	/* the product is one bit short of the reflected one */
+	hi = vorrq_u64(SHL128(hi, 1),
+		       vextq_u64(vshrq_n_u64(lo, 63), vdupq_n_u64(0), 1));
+	lo = SHL128(lo, 1);
+
+	/* fold the low 64 bits, then reduce the low 128 into the high */
+	t = vshlq_n_u64(lo, 63);
+	t = veorq_u64(t, vshlq_n_u64(lo, 62));
+	t = veorq_u64(t, vshlq_n_u64(lo, 57));
+	lo = veorq_u64(lo, vextq_u64(vdupq_n_u64(0), t, 1));
+
+	t = veorq_u64(SHR128(lo, 1), SHR128(lo, 2));
+	t = veorq_u64(t, SHR128(lo, 7));
+	return veorq_u64(hi, veorq_u64(lo, t));
+}
+
+/* bytes b0..b15 to the integer b0 * 2^120 + ... + b15 and back */
+static inline uint64x2_t byte_reverse(uint8x16_t x)
+{
+	x = vrev64q_u8(x);
+	return vreinterpretq_u64_u8(vextq_u8(x, x, 8));
+}
+
+void ghash_neon_update(u8 *dg, const u8 *src, int blocks, const u64 *k)
+{
+	uint64x2_t h = vld1q_u64(k);
+	uint64x2_t x = byte_reverse(vld1q_u8(dg));
+
+	while (blocks--) {
+		x = veorq_u64(x, byte_reverse(vld1q_u8(src)));
+		x = gf128_mul(x, h);
+		src += 16;
+	}
+
+	vst1q_u8(dg, vreinterpretq_u8_u64(byte_reverse(
+		vreinterpretq_u8_u64(x))));
+}
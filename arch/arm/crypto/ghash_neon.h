@@ -0,0 +1,53 @@
+/*
+ * GHASH using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * ARMv7 has no 64-bit carry-less multiply (vmull.p64), so the 128x128
+ * bit products are put together from the 8x8 bit vmull.p8, which has no
+ * data dependent timing, unlike the table based generic code.
+ * ghash_neon.c is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). Also built in user space by
+ * tools/crypto.
+ */
+
+#ifndef _ARM_CRYPTO_GHASH_NEON_H
+#define _ARM_CRYPTO_GHASH_NEON_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint64_t u64;
+#endif
+
+/**
+ * ghash_neon_key() - Converts the 16 byte hash key H
+ *
+ * @k: Receives H as a 128-bit integer, low half first, bit 127 being the
+ *     first bit of the key
+ */
+static inline void ghash_neon_key(u64 *k, const u8 *key)
+{
+	int i;
+
+	k[0] = k[1] = 0;
+	for (i = 0; i < 8; i++) {
+		k[1] = k[1] << 8 | key[i];
+		k[0] = k[0] << 8 | key[i + 8];
+	}
+}
+
+/**
+ * ghash_neon_update() - Runs whole blocks through GHASH
+ *
+ * For each 16 byte block, @dg = (@dg ^ block) * H.
+ */
+void ghash_neon_update(u8 *dg, const u8 *src, int blocks, const u64 *k);
+
+#endif /* _ARM_CRYPTO_GHASH_NEON_H */
@@ -0,0 +1,175 @@
+/*
+ * GHASH using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Buffering as in ghash-generic. Unlike the x86 CLMUL driver there is no
+ * cryptd wrapper: in interrupt context the blocks go through
+ * gf128mul_lle() instead, which is slow but rare.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/hardirq.h>
+#include <linux/string.h>
+#include <crypto/algapi.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/hash.h>
+#include <asm/neon.h>
+
+#include "ghash_neon.h"
+
+#define GHASH_BLOCK_SIZE	16
+#define GHASH_DIGEST_SIZE	16
+
+struct ghash_neon_ctx {
+	u64 k[2];
+	be128 h;
+};
+
+/* xored in to multiply the buffer by H alone */
+static const u8 ghash_zero[GHASH_BLOCK_SIZE];
+
+struct ghash_neon_desc_ctx {
+	u8 buffer[GHASH_BLOCK_SIZE];
+	u32 bytes;
+};
+
+static void ghash_neon_blocks(struct ghash_neon_ctx *ctx, u8 *dg,
+		const u8 *src, int blocks)
+{
+	if (in_interrupt()) {
+		while (blocks--) {
+			crypto_xor(dg, src, GHASH_BLOCK_SIZE);
+			gf128mul_lle((be128 *)dg, &ctx->h);
+			src += GHASH_BLOCK_SIZE;
+		}
+		return;
+	}
+
+	kernel_neon_begin();
+	ghash_neon_update(dg, src, blocks, ctx->k);
+	kernel_neon_end();
+}
+
+static int ghash_neon_init(struct shash_desc *desc)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	memset(dctx, 0, sizeof(*dctx));
+
+	return 0;
+}
+
+static int ghash_neon_setkey(struct crypto_shash *tfm,
+		const u8 *key, unsigned int keylen)
+{
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+
+	ghash_neon_key(ctx->k, key);
+	memcpy(&ctx->h, key, GHASH_BLOCK_SIZE);
+
+	return 0;
+}
+
+static int ghash_neon_update_desc(struct shash_desc *desc,
+		const u8 *src, unsigned int srclen)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(desc->tfm);
+	u8 *dst = dctx->buffer;
+	unsigned int blocks;
+
+	if (dctx->bytes) {
+		int n = min(srclen, dctx->bytes);
+		u8 *pos = dst + (GHASH_BLOCK_SIZE - dctx->bytes);
+
+		dctx->bytes -= n;
+		srclen -= n;
+
+		while (n--)
+			*pos++ ^= *src++;
+
+		if (!dctx->bytes)
+			ghash_neon_blocks(ctx, dst, ghash_zero, 1);
+	}
+
+	/* ghash_neon_update() xors each block into dst itself */
+	blocks = srclen / GHASH_BLOCK_SIZE;
+	if (blocks) {
+		ghash_neon_blocks(ctx, dst, src, blocks);
+		src += blocks * GHASH_BLOCK_SIZE;
+		srclen -= blocks * GHASH_BLOCK_SIZE;
+	}
+
+	if (srclen) {
+		dctx->bytes = GHASH_BLOCK_SIZE - srclen;
+		while (srclen--)
+			*dst++ ^= *src++;
+	}
+
+	return 0;
+}
+
+static int ghash_neon_final(struct shash_desc *desc, u8 *dst)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(desc->tfm);
+	/* the rest of a partial block is zero padded */
+	if (dctx->bytes)
+		ghash_neon_blocks(ctx, dctx->buffer, ghash_zero, 1);
+	dctx->bytes = 0;
+
+	memcpy(dst, dctx->buffer, GHASH_BLOCK_SIZE);
+
+	return 0;
+}
+
+static struct shash_alg ghash_neon_alg = {
+	.digestsize	= GHASH_DIGEST_SIZE,
+	.init		= ghash_neon_init,
+	.update		= ghash_neon_update_desc,
+	.final		= ghash_neon_final,
+	.setkey		= ghash_neon_setkey,
+	.descsize	= sizeof(struct ghash_neon_desc_ctx),
+	.base		= {
+		.cra_name		= "ghash",
+		.cra_driver_name	= "ghash-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= GHASH_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct ghash_neon_ctx),
+		.cra_module		= THIS_MODULE,
+		.cra_list		= LIST_HEAD_INIT(ghash_neon_alg.base.cra_list),
+	},
+};
+
+static int __init ghash_neon_mod_init(void)
+{
+	if (!cpu_has_neon()) {
+		pr_info("ghash-neon: no NEON, not registering\n");
+		return -ENODEV;
+	}
+
+	return crypto_register_shash(&ghash_neon_alg);
+}
+
+static void __exit ghash_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&ghash_neon_alg);
+}
+
+module_init(ghash_neon_mod_init);
+module_exit(ghash_neon_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("GHASH Message Digest Algorithm, NEON accelerated");
+MODULE_ALIAS("ghash");
@@ -0,0 +1,76 @@
+/*
+ * SHA-256 block function using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Built with -mfpu=neon, see sha256_neon.h.
+ */
+
+#include <arm_neon.h>
+
+#include "sha256_neon.h"
+
+#define ROR(x, n)	vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+#define ROR2(x, n)	vsri_n_u32(vshl_n_u32(x, 32 - (n)), x, n)
+
+static inline uint32x4_t sigma0(uint32x4_t x)
+{
+	return veorq_u32(veorq_u32(ROR(x, 7), ROR(x, 18)), vshrq_n_u32(x, 3));
+}
+
+/* sigma1 on two words, the later two depend on the first two */
+static inline uint32x2_t sigma1(uint32x2_t x)
+{
+	return veor_u32(veor_u32(ROR2(x, 17), ROR2(x, 19)), vshr_n_u32(x, 10));
+}
+
+static inline uint32x4_t load_be(const u8 *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+/* W[t..t+3] from the 16 words before, in x0 (oldest) to x3 */
+static inline uint32x4_t schedule(uint32x4_t x0, uint32x4_t x1,
+				  uint32x4_t x2, uint32x4_t x3)
+{
+	uint32x4_t s = vaddq_u32(vaddq_u32(x0, sigma0(vextq_u32(x0, x1, 1))),
+				 vextq_u32(x2, x3, 1));
+	uint32x2_t lo = vadd_u32(vget_low_u32(s), sigma1(vget_high_u32(x3)));
+	uint32x2_t hi = vadd_u32(vget_high_u32(s), sigma1(lo));
+
+	return vcombine_u32(lo, hi);
+}
+
+void sha256_neon_blocks(u32 *state, const u8 *data, int blocks)
+{
+	u32 wk[64];
+	uint32x4_t x0, x1, x2, x3, x4;
+	int t;
+
+	while (blocks--) {
+		x0 = load_be(data);
+		x1 = load_be(data + 16);
+		x2 = load_be(data + 32);
+		x3 = load_be(data + 48);
+
+		for (t = 0; t < 64; t += 4) {
+			vst1q_u32(wk + t, vaddq_u32(x0, vld1q_u32(sha256_k + t)));
+			if (t < 48) {
+				x4 = schedule(x0, x1, x2, x3);
+				x0 = x1;
+				x1 = x2;
+				x2 = x3;
+				x3 = x4;
+			} else {
+				x0 = x1;
+				x1 = x2;
+				x2 = x3;
+			}
+		}
+
+		sha256_rounds(state, wk);
+		data += 64;
+	}
+}
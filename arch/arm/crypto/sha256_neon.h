@@ -0,0 +1,115 @@
+/*
+ * SHA-256 block function using NEON
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * NEON computes the message schedule four words at a time, adding the
+ * round constants, and the rounds, which are serial, stay in ARM
+ * registers. sha256_neon.c is built with -mfpu=neon and must only be
+ * called between kernel_neon_begin() and kernel_neon_end(); the plain C
+ * block function below is used otherwise. Also built in user space by
+ * tools/crypto.
+ */
+
+#ifndef _ARM_CRYPTO_SHA256_NEON_H
+#define _ARM_CRYPTO_SHA256_NEON_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+#endif
+
+static const u32 sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline u32 sha256_ror(u32 x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+/* the 64 rounds, with wk[t] = W[t] + K[t] */
+static inline void sha256_rounds(u32 *state, const u32 *wk)
+{
+	u32 a = state[0], b = state[1], c = state[2], d = state[3];
+	u32 e = state[4], f = state[5], g = state[6], h = state[7];
+	u32 t1, t2;
+	int t;
+
+	for (t = 0; t < 64; t++) {
+		t1 = h + (sha256_ror(e, 6) ^ sha256_ror(e, 11) ^
+			  sha256_ror(e, 25)) + (g ^ (e & (f ^ g))) + wk[t];
+		t2 = (sha256_ror(a, 2) ^ sha256_ror(a, 13) ^
+		      sha256_ror(a, 22)) + ((a & b) | (c & (a | b)));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+static inline void sha256_blocks_c(u32 *state, const u8 *data, int blocks)
+{
+	u32 w[64];
+	int t;
+
+	while (blocks--) {
+		for (t = 0; t < 16; t++)
+			w[t] = (u32)data[4 * t] << 24 | data[4 * t + 1] << 16 |
+				data[4 * t + 2] << 8 | data[4 * t + 3];
+		for (t = 16; t < 64; t++)
+			w[t] = (sha256_ror(w[t - 2], 17) ^
+				sha256_ror(w[t - 2], 19) ^ (w[t - 2] >> 10)) +
+			       w[t - 7] +
+			       (sha256_ror(w[t - 15], 7) ^
+				sha256_ror(w[t - 15], 18) ^ (w[t - 15] >> 3)) +
+			       w[t - 16];
+		for (t = 0; t < 64; t++)
+			w[t] += sha256_k[t];
+
+		sha256_rounds(state, w);
+		data += 64;
+	}
+}
+
+/**
+ * sha256_neon_blocks() - Hashes whole 64 byte blocks into @state
+ */
+void sha256_neon_blocks(u32 *state, const u8 *data, int blocks);
+
+#endif /* _ARM_CRYPTO_SHA256_NEON_H */
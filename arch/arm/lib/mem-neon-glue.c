@@ -0,0 +1,140 @@
+/*
+ *  linux/arch/arm/lib/mem-neon-glue.c
+ *
+ * When memcpy, memset, __memzero and copy_page use NEON
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NEON needs kernel_neon_begin(), which is not allowed in interrupt
+ * context and, if a task's VFP state is live in the registers, has to
+ * save it (and the task then takes a fault to get it back).  So NEON is
+ * used from min_free bytes when the registers are free, and only from
+ * min_busy bytes when they are not.  copy_page, mostly called from the
+ * COW fault of a task that may well be using VFP, never takes them from
+ * a task.  Lengths below NEON_MEM_MIN never get here.  Inside a kernel
+ * mode NEON section it is used directly, clobbering only registers the
+ * caller may not expect to survive a call anyway.
+ */
+#include <linux/module.h>
+#include <linux/hardirq.h>
+#include <linux/preempt.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#include "mem-neon.h"
+
+extern void *__memcpy_neon(void *dest, const void *src, size_t n);
+extern void *__memset_neon(void *s, int c, size_t n);
+extern void __copy_page_neon(void *to, const void *from);
+
+extern void *__memcpy_arm(void *dest, const void *src, size_t n);
+extern void __memset_arm(void *s, int c, size_t n);
+extern void __memzero_arm(void *s, size_t n);
+extern void __copy_page_arm(void *to, const void *from);
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "neon_mem."
+
+static bool enable = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Use NEON for long memcpy, memset and copy_page");
+
+static unsigned int min_free = NEON_MEM_MIN;
+module_param(min_free, uint, 0644);
+MODULE_PARM_DESC(min_free, "Shortest length copied with NEON if it is free");
+
+static unsigned int min_busy = PAGE_SIZE;
+module_param(min_busy, uint, 0644);
+MODULE_PARM_DESC(min_busy, "Shortest length copied with NEON if it is in use");
+
+enum {
+	NEON_MEM_NO,
+	NEON_MEM_BEGUN,
+	NEON_MEM_NESTED,
+};
+
+/*
+ * Whether to use NEON for n bytes, with a task's VFP state to save first
+ * only if may_save.  If so, returns with preemption disabled and NEON
+ * usable, and neon_mem_end() must follow.
+ */
+static int neon_mem_begin(size_t n, bool may_save)
+{
+	if (!enable || n < min_free || !cpu_has_neon() || in_interrupt())
+		return NEON_MEM_NO;
+
+	preempt_disable();
+	switch (kernel_neon_state()) {
+	case KERNEL_NEON_SAVE:
+		if (!may_save || n < min_busy)
+			break;
+		/* fall through */
+	case KERNEL_NEON_FREE:
+		kernel_neon_begin();
+		return NEON_MEM_BEGUN;
+	case KERNEL_NEON_ACTIVE:
+		return NEON_MEM_NESTED;
+	}
+	preempt_enable();
+	return NEON_MEM_NO;
+}
+
+static void neon_mem_end(int how)
+{
+	if (how == NEON_MEM_BEGUN)
+		kernel_neon_end();
+	preempt_enable();
+}
+
+void *memcpy_neon(void *dest, const void *src, size_t n)
+{
+	int how = neon_mem_begin(n, true);
+
+	if (how == NEON_MEM_NO)
+		return __memcpy_arm(dest, src, n);
+	__memcpy_neon(dest, src, n);
+	neon_mem_end(how);
+	return dest;
+}
+
+void *memset_neon(void *s, int c, size_t n)
+{
+	int how = neon_mem_begin(n, true);
+
+	if (how == NEON_MEM_NO) {
+		__memset_arm(s, c, n);
+		return s;
+	}
+	__memset_neon(s, c, n);
+	neon_mem_end(how);
+	return s;
+}
+
+void memzero_neon(void *s, size_t n)
+{
+	int how = neon_mem_begin(n, true);
+
+	if (how == NEON_MEM_NO) {
+		__memzero_arm(s, n);
+		return;
+	}
+	__memset_neon(s, 0, n);
+	neon_mem_end(how);
+}
+
+#ifdef CONFIG_MMU
+void copy_page(void *to, const void *from)
+{
+	int how = neon_mem_begin(PAGE_SIZE, false);
+
+	if (how == NEON_MEM_NO) {
+		__copy_page_arm(to, from);
+		return;
+	}
+	__copy_page_neon(to, from);
+	neon_mem_end(how);
+}
+#endif
@@ -0,0 +1,14 @@
+/*
+ *  linux/arch/arm/lib/mem-neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * memcpy, memset and __memzero hand lengths from this up to the NEON
+ * dispatchers in mem-neon-glue.c, which have the final say; below it
+ * the ARM code runs without further ado.
+ */
+#define NEON_MEM_MIN	512
@@ -202,6 +202,26 @@ void flush_cpu_dcache(void *vaddr, u32 paddr, u32 length, bool inner_only,
 	}
 }
 
+void flush_cpu_dcache_all(bool inner_only)
+{
+	/* Same order as flush_cpu_dcache(), see the comment there */
+	if (!inner_only) {
+		if (is_cache_exclusive())
+			panic("%s can't handle exclusive CPU caches\n",
+								__func__);
+
+		clean_inner_dcache_all();
+		outer_cache.flush_all();
+	}
+
+	flush_inner_dcache_all();
+}
+
+u32 get_dcache_flush_all_breakpoint(bool inner_only)
+{
+	return inner_only ? inner_flush_breakpoint : outer_flush_breakpoint;
+}
+
 bool speculative_data_prefetch(void)
 {
 	return true;
@@ -19,6 +19,10 @@ void clean_cpu_dcache(void *vaddr, u32 paddr, u32 length, bool inner_only,
 						bool *cleaned_everything);
 void flush_cpu_dcache(void *vaddr, u32 paddr, u32 length, bool inner_only,
 						bool *flushed_everything);
+/* Clean and invalidate the whole data cache, outer too unless inner_only */
+void flush_cpu_dcache_all(bool inner_only);
+/* Range length from which flushing everything is cheaper than the range */
+u32 get_dcache_flush_all_breakpoint(bool inner_only);
 bool speculative_data_prefetch(void);
 /* Returns 1 if no cache is present */
 u32 get_dcache_granularity(void);
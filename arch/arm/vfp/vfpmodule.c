@@ -17,8 +17,10 @@
 #include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
+#include <linux/hardirq.h>
 
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
 
@@ -508,6 +510,85 @@ void vfp_flush_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel-side NEON support functions
+ */
+void kernel_neon_begin(void)
+{
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled. This will make sure that the kernel
+	 * mode NEON register contents never need to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	/*
+	 * Save the userland NEON/VFP state. Under UP,
+	 * the owner could be a task other than 'current'
+	 */
+	if (vfp_current_hw_state[cpu] == &thread->vfpstate)
+		vfp_save_state(&thread->vfpstate, fpexc);
+#ifndef CONFIG_SMP
+	else if (vfp_current_hw_state[cpu] != NULL)
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+	vfp_current_hw_state[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable the NEON/VFP unit. */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+/*
+ * What kernel_neon_begin() would cost on this CPU right now, for code
+ * that can do its job without NEON too and only wants it when it is
+ * cheap: nothing, a save of a task's VFP state (which the task then has
+ * to fault back in), or nothing at all because a kernel mode NEON
+ * section is already open further up the stack.  In the last case the
+ * caller must not begin another one, but may use the registers the
+ * AAPCS lets a callee clobber (d0-d7 and d16-d31).
+ *
+ * On SMP the state of a task is saved when it is switched out, so the
+ * registers only hold something unsaved while current owns them and
+ * VFP is enabled.  On UP any owner's state is live.
+ *
+ * Must be called with preemption disabled.
+ */
+enum kernel_neon_state kernel_neon_state(void)
+{
+	unsigned int cpu = smp_processor_id();
+	union vfp_state *owner = vfp_current_hw_state[cpu];
+	u32 fpexc = fmrx(FPEXC);
+
+	if (!owner)
+		return (fpexc & FPEXC_EN) ? KERNEL_NEON_ACTIVE :
+					    KERNEL_NEON_FREE;
+#ifdef CONFIG_SMP
+	if (owner != &current_thread_info()->vfpstate ||
+	    !(fpexc & FPEXC_EN))
+		return KERNEL_NEON_FREE;
+#endif
+	return KERNEL_NEON_SAVE;
+}
+EXPORT_SYMBOL(kernel_neon_state);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 /*
  * VFP hardware can lose all context when a CPU goes offline.
  * As we will be running in SMP mode with CPU hotplug, we will save the
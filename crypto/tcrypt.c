@@ -64,7 +64,7 @@ static char *check[] = {
 	"cast6", "arc4", "michael_mic", "deflate", "crc32c", "tea", "xtea",
 	"khazad", "wp512", "wp384", "wp256", "tnepres", "xeta",  "fcrypt",
 	"camellia", "seed", "salsa20", "rmd128", "rmd160", "rmd256", "rmd320",
-	"lzo", "cts", "zlib", NULL
+	"lzo", "cts", "zlib", "lz4", NULL
 };
 
 static int test_cipher_jiffies(struct blkcipher_desc *desc, int enc,
@@ -719,6 +719,167 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+/*
+ * Used by test_comp_speed(): block sizes, up to the page that zram and
+ * zcache compress, and text made of a few words, which LZ compressors
+ * shrink to about half, like typical anonymous memory.
+ */
+static unsigned int comp_block_sizes[] = { 256, 1024, PAGE_SIZE, 0 };
+
+static void test_comp_fill(u8 *buf, unsigned int len)
+{
+	static const char * const words[] = {
+		"the ", "page ", "cache ", "swap ", "of ", "and ", "\n",
+		"compressed ", "0x0000 ", "struct ", "return ",
+	};
+	u32 rnd = 1;
+	unsigned int i, n;
+	const char *w;
+
+	for (i = 0; i < len; i += n) {
+		rnd = rnd * 1103515245 + 12345;
+		w = words[(rnd >> 16) % ARRAY_SIZE(words)];
+		n = min_t(unsigned int, strlen(w), len - i);
+		memcpy(buf + i, w, n);
+	}
+}
+
+static inline int do_one_comp_op(struct crypto_comp *tfm, int enc,
+				 const u8 *src, unsigned int slen, u8 *dst,
+				 unsigned int *dlen)
+{
+	*dlen = PAGE_SIZE;
+	if (enc)
+		return crypto_comp_compress(tfm, src, slen, dst, dlen);
+	return crypto_comp_decompress(tfm, src, slen, dst, dlen);
+}
+
+static int test_comp_jiffies(struct crypto_comp *tfm, int enc, const u8 *src,
+			     unsigned int slen, u8 *dst, unsigned int blen,
+			     int sec)
+{
+	unsigned long start, end;
+	unsigned int dlen;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_one_comp_op(tfm, enc, src, slen, dst, &dlen);
+		if (ret)
+			return ret;
+	}
+
+	printk("%6u opers/sec, %9lu bytes/sec\n",
+	       bcount / sec, ((long)bcount * blen) / sec);
+
+	return 0;
+}
+
+static int test_comp_cycles(struct crypto_comp *tfm, int enc, const u8 *src,
+			    unsigned int slen, u8 *dst, unsigned int blen)
+{
+	unsigned long cycles = 0;
+	unsigned int dlen;
+	int ret = 0;
+	int i;
+
+	local_bh_disable();
+	local_irq_disable();
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = do_one_comp_op(tfm, enc, src, slen, dst, &dlen);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+		ret = do_one_comp_op(tfm, enc, src, slen, dst, &dlen);
+		end = get_cycles();
+
+		if (ret)
+			goto out;
+
+		cycles += end - start;
+	}
+
+out:
+	local_irq_enable();
+	local_bh_enable();
+
+	if (ret == 0)
+		printk("%6lu cycles/operation, %4lu cycles/byte\n",
+		       cycles / 8, cycles / (8 * blen));
+
+	return ret;
+}
+
+/*
+ * Compression and decompression speed of blocks of text; the bytes per
+ * second are uncompressed bytes both ways.
+ */
+static void test_comp_speed(const char *algo, unsigned int sec)
+{
+	struct crypto_comp *tfm;
+	u8 *src = (u8 *)tvmem[0], *comp = (u8 *)tvmem[1];
+	u8 *out = (u8 *)tvmem[2];
+	unsigned int blen, clen, dlen;
+	int i, ret = 0;
+
+	printk(KERN_INFO "\ntesting speed of %s\n", algo);
+
+	tfm = crypto_alloc_comp(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	test_comp_fill(src, PAGE_SIZE);
+	for (i = 0; comp_block_sizes[i] != 0; i++) {
+		blen = comp_block_sizes[i];
+
+		ret = do_one_comp_op(tfm, 1, src, blen, comp, &clen);
+		if (!ret)
+			ret = do_one_comp_op(tfm, 0, comp, clen, out, &dlen);
+		if (ret || dlen != blen || memcmp(src, out, blen)) {
+			printk(KERN_ERR "%s: round trip of %u bytes failed\n",
+			       algo, blen);
+			break;
+		}
+
+		printk(KERN_INFO "test%3u (%5u byte blocks,%5u compressed): "
+		       "compress   ", i, blen, clen);
+		if (sec)
+			ret = test_comp_jiffies(tfm, 1, src, blen, comp, blen,
+						sec);
+		else
+			ret = test_comp_cycles(tfm, 1, src, blen, comp, blen);
+		if (ret)
+			break;
+
+		printk(KERN_INFO "test%3u (%5u byte blocks,%5u compressed): "
+		       "decompress ", i, blen, clen);
+		if (sec)
+			ret = test_comp_jiffies(tfm, 0, comp, clen, out, blen,
+						sec);
+		else
+			ret = test_comp_cycles(tfm, 0, comp, clen, out, blen);
+		if (ret)
+			break;
+	}
+
+	if (ret)
+		printk(KERN_ERR "compression failed ret=%d\n", ret);
+
+	crypto_free_comp(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -944,6 +1105,10 @@ static int do_test(int m)
 		ret += tcrypt_test("rfc4309(ccm(aes))");
 		break;
 
+	case 46:
+		ret += tcrypt_test("lz4");
+		break;
+
 	case 100:
 		ret += tcrypt_test("hmac(md5)");
 		break;
@@ -1231,6 +1396,24 @@ static int do_test(int m)
 	case 499:
 		break;
 
+	case 500:
+		/* fall through */
+
+	case 501:
+		test_comp_speed("deflate", sec);
+		if (mode > 500 && mode < 600) break;
+
+	case 502:
+		test_comp_speed("lzo", sec);
+		if (mode > 500 && mode < 600) break;
+
+	case 503:
+		test_comp_speed("lz4", sec);
+		if (mode > 500 && mode < 600) break;
+
+	case 599:
+		break;
+
 	case 1000:
 		test_available();
 		break;
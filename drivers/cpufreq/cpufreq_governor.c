@@ -0,0 +1,359 @@
+/*
+ * drivers/cpufreq/cpufreq_governor.c
+ *
+ * Common sampling core shared by the timer-driven cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The interactive, smartassV2, sakuractive and abyssplug governors all
+ * used to carry their own copy of the idle time accounting, the deferrable
+ * sampling timer and (for interactive) the touchscreen input handler. This
+ * file holds the one copy of each:
+ *
+ *  - cpufreq_gov_load_*():  busy percentage of a CPU from the NO_HZ idle
+ *    and iowait counters, with io_is_busy handled in a single place.
+ *  - cpufreq_gov_sampler_*():  a per-policy deferrable delayed work that
+ *    computes the load of every CPU of the policy once per period and
+ *    hands max/total load to the governor's ->sample() plug-in.
+ *  - cpufreq_gov_*_booster():  a single input handler fanning SYN_REPORTs
+ *    out to every registered boost hook.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+
+#include "cpufreq_governor.h"
+
+static DEFINE_PER_CPU(struct cpufreq_gov_load, gov_load);
+
+static struct workqueue_struct *gov_wq;
+
+/************************** load accounting ************************/
+
+void cpufreq_gov_load_snapshot(unsigned int cpu, struct cpufreq_gov_load *snap)
+{
+	u64 iowait;
+
+	snap->idle = get_cpu_idle_time_us(cpu, &snap->wall);
+	iowait = get_cpu_iowait_time_us(cpu, NULL);
+	snap->iowait = iowait == -1ULL ? 0 : iowait;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_load_snapshot);
+
+/*
+ * Busy percentage over an interval of @wall usecs of which @idle were spent
+ * idle, @iowait of those with I/O outstanding. With io_is_busy set the
+ * iowait part counts as busy time.
+ */
+unsigned int cpufreq_gov_calc_load(u64 wall, u64 idle, u64 iowait,
+				   unsigned int io_is_busy)
+{
+	u64 busy;
+
+	if (io_is_busy && idle >= iowait)
+		idle -= iowait;
+
+	if (!wall || idle >= wall)
+		return 0;
+
+	busy = div64_u64(100 * (wall - idle), wall);
+	return (unsigned int)busy;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_calc_load);
+
+/*
+ * Load of @cpu since the snapshot in @prev, which is advanced to now.
+ */
+unsigned int cpufreq_gov_load_update(unsigned int cpu,
+				     struct cpufreq_gov_load *prev,
+				     unsigned int io_is_busy)
+{
+	struct cpufreq_gov_load now;
+	unsigned int load;
+
+	cpufreq_gov_load_snapshot(cpu, &now);
+	load = cpufreq_gov_calc_load(now.wall - prev->wall,
+				     now.idle - prev->idle,
+				     now.iowait - prev->iowait, io_is_busy);
+	*prev = now;
+
+	return load;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_load_update);
+
+/*
+ * Restart the sampler's load window of @cpu, e.g. after a tunable change
+ * made the previous interval meaningless.
+ */
+void cpufreq_gov_load_reset(unsigned int cpu)
+{
+	cpufreq_gov_load_snapshot(cpu, &per_cpu(gov_load, cpu));
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_load_reset);
+
+/************************** sampler ************************/
+
+static void cpufreq_gov_sample_work(struct work_struct *work)
+{
+	struct cpufreq_gov_sampler *s =
+		container_of(work, struct cpufreq_gov_sampler, work.work);
+	unsigned int max_load = 0;
+	unsigned int total_load = 0;
+	unsigned int load;
+	unsigned int delay;
+	unsigned int j;
+
+	mutex_lock(&s->timer_mutex);
+
+	for_each_cpu(j, s->policy->cpus) {
+		load = cpufreq_gov_load_update(j, &per_cpu(gov_load, j),
+					       s->io_is_busy);
+		total_load += load;
+		if (load > max_load)
+			max_load = load;
+	}
+
+	delay = s->ops->sample(s, max_load, total_load);
+	if (!delay)
+		delay = s->rate;
+
+	queue_delayed_work_on(s->cpu, gov_wq, &s->work,
+			      usecs_to_jiffies(delay));
+	mutex_unlock(&s->timer_mutex);
+}
+
+/*
+ * Start sampling @policy. s->ops, s->rate, s->io_is_busy and s->data must
+ * be set up by the caller. The first sample is taken @first_delay usecs
+ * from now, rounded so that all policies sample on the same jiffy.
+ */
+int cpufreq_gov_sampler_start(struct cpufreq_gov_sampler *s,
+			      struct cpufreq_policy *policy,
+			      unsigned int first_delay)
+{
+	unsigned int j;
+	int delay;
+
+	if (!gov_wq || !s->ops || !s->ops->sample || !s->rate)
+		return -EINVAL;
+
+	s->policy = policy;
+	s->cpu = policy->cpu;
+	mutex_init(&s->timer_mutex);
+
+	for_each_cpu(j, policy->cpus)
+		cpufreq_gov_load_reset(j);
+
+	delay = usecs_to_jiffies(first_delay ? first_delay : s->rate);
+	if (delay > 1)
+		delay -= jiffies % delay;
+
+	INIT_DELAYED_WORK_DEFERRABLE(&s->work, cpufreq_gov_sample_work);
+	queue_delayed_work_on(s->cpu, gov_wq, &s->work, delay);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_sampler_start);
+
+void cpufreq_gov_sampler_stop(struct cpufreq_gov_sampler *s)
+{
+	cancel_delayed_work_sync(&s->work);
+	mutex_destroy(&s->timer_mutex);
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_sampler_stop);
+
+/* CPUFREQ_GOV_LIMITS handling common to all sampling governors */
+void cpufreq_gov_sampler_limits(struct cpufreq_gov_sampler *s,
+				struct cpufreq_policy *policy)
+{
+	mutex_lock(&s->timer_mutex);
+	if (policy->max < s->policy->cur)
+		__cpufreq_driver_target(s->policy, policy->max,
+					CPUFREQ_RELATION_H);
+	else if (policy->min > s->policy->cur)
+		__cpufreq_driver_target(s->policy, policy->min,
+					CPUFREQ_RELATION_L);
+	mutex_unlock(&s->timer_mutex);
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_sampler_limits);
+
+/************************** input boost ************************/
+
+static LIST_HEAD(booster_list);
+static DEFINE_MUTEX(booster_mutex);
+
+#ifdef CONFIG_INPUT
+
+struct cpufreq_gov_input_handle {
+	struct input_handle handle;
+	struct work_struct open_work;
+	bool opened;		/* set by open_work */
+};
+
+static void cpufreq_gov_input_event(struct input_handle *handle,
+				    unsigned int type,
+				    unsigned int code, int value)
+{
+	struct cpufreq_gov_booster *b;
+
+	if (type != EV_SYN || code != SYN_REPORT)
+		return;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(b, &booster_list, node)
+		b->boost(b);
+	rcu_read_unlock();
+}
+
+/*
+ * input_open_device() may sleep; connect runs under the input mutex. A
+ * handle that fails to open stays registered, without events, until
+ * disconnect frees it: freeing it here would race with disconnect.
+ */
+static void cpufreq_gov_input_open(struct work_struct *w)
+{
+	struct cpufreq_gov_input_handle *gh =
+		container_of(w, struct cpufreq_gov_input_handle, open_work);
+
+	gh->opened = !input_open_device(&gh->handle);
+}
+
+static int cpufreq_gov_input_connect(struct input_handler *handler,
+				     struct input_dev *dev,
+				     const struct input_device_id *id)
+{
+	struct cpufreq_gov_input_handle *gh;
+	int error;
+
+	gh = kzalloc(sizeof(*gh), GFP_KERNEL);
+	if (!gh)
+		return -ENOMEM;
+
+	gh->handle.dev = dev;
+	gh->handle.handler = handler;
+	gh->handle.name = "cpufreq_gov";
+
+	error = input_register_handle(&gh->handle);
+	if (error) {
+		kfree(gh);
+		return error;
+	}
+
+	INIT_WORK(&gh->open_work, cpufreq_gov_input_open);
+	schedule_work(&gh->open_work);
+	return 0;
+}
+
+static void cpufreq_gov_input_disconnect(struct input_handle *handle)
+{
+	struct cpufreq_gov_input_handle *gh =
+		container_of(handle, struct cpufreq_gov_input_handle, handle);
+
+	cancel_work_sync(&gh->open_work);
+	if (gh->opened)
+		input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(gh);
+}
+
+static const struct input_device_id cpufreq_gov_input_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	}, /* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	}, /* touchpad */
+	{ },
+};
+
+static struct input_handler cpufreq_gov_input_handler = {
+	.event		= cpufreq_gov_input_event,
+	.connect	= cpufreq_gov_input_connect,
+	.disconnect	= cpufreq_gov_input_disconnect,
+	.name		= "cpufreq_gov",
+	.id_table	= cpufreq_gov_input_ids,
+};
+
+static int cpufreq_gov_input_register(void)
+{
+	return input_register_handler(&cpufreq_gov_input_handler);
+}
+
+static void cpufreq_gov_input_unregister(void)
+{
+	input_unregister_handler(&cpufreq_gov_input_handler);
+}
+
+#else
+
+static inline int cpufreq_gov_input_register(void) { return 0; }
+static inline void cpufreq_gov_input_unregister(void) { }
+
+#endif /* CONFIG_INPUT */
+
+/*
+ * The input handler is only registered while somebody listens, so input
+ * events cost nothing when no boosting governor is active.
+ */
+int cpufreq_gov_register_booster(struct cpufreq_gov_booster *b)
+{
+	int rc = 0;
+
+	mutex_lock(&booster_mutex);
+	if (list_empty(&booster_list)) {
+		rc = cpufreq_gov_input_register();
+		if (rc) {
+			pr_warn("%s: failed to register input handler\n",
+				__func__);
+			goto out;
+		}
+	}
+	list_add_tail_rcu(&b->node, &booster_list);
+out:
+	mutex_unlock(&booster_mutex);
+	return rc;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_register_booster);
+
+void cpufreq_gov_unregister_booster(struct cpufreq_gov_booster *b)
+{
+	mutex_lock(&booster_mutex);
+	list_del_rcu(&b->node);
+	if (list_empty(&booster_list))
+		cpufreq_gov_input_unregister();
+	mutex_unlock(&booster_mutex);
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_unregister_booster);
+
+static int __init cpufreq_gov_common_init(void)
+{
+	gov_wq = alloc_workqueue("kcpufreq_gov", 0, 0);
+	if (!gov_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+core_initcall(cpufreq_gov_common_init);
@@ -0,0 +1,86 @@
+/*
+ * drivers/cpufreq/cpufreq_governor.h
+ *
+ * Common sampling core shared by the timer-driven cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _CPUFREQ_GOVERNOR_H
+#define _CPUFREQ_GOVERNOR_H
+
+#include <linux/cpufreq.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/types.h>
+#include <linux/workqueue.h>
+
+/*
+ * Idle accounting snapshot of one CPU, all in microseconds. Idle time as
+ * reported by the tick code includes time spent waiting for I/O.
+ */
+struct cpufreq_gov_load {
+	u64 wall;
+	u64 idle;
+	u64 iowait;
+};
+
+struct cpufreq_gov_sampler;
+
+/*
+ * Policy plug-in. ->sample() is called once per sampling period, with the
+ * sampler's timer_mutex held, after the load of every CPU of the policy has
+ * been computed. It returns the delay in usecs until the next sample, or 0
+ * to use s->rate.
+ */
+struct cpufreq_gov_ops {
+	unsigned int (*sample)(struct cpufreq_gov_sampler *s,
+			       unsigned int max_load, unsigned int total_load);
+};
+
+struct cpufreq_gov_sampler {
+	struct cpufreq_policy *policy;
+	const struct cpufreq_gov_ops *ops;
+	struct delayed_work work;
+	int cpu;
+	/*
+	 * Serializes governor limit changes with the sampling work. We do
+	 * not want ->sample() to run while the limits are being changed.
+	 */
+	struct mutex timer_mutex;
+	unsigned int rate;		/* sampling period, usecs */
+	unsigned int io_is_busy;	/* count iowait as busy time */
+	void *data;			/* plug-in private */
+};
+
+/*
+ * Input boost hook. ->boost() is called from the input event path, in
+ * atomic context, on every SYN_REPORT of a touchscreen/pointer device.
+ */
+struct cpufreq_gov_booster {
+	void (*boost)(struct cpufreq_gov_booster *b);
+	struct list_head node;
+};
+
+extern void cpufreq_gov_load_snapshot(unsigned int cpu,
+				      struct cpufreq_gov_load *snap);
+extern unsigned int cpufreq_gov_calc_load(u64 wall, u64 idle, u64 iowait,
+					  unsigned int io_is_busy);
+extern unsigned int cpufreq_gov_load_update(unsigned int cpu,
+					    struct cpufreq_gov_load *prev,
+					    unsigned int io_is_busy);
+
+extern int cpufreq_gov_sampler_start(struct cpufreq_gov_sampler *s,
+				     struct cpufreq_policy *policy,
+				     unsigned int first_delay);
+extern void cpufreq_gov_sampler_stop(struct cpufreq_gov_sampler *s);
+extern void cpufreq_gov_sampler_limits(struct cpufreq_gov_sampler *s,
+				       struct cpufreq_policy *policy);
+extern void cpufreq_gov_load_reset(unsigned int cpu);
+
+extern int cpufreq_gov_register_booster(struct cpufreq_gov_booster *b);
+extern void cpufreq_gov_unregister_booster(struct cpufreq_gov_booster *b);
+
+#endif /* _CPUFREQ_GOVERNOR_H */
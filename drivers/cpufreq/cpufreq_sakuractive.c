@@ -33,6 +33,8 @@
 #include <linux/err.h>
 #include <linux/slab.h>
 
+#include "cpufreq_governor.h"
+
 /* greater than 80% avg load across online CPUs increases frequency */
 #define DEFAULT_UP_FREQ_MIN_LOAD			(80)
 
@@ -51,7 +53,6 @@
 /* default number of sampling periods to average before hotplug-out decision */
 #define DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS		(20)
 
-static void do_dbs_timer(struct work_struct *work);
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		unsigned int event);
 //static int hotplug_boost(struct cpufreq_policy *policy);
@@ -66,22 +67,14 @@ struct cpufreq_governor cpufreq_gov_sakuractive = {
 };
 
 struct cpu_dbs_info_s {
-	cputime64_t prev_cpu_idle;
-	cputime64_t prev_cpu_wall;
 	cputime64_t prev_cpu_nice;
 	struct cpufreq_policy *cur_policy;
-	struct delayed_work work;
+	struct cpufreq_gov_sampler sampler;
 	struct work_struct cpu_up_work;
 	struct work_struct cpu_down_work;
 	struct cpufreq_frequency_table *freq_table;
 	int cpu;
 	unsigned int boost_applied;
-	/*
-	 * percpu mutex that serializes governor limit change with
-	 * do_dbs_timer invocation. We do not want do_dbs_timer to run
-	 * when user is changing the governor or limits.
-	 */
-	struct mutex timer_mutex;
 };
 static DEFINE_PER_CPU(struct cpu_dbs_info_s, hp_cpu_dbs_info);
 
@@ -120,32 +113,6 @@ static struct dbs_tuners {
 	.boost_timeout = 0,
 };
 
-/*
- * A corner case exists when switching io_is_busy at run-time: comparing idle
- * times from a non-io_is_busy period to an io_is_busy period (or vice-versa)
- * will misrepresent the actual change in system idleness.  We ignore this
- * corner case: enabling io_is_busy might cause freq increase and disabling
- * might cause freq decrease, which probably matches the original intent.
- */
-static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
-{
-        u64 idle_time;
-        u64 iowait_time;
-
-        /* cpufreq-sakuractive always assumes CONFIG_NO_HZ */
-        idle_time = get_cpu_idle_time_us(cpu, wall);
-
-	/* add time spent doing I/O to idle time */
-        if (dbs_tuners_ins.io_is_busy) {
-                iowait_time = get_cpu_iowait_time_us(cpu, wall);
-                /* cpufreq-sakuractive always assumes CONFIG_NO_HZ */
-                if (iowait_time != -1ULL && idle_time >= iowait_time)
-                        idle_time -= iowait_time;
-        }
-
-        return idle_time;
-}
-
 /************************** sysfs interface ************************/
 
 /* XXX look at global sysfs macros in cpufreq.h, can those be used here? */
@@ -372,12 +339,11 @@ static ssize_t store_ignore_nice_load(struct kobject *a, struct attribute *b,
 	}
 	dbs_tuners_ins.ignore_nice = input;
 
-	/* we need to re-evaluate prev_cpu_idle */
+	/* we need to re-evaluate the load window */
 	for_each_online_cpu(j) {
 		struct cpu_dbs_info_s *dbs_info;
 		dbs_info = &per_cpu(hp_cpu_dbs_info, j);
-		dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-						&dbs_info->prev_cpu_wall);
+		cpufreq_gov_load_reset(j);
 		if (dbs_tuners_ins.ignore_nice)
 			dbs_info->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
 
@@ -434,12 +400,9 @@ static struct attribute_group dbs_attr_group = {
 
 /************************** sysfs end ************************/
 
-static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
+static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info,
+			  unsigned int max_load, unsigned int total_load)
 {
-	/* combined load of all enabled CPUs */
-	unsigned int total_load = 0;
-	/* single largest CPU load percentage*/
-	unsigned int max_load = 0;
 	/* largest CPU load in terms of frequency */
 	unsigned int max_load_freq = 0;
 	/* average load across all enabled CPUs */
@@ -455,45 +418,6 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 
 	policy = this_dbs_info->cur_policy;
 
-	/*
-	 * cpu load accounting
-	 * get highest load, total load and average load across all CPUs
-	 */
-	for_each_cpu(j, policy->cpus) {
-		unsigned int load;
-		unsigned int idle_time, wall_time;
-		cputime64_t cur_wall_time, cur_idle_time;
-		struct cpu_dbs_info_s *j_dbs_info;
-
-		j_dbs_info = &per_cpu(hp_cpu_dbs_info, j);
-
-		/* update both cur_idle_time and cur_wall_time */
-		cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
-
-		/* how much wall time has passed since last iteration? */
-		wall_time = (unsigned int) cputime64_sub(cur_wall_time,
-				j_dbs_info->prev_cpu_wall);
-		j_dbs_info->prev_cpu_wall = cur_wall_time;
-
-		/* how much idle time has passed since last iteration? */
-		idle_time = (unsigned int) cputime64_sub(cur_idle_time,
-				j_dbs_info->prev_cpu_idle);
-		j_dbs_info->prev_cpu_idle = cur_idle_time;
-
-		if (unlikely(!wall_time || wall_time < idle_time))
-			continue;
-
-		/* load is the percentage of time not spent in idle */
-		load = 100 * (wall_time - idle_time) / wall_time;
-
-		/* keep track of combined load across all CPUs */
-		total_load += load;
-
-		/* keep track of highest single load across all CPUs */
-		if (load > max_load)
-			max_load = load;
-	}
-
 	/* use the max load in the OPP freq change policy */
 	max_load_freq = max_load * policy->cur;
 
@@ -607,47 +531,53 @@ static void do_cpu_down(struct work_struct *work)
 	cpu_down(1);
 }
 
-static void do_dbs_timer(struct work_struct *work)
+/*
+ * Sampler plug-in: the common core has already computed the load of every
+ * CPU of the policy; decide on frequency and hotplug.
+ */
+static unsigned int dbs_sample(struct cpufreq_gov_sampler *s,
+			       unsigned int max_load, unsigned int total_load)
 {
-	struct cpu_dbs_info_s *dbs_info =
-		container_of(work, struct cpu_dbs_info_s, work.work);
-	unsigned int cpu = dbs_info->cpu;
-	int delay = 0;
+	struct cpu_dbs_info_s *dbs_info = s->data;
+
+	s->rate = dbs_tuners_ins.sampling_rate;
+	s->io_is_busy = dbs_tuners_ins.io_is_busy;
 
-	mutex_lock(&dbs_info->timer_mutex);
 	if (!dbs_info->boost_applied) {
-	    dbs_check_cpu(dbs_info);
-		/* We want all related CPUs to do sampling nearly on same jiffy */
-		delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
-	} else {
-		delay = usecs_to_jiffies(dbs_tuners_ins.boost_timeout);
-		dbs_info->boost_applied = 0;
-		if (num_online_cpus() < 2)
-			queue_work_on(cpu, khotplug_wq,
-						&dbs_info->cpu_up_work);
+		dbs_check_cpu(dbs_info, max_load, total_load);
+		return 0;
 	}
-	queue_delayed_work_on(cpu, khotplug_wq, &dbs_info->work, delay);
-	mutex_unlock(&dbs_info->timer_mutex);
+
+	dbs_info->boost_applied = 0;
+	if (num_online_cpus() < 2)
+		queue_work_on(dbs_info->cpu, khotplug_wq,
+			      &dbs_info->cpu_up_work);
+	return dbs_tuners_ins.boost_timeout;
 }
 
-static inline void dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
+static const struct cpufreq_gov_ops dbs_ops = {
+	.sample = dbs_sample,
+};
+
+static inline int dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
 {
-	/* We want all related CPUs to do sampling nearly on same jiffy */
-	int delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
-	delay -= jiffies % delay;
+	struct cpufreq_gov_sampler *s = &dbs_info->sampler;
 
-	INIT_DELAYED_WORK_DEFERRABLE(&dbs_info->work, do_dbs_timer);
 	INIT_WORK(&dbs_info->cpu_up_work, do_cpu_up);
 	INIT_WORK(&dbs_info->cpu_down_work, do_cpu_down);
-	if (!dbs_info->boost_applied)
-		delay = usecs_to_jiffies(dbs_tuners_ins.boost_timeout);
-	queue_delayed_work_on(dbs_info->cpu, khotplug_wq, &dbs_info->work,
-		delay);
+
+	s->ops = &dbs_ops;
+	s->rate = dbs_tuners_ins.sampling_rate;
+	s->io_is_busy = dbs_tuners_ins.io_is_busy;
+	s->data = dbs_info;
+
+	return cpufreq_gov_sampler_start(s, dbs_info->cur_policy,
+					 dbs_tuners_ins.boost_timeout);
 }
 
 static inline void dbs_timer_exit(struct cpu_dbs_info_s *dbs_info)
 {
-	cancel_delayed_work_sync(&dbs_info->work);
+	cpufreq_gov_sampler_stop(&dbs_info->sampler);
 }
 
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
@@ -672,25 +602,25 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 			j_dbs_info = &per_cpu(hp_cpu_dbs_info, j);
 			j_dbs_info->cur_policy = policy;
 
-			j_dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-						&j_dbs_info->prev_cpu_wall);
 			if (dbs_tuners_ins.ignore_nice) {
 				j_dbs_info->prev_cpu_nice =
 						kstat_cpu(j).cpustat.nice;
 			}
+		}
 
-			max_periods = max(DEFAULT_HOTPLUG_IN_SAMPLING_PERIODS,
-					DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS);
-			dbs_tuners_ins.hotplug_load_history = kmalloc(
-					(sizeof(unsigned int) * max_periods),
-					GFP_KERNEL);
-			if (!dbs_tuners_ins.hotplug_load_history) {
-				WARN_ON(1);
-				return -ENOMEM;
-			}
-			for (i = 0; i < max_periods; i++)
-				dbs_tuners_ins.hotplug_load_history[i] = 50;
+		max_periods = max(DEFAULT_HOTPLUG_IN_SAMPLING_PERIODS,
+				DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS);
+		dbs_tuners_ins.hotplug_load_history = kmalloc(
+				(sizeof(unsigned int) * max_periods),
+				GFP_KERNEL);
+		if (!dbs_tuners_ins.hotplug_load_history) {
+			WARN_ON(1);
+			rc = -ENOMEM;
+			goto err_enable;
 		}
+		for (i = 0; i < max_periods; i++)
+			dbs_tuners_ins.hotplug_load_history[i] = 50;
+
 		this_dbs_info->cpu = cpu;
 		this_dbs_info->freq_table = cpufreq_frequency_get_table(cpu);
 		/*
@@ -700,24 +630,27 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		if (dbs_enable == 1) {
 			rc = sysfs_create_group(cpufreq_global_kobject,
 						&dbs_attr_group);
-			if (rc) {
-				mutex_unlock(&dbs_mutex);
-				return rc;
-			}
+			if (rc)
+				goto err_history;
 		}
 		if (!dbs_tuners_ins.boost_timeout)
 			dbs_tuners_ins.boost_timeout =  dbs_tuners_ins.sampling_rate * 30;
 		mutex_unlock(&dbs_mutex);
 
-		mutex_init(&this_dbs_info->timer_mutex);
-		dbs_timer_init(this_dbs_info);
+		rc = dbs_timer_init(this_dbs_info);
+		if (rc) {
+			mutex_lock(&dbs_mutex);
+			if (dbs_enable == 1)
+				sysfs_remove_group(cpufreq_global_kobject,
+						   &dbs_attr_group);
+			goto err_history;
+		}
 		break;
 
 	case CPUFREQ_GOV_STOP:
 		dbs_timer_exit(this_dbs_info);
 
 		mutex_lock(&dbs_mutex);
-		mutex_destroy(&this_dbs_info->timer_mutex);
 		dbs_enable--;
 		mutex_unlock(&dbs_mutex);
 		if (!dbs_enable)
@@ -732,17 +665,19 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		break;
 
 	case CPUFREQ_GOV_LIMITS:
-		mutex_lock(&this_dbs_info->timer_mutex);
-		if (policy->max < this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->max, CPUFREQ_RELATION_H);
-		else if (policy->min > this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->min, CPUFREQ_RELATION_L);
-		mutex_unlock(&this_dbs_info->timer_mutex);
+		cpufreq_gov_sampler_limits(&this_dbs_info->sampler, policy);
 		break;
 	}
 	return 0;
+
+	/* GOV_START failed: undo it with dbs_mutex held */
+err_history:
+	kfree(dbs_tuners_ins.hotplug_load_history);
+	dbs_tuners_ins.hotplug_load_history = NULL;
+err_enable:
+	dbs_enable--;
+	mutex_unlock(&dbs_mutex);
+	return rc;
 }
 
 #if 0
@@ -759,11 +694,11 @@ static int hotplug_boost(struct cpufreq_policy *policy)
 		return;
 #endif
 
-	mutex_lock(&this_dbs_info->timer_mutex);
+	mutex_lock(&this_dbs_info->sampler.timer_mutex);
 	this_dbs_info->boost_applied = 1;
 	__cpufreq_driver_target(policy, policy->max,
 		CPUFREQ_RELATION_H);
-	mutex_unlock(&this_dbs_info->timer_mutex);
+	mutex_unlock(&this_dbs_info->sampler.timer_mutex);
 
 	return 0;
 }
@@ -0,0 +1,564 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * Scheduler-driven cpufreq governor.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Instead of sampling idle time from a timer, this governor is told the
+ * utilisation of each CPU by the fair scheduling class whenever a task is
+ * enqueued, dequeued or ticked (see kernel/sched_fair.c). The decision is
+ * made right there, under the runqueue lock, and the frequency change
+ * itself is handed to a SCHED_FIFO thread through irq_work. Where the
+ * architecture cannot raise irq_work itself, as on ARM, that runs from
+ * the next tick, so a change can lag the decision by up to a jiffy. NO_HZ
+ * does not stop the tick while irq_work is pending.
+ *
+ * Each policy remembers the band of utilisation its current speed
+ * covers, so a report only looks at the frequency table when the speed
+ * has to change.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_sched.h>
+
+struct cpufreq_sched_cpuinfo {
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned long util;
+	u64 idle_since;		/* local_clock() when reported idle, or 0 */
+	/* The following are only used on policy->cpu */
+	spinlock_t lock;	/* protects the fields below */
+	unsigned int target_freq;
+	u64 raise_time;		/* local_clock() of the last raise */
+	unsigned long max_util;	/* of the busiest CPU, when last looked */
+	unsigned int max_cpu;
+	/* Utilisations in [band_lo, band_hi) map to band_freq */
+	unsigned long band_lo;
+	unsigned long band_hi;
+	unsigned int band_freq;
+	/* Looks again when a drop had to wait for down_delay */
+	struct timer_list drop_timer;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_sched_cpuinfo, cpuinfo);
+static DEFINE_PER_CPU(struct irq_work, kick_work);
+
+static atomic_t active_count = ATOMIC_INIT(0);
+
+static struct task_struct *set_task;
+static cpumask_t set_cpumask;
+static DEFINE_SPINLOCK(set_cpumask_lock);
+static DEFINE_MUTEX(set_speed_lock);
+
+/* Run at a frequency this much (percent) above what the load needs */
+#define DEFAULT_HEADROOM 25
+static unsigned long headroom_val = DEFAULT_HEADROOM;
+
+/* Minimum time (us) after raising the frequency before it may drop again */
+#define DEFAULT_DOWN_DELAY 20000
+static unsigned long down_delay_val = DEFAULT_DOWN_DELAY;
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+static unsigned int cpufreq_sched_get_target(struct cpufreq_policy *policy,
+					     unsigned long util)
+{
+	u64 freq = (u64)policy->max * util * (100 + headroom_val);
+
+	do_div(freq, 100 * SCHED_LOAD_SCALE);
+	return clamp_t(unsigned int, freq, policy->min, policy->max);
+}
+
+/*
+ * The utilisation of a CPU as last reported. An idle CPU may not report
+ * again for a long time under NO_HZ, so its busy average is decayed here
+ * as the scheduler would have on every tick.
+ */
+static unsigned long cpufreq_sched_util(struct cpufreq_sched_cpuinfo *pcpu,
+					u64 now)
+{
+	unsigned long util = ACCESS_ONCE(pcpu->util);
+	u64 idle_since = ACCESS_ONCE(pcpu->idle_since);
+	u64 idle;
+
+	if (!idle_since || now <= idle_since)
+		return util;
+
+	idle = min_t(u64, now - idle_since, 1ULL << 30);
+	return div64_u64((u64)util * CPUFREQ_SCHED_BUSY_TAU_NS,
+			 idle + CPUFREQ_SCHED_BUSY_TAU_NS);
+}
+
+static unsigned long cpufreq_sched_walk_util(struct cpufreq_policy *policy,
+					     struct cpufreq_sched_cpuinfo *ppol,
+					     u64 now)
+{
+	unsigned long j_util;
+	unsigned int j;
+
+	ppol->max_util = 0;
+	for_each_cpu(j, policy->cpus) {
+		j_util = cpufreq_sched_util(&per_cpu(cpuinfo, j), now);
+		if (j_util >= ppol->max_util) {
+			ppol->max_util = j_util;
+			ppol->max_cpu = j;
+		}
+	}
+	return ppol->max_util;
+}
+
+/*
+ * The busiest CPU of the policy decides the shared clock. The other CPUs
+ * only have to be looked at again when the CPU that was the busiest got
+ * less busy, or is idle and so decaying.
+ */
+static unsigned long cpufreq_sched_max_util(struct cpufreq_policy *policy,
+					    struct cpufreq_sched_cpuinfo *ppol,
+					    unsigned int cpu, unsigned long util,
+					    u64 now)
+{
+	if (util >= ppol->max_util) {
+		ppol->max_util = util;
+		ppol->max_cpu = cpu;
+		return util;
+	}
+	if (cpu != ppol->max_cpu && !per_cpu(cpuinfo, ppol->max_cpu).idle_since)
+		return ppol->max_util;
+
+	return cpufreq_sched_walk_util(policy, ppol, now);
+}
+
+/* The lowest utilisation whose target exceeds @freq */
+static unsigned long cpufreq_sched_util_above(struct cpufreq_policy *policy,
+					      unsigned int freq)
+{
+	u64 scale = (u64)policy->max * (100 + headroom_val);
+
+	return div64_u64(((u64)freq + 1) * 100 * SCHED_LOAD_SCALE +
+			 scale - 1, scale);
+}
+
+/*
+ * The lowest frequency of the table at or above the target for @util, as
+ * CPUFREQ_RELATION_L picks it, and the band of utilisation that maps to
+ * the same frequency.
+ */
+static unsigned int cpufreq_sched_find_freq(struct cpufreq_policy *policy,
+					    struct cpufreq_frequency_table *table,
+					    unsigned long util,
+					    unsigned long *band_lo,
+					    unsigned long *band_hi)
+{
+	unsigned int target = cpufreq_sched_get_target(policy, util);
+	unsigned int freq = 0, above = 0, below = 0;
+	unsigned int i;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		unsigned int f = table[i].frequency;
+
+		if (f == CPUFREQ_ENTRY_INVALID ||
+		    f < policy->min || f > policy->max)
+			continue;
+		if (f >= target) {
+			if (!freq || f < freq)
+				freq = f;
+		} else if (f > below) {
+			below = f;
+		}
+	}
+	if (!freq) {
+		/* Nothing fast enough, take the fastest and look again */
+		*band_lo = *band_hi = 0;
+		return below;
+	}
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		unsigned int f = table[i].frequency;
+
+		if (f != CPUFREQ_ENTRY_INVALID && f > freq &&
+		    f <= policy->max && (!above || f < above))
+			above = f;
+	}
+
+	*band_lo = below ? cpufreq_sched_util_above(policy, below) : 0;
+	*band_hi = above ? cpufreq_sched_util_above(policy, freq) : ULONG_MAX;
+	return freq;
+}
+
+static bool cpufreq_sched_may_drop(struct cpufreq_sched_cpuinfo *ppol, u64 now)
+{
+	/* local_clock() of another CPU of the policy may be a bit behind */
+	return (s64)(now - ppol->raise_time) >=
+		(s64)down_delay_val * NSEC_PER_USEC;
+}
+
+/*
+ * Moves the target of the policy to the speed for @max_util, with
+ * ppol->lock held. Returns whether the thread has a speed to set.
+ */
+static bool cpufreq_sched_retarget(struct cpufreq_policy *policy,
+				   struct cpufreq_sched_cpuinfo *ppol,
+				   unsigned long max_util, u64 now, int cpu,
+				   enum cpufreq_sched_event event)
+{
+	unsigned int new_freq;
+	u64 wait;
+
+	new_freq = cpufreq_sched_find_freq(policy, ppol->freq_table, max_util,
+					   &ppol->band_lo, &ppol->band_hi);
+	ppol->band_freq = new_freq;
+	if (!new_freq || new_freq == ppol->target_freq)
+		return false;
+
+	if (new_freq < ppol->target_freq &&
+	    !cpufreq_sched_may_drop(ppol, now)) {
+		/*
+		 * No later report may come, e.g. when the CPUs go idle, so
+		 * look again once the drop is allowed.
+		 */
+		wait = ppol->raise_time + down_delay_val * NSEC_PER_USEC - now;
+		mod_timer(&ppol->drop_timer,
+			  jiffies + nsecs_to_jiffies(wait) + 1);
+		trace_cpufreq_sched_notyet(cpu, max_util, ppol->target_freq,
+					   new_freq, event);
+		return false;
+	}
+
+	if (new_freq > ppol->target_freq)
+		ppol->raise_time = now;
+	ppol->target_freq = new_freq;
+
+	spin_lock(&set_cpumask_lock);
+	cpumask_set_cpu(policy->cpu, &set_cpumask);
+	spin_unlock(&set_cpumask_lock);
+
+	trace_cpufreq_sched_target(cpu, max_util, policy->cur, new_freq,
+				   event);
+	return true;
+}
+
+void cpufreq_sched_update(int cpu, unsigned long util,
+			  enum cpufreq_sched_event event)
+{
+	struct cpufreq_sched_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	struct cpufreq_sched_cpuinfo *ppol;
+	struct cpufreq_policy *policy;
+	unsigned long max_util;
+	unsigned long flags;
+	bool kick;
+	u64 now;
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	smp_rmb();
+	now = local_clock();
+	pcpu->util = util;
+	pcpu->idle_since = event == CPUFREQ_SCHED_IDLE ? now : 0;
+	policy = pcpu->policy;
+	ppol = &per_cpu(cpuinfo, policy->cpu);
+
+	spin_lock_irqsave(&ppol->lock, flags);
+
+	/* Most reports leave the speed where it is: skip the table then */
+	max_util = cpufreq_sched_max_util(policy, ppol, cpu, util, now);
+	if (max_util >= ppol->band_lo && max_util < ppol->band_hi &&
+	    (ppol->band_freq == ppol->target_freq ||
+	     !cpufreq_sched_may_drop(ppol, now)))
+		kick = false;
+	else
+		kick = cpufreq_sched_retarget(policy, ppol, max_util, now, cpu,
+					      event);
+
+	spin_unlock_irqrestore(&ppol->lock, flags);
+
+	/*
+	 * We hold a runqueue lock here, so the thread can't be woken
+	 * directly. Bounce through irq_work. NO_HZ keeps the tick running
+	 * on this CPU until the work has run, also if it is going idle.
+	 */
+	if (kick)
+		irq_work_queue(&per_cpu(kick_work, smp_processor_id()));
+}
+
+static void cpufreq_sched_drop_timer(unsigned long data)
+{
+	struct cpufreq_sched_cpuinfo *ppol = &per_cpu(cpuinfo, data);
+	unsigned long flags;
+	bool kick = false;
+	u64 now;
+
+	spin_lock_irqsave(&ppol->lock, flags);
+	if (ppol->governor_enabled) {
+		smp_rmb();
+		now = local_clock();
+		kick = cpufreq_sched_retarget(ppol->policy, ppol,
+				cpufreq_sched_walk_util(ppol->policy, ppol, now),
+				now, smp_processor_id(), CPUFREQ_SCHED_TIMER);
+	}
+	spin_unlock_irqrestore(&ppol->lock, flags);
+
+	if (kick)
+		wake_up_process(set_task);
+}
+
+static void cpufreq_sched_kick(struct irq_work *work)
+{
+	wake_up_process(set_task);
+}
+
+static int cpufreq_sched_set_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *ppol;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&set_cpumask_lock, flags);
+
+		if (cpumask_empty(&set_cpumask)) {
+			spin_unlock_irqrestore(&set_cpumask_lock, flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&set_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = set_cpumask;
+		cpumask_clear(&set_cpumask);
+		spin_unlock_irqrestore(&set_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			ppol = &per_cpu(cpuinfo, cpu);
+
+			mutex_lock(&set_speed_lock);
+			smp_rmb();
+
+			if (ppol->governor_enabled)
+				__cpufreq_driver_target(ppol->policy,
+							ppol->target_freq,
+							CPUFREQ_RELATION_L);
+
+			mutex_unlock(&set_speed_lock);
+
+			trace_cpufreq_sched_set(cpu, ppol->target_freq,
+						ppol->policy->cur);
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t show_headroom(struct kobject *kobj,
+			     struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", headroom_val);
+}
+
+/* Makes the next report of each policy look up its speed again */
+static void cpufreq_sched_forget_band(struct cpufreq_sched_cpuinfo *ppol)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ppol->lock, flags);
+	ppol->band_lo = ppol->band_hi = 0;
+	spin_unlock_irqrestore(&ppol->lock, flags);
+}
+
+static ssize_t store_headroom(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned int i;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	headroom_val = val;
+	for_each_possible_cpu(i)
+		cpufreq_sched_forget_band(&per_cpu(cpuinfo, i));
+	return count;
+}
+
+define_one_global_rw(headroom);
+
+static ssize_t show_down_delay(struct kobject *kobj,
+			       struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", down_delay_val);
+}
+
+static ssize_t store_down_delay(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	down_delay_val = val;
+	return count;
+}
+
+define_one_global_rw(down_delay);
+
+static struct attribute *sched_attributes[] = {
+	&headroom.attr,
+	&down_delay.attr,
+	NULL,
+};
+
+static struct attribute_group sched_attr_group = {
+	.attrs = sched_attributes,
+	.name = "sched",
+};
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct cpufreq_frequency_table *freq_table;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		freq_table = cpufreq_frequency_get_table(policy->cpu);
+		if (!freq_table)
+			return -EINVAL;
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->freq_table = freq_table;
+			pcpu->util = 0;
+			pcpu->idle_since = 0;
+			pcpu->target_freq = policy->cur;
+			pcpu->raise_time = local_clock();
+			pcpu->max_util = 0;
+			pcpu->max_cpu = policy->cpu;
+			pcpu->band_lo = pcpu->band_hi = 0;
+			pcpu->band_freq = 0;
+			smp_wmb();
+			pcpu->governor_enabled = 1;
+		}
+
+		if (atomic_inc_return(&active_count) > 1)
+			return 0;
+
+		rc = sysfs_create_group(cpufreq_global_kobject,
+				&sched_attr_group);
+		if (rc) {
+			for_each_cpu(j, policy->cpus)
+				per_cpu(cpuinfo, j).governor_enabled = 0;
+			atomic_dec(&active_count);
+			return rc;
+		}
+
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&set_speed_lock);
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->governor_enabled = 0;
+		}
+		smp_wmb();
+		mutex_unlock(&set_speed_lock);
+
+		del_timer_sync(&per_cpu(cpuinfo, policy->cpu).drop_timer);
+
+		if (atomic_dec_return(&active_count) > 0)
+			return 0;
+
+		sysfs_remove_group(cpufreq_global_kobject,
+				&sched_attr_group);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		cpufreq_sched_forget_band(&per_cpu(cpuinfo, policy->cpu));
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_sched_init(void)
+{
+	unsigned int i;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	for_each_possible_cpu(i) {
+		init_irq_work(&per_cpu(kick_work, i), cpufreq_sched_kick);
+		spin_lock_init(&per_cpu(cpuinfo, i).lock);
+		setup_timer(&per_cpu(cpuinfo, i).drop_timer,
+			    cpufreq_sched_drop_timer, i);
+	}
+
+	set_task = kthread_create(cpufreq_sched_set_task, NULL,
+				  "kschedfreq");
+	if (IS_ERR(set_task))
+		return PTR_ERR(set_task);
+
+	sched_setscheduler_nocheck(set_task, SCHED_FIFO, &param);
+	get_task_struct(set_task);
+
+	return cpufreq_register_governor(&cpufreq_gov_sched);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
+
+MODULE_DESCRIPTION("'cpufreq_sched' - A cpufreq governor driven by "
+	"scheduler utilisation");
+MODULE_LICENSE("GPL");
@@ -34,6 +34,8 @@
 #include <linux/moduleparam.h>
 #include <asm/cputime.h>
 #include <linux/earlysuspend.h>
+
+#include "cpufreq_governor.h"
  
  
 /******************** Tunable parameters: ********************/
@@ -298,10 +300,7 @@ static void cpufreq_smartass_timer(unsigned long cpu)
         return;
     }
  
-    if (delta_idle > delta_time)
-        cpu_load = 0;
-    else
-        cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
+    cpu_load = cpufreq_gov_calc_load(delta_time, delta_idle, 0, 0);
  
     dprintk(SMARTASS_DEBUG_LOAD,"smartassT @ %d: load %d (delta_time %llu)\n",
         old_freq,cpu_load,delta_time);
@@ -19,6 +19,7 @@
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
+#include <linux/padata.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -63,6 +64,17 @@ struct dm_crypt_io {
 	struct dm_crypt_io *base_io;
 };
 
+/*
+ * A run of sectors of a bio converted by one CPU of the padata instance
+ */
+struct dm_crypt_chunk {
+	struct padata_priv padata;
+	struct dm_crypt_io *io;
+	struct convert_context ctx;
+	unsigned int sectors;
+	int error;
+};
+
 struct dm_crypt_request {
 	struct convert_context *ctx;
 	struct scatterlist sg_in;
@@ -110,6 +122,8 @@ enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
  */
 struct crypt_cpu {
 	struct ablkcipher_request *req;
+	/* preallocated, used only by the padata workers of this CPU */
+	struct ablkcipher_request *par_req;
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
 	struct crypto_ablkcipher *tfms[0];
@@ -135,6 +149,18 @@ struct crypt_config {
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
+	/*
+	 * Splits the conversion of large bios over the CPUs and
+	 * completes the pieces in order. NULL for asynchronous ciphers.
+	 */
+	struct padata_instance *pinst;
+	struct workqueue_struct *padata_queue;
+	mempool_t *chunk_pool;
+	unsigned int parallel_sectors;
+	/* chunks completed, waited on for padata to take more */
+	atomic_t chunks_done;
+	wait_queue_head_t chunk_wait;
+
 	char *cipher;
 	char *cipher_string;
 
@@ -179,6 +205,18 @@ struct crypt_config {
 #define MIN_POOL_PAGES 32
 
 static struct kmem_cache *_crypt_io_pool;
+static struct kmem_cache *_crypt_chunk_pool;
+
+/*
+ * Smallest run of sectors given to one CPU; bios shorter than two runs
+ * are converted by the CPU that picked them up. 0 disables the split,
+ * the default: padata runs the pieces with bottom halves disabled, where
+ * NEON ciphers fall back to scalar code. Read when a table is loaded.
+ */
+static unsigned int parallel_sectors;
+module_param(parallel_sectors, uint, 0644);
+MODULE_PARM_DESC(parallel_sectors,
+	"Sectors per CPU when splitting a bio over the CPUs, 0 to disable");
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
 static void kcryptd_queue_crypt(struct dm_crypt_io *io);
@@ -745,6 +783,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 
 static void kcryptd_async_done(struct crypto_async_request *async_req,
 			       int error);
+static void kcryptd_crypt_done(struct dm_crypt_io *io, int error);
 
 static void crypt_alloc_req(struct crypt_config *cc,
 			    struct convert_context *ctx)
@@ -761,6 +800,183 @@ static void crypt_alloc_req(struct crypt_config *cc,
 	    kcryptd_async_done, dmreq_of_req(cc, this_cc->req));
 }
 
+#ifdef CONFIG_PADATA
+/* Sectors left in @bio from the given position */
+static unsigned int crypt_bio_sectors_from(struct bio *bio, unsigned int idx,
+					   unsigned int offset)
+{
+	unsigned int bytes = 0;
+
+	for (; idx < bio->bi_vcnt; idx++)
+		bytes += bio_iovec_idx(bio, idx)->bv_len;
+
+	return (bytes - offset) >> SECTOR_SHIFT;
+}
+
+/* Moves the position of @ctx on by @sectors, as converting them would */
+static void crypt_convert_skip(struct convert_context *ctx,
+			       unsigned int sectors)
+{
+	unsigned int len = sectors << SECTOR_SHIFT;
+	unsigned int n;
+
+	while (len) {
+		n = min(len, bio_iovec_idx(ctx->bio_in, ctx->idx_in)->bv_len -
+			     ctx->offset_in);
+		ctx->offset_in += n;
+		if (ctx->offset_in >= bio_iovec_idx(ctx->bio_in,
+						    ctx->idx_in)->bv_len) {
+			ctx->offset_in = 0;
+			ctx->idx_in++;
+		}
+		len -= n;
+	}
+
+	len = sectors << SECTOR_SHIFT;
+	while (len) {
+		n = min(len, bio_iovec_idx(ctx->bio_out, ctx->idx_out)->bv_len -
+			     ctx->offset_out);
+		ctx->offset_out += n;
+		if (ctx->offset_out >= bio_iovec_idx(ctx->bio_out,
+						     ctx->idx_out)->bv_len) {
+			ctx->offset_out = 0;
+			ctx->idx_out++;
+		}
+		len -= n;
+	}
+
+	ctx->sector += sectors;
+}
+
+/*
+ * Converts the sectors of a chunk with the preallocated request of this
+ * CPU. Runs with bottom halves disabled, so the cipher is synchronous and
+ * nothing else uses the request meanwhile.
+ */
+static int crypt_convert_chunk(struct crypt_config *cc,
+			       struct dm_crypt_chunk *chunk)
+{
+	struct crypt_cpu *this_cc = this_crypt_config(cc);
+	struct ablkcipher_request *req = this_cc->par_req;
+	struct convert_context *ctx = &chunk->ctx;
+	unsigned key_index;
+	int r;
+
+	for (; chunk->sectors; chunk->sectors--) {
+		key_index = ctx->sector & (cc->tfms_count - 1);
+		ablkcipher_request_set_tfm(req, this_cc->tfms[key_index]);
+		ablkcipher_request_set_callback(req, 0, NULL, NULL);
+
+		r = crypt_convert_block(cc, ctx, req);
+		if (r)
+			return r;
+		ctx->sector++;
+	}
+
+	return 0;
+}
+
+static void kcryptd_chunk_crypt(struct padata_priv *padata)
+{
+	struct dm_crypt_chunk *chunk = container_of(padata,
+					struct dm_crypt_chunk, padata);
+	struct dm_crypt_io *io = chunk->io;
+
+	chunk->error = crypt_convert_chunk(io->target->private, chunk);
+	padata_do_serial(padata);
+}
+
+/* Called in the order the chunks were handed out */
+static void kcryptd_chunk_done(struct padata_priv *padata)
+{
+	struct dm_crypt_chunk *chunk = container_of(padata,
+					struct dm_crypt_chunk, padata);
+	struct dm_crypt_io *io = chunk->io;
+	struct crypt_config *cc = io->target->private;
+	int error = chunk->error;
+
+	mempool_free(chunk, cc->chunk_pool);
+	kcryptd_crypt_done(io, error);
+
+	atomic_inc(&cc->chunks_done);
+	smp_mb__after_atomic_inc();
+	if (waitqueue_active(&cc->chunk_wait))
+		wake_up(&cc->chunk_wait);
+}
+
+/*
+ * Hands the rest of the conversion of @ctx out to the padata instance in
+ * chunks, one per CPU. Each chunk holds a reference on ctx->pending like
+ * an asynchronous request, and completes through kcryptd_crypt_done().
+ * Returns 0 if the bio is too small to be worth splitting.
+ */
+static int crypt_convert_parallel(struct crypt_config *cc,
+				  struct convert_context *ctx)
+{
+	struct dm_crypt_io *io = container_of(ctx, struct dm_crypt_io, ctx);
+	struct dm_crypt_chunk *chunk;
+	unsigned int sectors, chunks, i;
+	int cpu, done, r;
+
+	if (!cc->pinst)
+		return 0;
+
+	sectors = min(crypt_bio_sectors_from(ctx->bio_in, ctx->idx_in,
+					     ctx->offset_in),
+		      crypt_bio_sectors_from(ctx->bio_out, ctx->idx_out,
+					     ctx->offset_out));
+	chunks = min(sectors / cc->parallel_sectors, num_online_cpus());
+	if (chunks < 2)
+		return 0;
+
+	for (i = 0; i < chunks; i++) {
+		chunk = mempool_alloc(cc->chunk_pool, GFP_NOIO);
+		chunk->io = io;
+		chunk->sectors = sectors / chunks + (i < sectors % chunks);
+		chunk->error = 0;
+		chunk->ctx.bio_in = ctx->bio_in;
+		chunk->ctx.bio_out = ctx->bio_out;
+		chunk->ctx.offset_in = ctx->offset_in;
+		chunk->ctx.offset_out = ctx->offset_out;
+		chunk->ctx.idx_in = ctx->idx_in;
+		chunk->ctx.idx_out = ctx->idx_out;
+		chunk->ctx.sector = ctx->sector;
+		crypt_convert_skip(ctx, chunk->sectors);
+
+		memset(&chunk->padata, 0, sizeof(chunk->padata));
+		chunk->padata.parallel = kcryptd_chunk_crypt;
+		chunk->padata.serial = kcryptd_chunk_done;
+
+		atomic_inc(&ctx->pending);
+
+		/*
+		 * Converting the chunk here would complete it ahead of those
+		 * still queued. So while padata has too many chunks in flight
+		 * or is being changed for CPU hotplug, wait for a chunk to
+		 * complete, or a tick, and queue it again.
+		 */
+		for (;;) {
+			done = atomic_read(&cc->chunks_done);
+			cpu = get_cpu();
+			r = padata_do_parallel(cc->pinst, &chunk->padata, cpu);
+			put_cpu();
+			if (likely(!r))
+				break;
+			wait_event_timeout(cc->chunk_wait,
+				atomic_read(&cc->chunks_done) != done, 1);
+		}
+	}
+
+	return 1;
+}
+#else
+static int crypt_convert_parallel(struct crypt_config *cc,
+				  struct convert_context *ctx)
+{
+	return 0;
+}
+#endif
+
 /*
  * Encrypt / decrypt data from one bio to another one (can be the same one)
  */
@@ -772,6 +988,9 @@ static int crypt_convert(struct crypt_config *cc,
 
 	atomic_set(&ctx->pending, 1);
 
+	if (crypt_convert_parallel(cc, ctx))
+		return 0;
+
 	while(ctx->idx_in < ctx->bio_in->bi_vcnt &&
 	      ctx->idx_out < ctx->bio_out->bi_vcnt) {
 
@@ -1204,12 +1423,21 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 	if (!error && cc->iv_gen_ops && cc->iv_gen_ops->post)
 		error = cc->iv_gen_ops->post(cc, iv_of_dmreq(cc, dmreq), dmreq);
 
+	mempool_free(req_of_dmreq(cc, dmreq), cc->req_pool);
+
+	kcryptd_crypt_done(io, error);
+}
+
+/*
+ * Drops the reference of an asynchronous request or of a padata chunk on
+ * the conversion of @io and finishes it if that was the last one.
+ */
+static void kcryptd_crypt_done(struct dm_crypt_io *io, int error)
+{
 	if (error < 0)
 		io->error = -EIO;
 
-	mempool_free(req_of_dmreq(cc, dmreq), cc->req_pool);
-
-	if (!atomic_dec_and_test(&ctx->pending))
+	if (!atomic_dec_and_test(&io->ctx.pending))
 		return;
 
 	if (bio_data_dir(io->base_bio) == READ)
@@ -1359,6 +1587,77 @@ static int crypt_wipe_key(struct crypt_config *cc)
 	return crypt_setkey_allcpus(cc);
 }
 
+#ifdef CONFIG_PADATA
+/*
+ * Sets up the padata instance splitting large bios over the CPUs, unless
+ * disabled, pointless or not possible: the chunks are converted with
+ * bottom halves disabled, which rules out ciphers that may sleep.
+ */
+static int crypt_alloc_parallel(struct crypt_config *cc)
+{
+	struct crypto_ablkcipher *tfm = any_tfm(cc);
+	unsigned int req_size;
+	int cpu;
+
+	atomic_set(&cc->chunks_done, 0);
+	init_waitqueue_head(&cc->chunk_wait);
+
+	cc->parallel_sectors = parallel_sectors;
+	if (!cc->parallel_sectors || num_possible_cpus() < 2 ||
+	    crypto_ablkcipher_tfm(tfm)->__crt_alg->cra_flags & CRYPTO_ALG_ASYNC)
+		return 0;
+
+	req_size = cc->dmreq_start + sizeof(struct dm_crypt_request) +
+		   cc->iv_size;
+	for_each_possible_cpu(cpu) {
+		struct crypt_cpu *cpu_cc = per_cpu_ptr(cc->cpu, cpu);
+
+		cpu_cc->par_req = kmalloc_node(req_size, GFP_KERNEL,
+					       cpu_to_node(cpu));
+		if (!cpu_cc->par_req)
+			return -ENOMEM;
+	}
+
+	cc->chunk_pool = mempool_create_slab_pool(MIN_IOS, _crypt_chunk_pool);
+	if (!cc->chunk_pool)
+		return -ENOMEM;
+
+	cc->padata_queue = alloc_workqueue("kcryptd_par",
+					   WQ_MEM_RECLAIM|
+					   WQ_CPU_INTENSIVE,
+					   1);
+	if (!cc->padata_queue)
+		return -ENOMEM;
+
+	cc->pinst = padata_alloc_possible(cc->padata_queue);
+	if (!cc->pinst)
+		return -ENOMEM;
+
+	return padata_start(cc->pinst);
+}
+
+static void crypt_free_parallel(struct crypt_config *cc)
+{
+	if (cc->pinst) {
+		padata_stop(cc->pinst);
+		padata_free(cc->pinst);
+	}
+	if (cc->padata_queue)
+		destroy_workqueue(cc->padata_queue);
+	if (cc->chunk_pool)
+		mempool_destroy(cc->chunk_pool);
+}
+#else
+static int crypt_alloc_parallel(struct crypt_config *cc)
+{
+	return 0;
+}
+
+static void crypt_free_parallel(struct crypt_config *cc)
+{
+}
+#endif
+
 static void crypt_dtr(struct dm_target *ti)
 {
 	struct crypt_config *cc = ti->private;
@@ -1375,11 +1674,14 @@ static void crypt_dtr(struct dm_target *ti)
 	if (cc->crypt_queue)
 		destroy_workqueue(cc->crypt_queue);
 
+	crypt_free_parallel(cc);
+
 	if (cc->cpu)
 		for_each_possible_cpu(cpu) {
 			cpu_cc = per_cpu_ptr(cc->cpu, cpu);
 			if (cpu_cc->req)
 				mempool_free(cpu_cc->req, cc->req_pool);
+			kzfree(cpu_cc->par_req);
 			crypt_free_tfms(cc, cpu);
 		}
 
@@ -1670,6 +1972,12 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	ret = crypt_alloc_parallel(cc);
+	if (ret < 0) {
+		ti->error = "Couldn't set up parallel conversion";
+		goto bad;
+	}
+
 	ti->num_flush_requests = 1;
 	return 0;
 
@@ -1847,9 +2155,16 @@ static int __init dm_crypt_init(void)
 	if (!_crypt_io_pool)
 		return -ENOMEM;
 
+	_crypt_chunk_pool = KMEM_CACHE(dm_crypt_chunk, 0);
+	if (!_crypt_chunk_pool) {
+		kmem_cache_destroy(_crypt_io_pool);
+		return -ENOMEM;
+	}
+
 	r = dm_register_target(&crypt_target);
 	if (r < 0) {
 		DMERR("register failed %d", r);
+		kmem_cache_destroy(_crypt_chunk_pool);
 		kmem_cache_destroy(_crypt_io_pool);
 	}
 
@@ -1859,6 +2174,7 @@ static int __init dm_crypt_init(void)
 static void __exit dm_crypt_exit(void)
 {
 	dm_unregister_target(&crypt_target);
+	kmem_cache_destroy(_crypt_chunk_pool);
 	kmem_cache_destroy(_crypt_io_pool);
 }
 
@@ -19,21 +19,38 @@
 
 #define U32_MAX (~(u32)0)
 
+/*
+ * State of one cach_set_domain()/cach_set_domains() call. Maintenance is
+ * accounted to @stats, and when @defer_drain is set the write buffer is
+ * drained once at the end of the batch instead of once per buffer.
+ */
+struct sync_ctx {
+	struct hwmem_cache_stats *stats;
+	bool defer_drain;
+	bool drain_pending;
+};
+
 enum hwmem_alloc_flags cachi_get_cache_settings(
 			enum hwmem_alloc_flags requested_cache_settings);
 void cachi_set_pgprot_cache_options(enum hwmem_alloc_flags cache_settings,
 							pgprot_t *pgprot);
 
-static void sync_buf_pre_cpu(struct cach_buf *buf, enum hwmem_access access,
-						struct hwmem_region *region);
-static void sync_buf_post_cpu(struct cach_buf *buf,
+static void set_domain(struct sync_ctx *ctx, struct cach_buf *buf,
+		enum hwmem_access access, enum hwmem_domain domain,
+					struct hwmem_region *region);
+static void sync_buf_pre_cpu(struct sync_ctx *ctx, struct cach_buf *buf,
+		enum hwmem_access access, struct hwmem_region *region);
+static void sync_buf_post_cpu(struct sync_ctx *ctx, struct cach_buf *buf,
 	enum hwmem_access next_access, struct hwmem_region *next_region);
+static u32 sync_cost(struct cach_buf *buf, enum hwmem_access access,
+		enum hwmem_domain domain, struct hwmem_region *region);
+static void all_flushed(struct cach_buf *buf, enum hwmem_domain domain);
 
-static void invalidate_cpu_cache(struct cach_buf *buf,
+static void invalidate_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
 					struct cach_range *range_2b_used);
-static void clean_cpu_cache(struct cach_buf *buf,
+static void clean_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
 					struct cach_range *range_2b_used);
-static void flush_cpu_cache(struct cach_buf *buf,
+static void flush_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
 					struct cach_range *range_2b_used);
 
 static void null_range(struct cach_range *range);
@@ -118,34 +135,60 @@ void cach_set_pgprot_cache_options(struct cach_buf *buf, pgprot_t *pgprot)
 }
 
 void cach_set_domain(struct cach_buf *buf, enum hwmem_access access,
-			enum hwmem_domain domain, struct hwmem_region *region)
+			enum hwmem_domain domain, struct hwmem_region *region,
+					struct hwmem_cache_stats *stats)
 {
-	struct hwmem_region *__region;
-	struct hwmem_region full_region;
+	struct sync_ctx ctx = {
+		.stats = stats,
+	};
 
-	if (region != NULL) {
-		__region = region;
-	} else {
-		full_region.offset = 0;
-		full_region.count = 1;
-		full_region.start = 0;
-		full_region.end = buf->size;
-		full_region.size = buf->size;
+	set_domain(&ctx, buf, access, domain, region);
+}
 
-		__region = &full_region;
+void cach_set_domains(struct cach_domain_switch *switches, size_t count,
+					struct hwmem_cache_stats *stats)
+{
+	struct sync_ctx ctx = {
+		.stats = stats,
+		.defer_drain = true,
+	};
+	bool inner_only = true;
+	u32 total = 0;
+	size_t i;
+
+	/*
+	 * Add up what the switches would clean and flush one by one. Above
+	 * the breakpoint where a complete flush is cheaper, do that once and
+	 * let the per buffer passes below find nothing left to maintain.
+	 */
+	for (i = 0; i < count; i++) {
+		struct cach_domain_switch *sw = &switches[i];
+		u32 cost = sync_cost(sw->buf, sw->access, sw->domain,
+								sw->region);
+
+		if (cost == 0)
+			continue;
+		if (!(sw->buf->cache_settings &
+					HWMEM_ALLOC_HINT_INNER_CACHE_ONLY))
+			inner_only = false;
+		total = min(total + cost, U32_MAX - 1);
 	}
 
-	switch (domain) {
-	case HWMEM_DOMAIN_SYNC:
-		sync_buf_post_cpu(buf, access, __region);
+	if (total >= get_dcache_flush_all_breakpoint(inner_only)) {
+		flush_cpu_dcache_all(inner_only);
+		if (stats != NULL)
+			stats->full_flushes++;
 
-		break;
+		for (i = 0; i < count; i++)
+			all_flushed(switches[i].buf, switches[i].domain);
+	}
 
-	case HWMEM_DOMAIN_CPU:
-		sync_buf_pre_cpu(buf, access, __region);
+	for (i = 0; i < count; i++)
+		set_domain(&ctx, switches[i].buf, switches[i].access,
+				switches[i].domain, switches[i].region);
 
-		break;
-	}
+	if (ctx.drain_pending)
+		drain_cpu_write_buf();
 }
 
 /*
@@ -199,8 +242,122 @@ bool __attribute__((weak)) speculative_data_prefetch(void)
 	return true;
 }
 
-static void sync_buf_pre_cpu(struct cach_buf *buf, enum hwmem_access access,
-						struct hwmem_region *region)
+u32 __attribute__((weak)) get_dcache_flush_all_breakpoint(bool inner_only)
+{
+	/* Never flush everything, cach_set_domains() caps its sum below */
+	return U32_MAX;
+}
+
+void __attribute__((weak)) flush_cpu_dcache_all(bool inner_only)
+{
+	/* Unreachable with the default breakpoint above */
+	WARN_ON(1);
+}
+
+/* NULL stands for the whole buffer */
+static struct hwmem_region *region_or_full(struct cach_buf *buf,
+		struct hwmem_region *region, struct hwmem_region *full_region)
+{
+	if (region != NULL)
+		return region;
+
+	full_region->offset = 0;
+	full_region->count = 1;
+	full_region->start = 0;
+	full_region->end = buf->size;
+	full_region->size = buf->size;
+
+	return full_region;
+}
+
+static void set_domain(struct sync_ctx *ctx, struct cach_buf *buf,
+		enum hwmem_access access, enum hwmem_domain domain,
+					struct hwmem_region *region)
+{
+	struct hwmem_region full_region;
+	struct hwmem_region *__region = region_or_full(buf, region,
+								&full_region);
+
+	if (ctx->stats != NULL)
+		ctx->stats->domain_switches++;
+
+	switch (domain) {
+	case HWMEM_DOMAIN_SYNC:
+		sync_buf_post_cpu(ctx, buf, access, __region);
+
+		break;
+
+	case HWMEM_DOMAIN_CPU:
+		sync_buf_pre_cpu(ctx, buf, access, __region);
+
+		break;
+	}
+}
+
+/*
+ * Number of bytes set_domain() would clean or flush, ignoring the
+ * rounding of partial ranges to the edges of the tracked ranges.
+ */
+static u32 sync_cost(struct cach_buf *buf, enum hwmem_access access,
+		enum hwmem_domain domain, struct hwmem_region *region)
+{
+	bool write = access & HWMEM_ACCESS_WRITE;
+	bool read = access & HWMEM_ACCESS_READ;
+	struct hwmem_region full_region;
+	struct cach_range range;
+	struct cach_range intersection;
+
+	if (!(buf->cache_settings & HWMEM_ALLOC_HINT_CACHED))
+		return 0;
+	if (!write && !read)
+		return 0;
+
+	region_2_range(region_or_full(buf, region, &full_region), buf->size,
+								&range);
+
+	if (domain == HWMEM_DOMAIN_CPU) {
+		if (!read && !(buf->cache_settings &
+						HWMEM_ALLOC_HINT_CACHE_WB))
+			return 0;
+		intersect_range(&buf->range_invalid_in_cpu_cache, &range,
+								&intersection);
+	} else if (write && !speculative_data_prefetch()) {
+		intersect_range(&buf->range_in_cpu_cache, &range,
+								&intersection);
+	} else {
+		intersect_range(&buf->range_dirty_in_cpu_cache, &range,
+								&intersection);
+	}
+
+	return range_length(&intersection);
+}
+
+/*
+ * The whole data cache has just been flushed, bring the tracked ranges
+ * in line as the range operations would have done.
+ */
+static void all_flushed(struct cach_buf *buf, enum hwmem_domain domain)
+{
+	if (!(buf->cache_settings & HWMEM_ALLOC_HINT_CACHED))
+		return;
+
+	null_range(&buf->range_dirty_in_cpu_cache);
+
+	/*
+	 * The invalidates deferred for buffers headed for the sync domain
+	 * have to stay, the CPU may speculatively pull the stale lines back
+	 * in while the hardware writes.
+	 */
+	if (domain == HWMEM_DOMAIN_CPU) {
+		null_range(&buf->range_invalid_in_cpu_cache);
+	} else if (!speculative_data_prefetch()) {
+		null_range(&buf->range_in_cpu_cache);
+		null_range(&buf->range_invalid_in_cpu_cache);
+	}
+}
+
+static void sync_buf_pre_cpu(struct sync_ctx *ctx, struct cach_buf *buf,
+		enum hwmem_access access, struct hwmem_region *region)
 {
 	bool write = access & HWMEM_ACCESS_WRITE;
 	bool read = access & HWMEM_ACCESS_READ;
@@ -216,7 +373,7 @@ static void sync_buf_pre_cpu(struct cach_buf *buf, enum hwmem_access access,
 		if (read || (write && buf->cache_settings &
 						HWMEM_ALLOC_HINT_CACHE_WB))
 			/* Perform defered invalidates */
-			invalidate_cpu_cache(buf, &region_range);
+			invalidate_cpu_cache(ctx, buf, &region_range);
 		if (read || (write && buf->cache_settings &
 						HWMEM_ALLOC_HINT_CACHE_AOW))
 			expand_range(&buf->range_in_cpu_cache, &region_range);
@@ -239,7 +396,7 @@ static void sync_buf_pre_cpu(struct cach_buf *buf, enum hwmem_access access,
 	}
 }
 
-static void sync_buf_post_cpu(struct cach_buf *buf,
+static void sync_buf_post_cpu(struct sync_ctx *ctx, struct cach_buf *buf,
 	enum hwmem_access next_access, struct hwmem_region *next_region)
 {
 	bool write = next_access & HWMEM_ACCESS_WRITE;
@@ -262,22 +419,26 @@ static void sync_buf_post_cpu(struct cach_buf *buf,
 			expand_range(&buf->range_invalid_in_cpu_cache,
 								&intersection);
 
-			clean_cpu_cache(buf, &region_range);
+			clean_cpu_cache(ctx, buf, &region_range);
 		} else {
-			flush_cpu_cache(buf, &region_range);
+			flush_cpu_cache(ctx, buf, &region_range);
 		}
 	}
 	if (read)
-		clean_cpu_cache(buf, &region_range);
+		clean_cpu_cache(ctx, buf, &region_range);
 
 	if (buf->in_cpu_write_buf) {
-		drain_cpu_write_buf();
+		if (ctx->defer_drain)
+			ctx->drain_pending = true;
+		else
+			drain_cpu_write_buf();
 
 		buf->in_cpu_write_buf = false;
 	}
 }
 
-static void invalidate_cpu_cache(struct cach_buf *buf, struct cach_range *range)
+static void invalidate_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
+						struct cach_range *range)
 {
 	struct cach_range intersection;
 
@@ -301,6 +462,9 @@ static void invalidate_cpu_cache(struct cach_buf *buf, struct cach_range *range)
 				buf->cache_settings &
 					HWMEM_ALLOC_HINT_INNER_CACHE_ONLY,
 							&flushed_everything);
+		if (ctx->stats != NULL)
+			ctx->stats->invalidated_bytes +=
+						range_length(&intersection);
 
 		if (flushed_everything) {
 			null_range(&buf->range_invalid_in_cpu_cache);
@@ -317,7 +481,8 @@ static void invalidate_cpu_cache(struct cach_buf *buf, struct cach_range *range)
 	}
 }
 
-static void clean_cpu_cache(struct cach_buf *buf, struct cach_range *range)
+static void clean_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
+						struct cach_range *range)
 {
 	struct cach_range intersection;
 
@@ -335,6 +500,9 @@ static void clean_cpu_cache(struct cach_buf *buf, struct cach_range *range)
 				buf->cache_settings &
 					HWMEM_ALLOC_HINT_INNER_CACHE_ONLY,
 							&cleaned_everything);
+		if (ctx->stats != NULL)
+			ctx->stats->cleaned_bytes +=
+						range_length(&intersection);
 
 		if (cleaned_everything)
 			null_range(&buf->range_dirty_in_cpu_cache);
@@ -347,7 +515,8 @@ static void clean_cpu_cache(struct cach_buf *buf, struct cach_range *range)
 	}
 }
 
-static void flush_cpu_cache(struct cach_buf *buf, struct cach_range *range)
+static void flush_cpu_cache(struct sync_ctx *ctx, struct cach_buf *buf,
+						struct cach_range *range)
 {
 	struct cach_range intersection;
 
@@ -364,6 +533,9 @@ static void flush_cpu_cache(struct cach_buf *buf, struct cach_range *range)
 				buf->cache_settings &
 					HWMEM_ALLOC_HINT_INNER_CACHE_ONLY,
 							&flushed_everything);
+		if (ctx->stats != NULL)
+			ctx->stats->invalidated_bytes +=
+						range_length(&intersection);
 
 		if (flushed_everything) {
 			if (!speculative_data_prefetch())
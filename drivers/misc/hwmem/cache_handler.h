@@ -56,7 +56,28 @@ void cach_set_buf_addrs(struct cach_buf *buf, void* vaddr, u32 paddr);
 
 void cach_set_pgprot_cache_options(struct cach_buf *buf, pgprot_t *pgprot);
 
+/*
+ * One buffer's part of a batched domain switch. A NULL region means the
+ * whole buffer.
+ */
+struct cach_domain_switch {
+	struct cach_buf *buf;
+	enum hwmem_access access;
+	enum hwmem_domain domain;
+	struct hwmem_region *region;
+};
+
 void cach_set_domain(struct cach_buf *buf, enum hwmem_access access,
-			enum hwmem_domain domain, struct hwmem_region *region);
+			enum hwmem_domain domain, struct hwmem_region *region,
+					struct hwmem_cache_stats *stats);
+
+/*
+ * Switches several buffers at once. When the maintenance of all of them
+ * adds up to more than a complete cache flush costs, the cache is flushed
+ * once instead, and the write buffer is only drained once. stats may be
+ * NULL.
+ */
+void cach_set_domains(struct cach_domain_switch *switches, size_t count,
+					struct hwmem_cache_stats *stats);
 
 #endif /* _CACHE_HANDLER_H_ */
@@ -10,6 +10,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/bitops.h>
 #include <linux/err.h>
 #include <linux/list.h>
 #include <linux/slab.h>
@@ -17,14 +18,33 @@
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/vmalloc.h>
 #include <linux/pasr.h>
 #include <asm/sizes.h>
 
 #define MAX_INSTANCE_NAME_LENGTH 31
 
+/*
+ * Free areas are kept in segregated size classes: bin n holds the free
+ * areas of [2^n, 2^(n+1)) pages, the last bin everything larger. An
+ * allocation is served best-fit from the first non-empty bin that has a
+ * large enough area, so only a handful of areas are looked at however
+ * fragmented the region is.
+ */
+#define CONA_NR_BINS 16
+
+/* Allocation latency buckets: <1us, then powers of two up to >=1ms */
+#define CONA_NR_LAT_BUCKETS 12
+
 struct alloc {
+	/* All areas of the instance in address order */
 	struct list_head list;
+	/* Free areas only, in the bin of their size */
+	struct list_head free_list;
 
 	bool in_use;
 	phys_addr_t paddr;
@@ -40,7 +60,12 @@ struct instance {
 	void *region_kaddr;
 	size_t region_size;
 
+	/* Protects everything below */
+	struct mutex lock;
+
 	struct list_head alloc_list;
+	struct list_head bins[CONA_NR_BINS];
+	unsigned long bin_map;	/* bit n set if bins[n] is not empty */
 
 #ifdef CONFIG_DEBUG_FS
 	struct inode *debugfs_inode;
@@ -50,11 +75,13 @@ struct instance {
 	int cona_status_max_check;
 	int cona_status_biggest_free;
 	int cona_status_printed;
+	unsigned int cona_status_lat_hist[CONA_NR_LAT_BUCKETS];
 #endif /* #ifdef CONFIG_DEBUG_FS */
 };
 
 static LIST_HEAD(instance_list);
 
+/* Protects instance_list */
 static DEFINE_MUTEX(lock);
 
 void *cona_create(const char *name, phys_addr_t region_paddr,
@@ -67,10 +94,11 @@ size_t cona_get_alloc_size(void *alloc);
 
 static int init_alloc_list(struct instance *instance);
 static void clean_alloc_list(struct instance *instance);
-static struct alloc *find_free_alloc_bestfit(struct instance *instance,
-								size_t size);
-static struct alloc *split_allocation(struct alloc *alloc,
-							size_t new_alloc_size);
+static struct alloc *find_free_alloc(struct instance *instance, size_t size);
+static struct alloc *split_allocation(struct instance *instance,
+				struct alloc *alloc, size_t new_alloc_size);
+static void bin_insert(struct instance *instance, struct alloc *alloc);
+static void bin_remove(struct instance *instance, struct alloc *alloc);
 static phys_addr_t get_alloc_offset(struct instance *instance,
 							struct alloc *alloc);
 
@@ -78,6 +106,7 @@ void *cona_create(const char *name, phys_addr_t region_paddr,
 							size_t region_size)
 {
 	int ret;
+	int i;
 	struct instance *instance;
 	struct vm_struct *vm_area = NULL;
 #ifdef CONFIG_FLATMEM
@@ -134,7 +163,10 @@ void *cona_create(const char *name, phys_addr_t region_paddr,
 	 */
 	pasr_put(instance->region_paddr, instance->region_size);
 
+	mutex_init(&instance->lock);
 	INIT_LIST_HEAD(&instance->alloc_list);
+	for (i = 0; i < CONA_NR_BINS; i++)
+		INIT_LIST_HEAD(&instance->bins[i]);
 	ret = init_alloc_list(instance);
 	if (ret < 0)
 		goto init_alloc_list_failed;
@@ -159,24 +191,40 @@ vmem_alloc_failed:
 	return ERR_PTR(ret);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void account_alloc_latency(struct instance *instance, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int bucket = 0;
+
+	if (us > 0)
+		bucket = min_t(int, ilog2(us) + 1, CONA_NR_LAT_BUCKETS - 1);
+	instance->cona_status_lat_hist[bucket]++;
+}
+#endif /* #ifdef CONFIG_DEBUG_FS */
+
 void *cona_alloc(void *instance, size_t size)
 {
 	struct instance *instance_l = (struct instance *)instance;
 	struct alloc *alloc;
+#ifdef CONFIG_DEBUG_FS
+	ktime_t start = ktime_get();
+#endif /* #ifdef CONFIG_DEBUG_FS */
 
 	if (size == 0)
 		return ERR_PTR(-EINVAL);
 
-	mutex_lock(&lock);
+	mutex_lock(&instance_l->lock);
 
-	alloc = find_free_alloc_bestfit(instance_l, size);
+	alloc = find_free_alloc(instance_l, size);
 	if (IS_ERR(alloc))
 		goto out;
 	if (size < alloc->size) {
-		alloc = split_allocation(alloc, size);
+		alloc = split_allocation(instance_l, alloc, size);
 		if (IS_ERR(alloc))
 			goto out;
 	} else {
+		bin_remove(instance_l, alloc);
 		alloc->in_use = true;
 	}
 
@@ -187,10 +235,11 @@ void *cona_alloc(void *instance, size_t size)
 	instance_l->cona_status_max_check =
 					max(instance_l->cona_status_max_check,
 					instance_l->cona_status_max_cont);
+	account_alloc_latency(instance_l, start);
 #endif /* #ifdef CONFIG_DEBUG_FS */
 
 out:
-	mutex_unlock(&lock);
+	mutex_unlock(&instance_l->lock);
 
 	return alloc;
 }
@@ -201,7 +250,7 @@ void cona_free(void *instance, void *alloc)
 	struct alloc *alloc_l = (struct alloc *)alloc;
 	struct alloc *other;
 
-	mutex_lock(&lock);
+	mutex_lock(&instance_l->lock);
 
 	alloc_l->in_use = false;
 
@@ -211,9 +260,11 @@ void cona_free(void *instance, void *alloc)
 	instance_l->cona_status_max_cont -= alloc_l->size;
 #endif /* #ifdef CONFIG_DEBUG_FS */
 
+	/* Coalesce with free neighbours, then file under the merged size */
 	other = list_entry(alloc_l->list.prev, struct alloc, list);
 	if ((alloc_l->list.prev != &instance_l->alloc_list) &&
 							!other->in_use) {
+		bin_remove(instance_l, other);
 		other->size += alloc_l->size;
 		list_del(&alloc_l->list);
 		kfree(alloc_l);
@@ -222,12 +273,14 @@ void cona_free(void *instance, void *alloc)
 	other = list_entry(alloc_l->list.next, struct alloc, list);
 	if ((alloc_l->list.next != &instance_l->alloc_list) &&
 							!other->in_use) {
+		bin_remove(instance_l, other);
 		alloc_l->size += other->size;
 		list_del(&other->list);
 		kfree(other);
 	}
+	bin_insert(instance_l, alloc_l);
 
-	mutex_unlock(&lock);
+	mutex_unlock(&instance_l->lock);
 }
 
 phys_addr_t cona_get_alloc_paddr(void *alloc)
@@ -277,6 +330,7 @@ static int init_alloc_list(struct instance *instance)
 								PAGE_SIZE;
 			alloc->in_use = false;
 			list_add_tail(&alloc->list, &instance->alloc_list);
+			bin_insert(instance, alloc);
 			curr_pos = alloc->paddr + alloc->size;
 		}
 
@@ -307,6 +361,7 @@ static int init_alloc_list(struct instance *instance)
 	alloc->size = region_end - curr_pos;
 	alloc->in_use = false;
 	list_add_tail(&alloc->list, &instance->alloc_list);
+	bin_insert(instance, alloc);
 
 	return 0;
 
@@ -323,32 +378,77 @@ static void clean_alloc_list(struct instance *instance)
 							struct alloc, list);
 
 		list_del(&i->list);
+		if (!i->in_use)
+			bin_remove(instance, i);
 
 		kfree(i);
 	}
 }
 
-static struct alloc *find_free_alloc_bestfit(struct instance *instance,
-								size_t size)
+static int size_to_bin(size_t size)
 {
-	size_t best_diff = ~(size_t)0;
-	struct alloc *alloc = NULL, *i;
+	size_t pages = size >> PAGE_SHIFT;
 
-	list_for_each_entry(i, &instance->alloc_list, list) {
-		size_t diff = i->size - size;
-		if (i->in_use || i->size < size)
-			continue;
-		if (diff < best_diff) {
-			alloc = i;
-			best_diff = diff;
+	if (pages == 0)
+		return 0;
+
+	return min_t(int, ilog2(pages), CONA_NR_BINS - 1);
+}
+
+static void bin_insert(struct instance *instance, struct alloc *alloc)
+{
+	int bin = size_to_bin(alloc->size);
+
+	list_add(&alloc->free_list, &instance->bins[bin]);
+	__set_bit(bin, &instance->bin_map);
+}
+
+static void bin_remove(struct instance *instance, struct alloc *alloc)
+{
+	int bin = size_to_bin(alloc->size);
+
+	list_del(&alloc->free_list);
+	if (list_empty(&instance->bins[bin]))
+		__clear_bit(bin, &instance->bin_map);
+}
+
+static struct alloc *find_free_alloc(struct instance *instance, size_t size)
+{
+	int bin;
+
+	/*
+	 * Areas in the bin of the request may be too small, those in any
+	 * bin above it are not (except for the open-ended last bin). Take
+	 * the best fit within the first bin that can serve the request.
+	 */
+	for (bin = find_next_bit(&instance->bin_map, CONA_NR_BINS,
+				 size_to_bin(size));
+	     bin < CONA_NR_BINS;
+	     bin = find_next_bit(&instance->bin_map, CONA_NR_BINS, bin + 1)) {
+		size_t best_diff = ~(size_t)0;
+		struct alloc *alloc = NULL, *i;
+
+		list_for_each_entry(i, &instance->bins[bin], free_list) {
+			size_t diff = i->size - size;
+			if (i->size < size)
+				continue;
+			if (diff < best_diff) {
+				alloc = i;
+				best_diff = diff;
+				if (diff == 0)
+					break;
+			}
 		}
+
+		if (alloc != NULL)
+			return alloc;
 	}
 
-	return alloc != NULL ? alloc : ERR_PTR(-ENOMEM);
+	return ERR_PTR(-ENOMEM);
 }
 
-static struct alloc *split_allocation(struct alloc *alloc,
-							size_t new_alloc_size)
+static struct alloc *split_allocation(struct instance *instance,
+				struct alloc *alloc, size_t new_alloc_size)
 {
 	struct alloc *new_alloc;
 
@@ -356,6 +456,8 @@ static struct alloc *split_allocation(struct alloc *alloc,
 	if (new_alloc == NULL)
 		return ERR_PTR(-ENOMEM);
 
+	bin_remove(instance, alloc);
+
 	new_alloc->in_use = true;
 	new_alloc->paddr = alloc->paddr;
 	new_alloc->size = new_alloc_size;
@@ -363,6 +465,7 @@ static struct alloc *split_allocation(struct alloc *alloc,
 	alloc->paddr += new_alloc_size;
 
 	list_add_tail(&new_alloc->list, &alloc->list);
+	bin_insert(instance, alloc);
 
 	return new_alloc;
 }
@@ -441,33 +544,65 @@ static int print_alloc(struct instance *instance, struct alloc *alloc,
 static int print_alloc_status(struct instance *instance, char **buf,
 							size_t buf_size)
 {
+	size_t len = 0;
+	int frag = 0;
 	int ret;
 	int i;
+	unsigned int bin_count;
+	struct alloc *curr_alloc;
 
-	for (i = 0; i < 2; i++) {
-		size_t buf_size_l;
-		if (i == 0)
-			buf_size_l = 0;
-		else
-			buf_size_l = buf_size;
-
-		ret = snprintf(*buf, buf_size_l, "Overall peak usage:\t%10u "
-				"(%dMB)\nCurrent max usage:\t%10u (%dMB)\n"
-				"Current biggest free:\t%10d (%dMB)\n",
-				instance->cona_status_max_check,
-				instance->cona_status_max_check/1024/1024,
-				instance->cona_status_max_cont,
-				instance->cona_status_max_cont/1024/1024,
-				instance->cona_status_biggest_free,
-				instance->cona_status_biggest_free/1024/1024);
+/* Append to *buf, the caller finds out about truncation from len */
+#define STATUS_PRINT(...) \
+	do { \
+		ret = snprintf(*buf + len, buf_size > len ? buf_size - len : 0, \
+							__VA_ARGS__); \
+		if (ret < 0) \
+			return -ENOMSG; \
+		len += ret; \
+	} while (0)
 
-		if (ret < 0)
-			return -ENOMSG;
-		else if (ret + 1 > buf_size)
-			return -EINVAL;
+	/*
+	 * External fragmentation: the share of free memory that is not in
+	 * the biggest free area, 0% when one allocation could use all of it.
+	 */
+	if (instance->cona_status_free > 0)
+		frag = 100 - (int)div_u64(
+			(u64)instance->cona_status_biggest_free * 100,
+			instance->cona_status_free);
+
+	STATUS_PRINT("Overall peak usage:\t%10u (%dMB)\n"
+			"Current max usage:\t%10u (%dMB)\n"
+			"Current biggest free:\t%10d (%dMB)\n"
+			"Fragmentation:\t\t%10d%%\n",
+			instance->cona_status_max_check,
+			instance->cona_status_max_check/1024/1024,
+			instance->cona_status_max_cont,
+			instance->cona_status_max_cont/1024/1024,
+			instance->cona_status_biggest_free,
+			instance->cona_status_biggest_free/1024/1024,
+			frag);
+
+	STATUS_PRINT("Free areas per bin (2^n pages):");
+	for (i = 0; i < CONA_NR_BINS; i++) {
+		bin_count = 0;
+		list_for_each_entry(curr_alloc, &instance->bins[i], free_list)
+			bin_count++;
+		STATUS_PRINT(" %u", bin_count);
 	}
 
-	*buf += ret;
+	STATUS_PRINT("\nAlloc latency (us):");
+	for (i = 0; i < CONA_NR_LAT_BUCKETS - 1; i++)
+		STATUS_PRINT(" <%u:%u", 1U << i,
+					instance->cona_status_lat_hist[i]);
+	STATUS_PRINT(" >=%u:%u\n", 1U << (i - 1),
+					instance->cona_status_lat_hist[i]);
+
+#undef STATUS_PRINT
+
+	if (len + 1 > buf_size)
+		return -EINVAL;
+
+	*buf += len;
 
 	return 0;
 }
@@ -509,11 +644,15 @@ static int debugfs_allocs_read(struct file *file, char __user *buf,
 
 	mutex_lock(&lock);
 	instance = get_instance_from_file(file);
+	mutex_unlock(&lock);
 	if (IS_ERR(instance)) {
 		ret = PTR_ERR(instance);
-		goto out;
+		kfree(local_buf);
+		return ret;
 	}
 
+	mutex_lock(&instance->lock);
+
 	list_for_each_entry(curr_alloc, &instance->alloc_list, list) {
 		phys_addr_t alloc_offset = get_alloc_offset(instance,
 								curr_alloc);
@@ -572,7 +711,7 @@ static int debugfs_allocs_read(struct file *file, char __user *buf,
 
 out:
 	kfree(local_buf);
-	mutex_unlock(&lock);
+	mutex_unlock(&instance->lock);
 
 	return ret;
 }
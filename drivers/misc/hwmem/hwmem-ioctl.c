@@ -48,6 +48,8 @@ struct hwmem_file {
 	struct mutex lock;
 	struct idr idr; /* id -> struct hwmem_alloc*, ref counted */
 	struct hwmem_alloc *fd_alloc; /* Ref counted */
+	/* Cache maintenance done on behalf of this file instance */
+	struct hwmem_cache_stats cache_stats;
 };
 
 static s32 create_id(struct hwmem_file *hwfile, struct hwmem_alloc *alloc)
@@ -146,30 +148,86 @@ static int release(struct hwmem_file *hwfile, s32 id)
 	return 0;
 }
 
-static int set_cpu_domain(struct hwmem_file *hwfile,
-					struct hwmem_set_domain_request *req)
+static int set_domain(struct hwmem_file *hwfile,
+		struct hwmem_set_domain_request *req, enum hwmem_domain domain)
 {
-	struct hwmem_alloc *alloc;
+	struct hwmem_domain_switch domain_switch;
 
-	alloc = resolve_id(hwfile, req->id);
-	if (IS_ERR(alloc))
-		return PTR_ERR(alloc);
+	domain_switch.alloc = resolve_id(hwfile, req->id);
+	if (IS_ERR(domain_switch.alloc))
+		return PTR_ERR(domain_switch.alloc);
 
-	return hwmem_set_domain(alloc, req->access, HWMEM_DOMAIN_CPU,
-					(struct hwmem_region *)&req->region);
+	domain_switch.access = req->access;
+	domain_switch.domain = domain;
+	domain_switch.region = (struct hwmem_region *)&req->region;
+
+	return hwmem_set_domains(&domain_switch, 1, &hwfile->cache_stats);
+}
+
+static int set_cpu_domain(struct hwmem_file *hwfile,
+					struct hwmem_set_domain_request *req)
+{
+	return set_domain(hwfile, req, HWMEM_DOMAIN_CPU);
 }
 
 static int set_sync_domain(struct hwmem_file *hwfile,
 					struct hwmem_set_domain_request *req)
 {
-	struct hwmem_alloc *alloc;
+	return set_domain(hwfile, req, HWMEM_DOMAIN_SYNC);
+}
 
-	alloc = resolve_id(hwfile, req->id);
-	if (IS_ERR(alloc))
-		return PTR_ERR(alloc);
+static int set_domains(struct hwmem_file *hwfile,
+					struct hwmem_set_domains_request *req)
+{
+	int ret = 0;
+	struct hwmem_set_domains_entry *entries;
+	struct hwmem_domain_switch *switches;
+	u32 i;
+
+	if (req->count == 0)
+		return 0;
+	if (req->count > HWMEM_MAX_SET_DOMAINS)
+		return -EINVAL;
+
+	entries = kmalloc(req->count * sizeof(*entries), GFP_KERNEL);
+	switches = kmalloc(req->count * sizeof(*switches), GFP_KERNEL);
+	if (entries == NULL || switches == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (copy_from_user(entries, (void __user *)req->entries,
+					req->count * sizeof(*entries))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Resolve everything first so that a bad entry leaves all untouched */
+	for (i = 0; i < req->count; i++) {
+		if (entries[i].domain != HWMEM_DOMAIN_SYNC &&
+				entries[i].domain != HWMEM_DOMAIN_CPU) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		switches[i].alloc = resolve_id(hwfile, entries[i].id);
+		if (IS_ERR(switches[i].alloc)) {
+			ret = PTR_ERR(switches[i].alloc);
+			goto out;
+		}
+
+		switches[i].access = entries[i].access;
+		switches[i].domain = entries[i].domain;
+		switches[i].region = (struct hwmem_region *)&entries[i].region;
+	}
+
+	ret = hwmem_set_domains(switches, req->count, &hwfile->cache_stats);
 
-	return hwmem_set_domain(alloc, req->access, HWMEM_DOMAIN_SYNC,
-					(struct hwmem_region *)&req->region);
+out:
+	kfree(switches);
+	kfree(entries);
+
+	return ret;
 }
 
 static int pin(struct hwmem_file *hwfile, struct hwmem_pin_request *req)
@@ -484,6 +542,23 @@ static long hwmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case HWMEM_IMPORT_FD_IOC:
 		ret = import_fd(hwfile, (s32)arg);
 		break;
+	case HWMEM_SET_DOMAINS_IOC:
+		{
+			struct hwmem_set_domains_request req;
+			if (copy_from_user(&req, (void __user *)arg,
+				sizeof(struct hwmem_set_domains_request)))
+				ret = -EFAULT;
+			else
+				ret = set_domains(hwfile, &req);
+		}
+		break;
+	case HWMEM_GET_CACHE_STATS_IOC:
+		if (copy_to_user((void __user *)arg, &hwfile->cache_stats,
+					sizeof(struct hwmem_cache_stats)))
+			ret = -EFAULT;
+		else
+			ret = 0;
+		break;
 	}
 
 	mutex_unlock(&hwfile->lock);
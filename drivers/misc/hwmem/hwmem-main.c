@@ -28,10 +28,13 @@
 #include <linux/io.h>
 #include <linux/kallsyms.h>
 #include <linux/vmalloc.h>
+#include <linux/moduleparam.h>
 #include "cache_handler.h"
 
 #define S32_MAX 2147483647
 
+#define HWMEM_MAX_POOLS 16
+
 struct hwmem_alloc_threadg_info {
 	struct list_head list;
 
@@ -65,6 +68,9 @@ struct hwmem_alloc {
 	struct page **sglist;
 	size_t nr_of_pages;
 
+	/* Buffer pool, see pool_put() */
+	struct list_head pool_lru;
+
 #ifdef CONFIG_DEBUG_FS
 	/* Debug */
 	void *creator;
@@ -78,6 +84,46 @@ static LIST_HEAD(alloc_list);
 static DEFINE_IDR(global_idr);
 static DEFINE_MUTEX(lock);
 
+/* Cache maintenance done on behalf of all clients, protected by lock */
+static struct hwmem_cache_stats cache_stats;
+
+/*
+ * Released buffers of one size, memory type and set of flags, kept mapped
+ * and ready to be handed out again. Protected by lock.
+ */
+struct hwmem_pool {
+	struct list_head list;
+
+	struct hwmem_mem_type_struct *mem_type;
+	size_t size;
+	enum hwmem_alloc_flags flags;
+
+	struct list_head free_list;
+	size_t nr_free;
+
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long rejects;
+	unsigned long evictions;
+};
+
+/* Most recently used first */
+static LIST_HEAD(pool_list);
+/* Pooled buffers of all pools, least recently released first */
+static LIST_HEAD(pool_lru);
+static unsigned int nr_pools;
+static size_t pool_bytes;
+static unsigned long pool_unpooled_allocs;
+
+static unsigned int pool_max_kb = 16384;
+module_param(pool_max_kb, uint, 0644);
+MODULE_PARM_DESC(pool_max_kb, "Memory kept by one buffer pool at most, in kB");
+
+static unsigned int pool_total_max_kb = 32768;
+module_param(pool_total_max_kb, uint, 0644);
+MODULE_PARM_DESC(pool_total_max_kb,
+			"Memory kept by all buffer pools at most, in kB, 0 disables");
+
 static void vm_open(struct vm_area_struct *vma);
 static void vm_close(struct vm_area_struct *vma);
 static struct vm_operations_struct vm_ops = {
@@ -138,7 +184,7 @@ static enum hwmem_access get_access(struct hwmem_alloc *alloc)
 static void clear_alloc_mem(struct hwmem_alloc *alloc)
 {
 	cach_set_domain(&alloc->cach_buf, HWMEM_ACCESS_WRITE,
-						HWMEM_DOMAIN_CPU, NULL);
+						HWMEM_DOMAIN_CPU, NULL, NULL);
 
 	memset(alloc->kaddr, 0, alloc->size);
 }
@@ -146,6 +192,7 @@ static void clear_alloc_mem(struct hwmem_alloc *alloc)
 static void destroy_alloc(struct hwmem_alloc *alloc)
 {
 	list_del(&alloc->list);
+	list_del(&alloc->pool_lru);
 
 	if (alloc->name != 0) {
 		idr_remove(&global_idr, alloc->name);
@@ -229,6 +276,196 @@ static struct hwmem_mem_type_struct *resolve_mem_type(
 	return ERR_PTR(-ENOENT);
 }
 
+/* Buffer pools */
+
+static struct hwmem_pool *lookup_pool(struct hwmem_mem_type_struct *mem_type,
+			size_t size, enum hwmem_alloc_flags flags)
+{
+	struct hwmem_pool *pool;
+
+	list_for_each_entry(pool, &pool_list, list) {
+		if (pool->mem_type == mem_type && pool->size == size &&
+							pool->flags == flags)
+			return pool;
+	}
+
+	return NULL;
+}
+
+/* Like lookup_pool() but also marks the pool as most recently used */
+static struct hwmem_pool *find_pool(struct hwmem_mem_type_struct *mem_type,
+			size_t size, enum hwmem_alloc_flags flags, bool create)
+{
+	struct hwmem_pool *pool;
+
+	pool = lookup_pool(mem_type, size, flags);
+	if (pool != NULL) {
+		list_move(&pool->list, &pool_list);
+		return pool;
+	}
+
+	if (!create)
+		return NULL;
+
+	if (nr_pools < HWMEM_MAX_POOLS) {
+		pool = kzalloc(sizeof(struct hwmem_pool), GFP_KERNEL);
+		if (pool == NULL)
+			return NULL;
+
+		INIT_LIST_HEAD(&pool->free_list);
+		nr_pools++;
+	} else {
+		/* Take over the least recently used empty pool */
+		list_for_each_entry_reverse(pool, &pool_list, list) {
+			if (pool->nr_free == 0)
+				break;
+		}
+		if (&pool->list == &pool_list)
+			return NULL;
+
+		list_del(&pool->list);
+		pool->hits = 0;
+		pool->misses = 0;
+		pool->rejects = 0;
+		pool->evictions = 0;
+	}
+
+	pool->mem_type = mem_type;
+	pool->size = size;
+	pool->flags = flags;
+	list_add(&pool->list, &pool_list);
+
+	return pool;
+}
+
+/*
+ * Parks a released buffer in its pool instead of freeing it. The buffer
+ * keeps its backing memory, kernel mapping and cache state. Returns false
+ * if the buffer has to be destroyed.
+ */
+static bool pool_put(struct hwmem_alloc *alloc)
+{
+	struct hwmem_pool *pool;
+	size_t max_bytes = (size_t)pool_max_kb * 1024;
+	size_t total_max_bytes = (size_t)pool_total_max_kb * 1024;
+
+	if (total_max_bytes == 0 || alloc->kaddr == NULL)
+		return false;
+
+	pool = find_pool(alloc->mem_type, alloc->size, alloc->flags, true);
+	if (pool == NULL)
+		return false;
+
+	if ((pool->nr_free + 1) * pool->size > max_bytes ||
+				pool_bytes + alloc->size > total_max_bytes) {
+		pool->rejects++;
+		return false;
+	}
+
+	list_del(&alloc->list);
+
+	if (alloc->name != 0) {
+		idr_remove(&global_idr, alloc->name);
+		alloc->name = 0;
+	}
+
+	clean_alloc_threadg_info_list(alloc);
+
+	list_add(&alloc->list, &pool->free_list);
+	list_add_tail(&alloc->pool_lru, &pool_lru);
+	pool->nr_free++;
+	pool_bytes += alloc->size;
+
+	return true;
+}
+
+static struct hwmem_alloc *pool_get(struct hwmem_mem_type_struct *mem_type,
+			size_t size, enum hwmem_alloc_flags flags)
+{
+	struct hwmem_pool *pool;
+	struct hwmem_alloc *alloc;
+
+	pool = find_pool(mem_type, size, flags, false);
+	if (pool == NULL) {
+		pool_unpooled_allocs++;
+		return NULL;
+	}
+
+	if (pool->nr_free == 0) {
+		pool->misses++;
+		return NULL;
+	}
+
+	/* Most recently released first, it is the most likely to be cached */
+	alloc = list_first_entry(&pool->free_list, struct hwmem_alloc, list);
+	list_del_init(&alloc->list);
+	list_del_init(&alloc->pool_lru);
+	pool->nr_free--;
+	pool->hits++;
+	pool_bytes -= alloc->size;
+
+	return alloc;
+}
+
+static void pool_evict(struct hwmem_alloc *alloc)
+{
+	struct hwmem_pool *pool;
+
+	pool = lookup_pool(alloc->mem_type, alloc->size, alloc->flags);
+	if (pool != NULL) {
+		pool->nr_free--;
+		pool->evictions++;
+	}
+	pool_bytes -= alloc->size;
+
+	destroy_alloc(alloc);
+}
+
+/* Frees pooled buffers, oldest first, until nr_pages have been freed */
+static unsigned long pool_shrink(unsigned long nr_pages)
+{
+	struct hwmem_alloc *alloc;
+	struct hwmem_alloc *tmp;
+	unsigned long freed = 0;
+
+	list_for_each_entry_safe(alloc, tmp, &pool_lru, pool_lru) {
+		if (freed >= nr_pages)
+			break;
+
+		freed += alloc->size >> PAGE_SHIFT;
+		pool_evict(alloc);
+	}
+
+	return freed;
+}
+
+/*
+ * hwmem allocates with lock held, so lock can only be tried from here or
+ * reclaim would deadlock.
+ */
+static int pool_shrinker_fn(struct shrinker *shrinker,
+						struct shrink_control *sc)
+{
+	if (sc->nr_to_scan) {
+		/* Unmapping may sleep */
+		if (!(sc->gfp_mask & __GFP_WAIT))
+			return -1;
+		if (!mutex_trylock(&lock))
+			return -1;
+
+		pool_shrink(sc->nr_to_scan);
+
+		mutex_unlock(&lock);
+	}
+
+	return ACCESS_ONCE(pool_bytes) >> PAGE_SHIFT;
+}
+
+static struct shrinker pool_shrinker = {
+	.shrink = pool_shrinker_fn,
+	.seeks = DEFAULT_SEEKS,
+};
+
 /* HWMEM API */
 
 struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
@@ -236,6 +473,7 @@ struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
 {
 	int ret;
 	struct hwmem_alloc *alloc;
+	struct hwmem_mem_type_struct *mem_type_struct;
 
 	if (hwdev == NULL) {
 		printk(KERN_ERR "HWMEM: Badly configured\n");
@@ -249,6 +487,29 @@ struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
 
 	size = PAGE_ALIGN(size);
 
+	mem_type_struct = resolve_mem_type(mem_type);
+	if (!IS_ERR(mem_type_struct)) {
+		alloc = pool_get(mem_type_struct, size, flags);
+		if (alloc != NULL) {
+			atomic_set(&alloc->ref_cnt, 1);
+			alloc->default_access = def_access;
+#ifdef CONFIG_DEBUG_FS
+			alloc->creator = __builtin_return_address(0);
+			alloc->creator_tgid = task_tgid_nr(current);
+#endif
+			list_add_tail(&alloc->list, &alloc_list);
+
+			/*
+			 * Whoever had the buffer before may have been anyone,
+			 * and so may anyone it was shared with.
+			 */
+			if (alloc->mem_type->id != HWMEM_MEM_PROTECTED_SYS)
+				clear_alloc_mem(alloc);
+
+			goto out;
+		}
+	}
+
 	alloc = kzalloc(sizeof(struct hwmem_alloc), GFP_KERNEL);
 	if (alloc == NULL) {
 		ret = -ENOMEM;
@@ -256,6 +517,7 @@ struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
 	}
 
 	INIT_LIST_HEAD(&alloc->list);
+	INIT_LIST_HEAD(&alloc->pool_lru);
 	atomic_inc(&alloc->ref_cnt);
 	alloc->flags = flags;
 	alloc->default_access = def_access;
@@ -264,7 +526,7 @@ struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
 	alloc->creator = __builtin_return_address(0);
 	alloc->creator_tgid = task_tgid_nr(current);
 #endif
-	alloc->mem_type = resolve_mem_type(mem_type);
+	alloc->mem_type = mem_type_struct;
 
 	if (IS_ERR(alloc->mem_type)) {
 		ret = PTR_ERR(alloc->mem_type);
@@ -273,6 +535,12 @@ struct hwmem_alloc *hwmem_alloc(size_t size, enum hwmem_alloc_flags flags,
 
 	alloc->allocator_hndl = alloc->mem_type->allocator_api.alloc(
 				alloc->mem_type->allocator_instance, size);
+	if (IS_ERR(alloc->allocator_hndl) && pool_bytes != 0) {
+		/* The pools may be holding the memory we need */
+		pool_shrink(ULONG_MAX);
+		alloc->allocator_hndl = alloc->mem_type->allocator_api.alloc(
+				alloc->mem_type->allocator_instance, size);
+	}
 	if (IS_ERR(alloc->allocator_hndl)) {
 		ret = PTR_ERR(alloc->allocator_hndl);
 		goto allocator_failed;
@@ -328,7 +596,7 @@ void hwmem_release(struct hwmem_alloc *alloc)
 {
 	mutex_lock(&lock);
 
-	if (atomic_dec_and_test(&alloc->ref_cnt))
+	if (atomic_dec_and_test(&alloc->ref_cnt) && !pool_put(alloc))
 		destroy_alloc(alloc);
 
 	mutex_unlock(&lock);
@@ -340,7 +608,8 @@ int hwmem_set_domain(struct hwmem_alloc *alloc, enum hwmem_access access,
 {
 	mutex_lock(&lock);
 
-	cach_set_domain(&alloc->cach_buf, access, domain, region);
+	cach_set_domain(&alloc->cach_buf, access, domain, region,
+								&cache_stats);
 
 	mutex_unlock(&lock);
 
@@ -348,6 +617,50 @@ int hwmem_set_domain(struct hwmem_alloc *alloc, enum hwmem_access access,
 }
 EXPORT_SYMBOL(hwmem_set_domain);
 
+static void add_cache_stats(struct hwmem_cache_stats *to,
+					const struct hwmem_cache_stats *from)
+{
+	to->cleaned_bytes += from->cleaned_bytes;
+	to->invalidated_bytes += from->invalidated_bytes;
+	to->full_flushes += from->full_flushes;
+	to->domain_switches += from->domain_switches;
+}
+
+int hwmem_set_domains(struct hwmem_domain_switch *switches, size_t count,
+					struct hwmem_cache_stats *stats)
+{
+	struct cach_domain_switch cach_switches[HWMEM_MAX_SET_DOMAINS];
+	struct hwmem_cache_stats local_stats;
+	size_t i;
+
+	if (count == 0)
+		return 0;
+	if (count > HWMEM_MAX_SET_DOMAINS)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		cach_switches[i].buf = &switches[i].alloc->cach_buf;
+		cach_switches[i].access = switches[i].access;
+		cach_switches[i].domain = switches[i].domain;
+		cach_switches[i].region = switches[i].region;
+	}
+
+	memset(&local_stats, 0, sizeof(local_stats));
+
+	mutex_lock(&lock);
+
+	cach_set_domains(cach_switches, count, &local_stats);
+	add_cache_stats(&cache_stats, &local_stats);
+
+	mutex_unlock(&lock);
+
+	if (stats != NULL)
+		add_cache_stats(stats, &local_stats);
+
+	return 0;
+}
+EXPORT_SYMBOL(hwmem_set_domains);
+
 int hwmem_pin(struct hwmem_alloc *alloc, struct hwmem_mem_chunk *mem_chunks,
 							u32 *mem_chunks_length)
 {
@@ -769,12 +1082,97 @@ out:
 	return ret;
 }
 
+static ssize_t debugfs_cache_stats_read(struct file *file,
+				char __user *buf, size_t count, loff_t *f_pos)
+{
+	char local_buf[192];
+	struct hwmem_cache_stats stats;
+	int len;
+
+	mutex_lock(&lock);
+	stats = cache_stats;
+	mutex_unlock(&lock);
+
+	len = snprintf(local_buf, sizeof(local_buf),
+			"Cleaned bytes: %llu\n"
+			"Invalidated bytes: %llu\n"
+			"Full flushes: %u\n"
+			"Domain switches: %u\n",
+			(unsigned long long)stats.cleaned_bytes,
+			(unsigned long long)stats.invalidated_bytes,
+			stats.full_flushes, stats.domain_switches);
+
+	return simple_read_from_buffer(buf, count, f_pos, local_buf, len);
+}
+
+static const struct file_operations debugfs_cache_stats_fops = {
+	.owner = THIS_MODULE,
+	.read  = debugfs_cache_stats_read,
+};
+
+static ssize_t debugfs_pools_read(struct file *file, char __user *buf,
+						size_t count, loff_t *f_pos)
+{
+	struct hwmem_pool *pool;
+	unsigned long hits = 0;
+	unsigned long allocs = pool_unpooled_allocs;
+	char *local_buf;
+	size_t len = 0;
+	ssize_t ret;
+
+	local_buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (local_buf == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&lock);
+
+	list_for_each_entry(pool, &pool_list, list) {
+		unsigned long pool_allocs = pool->hits + pool->misses;
+
+		hits += pool->hits;
+		allocs += pool_allocs;
+
+		len += scnprintf(local_buf + len, PAGE_SIZE - len,
+			"Memory type: %u size: %zu flags: %#x\n"
+			"\tFree buffers: %zu\n"
+			"\tHits: %lu misses: %lu (%lu%% hit rate)\n"
+			"\tRejected: %lu evicted: %lu\n",
+			pool->mem_type->id, pool->size, pool->flags,
+			pool->nr_free, pool->hits, pool->misses,
+			pool_allocs ? pool->hits * 100 / pool_allocs : 0,
+			pool->rejects, pool->evictions);
+	}
+
+	len += scnprintf(local_buf + len, PAGE_SIZE - len,
+		"Pooled: %zu kB of %u kB\n"
+		"Allocations: %lu, from pools: %lu (%lu%%)\n",
+		pool_bytes / 1024, pool_total_max_kb, allocs, hits,
+		allocs ? hits * 100 / allocs : 0);
+
+	mutex_unlock(&lock);
+
+	ret = simple_read_from_buffer(buf, count, f_pos, local_buf, len);
+
+	kfree(local_buf);
+
+	return ret;
+}
+
+static const struct file_operations debugfs_pools_fops = {
+	.owner = THIS_MODULE,
+	.read  = debugfs_pools_read,
+};
+
 static void init_debugfs(void)
 {
 	/* Hwmem is never unloaded so dropping the dentrys is ok. */
 	struct dentry *debugfs_root_dir = debugfs_create_dir("hwmem", NULL);
 	(void)debugfs_create_file("allocs", 0444, debugfs_root_dir, 0,
 							&debugfs_allocs_fops);
+	(void)debugfs_create_file("cache_stats", 0444, debugfs_root_dir, 0,
+						&debugfs_cache_stats_fops);
+	(void)debugfs_create_file("pools", 0444, debugfs_root_dir, 0,
+							&debugfs_pools_fops);
 }
 
 #endif /* #ifdef CONFIG_DEBUG_FS */
@@ -806,6 +1204,8 @@ static int __devinit hwmem_probe(struct platform_device *pdev)
 		dev_warn(&pdev->dev, "Failed to start hwmem-ioctl, continuing"
 								" anyway\n");
 
+	register_shrinker(&pool_shrinker);
+
 #ifdef CONFIG_DEBUG_FS
 	init_debugfs();
 #endif
@@ -1,14 +1,16 @@
 /*
- * zcache.c
+ * zcache-main.c
  *
  * Copyright (c) 2010,2011, Dan Magenheimer, Oracle Corp.
  * Copyright (c) 2010,2011, Nitin Gupta
  *
  * Zcache provides an in-kernel "host implementation" for transcendent memory
  * and, thus indirectly, for cleancache and frontswap.  Zcache includes two
- * page-accessible memory [1] interfaces, both utilizing lzo1x compression:
+ * page-accessible memory [1] interfaces, both utilizing compression:
  * 1) "compression buddies" ("zbud") is used for ephemeral pages
  * 2) xvmalloc is used for persistent pages.
+ * Compression goes through the crypto API, lzo1x by default, and the
+ * compressor can be chosen per pool (see "zcache compressors" below).
  * Xvmalloc (based on the TLSF allocator) has very low fragmentation
  * so maximizes space efficiency, while zbud allows pairs (and potentially,
  * in the future, more than a pair of) compressed pages to be closely linked
@@ -20,12 +22,18 @@
  */
 
 #include <linux/cpu.h>
+#include <linux/crypto.h>
 #include <linux/highmem.h>
+#include <linux/jiffies.h>
 #include <linux/list.h>
-#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
+#include <linux/string.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <linux/atomic.h>
 #include "tmem.h"
 
@@ -63,7 +71,9 @@
  * "buddied" list if it is fully populated  with two zbuds; or
  * (3) one of PAGE_SIZE/64 "unbuddied" lists indexed by how many chunks
  * the one unbuddied zbud uses.  The data inside a zbpg cannot be
- * read or written unless the zbpg's lock is held.
+ * read or written unless the zbpg's lock is held.  Every zbpg with
+ * zbuds is also on the LRU list, ordered by when a zbud was last put
+ * into it, which is the order in which zbpgs are evicted.
  */
 
 #define ZBH_SENTINEL  0x43214321
@@ -76,11 +86,14 @@ struct zbud_hdr {
 	struct tmem_oid oid;
 	uint32_t index;
 	uint16_t size; /* compressed size in bytes, zero means unused */
+	uint8_t comp; /* compressor the data was compressed with */
 	DECL_SENTINEL
 };
 
 struct zbud_page {
 	struct list_head bud_list;
+	struct list_head lru;
+	unsigned long last_put; /* jiffies */
 	spinlock_t lock;
 	struct zbud_hdr buddy[ZBUD_MAX_BUDS];
 	DECL_SENTINEL
@@ -105,7 +118,10 @@ static unsigned long zbud_cumul_chunk_counts[NCHUNKS];
 struct list_head zbud_buddied_list;
 static unsigned long zcache_zbud_buddied_count;
 
-/* protects the buddied list and all unbuddied lists */
+/* oldest first, see zbud_evict_lru() */
+static LIST_HEAD(zbud_lru_list);
+
+/* protects the buddied list, all unbuddied lists and the LRU list */
 static DEFINE_SPINLOCK(zbud_budlists_spinlock);
 
 static LIST_HEAD(zbpg_unused_list);
@@ -124,6 +140,8 @@ static unsigned long zcache_compress_poor;
 /* forward references */
 static void *zcache_get_free_page(void);
 static void zcache_free_page(void *p);
+static int zcache_decompress(unsigned comp, void *src, unsigned slen,
+				struct page *page);
 
 /*
  * zbud helper functions
@@ -201,6 +219,7 @@ static struct zbud_page *zbud_alloc_raw_page(void)
 		zbpg = zcache_get_free_page();
 	if (likely(zbpg != NULL)) {
 		INIT_LIST_HEAD(&zbpg->bud_list);
+		INIT_LIST_HEAD(&zbpg->lru);
 		zh0 = &zbpg->buddy[0]; zh1 = &zbpg->buddy[1];
 		spin_lock_init(&zbpg->lock);
 		if (recycled) {
@@ -226,6 +245,7 @@ static void zbud_free_raw_page(struct zbud_page *zbpg)
 
 	ASSERT_SENTINEL(zbpg, ZBPG);
 	BUG_ON(!list_empty(&zbpg->bud_list));
+	BUG_ON(!list_empty(&zbpg->lru));
 	ASSERT_SPINLOCK(&zbpg->lock);
 	BUG_ON(zh0->size != 0 || tmem_oid_valid(&zh0->oid));
 	BUG_ON(zh1->size != 0 || tmem_oid_valid(&zh1->oid));
@@ -279,6 +299,7 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 		spin_lock(&zbud_budlists_spinlock);
 		BUG_ON(list_empty(&zbud_unbuddied[chunks].list));
 		list_del_init(&zbpg->bud_list);
+		list_del_init(&zbpg->lru);
 		zbud_unbuddied[chunks].count--;
 		spin_unlock(&zbud_budlists_spinlock);
 		zbud_free_raw_page(zbpg);
@@ -295,7 +316,7 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 }
 
 static struct zbud_hdr *zbud_create(uint32_t pool_id, struct tmem_oid *oid,
-					uint32_t index, struct page *page,
+					uint32_t index, unsigned comp,
 					void *cdata, unsigned size)
 {
 	struct zbud_hdr *zh0, *zh1, *zh = NULL;
@@ -348,8 +369,11 @@ found_unbuddied:
 	zcache_zbud_buddied_count++;
 
 init_zh:
+	list_move_tail(&zbpg->lru, &zbud_lru_list);
+	zbpg->last_put = jiffies;
 	SET_SENTINEL(zh, ZBH);
 	zh->size = size;
+	zh->comp = comp;
 	zh->index = index;
 	zh->oid = *oid;
 	zh->pool_id = pool_id;
@@ -372,8 +396,7 @@ static int zbud_decompress(struct page *page, struct zbud_hdr *zh)
 {
 	struct zbud_page *zbpg;
 	unsigned budnum = zbud_budnum(zh);
-	size_t out_len = PAGE_SIZE;
-	char *to_va, *from_va;
+	char *from_va;
 	unsigned size;
 	int ret = 0;
 
@@ -386,13 +409,9 @@ static int zbud_decompress(struct page *page, struct zbud_hdr *zh)
 	}
 	ASSERT_SENTINEL(zh, ZBH);
 	BUG_ON(zh->size == 0 || zh->size > zbud_max_buddy_size());
-	to_va = kmap_atomic(page, KM_USER0);
 	size = zh->size;
 	from_va = zbud_data(zh, size);
-	ret = lzo1x_decompress_safe(from_va, size, to_va, &out_len);
-	BUG_ON(ret != LZO_E_OK);
-	BUG_ON(out_len != PAGE_SIZE);
-	kunmap_atomic(to_va, KM_USER0);
+	ret = zcache_decompress(zh->comp, from_va, size, page);
 out:
 	spin_unlock(&zbpg->lock);
 	return ret;
@@ -400,15 +419,17 @@ out:
 
 /*
  * The following routines handle shrinking of ephemeral pages by evicting
- * pages "least valuable" first.
+ * the pages that have gone longest without a put first.
  */
 
 static unsigned long zcache_evicted_raw_pages;
 static unsigned long zcache_evicted_buddied_pages;
 static unsigned long zcache_evicted_unbuddied_pages;
+static unsigned long zcache_evicted_cold_pages;
 
 static struct tmem_pool *zcache_get_pool_by_id(uint32_t poolid);
 static void zcache_put_pool(struct tmem_pool *pool);
+static void zcache_pool_evicted(struct tmem_pool *pool);
 
 /*
  * Flush and free all zbuds in a zbpg, then free the pageframe
@@ -438,6 +459,7 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
 		pool = zcache_get_pool_by_id(pool_id[i]);
 		if (pool != NULL) {
 			tmem_flush_page(pool, &oid[i], index[i]);
+			zcache_pool_evicted(pool);
 			zcache_put_pool(pool);
 		}
 	}
@@ -446,6 +468,62 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
 	zbud_free_raw_page(zbpg);
 }
 
+/*
+ * Take a locked zbpg off the bud lists and the LRU list, turning it into
+ * a "zombie" that zbud_free_and_delist() and zbud_decompress() ignore.
+ */
+static void zbud_unlist_zbpg(struct zbud_page *zbpg)
+{
+	struct zbud_hdr *zh0 = &zbpg->buddy[0], *zh1 = &zbpg->buddy[1];
+	unsigned chunks;
+
+	ASSERT_SPINLOCK(&zbpg->lock);
+	ASSERT_SPINLOCK(&zbud_budlists_spinlock);
+	if (zh0->size != 0 && zh1->size != 0) {
+		zcache_zbud_buddied_count--;
+		zcache_evicted_buddied_pages++;
+	} else {
+		chunks = zbud_size_to_chunks(zh0->size ? zh0->size : zh1->size);
+		zbud_unbuddied[chunks].count--;
+		zcache_evicted_unbuddied_pages++;
+	}
+	list_del_init(&zbpg->bud_list);
+	list_del_init(&zbpg->lru);
+}
+
+/*
+ * Evict up to nr zbpgs from the cold end of the LRU list, stopping at the
+ * first zbpg put into after cutoff (in jiffies).  Returns how many were
+ * evicted.
+ */
+static int zbud_evict_lru(int nr, unsigned long cutoff)
+{
+	struct zbud_page *zbpg;
+	int evicted = 0;
+
+	if (nr <= 0)
+		goto out;
+retry_lru:
+	spin_lock_bh(&zbud_budlists_spinlock);
+	list_for_each_entry(zbpg, &zbud_lru_list, lru) {
+		if (time_after(zbpg->last_put, cutoff))
+			break;
+		if (unlikely(!spin_trylock(&zbpg->lock)))
+			continue;
+		zbud_unlist_zbpg(zbpg);
+		spin_unlock(&zbud_budlists_spinlock);
+		/* want budlists unlocked when doing zbpg eviction */
+		zbud_evict_zbpg(zbpg);
+		local_bh_enable();
+		if (++evicted >= nr)
+			goto out;
+		goto retry_lru;
+	}
+	spin_unlock_bh(&zbud_budlists_spinlock);
+out:
+	return evicted;
+}
+
 /*
  * Free nr pages.  This code is funky because we want to hold the locks
  * protecting various lists for as short a time as possible, and in some
@@ -457,7 +535,6 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
 static void zbud_evict_pages(int nr)
 {
 	struct zbud_page *zbpg;
-	int i;
 
 	/* first try freeing any pages on unused list */
 retry_unused_list:
@@ -478,53 +555,8 @@ retry_unused_list:
 	}
 	spin_unlock_bh(&zbpg_unused_list_spinlock);
 
-	/* now try freeing unbuddied pages, starting with least space avail */
-	for (i = 0; i < MAX_CHUNK; i++) {
-retry_unbud_list_i:
-		spin_lock_bh(&zbud_budlists_spinlock);
-		if (list_empty(&zbud_unbuddied[i].list)) {
-			spin_unlock_bh(&zbud_budlists_spinlock);
-			continue;
-		}
-		list_for_each_entry(zbpg, &zbud_unbuddied[i].list, bud_list) {
-			if (unlikely(!spin_trylock(&zbpg->lock)))
-				continue;
-			list_del_init(&zbpg->bud_list);
-			zbud_unbuddied[i].count--;
-			spin_unlock(&zbud_budlists_spinlock);
-			zcache_evicted_unbuddied_pages++;
-			/* want budlists unlocked when doing zbpg eviction */
-			zbud_evict_zbpg(zbpg);
-			local_bh_enable();
-			if (--nr <= 0)
-				goto out;
-			goto retry_unbud_list_i;
-		}
-		spin_unlock_bh(&zbud_budlists_spinlock);
-	}
-
-	/* as a last resort, free buddied pages */
-retry_bud_list:
-	spin_lock_bh(&zbud_budlists_spinlock);
-	if (list_empty(&zbud_buddied_list)) {
-		spin_unlock_bh(&zbud_budlists_spinlock);
-		goto out;
-	}
-	list_for_each_entry(zbpg, &zbud_buddied_list, bud_list) {
-		if (unlikely(!spin_trylock(&zbpg->lock)))
-			continue;
-		list_del_init(&zbpg->bud_list);
-		zcache_zbud_buddied_count--;
-		spin_unlock(&zbud_budlists_spinlock);
-		zcache_evicted_buddied_pages++;
-		/* want budlists unlocked when doing zbpg eviction */
-		zbud_evict_zbpg(zbpg);
-		local_bh_enable();
-		if (--nr <= 0)
-			goto out;
-		goto retry_bud_list;
-	}
-	spin_unlock_bh(&zbud_budlists_spinlock);
+	/* then the least recently put zbpgs, buddied or not */
+	zbud_evict_lru(nr, jiffies);
 out:
 	return;
 }
@@ -586,7 +618,7 @@ static int zbud_show_cumul_chunk_counts(char *buf)
 
 /**********
  * This "zv" PAM implementation combines the TLSF-based xvMalloc
- * with lzo1x compression to maximize the amount of data that can
+ * with compression to maximize the amount of data that can
  * be packed into a physical page.
  *
  * Zv represents a PAM page with the index and object (plus a "size" value
@@ -599,6 +631,7 @@ struct zv_hdr {
 	uint32_t pool_id;
 	struct tmem_oid oid;
 	uint32_t index;
+	uint8_t comp; /* compressor the data was compressed with */
 	DECL_SENTINEL
 };
 
@@ -606,7 +639,7 @@ static const int zv_max_page_size = (PAGE_SIZE / 8) * 7;
 
 static struct zv_hdr *zv_create(struct xv_pool *xvpool, uint32_t pool_id,
 				struct tmem_oid *oid, uint32_t index,
-				void *cdata, unsigned clen)
+				unsigned comp, void *cdata, unsigned clen)
 {
 	struct page *page;
 	struct zv_hdr *zv = NULL;
@@ -620,6 +653,7 @@ static struct zv_hdr *zv_create(struct xv_pool *xvpool, uint32_t pool_id,
 		goto out;
 	zv = kmap_atomic(page, KM_USER0) + offset;
 	zv->index = index;
+	zv->comp = comp;
 	zv->oid = *oid;
 	zv->pool_id = pool_id;
 	SET_SENTINEL(zv, ZVH);
@@ -649,20 +683,12 @@ static void zv_free(struct xv_pool *xvpool, struct zv_hdr *zv)
 
 static void zv_decompress(struct page *page, struct zv_hdr *zv)
 {
-	size_t clen = PAGE_SIZE;
-	char *to_va;
 	unsigned size;
-	int ret;
 
 	ASSERT_SENTINEL(zv, ZVH);
 	size = xv_get_object_size(zv) - sizeof(*zv);
 	BUG_ON(size == 0 || size > zv_max_page_size);
-	to_va = kmap_atomic(page, KM_USER0);
-	ret = lzo1x_decompress_safe((char *)zv + sizeof(*zv),
-					size, to_va, &clen);
-	kunmap_atomic(to_va, KM_USER0);
-	BUG_ON(ret != LZO_E_OK);
-	BUG_ON(clen != PAGE_SIZE);
+	zcache_decompress(zv->comp, (char *)zv + sizeof(*zv), size, page);
 }
 
 /*
@@ -684,6 +710,45 @@ static struct {
 	struct xv_pool *xvpool;
 } zcache_client;
 
+/*
+ * Per-pool latencies, in ns, of the shims below as seen by cleancache and
+ * frontswap.  Like the other zcache counters they are updated without
+ * locks, so they are approximate.
+ */
+struct zcache_lat {
+	unsigned long count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+/* zcache's side of a tmem pool */
+struct zcache_pool {
+	struct tmem_pool tmem;
+	unsigned comp; /* compressor for new puts, see zcache_comps */
+	unsigned long failed_puts;
+	unsigned long evicted;
+	struct zcache_lat put;
+	struct zcache_lat hit;
+	struct zcache_lat miss;
+};
+
+#define zcache_pool(_pool) container_of(_pool, struct zcache_pool, tmem)
+
+static void zcache_lat_add(struct zcache_lat *lat, u64 start)
+{
+	u64 ns = local_clock() - start;
+
+	lat->count++;
+	lat->total_ns += ns;
+	if (ns > lat->max_ns)
+		lat->max_ns = ns;
+}
+
+static void zcache_pool_evicted(struct tmem_pool *pool)
+{
+	zcache_pool(pool)->evicted++;
+}
+
 /*
  * Tmem operations assume the poolid implies the invoking client.
  * Zcache only has one client (the kernel itself), so translate
@@ -723,6 +788,40 @@ static unsigned long zcache_aborted_shrink;
  */
 static DEFINE_SPINLOCK(zcache_direct_reclaim_lock);
 
+/*
+ * Age based eviction: if zcache_eph_max_age (seconds) is set, zbpgs
+ * nobody has put into for that long are evicted in the background, so
+ * that cold pages are gone before reclaim has to go through the shrinker
+ * for them. The work is deferrable, so it does not wake an idle CPU.
+ */
+static unsigned long zcache_eph_max_age;
+
+#define ZBUD_AGE_EVICT_BATCH 32
+
+static void zbud_age_evict(struct work_struct *work);
+static DECLARE_DEFERRED_WORK(zbud_age_work, zbud_age_evict);
+
+static void zbud_age_evict(struct work_struct *work)
+{
+	unsigned long max_age = ACCESS_ONCE(zcache_eph_max_age);
+	int evicted;
+
+	if (max_age == 0)
+		return;
+	do {
+		if (!spin_trylock(&zcache_direct_reclaim_lock))
+			break;
+		evicted = zbud_evict_lru(ZBUD_AGE_EVICT_BATCH,
+					 jiffies - max_age * HZ);
+		spin_unlock(&zcache_direct_reclaim_lock);
+		zcache_evicted_cold_pages += evicted;
+		cond_resched();
+	} while (evicted == ZBUD_AGE_EVICT_BATCH);
+	/* zcache_store_eph_max_age() restarts it if set again */
+	if (ACCESS_ONCE(zcache_eph_max_age))
+		schedule_delayed_work(&zbud_age_work, HZ);
+}
+
 /*
  * for now, used named slabs so can easily track usage; later can
  * either just use kmalloc, or perhaps add a slab-like allocator
@@ -899,19 +998,21 @@ static atomic_t zcache_curr_pers_pampd_count = ATOMIC_INIT(0);
 static unsigned long zcache_curr_pers_pampd_count_max;
 
 /* forward reference */
-static int zcache_compress(struct page *from, void **out_va, size_t *out_len);
+static int zcache_compress(struct page *from, unsigned comp,
+				void **out_va, unsigned *out_len);
 
 static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 				 uint32_t index, struct page *page)
 {
 	void *pampd = NULL, *cdata;
-	size_t clen;
+	unsigned clen;
 	int ret;
 	bool ephemeral = is_ephemeral(pool);
+	unsigned comp = zcache_pool(pool)->comp;
 	unsigned long count;
 
 	if (ephemeral) {
-		ret = zcache_compress(page, &cdata, &clen);
+		ret = zcache_compress(page, comp, &cdata, &clen);
 		if (ret == 0)
 
 			goto out;
@@ -920,7 +1021,7 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 			goto out;
 		}
 		pampd = (void *)zbud_create(pool->pool_id, oid, index,
-						page, cdata, clen);
+						comp, cdata, clen);
 		if (pampd != NULL) {
 			count = atomic_inc_return(&zcache_curr_eph_pampd_count);
 			if (count > zcache_curr_eph_pampd_count_max)
@@ -935,7 +1036,7 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 		if (atomic_read(&zcache_curr_pers_pampd_count) >
 							3 * totalram_pages / 4)
 			goto out;
-		ret = zcache_compress(page, &cdata, &clen);
+		ret = zcache_compress(page, comp, &cdata, &clen);
 		if (ret == 0)
 			goto out;
 		if (clen > zv_max_page_size) {
@@ -943,7 +1044,7 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 			goto out;
 		}
 		pampd = (void *)zv_create(zcache_client.xvpool, pool->pool_id,
-						oid, index, cdata, clen);
+						oid, index, comp, cdata, clen);
 		if (pampd == NULL)
 			goto out;
 		count = atomic_inc_return(&zcache_curr_pers_pampd_count);
@@ -993,36 +1094,151 @@ static struct tmem_pamops zcache_pamops = {
 	.free = zcache_pampd_free,
 };
 
+/*
+ * zcache compressors
+ *
+ * Compression goes through the crypto API, so any compression algorithm
+ * built into the kernel ("lzo", "deflate", ...) can be used.  Compressors
+ * are loaded by name, from the "zcache=" boot parameter or when written
+ * to one of the compressor sysfs files, and are never unloaded: pages
+ * compressed with them may stay around as long as their pool does.  Each
+ * zbud and zv records which compressor it was compressed with, so the
+ * compressor of a pool can be changed at any time and only affects the
+ * puts after the change.
+ */
+
+#define ZCACHE_MAX_COMPS 4
+#define ZCACHE_DEFAULT_COMP "lzo"
+
+struct zcache_comp {
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_comp * __percpu *tfms;
+};
+
+static struct zcache_comp zcache_comps[ZCACHE_MAX_COMPS];
+static unsigned zcache_nr_comps;
+
+/* serializes loading compressors */
+static DEFINE_MUTEX(zcache_comps_mutex);
+
+/* compressors of new ephemeral and persistent pools */
+static unsigned zcache_eph_comp;
+static unsigned zcache_pers_comp;
+
+static void zcache_comp_free_tfms(struct crypto_comp * __percpu *tfms)
+{
+	struct crypto_comp *tfm;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		tfm = *per_cpu_ptr(tfms, cpu);
+		if (tfm != NULL)
+			crypto_free_comp(tfm);
+	}
+	free_percpu(tfms);
+}
+
+/*
+ * Returns the index in zcache_comps of the named compressor, loading it
+ * first if needed, or a negative errno.  A tfm is allocated for every
+ * possible cpu up front so that cpu hotplug doesn't have to.
+ */
+static int zcache_comp_load(const char *name)
+{
+	struct crypto_comp * __percpu *tfms;
+	struct crypto_comp *tfm;
+	unsigned int cpu;
+	int i, ret;
+
+	mutex_lock(&zcache_comps_mutex);
+	for (i = 0; i < zcache_nr_comps; i++)
+		if (!strcmp(zcache_comps[i].name, name))
+			goto found;
+	ret = -ENOSPC;
+	if (zcache_nr_comps >= ZCACHE_MAX_COMPS)
+		goto out;
+	ret = -ENOENT;
+	if (strlen(name) >= CRYPTO_MAX_ALG_NAME || !crypto_has_comp(name, 0, 0))
+		goto out;
+	ret = -ENOMEM;
+	tfms = alloc_percpu(struct crypto_comp *);
+	if (tfms == NULL)
+		goto out;
+	for_each_possible_cpu(cpu) {
+		tfm = crypto_alloc_comp(name, 0, 0);
+		if (IS_ERR(tfm)) {
+			ret = PTR_ERR(tfm);
+			zcache_comp_free_tfms(tfms);
+			goto out;
+		}
+		*per_cpu_ptr(tfms, cpu) = tfm;
+	}
+	strcpy(zcache_comps[i].name, name);
+	zcache_comps[i].tfms = tfms;
+	/* the compressor must be complete before its index is handed out */
+	smp_wmb();
+	zcache_nr_comps++;
+	pr_info("zcache: loaded compressor %s\n", name);
+found:
+	ret = i;
+out:
+	mutex_unlock(&zcache_comps_mutex);
+	return ret;
+}
+
 /*
  * zcache compression/decompression and related per-cpu stuff
  */
 
-#define LZO_WORKMEM_BYTES LZO1X_1_MEM_COMPRESS
-#define LZO_DSTMEM_PAGE_ORDER 1
-static DEFINE_PER_CPU(unsigned char *, zcache_workmem);
+#define ZCACHE_DSTMEM_PAGE_ORDER 1
 static DEFINE_PER_CPU(unsigned char *, zcache_dstmem);
 
-static int zcache_compress(struct page *from, void **out_va, size_t *out_len)
+static int zcache_compress(struct page *from, unsigned comp,
+				void **out_va, unsigned *out_len)
 {
 	int ret = 0;
 	unsigned char *dmem = __get_cpu_var(zcache_dstmem);
-	unsigned char *wmem = __get_cpu_var(zcache_workmem);
-	char *from_va;
+	struct crypto_comp *tfm;
+	unsigned char *from_va;
 
 	BUG_ON(!irqs_disabled());
-	if (unlikely(dmem == NULL || wmem == NULL))
+	if (unlikely(dmem == NULL))
 		goto out;  /* no buffer, so can't compress */
+	tfm = *this_cpu_ptr(zcache_comps[comp].tfms);
 	from_va = kmap_atomic(from, KM_USER0);
 	mb();
-	ret = lzo1x_1_compress(from_va, PAGE_SIZE, dmem, out_len, wmem);
-	BUG_ON(ret != LZO_E_OK);
-	*out_va = dmem;
+	*out_len = PAGE_SIZE << ZCACHE_DSTMEM_PAGE_ORDER;
+	ret = crypto_comp_compress(tfm, from_va, PAGE_SIZE, dmem, out_len);
 	kunmap_atomic(from_va, KM_USER0);
+	if (unlikely(ret)) {
+		/* e.g. deflate doesn't fit its output into dmem */
+		ret = 0;
+		goto out;
+	}
+	*out_va = dmem;
 	ret = 1;
 out:
 	return ret;
 }
 
+static int zcache_decompress(unsigned comp, void *src, unsigned slen,
+				struct page *page)
+{
+	struct crypto_comp *tfm;
+	unsigned dlen = PAGE_SIZE;
+	unsigned char *to_va;
+	int ret;
+
+	BUG_ON(!irqs_disabled());
+	BUG_ON(comp >= zcache_nr_comps);
+	tfm = *this_cpu_ptr(zcache_comps[comp].tfms);
+	to_va = kmap_atomic(page, KM_USER0);
+	ret = crypto_comp_decompress(tfm, src, slen, to_va, &dlen);
+	kunmap_atomic(to_va, KM_USER0);
+	BUG_ON(ret != 0);
+	BUG_ON(dlen != PAGE_SIZE);
+	return ret;
+}
 
 static int zcache_cpu_notifier(struct notifier_block *nb,
 				unsigned long action, void *pcpu)
@@ -1034,18 +1250,13 @@ static int zcache_cpu_notifier(struct notifier_block *nb,
 	case CPU_UP_PREPARE:
 		per_cpu(zcache_dstmem, cpu) = (void *)__get_free_pages(
 			GFP_KERNEL | __GFP_REPEAT,
-			LZO_DSTMEM_PAGE_ORDER),
-		per_cpu(zcache_workmem, cpu) =
-			kzalloc(LZO1X_MEM_COMPRESS,
-				GFP_KERNEL | __GFP_REPEAT);
+			ZCACHE_DSTMEM_PAGE_ORDER);
 		break;
 	case CPU_DEAD:
 	case CPU_UP_CANCELED:
 		free_pages((unsigned long)per_cpu(zcache_dstmem, cpu),
-				LZO_DSTMEM_PAGE_ORDER);
+				ZCACHE_DSTMEM_PAGE_ORDER);
 		per_cpu(zcache_dstmem, cpu) = NULL;
-		kfree(per_cpu(zcache_workmem, cpu));
-		per_cpu(zcache_workmem, cpu) = NULL;
 		kp = &per_cpu(zcache_preloads, cpu);
 		while (kp->nr) {
 			kmem_cache_free(zcache_objnode_cache,
@@ -1100,6 +1311,173 @@ static struct notifier_block zcache_cpu_notifier_block = {
 		.show = zcache_##_name##_show, \
 	}
 
+#define ZCACHE_SYSFS_RW_CUSTOM(_name, _show, _store) \
+	static ssize_t zcache_##_name##_show(struct kobject *kobj, \
+				struct kobj_attribute *attr, char *buf) \
+	{ \
+	    return _show(buf); \
+	} \
+	static ssize_t zcache_##_name##_store(struct kobject *kobj, \
+				struct kobj_attribute *attr, \
+				const char *buf, size_t count) \
+	{ \
+	    return _store(buf, count); \
+	} \
+	static struct kobj_attribute zcache_##_name##_attr = { \
+		.attr = { .name = __stringify(_name), .mode = 0644 }, \
+		.show = zcache_##_name##_show, \
+		.store = zcache_##_name##_store, \
+	}
+
+static int zcache_show_compressors(char *buf)
+{
+	unsigned i, nr = ACCESS_ONCE(zcache_nr_comps);
+	char *p = buf;
+
+	for (i = 0; i < nr; i++)
+		p += sprintf(p, "%s%s", i ? " " : "", zcache_comps[i].name);
+	p += sprintf(p, "\n");
+	return p - buf;
+}
+
+static int zcache_show_comp(unsigned comp, char *buf)
+{
+	return sprintf(buf, "%s\n", zcache_comps[comp].name);
+}
+
+static ssize_t zcache_store_comp(unsigned *comp, const char *buf,
+					size_t count)
+{
+	char name[CRYPTO_MAX_ALG_NAME];
+	int ret;
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	memcpy(name, buf, count);
+	name[count] = '\0';
+	ret = zcache_comp_load(strim(name));
+	if (ret < 0)
+		return ret;
+	*comp = ret;
+	return count;
+}
+
+static int zcache_show_eph_compressor(char *buf)
+{
+	return zcache_show_comp(zcache_eph_comp, buf);
+}
+
+static ssize_t zcache_store_eph_compressor(const char *buf, size_t count)
+{
+	return zcache_store_comp(&zcache_eph_comp, buf, count);
+}
+
+static int zcache_show_pers_compressor(char *buf)
+{
+	return zcache_show_comp(zcache_pers_comp, buf);
+}
+
+static ssize_t zcache_store_pers_compressor(const char *buf, size_t count)
+{
+	return zcache_store_comp(&zcache_pers_comp, buf, count);
+}
+
+/* "<pool id> <compressor>" per line */
+static int zcache_show_pool_compressors(char *buf)
+{
+	struct tmem_pool *pool;
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < MAX_POOLS_PER_CLIENT; i++) {
+		pool = zcache_get_pool_by_id(i);
+		if (pool == NULL)
+			continue;
+		p += sprintf(p, "%d %s\n", i,
+			zcache_comps[zcache_pool(pool)->comp].name);
+		zcache_put_pool(pool);
+	}
+	return p - buf;
+}
+
+static ssize_t zcache_store_pool_compressors(const char *buf, size_t count)
+{
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct tmem_pool *pool;
+	unsigned poolid;
+	int ret;
+
+	/* 63 is CRYPTO_MAX_ALG_NAME - 1 */
+	if (sscanf(buf, "%u %63s", &poolid, name) != 2)
+		return -EINVAL;
+	if (poolid >= MAX_POOLS_PER_CLIENT)
+		return -EINVAL;
+	ret = zcache_comp_load(name);
+	if (ret < 0)
+		return ret;
+	pool = zcache_get_pool_by_id(poolid);
+	if (pool == NULL)
+		return -ENOENT;
+	zcache_pool(pool)->comp = ret;
+	zcache_put_pool(pool);
+	return count;
+}
+
+/* " <name>:<count>/<mean ns>/<max ns>" */
+static int zcache_show_lat(char *buf, const char *name,
+				struct zcache_lat *lat)
+{
+	unsigned long count = lat->count;
+
+	return sprintf(buf, " %s:%lu/%llu/%llu", name, count,
+		count ? (unsigned long long)div64_u64(lat->total_ns, count) : 0,
+		(unsigned long long)lat->max_ns);
+}
+
+static int zcache_show_pool_stats(char *buf)
+{
+	struct tmem_pool *pool;
+	struct zcache_pool *zpool;
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < MAX_POOLS_PER_CLIENT; i++) {
+		pool = zcache_get_pool_by_id(i);
+		if (pool == NULL)
+			continue;
+		zpool = zcache_pool(pool);
+		p += sprintf(p, "%d %s %s failed:%lu evicted:%lu", i,
+			is_ephemeral(pool) ? "eph" : "pers",
+			zcache_comps[zpool->comp].name,
+			zpool->failed_puts, zpool->evicted);
+		p += zcache_show_lat(p, "put", &zpool->put);
+		p += zcache_show_lat(p, "hit", &zpool->hit);
+		p += zcache_show_lat(p, "miss", &zpool->miss);
+		p += sprintf(p, "\n");
+		zcache_put_pool(pool);
+	}
+	return p - buf;
+}
+
+static int zcache_show_eph_max_age(char *buf)
+{
+	return sprintf(buf, "%lu\n", zcache_eph_max_age);
+}
+
+static ssize_t zcache_store_eph_max_age(const char *buf, size_t count)
+{
+	unsigned long secs;
+	int ret;
+
+	ret = strict_strtoul(buf, 10, &secs);
+	if (ret)
+		return ret;
+	zcache_eph_max_age = secs;
+	if (secs)
+		schedule_delayed_work(&zbud_age_work, HZ);
+	return count;
+}
+
 ZCACHE_SYSFS_RO(curr_obj_count_max);
 ZCACHE_SYSFS_RO(curr_objnode_count_max);
 ZCACHE_SYSFS_RO(flush_total);
@@ -1116,6 +1494,7 @@ ZCACHE_SYSFS_RO(zbpg_unused_list_count);
 ZCACHE_SYSFS_RO(evicted_raw_pages);
 ZCACHE_SYSFS_RO(evicted_unbuddied_pages);
 ZCACHE_SYSFS_RO(evicted_buddied_pages);
+ZCACHE_SYSFS_RO(evicted_cold_pages);
 ZCACHE_SYSFS_RO(failed_get_free_pages);
 ZCACHE_SYSFS_RO(failed_alloc);
 ZCACHE_SYSFS_RO(put_to_flush);
@@ -1130,6 +1509,16 @@ ZCACHE_SYSFS_RO_CUSTOM(zbud_unbuddied_list_counts,
 			zbud_show_unbuddied_list_counts);
 ZCACHE_SYSFS_RO_CUSTOM(zbud_cumul_chunk_counts,
 			zbud_show_cumul_chunk_counts);
+ZCACHE_SYSFS_RO_CUSTOM(compressors, zcache_show_compressors);
+ZCACHE_SYSFS_RO_CUSTOM(pool_stats, zcache_show_pool_stats);
+ZCACHE_SYSFS_RW_CUSTOM(eph_compressor, zcache_show_eph_compressor,
+			zcache_store_eph_compressor);
+ZCACHE_SYSFS_RW_CUSTOM(pers_compressor, zcache_show_pers_compressor,
+			zcache_store_pers_compressor);
+ZCACHE_SYSFS_RW_CUSTOM(pool_compressors, zcache_show_pool_compressors,
+			zcache_store_pool_compressors);
+ZCACHE_SYSFS_RW_CUSTOM(eph_max_age, zcache_show_eph_max_age,
+			zcache_store_eph_max_age);
 
 static struct attribute *zcache_attrs[] = {
 	&zcache_curr_obj_count_attr.attr,
@@ -1153,6 +1542,7 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_evicted_raw_pages_attr.attr,
 	&zcache_evicted_unbuddied_pages_attr.attr,
 	&zcache_evicted_buddied_pages_attr.attr,
+	&zcache_evicted_cold_pages_attr.attr,
 	&zcache_failed_get_free_pages_attr.attr,
 	&zcache_failed_alloc_attr.attr,
 	&zcache_put_to_flush_attr.attr,
@@ -1160,6 +1550,12 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_aborted_shrink_attr.attr,
 	&zcache_zbud_unbuddied_list_counts_attr.attr,
 	&zcache_zbud_cumul_chunk_counts_attr.attr,
+	&zcache_compressors_attr.attr,
+	&zcache_eph_compressor_attr.attr,
+	&zcache_pers_compressor_attr.attr,
+	&zcache_pool_compressors_attr.attr,
+	&zcache_pool_stats_attr.attr,
+	&zcache_eph_max_age_attr.attr,
 	NULL,
 };
 
@@ -1216,6 +1612,7 @@ static int zcache_put_page(int pool_id, struct tmem_oid *oidp,
 				uint32_t index, struct page *page)
 {
 	struct tmem_pool *pool;
+	u64 start = local_clock();
 	int ret = -1;
 
 	BUG_ON(!irqs_disabled());
@@ -1230,7 +1627,9 @@ static int zcache_put_page(int pool_id, struct tmem_oid *oidp,
 				zcache_failed_eph_puts++;
 			else
 				zcache_failed_pers_puts++;
+			zcache_pool(pool)->failed_puts++;
 		}
+		zcache_lat_add(&zcache_pool(pool)->put, start);
 		zcache_put_pool(pool);
 		preempt_enable_no_resched();
 	} else {
@@ -1238,6 +1637,8 @@ static int zcache_put_page(int pool_id, struct tmem_oid *oidp,
 		if (atomic_read(&pool->obj_count) > 0)
 			/* the put fails whether the flush succeeds or not */
 			(void)tmem_flush_page(pool, oidp, index);
+		zcache_pool(pool)->failed_puts++;
+		zcache_lat_add(&zcache_pool(pool)->put, start);
 		zcache_put_pool(pool);
 	}
 out:
@@ -1250,12 +1651,16 @@ static int zcache_get_page(int pool_id, struct tmem_oid *oidp,
 	struct tmem_pool *pool;
 	int ret = -1;
 	unsigned long flags;
+	u64 start;
 
 	local_irq_save(flags);
+	start = local_clock();
 	pool = zcache_get_pool_by_id(pool_id);
 	if (likely(pool != NULL)) {
 		if (atomic_read(&pool->obj_count) > 0)
 			ret = tmem_get(pool, oidp, index, page);
+		zcache_lat_add(ret >= 0 ? &zcache_pool(pool)->hit :
+				&zcache_pool(pool)->miss, start);
 		zcache_put_pool(pool);
 	}
 	local_irq_restore(flags);
@@ -1319,7 +1724,7 @@ static int zcache_destroy_pool(int pool_id)
 	local_bh_disable();
 	ret = tmem_destroy_pool(pool);
 	local_bh_enable();
-	kfree(pool);
+	kfree(zcache_pool(pool));
 	pr_info("zcache: destroyed pool id=%d\n", pool_id);
 out:
 	return ret;
@@ -1328,31 +1733,35 @@ out:
 static int zcache_new_pool(uint32_t flags)
 {
 	int poolid = -1;
+	struct zcache_pool *zpool;
 	struct tmem_pool *pool;
 
-	pool = kmalloc(sizeof(struct tmem_pool), GFP_KERNEL);
-	if (pool == NULL) {
+	zpool = kzalloc(sizeof(struct zcache_pool), GFP_KERNEL);
+	if (zpool == NULL) {
 		pr_info("zcache: pool creation failed: out of memory\n");
 		goto out;
 	}
+	pool = &zpool->tmem;
 
 	for (poolid = 0; poolid < MAX_POOLS_PER_CLIENT; poolid++)
 		if (zcache_client.tmem_pools[poolid] == NULL)
 			break;
 	if (poolid >= MAX_POOLS_PER_CLIENT) {
 		pr_info("zcache: pool creation failed: max exceeded\n");
-		kfree(pool);
+		kfree(zpool);
 		poolid = -1;
 		goto out;
 	}
 	atomic_set(&pool->refcount, 0);
 	pool->client = &zcache_client;
 	pool->pool_id = poolid;
+	zpool->comp = flags & TMEM_POOL_PERSIST ?
+			zcache_pers_comp : zcache_eph_comp;
 	tmem_new_pool(pool, flags);
 	zcache_client.tmem_pools[poolid] = pool;
-	pr_info("zcache: created %s tmem pool, id=%d\n",
+	pr_info("zcache: created %s tmem pool, id=%d, compressor %s\n",
 		flags & TMEM_POOL_PERSIST ? "persistent" : "ephemeral",
-		poolid);
+		poolid, zcache_comps[zpool->comp].name);
 out:
 	return poolid;
 }
@@ -1562,10 +1971,15 @@ struct frontswap_ops zcache_frontswap_register_ops(void)
  */
 
 static int zcache_enabled;
+static char zcache_comp_name[CRYPTO_MAX_ALG_NAME] __initdata =
+							ZCACHE_DEFAULT_COMP;
 
+/* "zcache" or "zcache=<compressor>" */
 static int __init enable_zcache(char *s)
 {
 	zcache_enabled = 1;
+	if (*s == '=' && s[1] != '\0')
+		strlcpy(zcache_comp_name, s + 1, sizeof(zcache_comp_name));
 	return 1;
 }
 __setup("zcache", enable_zcache);
@@ -1606,7 +2020,23 @@ static int __init zcache_init(void)
 #if defined(CONFIG_CLEANCACHE) || defined(CONFIG_FRONTSWAP)
 	if (zcache_enabled) {
 		unsigned int cpu;
-
+		int comp;
+
+		comp = zcache_comp_load(zcache_comp_name);
+		if (comp < 0 && strcmp(zcache_comp_name, ZCACHE_DEFAULT_COMP)) {
+			pr_warning("zcache: can't load compressor %s, "
+				"using " ZCACHE_DEFAULT_COMP "\n",
+				zcache_comp_name);
+			comp = zcache_comp_load(ZCACHE_DEFAULT_COMP);
+		}
+		if (comp < 0) {
+			pr_err("zcache: can't load a compressor\n");
+			zcache_enabled = 0;
+			ret = comp;
+			goto out;
+		}
+		zcache_eph_comp = comp;
+		zcache_pers_comp = comp;
 		tmem_register_hostops(&zcache_hostops);
 		tmem_register_pamops(&zcache_pamops);
 		ret = register_cpu_notifier(&zcache_cpu_notifier_block);
@@ -30,6 +30,7 @@
 #include <linux/highmem.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
 
@@ -41,6 +42,30 @@ struct zram *devices;
 
 /* Module params (documentation at end) */
 unsigned int num_devices;
+static char *compressor = "lzo";
+
+/*
+ * Both return 0 on success, and take the size of dst in *dst_len, so
+ * lzo and lz4 plug in as they are.
+ */
+struct zram_compressor {
+	const char *name;
+	size_t workmem_size;
+	int (*compress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem);
+	int (*decompress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len);
+};
+
+static const struct zram_compressor zram_compressors[] = {
+	{ "lzo", LZO1X_MEM_COMPRESS, lzo1x_1_compress, lzo1x_decompress_safe },
+#ifdef CONFIG_ZRAM_LZ4
+	{ "lz4", LZ4_MEM_COMPRESS, lz4_compress, lz4_decompress_safe },
+#endif
+};
+
+/* the same for all devices, chosen at module load */
+static const struct zram_compressor *zram_comp = &zram_compressors[0];
 
 static void zram_stat_inc(u32 *v)
 {
@@ -251,7 +276,7 @@ static void zram_read(struct zram *zram, struct bio *bio)
 		cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
 				zram->table[index].offset;
 
-		ret = lzo1x_decompress_safe(
+		ret = zram_comp->decompress(
 			cmem + sizeof(*zheader),
 			xv_get_object_size(cmem) - sizeof(*zheader),
 			user_mem, &clen);
@@ -260,7 +285,7 @@ static void zram_read(struct zram *zram, struct bio *bio)
 		kunmap_atomic(cmem, KM_USER1);
 
 		/* Should NEVER happen. Return bio error if it does. */
-		if (unlikely(ret != LZO_E_OK)) {
+		if (unlikely(ret)) {
 			pr_err("Decompression failed! err=%d, page=%u\n",
 				ret, index);
 			zram_stat64_inc(zram, &zram->stats.failed_reads);
@@ -319,12 +344,13 @@ static void zram_write(struct zram *zram, struct bio *bio)
 			continue;
 		}
 
-		ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
+		clen = 2 * PAGE_SIZE;	/* compress_buffer */
+		ret = zram_comp->compress(user_mem, PAGE_SIZE, src, &clen,
 					zram->compress_workmem);
 
 		kunmap_atomic(user_mem, KM_USER0);
 
-		if (unlikely(ret != LZO_E_OK)) {
+		if (unlikely(ret)) {
 			mutex_unlock(&zram->lock);
 			pr_err("Compression failed! err=%d\n", ret);
 			zram_stat64_inc(zram, &zram->stats.failed_writes);
@@ -511,7 +537,7 @@ int zram_init_device(struct zram *zram)
 
 	zram_set_disksize(zram, totalram_pages << PAGE_SHIFT);
 
-	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	zram->compress_workmem = kzalloc(zram_comp->workmem_size, GFP_KERNEL);
 	if (!zram->compress_workmem) {
 		pr_err("Error allocating compressor working memory!\n");
 		ret = -ENOMEM;
@@ -655,7 +681,7 @@ static void destroy_device(struct zram *zram)
 
 static int __init zram_init(void)
 {
-	int ret, dev_id;
+	int ret, dev_id, i;
 
 	if (num_devices > max_num_devices) {
 		pr_warning("Invalid value for num_devices: %u\n",
@@ -664,6 +690,16 @@ static int __init zram_init(void)
 		goto out;
 	}
 
+	for (i = 0; i < ARRAY_SIZE(zram_compressors); i++)
+		if (!strcmp(compressor, zram_compressors[i].name))
+			break;
+	if (i == ARRAY_SIZE(zram_compressors)) {
+		pr_warning("Invalid value for compressor: %s\n", compressor);
+		ret = -EINVAL;
+		goto out;
+	}
+	zram_comp = &zram_compressors[i];
+
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_warning("Unable to get major number\n");
@@ -724,6 +760,10 @@ static void __exit zram_exit(void)
 module_param(num_devices, uint, 0);
 MODULE_PARM_DESC(num_devices, "Number of zram devices");
 
+module_param(compressor, charp, 0);
+MODULE_PARM_DESC(compressor, "Compression algorithm: lzo, or lz4 "
+		"if built with CONFIG_ZRAM_LZ4");
+
 module_init(zram_init);
 module_exit(zram_exit);
 
@@ -48,6 +48,7 @@
 #include "b2r2_input_validation.h"
 #include "b2r2_core.h"
 #include "b2r2_filters.h"
+#include "b2r2_cpu_blt.h"
 
 #define B2R2_HEAP_SIZE (4 * PAGE_SIZE)
 #define MAX_TMP_BUF_SIZE (128 * PAGE_SIZE)
@@ -69,6 +70,9 @@ static void dec_stat(struct b2r2_control *cont, unsigned long *stat);
 
 #ifndef CONFIG_B2R2_GENERIC_ONLY
 static void job_callback(struct b2r2_core_job *job);
+static void cpu_job_callback(struct b2r2_core_job *job);
+static int cpu_blt_set_domains(struct b2r2_blt_request *request,
+		enum hwmem_domain domain);
 static void job_release(struct b2r2_core_job *job);
 static int job_acquire_resources(struct b2r2_core_job *job, bool atomic);
 static void job_release_resources(struct b2r2_core_job *job, bool atomic);
@@ -390,6 +394,7 @@ int b2r2_control_blt(struct b2r2_blt_request *request)
 	int node_count;
 	struct b2r2_control_instance *instance = request->instance;
 	struct b2r2_control *cont = instance->control;
+	bool offload = false;
 
 	unsigned long long thread_runtime_at_start = 0;
 
@@ -546,6 +551,10 @@ int b2r2_control_blt(struct b2r2_blt_request *request)
 		/* There was no optimized path for this request */
 		b2r2_log_info(cont->dev, "%s: No optimized path for request\n",
 			__func__);
+		if (b2r2_cpu_blt_supported(request)) {
+			offload = false;
+			goto cpu_blt;
+		}
 		goto no_optimized_path;
 
 	} else if (ret < 0) {
@@ -572,6 +581,14 @@ int b2r2_control_blt(struct b2r2_blt_request *request)
 		goto generate_nodes_failed;
 	}
 
+	/* Let the CPU take the request if the hardware is busy */
+	if (b2r2_cpu_blt_should_offload(request)) {
+		b2r2_log_info(cont->dev, "%s: Offloading request to the CPU\n",
+			__func__);
+		offload = true;
+		goto cpu_blt;
+	}
+
 	/* Allocate the nodes needed */
 #ifdef B2R2_USE_NODE_GEN
 	request->first_node = b2r2_blt_alloc_nodes(cont,
@@ -717,6 +734,49 @@ int b2r2_control_blt(struct b2r2_blt_request *request)
 
 	return ret >= 0 ? request_id : ret;
 
+cpu_blt:
+	if (cont->bypass)
+		goto exit_dry_run;
+
+	request->job.tag = (int) instance;
+	request->job.data = (int) cont->data;
+	request->job.prio = request->user_req.prio;
+	request->job.callback = cpu_job_callback;
+	request->job.release = job_release;
+	request->job.acquire_resources = NULL;
+	request->job.release_resources = NULL;
+
+	/* The CPU reads and writes the buffers through its caches */
+	ret = cpu_blt_set_domains(request, HWMEM_DOMAIN_CPU);
+	if (ret < 0) {
+		b2r2_log_warn(cont->dev, "%s: Failed to set CPU domain, %d\n",
+			__func__, ret);
+		goto job_add_failed;
+	}
+
+	inc_stat(cont, &cont->stat_n_in_blt_add);
+	mutex_lock(&instance->lock);
+
+	request_id = b2r2_cpu_blt_add(request, offload);
+	request->request_id = request_id;
+
+	dec_stat(cont, &cont->stat_n_in_blt_add);
+
+	if (request_id < 0) {
+		b2r2_log_warn(cont->dev, "%s: Failed to add CPU job, %d\n",
+			__func__, request_id);
+		ret = request_id;
+		mutex_unlock(&instance->lock);
+		goto job_add_failed;
+	}
+
+	inc_stat(cont, &cont->stat_n_jobs_added);
+
+	instance->no_of_active_requests++;
+	mutex_unlock(&instance->lock);
+
+	return request_id;
+
 job_add_failed:
 exit_dry_run:
 no_optimized_path:
@@ -883,6 +943,22 @@ static void job_callback(struct b2r2_core_job *job)
 	b2r2_core_job_release(job, __func__);
 }
 
+/**
+ * Called when a job executed by the CPU blitter is done
+ *
+ * @job: The job
+ */
+static void cpu_job_callback(struct b2r2_core_job *job)
+{
+	struct b2r2_blt_request *request =
+		container_of(job, struct b2r2_blt_request, job);
+
+	/* Hand the buffers back to the hardware before unresolving them */
+	cpu_blt_set_domains(request, HWMEM_DOMAIN_SYNC);
+
+	job_callback(job);
+}
+
 /**
  * Called when job should be released (free memory etc.)
  *
@@ -2035,6 +2111,66 @@ static void set_up_hwmem_region(struct b2r2_control *cont,
 	}
 }
 
+/**
+ * cpu_blt_set_domains() - Moves the buffers of a request handled by the
+ *                         CPU blitter to the given domain
+ *
+ * hwmem buffers go through hwmem_set_domain(). The caches of FD_OFFSET
+ * buffers, which the CPU reaches through a mapping of its own, are
+ * maintained with sync_buf() as for the hardware: the source is cleaned
+ * and the destination flushed before the blit, and the destination is
+ * flushed again after it so that the pixels written reach memory.
+ *
+ * @request: The request
+ * @domain: HWMEM_DOMAIN_CPU before the CPU touches the buffers,
+ *          HWMEM_DOMAIN_SYNC when it is done
+ *
+ * Returns 0 if OK else negative error code
+ */
+static int cpu_blt_set_domains(struct b2r2_blt_request *request,
+		enum hwmem_domain domain)
+{
+	struct b2r2_control *cont = request->instance->control;
+	struct b2r2_blt_req *req = &request->user_req;
+	struct b2r2_blt_rect dst_rect;
+	struct hwmem_region region;
+	int ret;
+
+	if (domain == HWMEM_DOMAIN_CPU &&
+			req->src_img.buf.type == B2R2_BLT_PTR_FD_OFFSET &&
+			!(req->flags & B2R2_BLT_FLAG_SRC_NO_CACHE_FLUSH))
+		sync_buf(cont, &req->src_img, &request->src_resolved, false,
+			&req->src_rect);
+
+	/* Our own writes are flushed whatever the user asked for */
+	if (req->dst_img.buf.type == B2R2_BLT_PTR_FD_OFFSET &&
+			(domain == HWMEM_DOMAIN_SYNC ||
+			!(req->flags & B2R2_BLT_FLAG_DST_NO_CACHE_FLUSH)))
+		sync_buf(cont, &req->dst_img, &request->dst_resolved, true,
+			&req->dst_rect);
+
+	if (req->src_img.buf.type == B2R2_BLT_PTR_HWMEM_BUF_NAME_OFFSET) {
+		set_up_hwmem_region(cont, &req->src_img, &req->src_rect,
+			&region);
+		ret = hwmem_set_domain(request->src_resolved.hwmem_alloc,
+			HWMEM_ACCESS_READ, domain, &region);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (req->dst_img.buf.type == B2R2_BLT_PTR_HWMEM_BUF_NAME_OFFSET) {
+		get_actual_dst_rect(req, &dst_rect);
+		set_up_hwmem_region(cont, &req->dst_img, &dst_rect, &region);
+		ret = hwmem_set_domain(request->dst_resolved.hwmem_alloc,
+			HWMEM_ACCESS_READ | HWMEM_ACCESS_WRITE, domain,
+			&region);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int resolve_hwmem(struct b2r2_control *cont,
 		struct b2r2_blt_img *img,
 		struct b2r2_blt_rect *rect_2b_used,
@@ -3038,6 +3174,13 @@ int b2r2_control_init(struct b2r2_control *cont)
 		goto b2r2_mem_init_fail;
 	}
 
+	ret = b2r2_cpu_blt_init(cont);
+	if (ret) {
+		b2r2_log_warn(cont->dev, "%s: failed to init CPU blitter\n",
+			__func__);
+		goto b2r2_cpu_blt_init_fail;
+	}
+
 #ifdef CONFIG_DEBUG_FS
 	/* Initialize last_request_count and lock */
 	cont->last_request_count = 1;
@@ -3064,6 +3207,8 @@ int b2r2_control_init(struct b2r2_control *cont)
 
 	return ret;
 
+b2r2_cpu_blt_init_fail:
+	b2r2_mem_exit(cont);
 b2r2_mem_init_fail:
 	b2r2_filters_exit(cont);
 b2r2_filter_init_fail:
@@ -3088,6 +3233,7 @@ void b2r2_control_exit(struct b2r2_control *cont)
 			cont->debugfs_root_dir = NULL;
 		}
 #endif
+		b2r2_cpu_blt_exit(cont);
 		b2r2_mem_exit(cont);
 		destroy_tmp_bufs(cont);
 		b2r2_node_split_exit(cont);
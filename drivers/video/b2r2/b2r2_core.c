@@ -59,6 +59,10 @@
 #include "b2r2_profiler_api.h"
 #include "b2r2_timing.h"
 #include "b2r2_debug.h"
+#include "b2r2_cpu_blt.h"
+#ifdef CONFIG_B2R2_SIM
+#include "b2r2_sim.h"
+#endif
 
 /**
  * B2R2 Hardware defines below
@@ -130,6 +134,25 @@
  */
 static struct b2r2_core   *b2r2_core[B2R2_MAX_NBR_DEVICES];
 
+#ifdef CONFIG_B2R2_SIM
+static bool sim;
+module_param(sim, bool, 0444);
+MODULE_PARM_DESC(sim, "Execute the node lists on the software B2R2 core");
+
+/* Device registered when there is no B2R2 to simulate */
+static struct platform_device *sim_pdev;
+
+static inline bool is_sim(struct b2r2_core *core)
+{
+	return core->sim != NULL;
+}
+#else
+static inline bool is_sim(struct b2r2_core *core)
+{
+	return false;
+}
+#endif
+
 /* Local functions */
 static void check_prio_list(struct b2r2_core *core, bool atomic);
 static void  clear_interrupts(struct b2r2_core *core);
@@ -404,6 +427,83 @@ int b2r2_core_job_add(struct b2r2_control *control,
 	return job->job_id;
 }
 
+/**
+ * core->lock _must_ _NOT_ be held when calling this function
+ */
+int b2r2_core_job_add_cpu(struct b2r2_control *control,
+		struct b2r2_core_job *job)
+{
+	unsigned long flags;
+	struct b2r2_core *core = control->data;
+
+	b2r2_log_info(core->dev, "%s (core: %p, job: %p)\n",
+		__func__, core, job);
+
+	spin_lock_irqsave(&core->lock, flags);
+	core->stat_n_jobs_added++;
+	core->stat_n_cpu_jobs++;
+
+	init_job(job);
+	job->is_cpu_job = true;
+
+	/* Initial reference, should be released by caller of this function */
+	job->ref_count = 1;
+
+	/*
+	 * Reference for the cpu job list, released in
+	 * b2r2_core_job_cpu_done
+	 */
+	internal_job_addref(core, job, __func__);
+	list_add_tail(&job->list, &core->cpu_jobs);
+	core->n_cpu_jobs++;
+	job->job_state = B2R2_CORE_JOB_RUNNING;
+	spin_unlock_irqrestore(&core->lock, flags);
+
+	return job->job_id;
+}
+
+/**
+ * core->lock _must_ _NOT_ be held when calling this function
+ */
+void b2r2_core_job_cpu_done(struct b2r2_core_job *job, bool canceled)
+{
+	unsigned long flags;
+	struct b2r2_core *core = (struct b2r2_core *) job->data;
+
+	spin_lock_irqsave(&core->lock, flags);
+	list_del_init(&job->list);
+	BUG_ON(core->n_cpu_jobs == 0);
+	core->n_cpu_jobs--;
+	core->stat_n_jobs_removed++;
+	job->job_state = canceled ? B2R2_CORE_JOB_CANCELED :
+		B2R2_CORE_JOB_DONE;
+	wake_up_interruptible(&job->event);
+	spin_unlock_irqrestore(&core->lock, flags);
+
+	/* Tell the client */
+	if (job->callback)
+		job->callback(job);
+
+	/* Matches the addref in b2r2_core_job_add_cpu */
+	b2r2_core_job_release(job, __func__);
+}
+
+/**
+ * core->lock _must_ _NOT_ be held when calling this function
+ */
+unsigned long b2r2_core_queue_depth(struct b2r2_control *control)
+{
+	unsigned long flags;
+	unsigned long depth;
+	struct b2r2_core *core = control->data;
+
+	spin_lock_irqsave(&core->lock, flags);
+	depth = core->stat_n_jobs_in_prio_list + core->n_active_jobs;
+	spin_unlock_irqrestore(&core->lock, flags);
+
+	return depth;
+}
+
 /**
  * core->lock _must_ _NOT_ be held when calling this function
  */
@@ -424,6 +524,9 @@ struct b2r2_core_job *b2r2_core_job_find(struct b2r2_control *control,
 	if (!job)
 		job = find_job_in_active_jobs(core, job_id);
 
+	if (!job)
+		job = find_job_in_list(job_id, &core->cpu_jobs);
+
 	spin_unlock_irqrestore(&core->lock, flags);
 
 	return job;
@@ -449,6 +552,9 @@ struct b2r2_core_job *b2r2_core_job_find_first_with_tag(
 	if (!job)
 		job = find_tag_in_active_jobs(core, tag);
 
+	if (!job)
+		job = find_tag_in_list(core, tag, &core->cpu_jobs);
+
 	spin_unlock_irqrestore(&core->lock, flags);
 
 	return job;
@@ -583,6 +689,10 @@ int b2r2_core_job_cancel(struct b2r2_core_job *job)
 		return -ENOENT;
 	}
 
+	/* CPU jobs never enter the prio list, their blitter cancels them */
+	if (job->is_cpu_job)
+		return b2r2_cpu_blt_cancel(job);
+
 	/* Remove from prio list */
 	spin_lock_irqsave(&core->lock, flags);
 	cancel_job(core, job);
@@ -610,11 +720,13 @@ static void domain_disable_work_function(struct work_struct *work)
 	if (core->domain_request_count == 0) {
 		core->valid = false;
 		exit_hw(core);
-		clk_disable(core->b2r2_clock);
-		regulator_disable(core->b2r2_reg);
-		/* VANA is tighly coupled to DSS EPOD */
-		if (core->vana_reg)
-			regulator_disable(core->vana_reg);
+		if (!is_sim(core)) {
+			clk_disable(core->b2r2_clock);
+			regulator_disable(core->b2r2_reg);
+			/* VANA is tighly coupled to DSS EPOD */
+			if (core->vana_reg)
+				regulator_disable(core->vana_reg);
+		}
 		core->domain_enabled = false;
 	}
 
@@ -639,6 +751,10 @@ static int domain_enable(struct b2r2_core *core)
 		int retry = 0;
 		int ret;
 
+		/* The software core has no power or clock to turn on */
+		if (is_sim(core))
+			goto init_hw;
+
 		/* VANA is tighly coupled to DSS EPOD */
 		if (core->vana_reg)
 			WARN_ON_ONCE(regulator_enable(core->vana_reg));
@@ -660,6 +776,7 @@ again:
 				"%s: Could not enable clock\n", __func__);
 			goto enable_clk_failed;
 		}
+init_hw:
 		if (init_hw(core) < 0)
 			goto init_hw_failed;
 		core->domain_enabled = true;
@@ -673,6 +790,8 @@ again:
 init_hw_failed:
 	b2r2_log_err(core->dev,
 		"%s: Could not initialize hardware!\n", __func__);
+	if (is_sim(core))
+		goto regulator_enable_failed;
 	clk_disable(core->b2r2_clock);
 
 enable_clk_failed:
@@ -999,6 +1118,7 @@ static void init_job(struct b2r2_core_job *job)
 
 	/* Job is idle, never queued */
 	job->job_state = B2R2_CORE_JOB_IDLE;
+	job->is_cpu_job = false;
 
 	/* Initialize internal data */
 	INIT_LIST_HEAD(&job->list);
@@ -1437,6 +1557,11 @@ static void trigger_job(struct b2r2_core *core, struct b2r2_core_job *job)
 
 	} /* end switch */
 
+#ifdef CONFIG_B2R2_SIM
+	if (is_sim(core))
+		b2r2_sim_trigger(core->sim, job);
+#endif
+
 }
 
 /**
@@ -1557,28 +1682,13 @@ static void process_events(struct b2r2_core *core, u32 status)
 }
 
 /**
- * b2r2_irq_handler() - B2R2 interrupt handler
+ * handle_core_irq() - Handles the interrupt of one B2R2 core
  *
- * @irq: Interrupt number (not used)
- * @dev_id: A pointer to the b2r2 core entity
+ * @core: The b2r2 core entity
  */
-static irqreturn_t b2r2_irq_handler(int irq, void *dev_id)
+static irqreturn_t handle_core_irq(struct b2r2_core *core)
 {
 	unsigned long flags;
-	struct b2r2_core *core;
-	int i;
-	static unsigned int irq_count;
-
-	/* Interleave access to eliminate starvation of cores >= 1 */
-	for (i = 0; i < B2R2_MAX_NBR_DEVICES; i++) {
-		core = b2r2_core[irq_count++ % B2R2_MAX_NBR_DEVICES];
-		if (core != NULL)
-			break;
-	}
-
-	if (core == NULL)
-		/* ERROR */
-		return IRQ_HANDLED;
 
 	/* Spin lock is need in irq handler (SMP) */
 	spin_lock_irqsave(&core->lock, flags);
@@ -1608,6 +1718,53 @@ static irqreturn_t b2r2_irq_handler(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/**
+ * b2r2_irq_handler() - B2R2 interrupt handler
+ *
+ * @irq: Interrupt number (not used)
+ * @dev_id: A pointer to the b2r2 core entity
+ */
+static irqreturn_t b2r2_irq_handler(int irq, void *dev_id)
+{
+	struct b2r2_core *core;
+	int i;
+	static unsigned int irq_count;
+
+	/* Interleave access to eliminate starvation of cores >= 1 */
+	for (i = 0; i < B2R2_MAX_NBR_DEVICES; i++) {
+		core = b2r2_core[irq_count++ % B2R2_MAX_NBR_DEVICES];
+		if (core != NULL)
+			break;
+	}
+
+	if (core == NULL)
+		/* ERROR */
+		return IRQ_HANDLED;
+
+	return handle_core_irq(core);
+}
+
+#ifdef CONFIG_B2R2_SIM
+/**
+ * sim_irq() - Interrupt from the software core
+ *
+ * Only the software core sets BLT_ITS, from a single thread, so the
+ * status can be set before and cleared after the handler (the hardware
+ * register is write one to clear).
+ *
+ * @data: The b2r2 core entity
+ * @its: The interrupt status bits
+ */
+static void sim_irq(void *data, u32 its)
+{
+	struct b2r2_core *core = data;
+
+	writel(its, &core->hw->BLT_ITS);
+	handle_core_irq(core);
+	writel(0, &core->hw->BLT_ITS);
+}
+#endif
+
 
 #ifdef CONFIG_DEBUG_FS
 /**
@@ -2030,6 +2187,10 @@ static int debugfs_b2r2_stat_read(struct file *filp, char __user *buf,
 		dev_size += sprintf(tmpbuf + dev_size,
 				"   Job in queue %d : 0x%08lx\n",
 				i, (unsigned long) core->active_jobs[i]);
+	dev_size += sprintf(tmpbuf + dev_size, "CPU jobs          : %lu\n",
+			core->n_cpu_jobs);
+	dev_size += sprintf(tmpbuf + dev_size, "Added CPU jobs    : %lu\n",
+			core->stat_n_cpu_jobs);
 	dev_size += sprintf(tmpbuf + dev_size, "Clock requests    : %lu\n",
 			core->clock_request_count);
 
@@ -2257,7 +2418,8 @@ static int init_hw(struct b2r2_core *core)
 		&core->hw->BLT_CTL);
 
 	/* Enable interrupt handler */
-	enable_irq(core->irq);
+	if (!is_sim(core))
+		enable_irq(core->irq);
 
 	b2r2_log_info(core->dev, "do a global reset..\n");
 
@@ -2354,7 +2516,8 @@ static void exit_hw(struct b2r2_core *core)
 
 	/* Disable B2R2 interrupt handler */
 	b2r2_log_debug(core->dev, "%s: disable interrupt handler\n", __func__);
-	disable_irq(core->irq);
+	if (!is_sim(core))
+		disable_irq(core->irq);
 
 	b2r2_log_debug(core->dev, "%s: unlocking core->lock\n", __func__);
 	spin_unlock_irqrestore(&core->lock, flags);
@@ -2402,6 +2565,7 @@ static int b2r2_probe(struct platform_device *pdev)
 
 	/* Init job queues */
 	INIT_LIST_HEAD(&core->prio_queue);
+	INIT_LIST_HEAD(&core->cpu_jobs);
 
 #ifdef HANDLE_TIMEOUTED_JOBS
 	/* Create work queue for callbacks & timeout */
@@ -2415,6 +2579,26 @@ static int b2r2_probe(struct platform_device *pdev)
 		goto error_exit;
 	}
 
+	/* Init power management */
+	mutex_init(&core->domain_lock);
+	INIT_DELAYED_WORK_DEFERRABLE(&core->domain_disable_work,
+			domain_disable_work_function);
+	core->domain_enabled = false;
+	core->valid = false;
+	core->lockdown = false;
+
+#ifdef CONFIG_B2R2_SIM
+	if (sim) {
+		core->sim = b2r2_sim_create(core->dev, sim_irq, core);
+		if (!core->sim) {
+			ret = -ENOMEM;
+			goto error_exit;
+		}
+		core->hw = b2r2_sim_regs(core->sim);
+		goto init_control;
+	}
+#endif
+
 	/* Get the clock for B2R2 */
 	core->b2r2_clock = clk_get(core->dev, pdata->clock_id);
 	if (IS_ERR(core->b2r2_clock)) {
@@ -2440,14 +2624,6 @@ static int b2r2_probe(struct platform_device *pdev)
 		dev_err(&pdev->dev, "regulator_get vana failed (dev_name=%s)\n",
 				dev_name(core->dev));
 
-	/* Init power management */
-	mutex_init(&core->domain_lock);
-	INIT_DELAYED_WORK_DEFERRABLE(&core->domain_disable_work,
-			domain_disable_work_function);
-	core->domain_enabled = false;
-	core->valid = false;
-	core->lockdown = false;
-
 	/* Map B2R2 into kernel virtual memory space */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	if (res == NULL)
@@ -2481,6 +2657,9 @@ static int b2r2_probe(struct platform_device *pdev)
 
 	dev_dbg(core->dev, "b2r2 structure address %p\n", core->hw);
 
+#ifdef CONFIG_B2R2_SIM
+init_control:
+#endif
 	control = kzalloc(sizeof(*control), GFP_KERNEL);
 	if (!control) {
 		dev_err(&pdev->dev, "b2r2 control alloc failed\n");
@@ -2529,6 +2708,11 @@ static int b2r2_probe(struct platform_device *pdev)
 				&core->mg_size);
 		debugfs_create_u16("min_req_time", 0664,
 			core->debugfs_core_root_dir, &core->min_req_time);
+#ifdef CONFIG_B2R2_SIM
+		if (is_sim(core))
+			b2r2_sim_debugfs_init(core->sim,
+					core->debugfs_core_root_dir);
+#endif
 	}
 #endif
 
@@ -2574,6 +2758,12 @@ error_exit:
 	if (!IS_ERR_OR_NULL(core->work_queue))
 		destroy_workqueue(core->work_queue);
 
+#ifdef CONFIG_B2R2_SIM
+	if (is_sim(core)) {
+		b2r2_sim_destroy(core->sim);
+		core->hw = NULL;
+	}
+#endif
 	if (core->hw)
 		iounmap(core->hw);
 
@@ -2624,6 +2814,14 @@ void b2r2_core_release(struct kref *control_ref)
 	/* Make sure the power is turned off */
 	cancel_delayed_work_sync(&core->domain_disable_work);
 
+#ifdef CONFIG_B2R2_SIM
+	if (is_sim(core)) {
+		/* The registers belong to the software core */
+		b2r2_sim_destroy(core->sim);
+		core->hw = NULL;
+	}
+#endif
+
 	/* Unmap B2R2 registers */
 	b2r2_log_info(dev, "%s: unmap b2r2 registers..\n", __func__);
 	if (core->hw) {
@@ -2638,8 +2836,10 @@ void b2r2_core_release(struct kref *control_ref)
 	spin_unlock_irqrestore(&core->lock, flags);
 
 	/* Return the clock */
-	clk_put(core->b2r2_clock);
-	regulator_put(core->b2r2_reg);
+	if (!IS_ERR_OR_NULL(core->b2r2_clock))
+		clk_put(core->b2r2_clock);
+	if (!IS_ERR_OR_NULL(core->b2r2_reg))
+		regulator_put(core->b2r2_reg);
 	if (core->vana_reg)
 		regulator_put(core->vana_reg);
 
@@ -2668,7 +2868,8 @@ static int b2r2_remove(struct platform_device *pdev)
 
 	/* Free B2R2 interrupt handler */
 	b2r2_log_debug(core->dev, "%s: freeing interrupt handler\n", __func__);
-	free_irq(core->irq, core);
+	if (!is_sim(core))
+		free_irq(core->irq, core);
 
 #ifdef CONFIG_DEBUG_FS
 	if (!IS_ERR_OR_NULL(core->debugfs_root_dir)) {
@@ -2707,11 +2908,13 @@ int b2r2_reset_hold(void)
 			core->lockdown = true;
 			core->domain_request_count = 0;
 			exit_hw(core);
-			clk_disable(core->b2r2_clock);
-			regulator_disable(core->b2r2_reg);
-			/* VANA is tighly coupled to DSS EPOD */
-			if (core->vana_reg)
-				regulator_disable(core->vana_reg);
+			if (!is_sim(core)) {
+				clk_disable(core->b2r2_clock);
+				regulator_disable(core->b2r2_reg);
+				/* VANA is tighly coupled to DSS EPOD */
+				if (core->vana_reg)
+					regulator_disable(core->vana_reg);
+			}
 			core->domain_enabled = false;
 
 			/* Flush B2R2 work queue (call all callbacks) */
@@ -2851,8 +3054,29 @@ static struct platform_driver platform_b2r2_driver = {
  */
 static int __init b2r2_init(void)
 {
+	int ret;
+
 	printk(KERN_INFO "%s\n", __func__);
-	return platform_driver_probe(&platform_b2r2_driver, b2r2_probe);
+	ret = platform_driver_probe(&platform_b2r2_driver, b2r2_probe);
+
+#ifdef CONFIG_B2R2_SIM
+	/* Without a B2R2 device, e.g. on a PC, the software core gets one */
+	if (ret == -ENODEV && sim) {
+		sim_pdev = platform_device_register_simple("b2r2", 0, NULL, 0);
+		if (IS_ERR(sim_pdev)) {
+			ret = PTR_ERR(sim_pdev);
+			sim_pdev = NULL;
+			return ret;
+		}
+		ret = platform_driver_probe(&platform_b2r2_driver, b2r2_probe);
+		if (ret < 0) {
+			platform_device_unregister(sim_pdev);
+			sim_pdev = NULL;
+		}
+	}
+#endif
+
+	return ret;
 }
 module_init(b2r2_init);
 
@@ -2863,6 +3087,10 @@ static void __exit b2r2_exit(void)
 {
 	printk(KERN_INFO "%s\n", __func__);
 	platform_driver_unregister(&platform_b2r2_driver);
+#ifdef CONFIG_B2R2_SIM
+	if (sim_pdev)
+		platform_device_unregister(sim_pdev);
+#endif
 	return;
 }
 module_exit(b2r2_exit);
@@ -109,6 +109,8 @@ struct addref_release {
  * @prio_queue: Queue of jobs sorted in priority order
  * @active_jobs: Array containing pointer to zero or one job per queue
  * @n_active_jobs: Number of active jobs
+ * @cpu_jobs: Jobs being executed by the CPU blitter
+ * @n_cpu_jobs: Number of jobs in cpu_jobs
  * @jiffies_last_active: jiffie value when adding last active job
  * @jiffies_last_irq: jiffie value when last irq occured
  * @timeout_work: Work structure for timeout work
@@ -126,6 +128,9 @@ struct addref_release {
  * @stat_n_jobs_added: Number of jobs added (statistics)
  * @stat_n_jobs_removed: Number of jobs removed (statistics)
  * @stat_n_jobs_in_prio_list: Number of jobs in prio list (statistics)
+ * @stat_n_cpu_jobs: Number of jobs run by the CPU blitter (statistics)
+ *
+ * @sim: Software core used in place of the hardware, or NULL
  *
  * @debugfs_root_dir: Root directory for B2R2 debugfs
  *
@@ -154,6 +159,10 @@ struct b2r2_core {
 	struct b2r2_core_job *active_jobs[B2R2_CORE_QUEUE_NO_OF];
 	unsigned long    n_active_jobs;
 
+	/* Jobs executed by the CPU blitter, see b2r2_cpu_blt.c */
+	struct list_head cpu_jobs;
+	unsigned long    n_cpu_jobs;
+
 	unsigned long    jiffies_last_active;
 	unsigned long    jiffies_last_irq;
 #ifdef HANDLE_TIMEOUTED_JOBS
@@ -174,6 +183,7 @@ struct b2r2_core {
 	unsigned long    stat_n_jobs_removed;
 
 	unsigned long    stat_n_jobs_in_prio_list;
+	unsigned long    stat_n_cpu_jobs;
 
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_root_dir;
@@ -207,6 +217,10 @@ struct b2r2_core {
 	struct regulator *vana_reg;
 
 	struct b2r2_control *control;
+
+#ifdef CONFIG_B2R2_SIM
+	struct b2r2_sim *sim;
+#endif
 };
 
 /**
@@ -226,6 +240,42 @@ struct b2r2_core {
 int b2r2_core_job_add(struct b2r2_control *control,
 		struct b2r2_core_job *job);
 
+/**
+ * b2r2_core_job_add_cpu() - Adds a job that is executed by the CPU
+ *                           instead of the B2R2 hardware
+ *
+ * The job gets the same reference counting and wait/find semantics as
+ * one added with b2r2_core_job_add(), but it never enters the prio list.
+ * The caller executes it and must call b2r2_core_job_cpu_done() when
+ * finished. job->work is free for the caller to use.
+ *
+ * @control: The b2r2 control entity
+ * @job: Job to be added
+ *
+ * Returns the job id
+ */
+int b2r2_core_job_add_cpu(struct b2r2_control *control,
+		struct b2r2_core_job *job);
+
+/**
+ * b2r2_core_job_cpu_done() - Completes a job added with
+ *                            b2r2_core_job_add_cpu()
+ *
+ * Wakes up waiters and calls the job callback.
+ *
+ * @job: The job
+ * @canceled: true if the job was not executed
+ */
+void b2r2_core_job_cpu_done(struct b2r2_core_job *job, bool canceled);
+
+/**
+ * b2r2_core_queue_depth() - Returns the number of jobs queued or
+ *                           running on the B2R2 hardware
+ *
+ * @control: The b2r2 control entity
+ */
+unsigned long b2r2_core_queue_depth(struct b2r2_control *control);
+
 /**
  * b2r2_core_job_wait() - Waits for an added job to be done.
  *
@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 CPU blitter
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * Executes simple requests (format conversion between ARGB8888, RGB565 and
+ * planar YUV 4:2:0, bilinear scaling and source over blending) on the CPU.
+ * It is used for requests the hardware has no optimized path for, and for
+ * small requests when the hardware queue is busy. Jobs run on an unbound
+ * work queue, so they execute in parallel with the hardware and with each
+ * other.
+ *
+ * The pixel work is done one line at a time by the row kernels in
+ * b2r2_cpu_kernels.c, or their NEON versions when the CPU has NEON.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
+#include <video/b2r2_blt.h>
+
+#ifdef CONFIG_B2R2_CPU_BLT_NEON
+#include <asm/neon.h>
+#endif
+
+#include "b2r2_internal.h"
+#include "b2r2_core.h"
+#include "b2r2_debug.h"
+#include "b2r2_utils.h"
+#include "b2r2_cpu_blt.h"
+#include "b2r2_cpu_kernels.h"
+
+/* Lines done between kernel_neon_begin() and kernel_neon_end() */
+#define CPU_BLT_STRIP_LINES 16
+
+static unsigned int cpu_blt_busy_depth = 2;
+module_param(cpu_blt_busy_depth, uint, 0644);
+MODULE_PARM_DESC(cpu_blt_busy_depth,
+	"Offload requests to the CPU when this many jobs are queued on the "
+	"hardware (0 = never)");
+
+static unsigned int cpu_blt_max_pixels = 320 * 240;
+module_param(cpu_blt_max_pixels, uint, 0644);
+MODULE_PARM_DESC(cpu_blt_max_pixels,
+	"Largest destination area in pixels the CPU blitter takes");
+
+#ifdef CONFIG_B2R2_CPU_BLT_NEON
+static bool cpu_blt_neon = true;
+module_param(cpu_blt_neon, bool, 0444);
+MODULE_PARM_DESC(cpu_blt_neon, "Use the NEON kernels if the CPU has NEON");
+#endif
+
+#define CPU_BLT_FLAGS (B2R2_BLT_FLAG_ASYNCH | \
+	B2R2_BLT_FLAG_PER_PIXEL_ALPHA_BLEND | \
+	B2R2_BLT_FLAG_GLOBAL_ALPHA_BLEND | \
+	B2R2_BLT_FLAG_SRC_IS_NOT_PREMULT | \
+	B2R2_BLT_FLAG_INHERIT_PRIO | \
+	B2R2_BLT_FLAG_SRC_NO_CACHE_FLUSH | \
+	B2R2_BLT_FLAG_SRC_MASK_NO_CACHE_FLUSH | \
+	B2R2_BLT_FLAG_DST_NO_CACHE_FLUSH | \
+	B2R2_BLT_FLAG_FULL_RANGE_YUV | \
+	B2R2_BLT_FLAG_REPORT_WHEN_DONE | \
+	B2R2_BLT_FLAG_REPORT_PERFORMANCE)
+
+/**
+ * struct cpu_blt_stats - CPU blitter statistics
+ *
+ * @n_active: Jobs queued or running
+ * @n_fallback: Jobs the hardware had no optimized path for
+ * @n_offload: Jobs moved from a busy hardware queue
+ * @n_failed: Jobs that could not be executed
+ * @pixels: Destination pixels written
+ * @nsec: Time spent executing jobs
+ * @max_nsec: Longest job
+ */
+struct cpu_blt_stats {
+	unsigned long n_active;
+	unsigned long n_fallback;
+	unsigned long n_offload;
+	unsigned long n_failed;
+	u64 pixels;
+	u64 nsec;
+	u64 max_nsec;
+};
+
+/**
+ * struct b2r2_cpu_blt - CPU blitter of one b2r2 control
+ *
+ * @wq: Unbound work queue the jobs execute on
+ * @kernels: The row kernels in use
+ * @lock: Protects the statistics
+ * @stats: Statistics
+ */
+struct b2r2_cpu_blt {
+	struct workqueue_struct *wq;
+	const struct b2r2_cpu_kernels *kernels;
+
+	spinlock_t lock;
+	struct cpu_blt_stats stats;
+};
+
+/* One image as seen by the CPU */
+struct cpu_img {
+	enum b2r2_blt_fmt fmt;
+	u8 *base;
+	u8 *cb;
+	u8 *cr;
+	u32 pitch;
+	u32 chroma_pitch;
+};
+
+/* Per job line buffers and state */
+struct cpu_blt_ctx {
+	const struct b2r2_cpu_kernels *k;
+	struct cpu_img src;
+	struct cpu_img dst;
+	struct b2r2_blt_rect src_rect;
+	struct b2r2_blt_rect dst_rect;
+	const struct b2r2_cpu_yuv_coefs *coefs;
+
+	bool blend;
+	u32 global_alpha;
+	u32 blend_flags;
+
+	/* Source lines converted to ARGB8888, and which lines they hold */
+	u32 *line[2];
+	int line_y[2];
+	u32 *vbuf;	/* Vertically interpolated source line */
+	u32 *hbuf;	/* Scaled line */
+	u32 *dbuf;	/* Destination line for RGB565 blending */
+};
+
+static bool is_yuv420p(enum b2r2_blt_fmt fmt)
+{
+	return fmt == B2R2_BLT_FMT_YUV420_PACKED_PLANAR ||
+		fmt == B2R2_BLT_FMT_YVU420_PACKED_PLANAR ||
+		fmt == B2R2_BLT_FMT_YV12;
+}
+
+static bool is_src_fmt(enum b2r2_blt_fmt fmt)
+{
+	return fmt == B2R2_BLT_FMT_32_BIT_ARGB8888 ||
+		fmt == B2R2_BLT_FMT_16_BIT_RGB565 || is_yuv420p(fmt);
+}
+
+static bool is_dst_fmt(enum b2r2_blt_fmt fmt)
+{
+	return fmt == B2R2_BLT_FMT_32_BIT_ARGB8888 ||
+		fmt == B2R2_BLT_FMT_16_BIT_RGB565;
+}
+
+static bool has_vaddr(struct b2r2_blt_img *img,
+		struct b2r2_resolved_buf *resolved)
+{
+	return (img->buf.type == B2R2_BLT_PTR_FD_OFFSET ||
+			img->buf.type == B2R2_BLT_PTR_HWMEM_BUF_NAME_OFFSET) &&
+		resolved->virtual_address != NULL;
+}
+
+bool b2r2_cpu_blt_supported(struct b2r2_blt_request *request)
+{
+	struct b2r2_blt_req *req = &request->user_req;
+	struct b2r2_cpu_blt *cb = request->instance->control->cpu_blt;
+	struct b2r2_blt_rect bounds;
+
+	if (cb == NULL)
+		return false;
+
+	if (req->flags & ~CPU_BLT_FLAGS)
+		return false;
+
+	if (req->transform != B2R2_BLT_TRANSFORM_NONE)
+		return false;
+
+	if (!is_src_fmt(req->src_img.fmt) || !is_dst_fmt(req->dst_img.fmt))
+		return false;
+
+	if (!has_vaddr(&req->src_img, &request->src_resolved) ||
+			!has_vaddr(&req->dst_img, &request->dst_resolved))
+		return false;
+
+	if (b2r2_is_zero_area_rect(&req->src_rect) ||
+			b2r2_is_zero_area_rect(&req->dst_rect))
+		return false;
+
+	if ((u32)req->dst_rect.width * req->dst_rect.height >
+			cpu_blt_max_pixels)
+		return false;
+
+	b2r2_get_img_bounding_rect(&req->src_img, &bounds);
+	if (!b2r2_is_rect_inside_rect(&req->src_rect, &bounds))
+		return false;
+
+	b2r2_get_img_bounding_rect(&req->dst_img, &bounds);
+	if (!b2r2_is_rect_inside_rect(&req->dst_rect, &bounds))
+		return false;
+
+	return true;
+}
+
+bool b2r2_cpu_blt_should_offload(struct b2r2_blt_request *request)
+{
+	struct b2r2_control *cont = request->instance->control;
+
+	if (cpu_blt_busy_depth == 0 || cont->cpu_blt == NULL)
+		return false;
+
+	if (b2r2_core_queue_depth(cont) < cpu_blt_busy_depth)
+		return false;
+
+	return b2r2_cpu_blt_supported(request);
+}
+
+static void setup_img(struct b2r2_control *cont, struct cpu_img *ci,
+		struct b2r2_blt_img *img, struct b2r2_resolved_buf *resolved)
+{
+	ci->fmt = img->fmt;
+	ci->base = resolved->virtual_address;
+	/* hwmem_kmap() maps the whole buffer, the others include the offset */
+	if (img->buf.type == B2R2_BLT_PTR_HWMEM_BUF_NAME_OFFSET)
+		ci->base += img->buf.offset;
+	ci->pitch = b2r2_get_img_pitch(cont->dev, img);
+
+	if (is_yuv420p(img->fmt)) {
+		u32 cb_addr;
+		u32 cr_addr;
+
+		ci->chroma_pitch = b2r2_get_chroma_pitch(ci->pitch, img->fmt);
+		b2r2_get_cb_cr_addr((u32)ci->base, ci->pitch, img->height,
+			img->fmt, &cb_addr, &cr_addr);
+		ci->cb = (u8 *)cb_addr;
+		ci->cr = (u8 *)cr_addr;
+	}
+}
+
+/* Returns source line y (relative to src_rect) as ARGB8888 */
+static const u32 *get_src_line(struct cpu_blt_ctx *ctx, int y)
+{
+	const struct cpu_img *src = &ctx->src;
+	int x = ctx->src_rect.x;
+	int w = ctx->src_rect.width;
+	/* Chroma pairs start at even pixels, odd starts convert one more */
+	int skip = is_yuv420p(src->fmt) ? (x & 1) : 0;
+	int i;
+	u32 *line;
+
+	y += ctx->src_rect.y;
+
+	if (src->fmt == B2R2_BLT_FMT_32_BIT_ARGB8888)
+		return (const u32 *)(src->base + y * src->pitch) + x;
+
+	for (i = 0; i < 2; i++)
+		if (ctx->line_y[i] == y)
+			return ctx->line[i] + skip;
+
+	/* Replace the line furthest up, lines are fetched top down */
+	i = ctx->line_y[0] < ctx->line_y[1] ? 0 : 1;
+	line = ctx->line[i];
+	ctx->line_y[i] = y;
+
+	if (src->fmt == B2R2_BLT_FMT_16_BIT_RGB565) {
+		ctx->k->rgb565_to_argb8888(line,
+			(const u16 *)(src->base + y * src->pitch) + x, w);
+		return line;
+	}
+
+	ctx->k->yuv420_to_argb8888(line, src->base + y * src->pitch + x - skip,
+		src->cb + (y >> 1) * src->chroma_pitch + (x >> 1),
+		src->cr + (y >> 1) * src->chroma_pitch + (x >> 1),
+		w + skip, ctx->coefs);
+	return line + skip;
+}
+
+static void blt_line(struct cpu_blt_ctx *ctx, int dy, u32 y_pos, u32 x0,
+		u32 x_step)
+{
+	const struct b2r2_cpu_kernels *k = ctx->k;
+	int sw = ctx->src_rect.width;
+	int sh = ctx->src_rect.height;
+	int dw = ctx->dst_rect.width;
+	int sy = y_pos >> 16;
+	u32 frac = (y_pos >> 8) & 0xff;
+	const u32 *line;
+	u8 *dst;
+
+	dst = ctx->dst.base + (ctx->dst_rect.y + dy) * ctx->dst.pitch;
+
+	/* Plain copy */
+	if (sw == dw && sh == ctx->dst_rect.height && !ctx->blend &&
+			ctx->src.fmt == ctx->dst.fmt) {
+		int bpp = ctx->dst.fmt == B2R2_BLT_FMT_16_BIT_RGB565 ? 2 : 4;
+
+		memcpy(dst + ctx->dst_rect.x * bpp, ctx->src.base +
+			(ctx->src_rect.y + dy) * ctx->src.pitch +
+			ctx->src_rect.x * bpp, dw * bpp);
+		return;
+	}
+
+	if (sy >= sh - 1) {
+		sy = sh - 1;
+		frac = 0;
+	}
+
+	line = get_src_line(ctx, sy);
+	if (frac) {
+		k->lerp_rows((u8 *)ctx->vbuf, (const u8 *)line,
+			(const u8 *)get_src_line(ctx, sy + 1), sw * 4, frac);
+		line = ctx->vbuf;
+	}
+
+	if (sw != dw) {
+		k->scale_row_argb8888(ctx->hbuf, line, sw, dw, x0, x_step);
+		line = ctx->hbuf;
+	}
+
+	if (ctx->dst.fmt == B2R2_BLT_FMT_32_BIT_ARGB8888) {
+		u32 *d = (u32 *)dst + ctx->dst_rect.x;
+
+		if (ctx->blend)
+			k->blend_argb8888(d, line, dw, ctx->global_alpha,
+				ctx->blend_flags);
+		else
+			memcpy(d, line, dw * 4);
+	} else {
+		u16 *d = (u16 *)dst + ctx->dst_rect.x;
+
+		if (ctx->blend) {
+			k->rgb565_to_argb8888(ctx->dbuf, d, dw);
+			k->blend_argb8888(ctx->dbuf, line, dw,
+				ctx->global_alpha, ctx->blend_flags);
+			line = ctx->dbuf;
+		}
+		k->argb8888_to_rgb565(d, line, dw);
+	}
+}
+
+static void cpu_blt_begin(struct cpu_blt_ctx *ctx)
+{
+#ifdef CONFIG_B2R2_CPU_BLT_NEON
+	if (ctx->k == &b2r2_cpu_kernels_neon)
+		kernel_neon_begin();
+#endif
+}
+
+static void cpu_blt_end(struct cpu_blt_ctx *ctx)
+{
+#ifdef CONFIG_B2R2_CPU_BLT_NEON
+	if (ctx->k == &b2r2_cpu_kernels_neon)
+		kernel_neon_end();
+#endif
+}
+
+static int cpu_blt_execute(struct b2r2_cpu_blt *cb,
+		struct b2r2_blt_request *request)
+{
+	struct b2r2_control *cont = request->instance->control;
+	struct b2r2_blt_req *req = &request->user_req;
+	struct cpu_blt_ctx ctx;
+	size_t line_size;
+	u32 *bufs;
+	u32 x_step, x0, y_step, y_pos;
+	int dy;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.k = cb->kernels;
+	ctx.src_rect = req->src_rect;
+	ctx.dst_rect = req->dst_rect;
+	setup_img(cont, &ctx.src, &req->src_img, &request->src_resolved);
+	setup_img(cont, &ctx.dst, &req->dst_img, &request->dst_resolved);
+	ctx.coefs = (req->flags & B2R2_BLT_FLAG_FULL_RANGE_YUV) ?
+		&b2r2_cpu_bt601_full : &b2r2_cpu_bt601_video;
+
+	ctx.blend = req->flags & (B2R2_BLT_FLAG_PER_PIXEL_ALPHA_BLEND |
+		B2R2_BLT_FLAG_GLOBAL_ALPHA_BLEND);
+	ctx.global_alpha = (req->flags & B2R2_BLT_FLAG_GLOBAL_ALPHA_BLEND) ?
+		req->global_alpha : 255;
+	if (req->flags & B2R2_BLT_FLAG_PER_PIXEL_ALPHA_BLEND) {
+		ctx.blend_flags = B2R2_CPU_BLEND_PIXEL_ALPHA;
+		if (!(req->flags & B2R2_BLT_FLAG_SRC_IS_NOT_PREMULT))
+			ctx.blend_flags |= B2R2_CPU_BLEND_PREMULT;
+	}
+
+	/* One extra pixel for odd YUV starts */
+	line_size = max(ctx.src_rect.width, ctx.dst_rect.width) + 1;
+	bufs = kmalloc(5 * line_size * sizeof(u32), GFP_KERNEL);
+	if (bufs == NULL)
+		return -ENOMEM;
+	ctx.line[0] = bufs;
+	ctx.line[1] = bufs + line_size;
+	ctx.vbuf = bufs + 2 * line_size;
+	ctx.hbuf = bufs + 3 * line_size;
+	ctx.dbuf = bufs + 4 * line_size;
+	ctx.line_y[0] = -1;
+	ctx.line_y[1] = -1;
+
+	/* Sample at pixel centers, in 16.16 fixed point */
+	x_step = ((u32)ctx.src_rect.width << 16) / ctx.dst_rect.width;
+	y_step = ((u32)ctx.src_rect.height << 16) / ctx.dst_rect.height;
+	x0 = x_step > 0x10000 ? (x_step - 0x10000) / 2 : 0;
+	y_pos = y_step > 0x10000 ? (y_step - 0x10000) / 2 : 0;
+
+	for (dy = 0; dy < ctx.dst_rect.height; ) {
+		int end = min(dy + CPU_BLT_STRIP_LINES, ctx.dst_rect.height);
+
+		cpu_blt_begin(&ctx);
+		for (; dy < end; dy++, y_pos += y_step)
+			blt_line(&ctx, dy, y_pos, x0, x_step);
+		cpu_blt_end(&ctx);
+
+		cond_resched();
+	}
+
+	kfree(bufs);
+	return 0;
+}
+
+static void cpu_blt_work(struct work_struct *work)
+{
+	struct b2r2_core_job *job =
+		container_of(work, struct b2r2_core_job, work);
+	struct b2r2_blt_request *request =
+		container_of(job, struct b2r2_blt_request, job);
+	struct b2r2_control *cont = request->instance->control;
+	struct b2r2_cpu_blt *cb = cont->cpu_blt;
+	ktime_t start = ktime_get();
+	u64 nsec;
+	int ret;
+
+	ret = cpu_blt_execute(cb, request);
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (ret < 0)
+		b2r2_log_warn(cont->dev, "%s: CPU blit failed, %d\n",
+			__func__, ret);
+
+	spin_lock(&cb->lock);
+	cb->stats.n_active--;
+	if (ret < 0) {
+		cb->stats.n_failed++;
+	} else {
+		cb->stats.pixels += (u32)request->user_req.dst_rect.width *
+			request->user_req.dst_rect.height;
+		cb->stats.nsec += nsec;
+		if (nsec > cb->stats.max_nsec)
+			cb->stats.max_nsec = nsec;
+	}
+	spin_unlock(&cb->lock);
+
+	/* The request may be gone after this */
+	b2r2_core_job_cpu_done(job, ret < 0);
+}
+
+int b2r2_cpu_blt_add(struct b2r2_blt_request *request, bool offload)
+{
+	struct b2r2_control *cont = request->instance->control;
+	struct b2r2_cpu_blt *cb = cont->cpu_blt;
+	int job_id;
+
+	job_id = b2r2_core_job_add_cpu(cont, &request->job);
+	if (job_id < 0)
+		return job_id;
+
+	spin_lock(&cb->lock);
+	cb->stats.n_active++;
+	if (offload)
+		cb->stats.n_offload++;
+	else
+		cb->stats.n_fallback++;
+	spin_unlock(&cb->lock);
+
+	INIT_WORK(&request->job.work, cpu_blt_work);
+	queue_work(cb->wq, &request->job.work);
+
+	return job_id;
+}
+
+int b2r2_cpu_blt_cancel(struct b2r2_core_job *job)
+{
+	struct b2r2_blt_request *request =
+		container_of(job, struct b2r2_blt_request, job);
+	struct b2r2_cpu_blt *cb = request->instance->control->cpu_blt;
+
+	/* Waits for the job instead if it is running or done already */
+	if (!cancel_work_sync(&job->work))
+		return 0;
+
+	spin_lock(&cb->lock);
+	cb->stats.n_active--;
+	spin_unlock(&cb->lock);
+
+	b2r2_core_job_cpu_done(job, true);
+
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static ssize_t debugfs_cpu_blt_read(struct file *filp, char __user *buf,
+		size_t count, loff_t *f_pos)
+{
+	struct b2r2_cpu_blt *cb = filp->f_dentry->d_inode->i_private;
+	struct cpu_blt_stats s;
+	char tmp[512];
+	size_t len = 0;
+	u64 mpix = 0;
+
+	spin_lock(&cb->lock);
+	s = cb->stats;
+	spin_unlock(&cb->lock);
+
+	/* Pixels per microsecond is Mpixels per second */
+	if (s.nsec)
+		mpix = div64_u64(s.pixels * 1000, s.nsec);
+
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"kernels     : %s\n", cb->kernels->name);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"active      : %lu\n", s.n_active);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"fallback    : %lu\n", s.n_fallback);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"offload     : %lu\n", s.n_offload);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"failed      : %lu\n", s.n_failed);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"pixels      : %llu\n", (unsigned long long)s.pixels);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"time (us)   : %llu\n",
+		(unsigned long long)div_u64(s.nsec, 1000));
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"max (us)    : %llu\n",
+		(unsigned long long)div_u64(s.max_nsec, 1000));
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"Mpixels/s   : %llu\n", (unsigned long long)mpix);
+
+	return simple_read_from_buffer(buf, count, f_pos, tmp, len);
+}
+
+static const struct file_operations debugfs_cpu_blt_fops = {
+	.owner = THIS_MODULE,
+	.read  = debugfs_cpu_blt_read,
+};
+#endif
+
+int b2r2_cpu_blt_init(struct b2r2_control *cont)
+{
+	struct b2r2_cpu_blt *cb;
+
+	cb = kzalloc(sizeof(*cb), GFP_KERNEL);
+	if (cb == NULL)
+		return -ENOMEM;
+
+	cb->wq = alloc_workqueue("b2r2_cpu", WQ_UNBOUND, 0);
+	if (cb->wq == NULL) {
+		kfree(cb);
+		return -ENOMEM;
+	}
+
+	spin_lock_init(&cb->lock);
+	cb->kernels = &b2r2_cpu_kernels_c;
+#ifdef CONFIG_B2R2_CPU_BLT_NEON
+	if (cpu_blt_neon && cpu_has_neon())
+		cb->kernels = &b2r2_cpu_kernels_neon;
+#endif
+
+#ifdef CONFIG_DEBUG_FS
+	if (!IS_ERR_OR_NULL(cont->debugfs_root_dir))
+		debugfs_create_file("cpu_blt", 0444, cont->debugfs_root_dir,
+			cb, &debugfs_cpu_blt_fops);
+#endif
+
+	cont->cpu_blt = cb;
+
+	b2r2_log_info(cont->dev, "%s: using %s kernels\n", __func__,
+		cb->kernels->name);
+
+	return 0;
+}
+
+void b2r2_cpu_blt_exit(struct b2r2_control *cont)
+{
+	struct b2r2_cpu_blt *cb = cont->cpu_blt;
+
+	if (cb == NULL)
+		return;
+
+	/* Runs the queued jobs to completion */
+	destroy_workqueue(cb->wq);
+	cont->cpu_blt = NULL;
+	kfree(cb);
+}
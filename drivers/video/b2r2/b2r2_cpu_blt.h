@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 CPU blitter
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+#ifndef _LINUX_DRIVERS_VIDEO_B2R2_CPU_BLT_H_
+#define _LINUX_DRIVERS_VIDEO_B2R2_CPU_BLT_H_
+
+#include "b2r2_internal.h"
+
+#ifdef CONFIG_B2R2_CPU_BLT
+
+/**
+ * b2r2_cpu_blt_init() - Sets up the CPU blitter of a b2r2 control
+ *
+ * Returns 0 if OK else negative error code
+ */
+int b2r2_cpu_blt_init(struct b2r2_control *cont);
+
+/**
+ * b2r2_cpu_blt_exit() - Waits for running CPU jobs and frees the blitter
+ */
+void b2r2_cpu_blt_exit(struct b2r2_control *cont);
+
+/**
+ * b2r2_cpu_blt_supported() - Checks if the CPU blitter can execute a
+ *                            request
+ *
+ * @request: The request, with all buffers resolved
+ */
+bool b2r2_cpu_blt_supported(struct b2r2_blt_request *request);
+
+/**
+ * b2r2_cpu_blt_should_offload() - Checks if a request the hardware could
+ *                                 do should rather go to the CPU because
+ *                                 the hardware queue is busy
+ *
+ * @request: The request, with all buffers resolved
+ */
+bool b2r2_cpu_blt_should_offload(struct b2r2_blt_request *request);
+
+/**
+ * b2r2_cpu_blt_add() - Queues a request on the CPU blitter
+ *
+ * The job callbacks must be set up as for b2r2_core_job_add(), and
+ * the buffers must be in the CPU domain.
+ *
+ * @request: The request
+ * @offload: true if the hardware could have done the request
+ *
+ * Returns the job id or negative error code
+ */
+int b2r2_cpu_blt_add(struct b2r2_blt_request *request, bool offload);
+
+/**
+ * b2r2_cpu_blt_cancel() - Cancels a job queued with b2r2_cpu_blt_add()
+ *
+ * A job not started yet is completed as canceled, one already running is
+ * waited for. Must not be called from atomic context.
+ *
+ * @job: The job, the caller holds a reference to it
+ *
+ * Returns 0
+ */
+int b2r2_cpu_blt_cancel(struct b2r2_core_job *job);
+
+#else
+
+static inline int b2r2_cpu_blt_init(struct b2r2_control *cont)
+{
+	return 0;
+}
+
+static inline void b2r2_cpu_blt_exit(struct b2r2_control *cont)
+{
+}
+
+static inline bool b2r2_cpu_blt_supported(struct b2r2_blt_request *request)
+{
+	return false;
+}
+
+static inline bool b2r2_cpu_blt_should_offload(
+		struct b2r2_blt_request *request)
+{
+	return false;
+}
+
+static inline int b2r2_cpu_blt_add(struct b2r2_blt_request *request,
+		bool offload)
+{
+	return -ENOSYS;
+}
+
+static inline int b2r2_cpu_blt_cancel(struct b2r2_core_job *job)
+{
+	return -ENOSYS;
+}
+
+#endif /* CONFIG_B2R2_CPU_BLT */
+
+#endif /* _LINUX_DRIVERS_VIDEO_B2R2_CPU_BLT_H_ */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 CPU blit reference row kernels
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+#include "b2r2_cpu_kernels.h"
+
+/* BT.601, Y in 16..235 and CbCr in 16..240 */
+const struct b2r2_cpu_yuv_coefs b2r2_cpu_bt601_video = {
+	.y_offset = 16,
+	.cy = 298,
+	.crv = 409,
+	.cgu = 100,
+	.cgv = 208,
+	.cbu = 516,
+};
+
+/* BT.601, full 0..255 range (JFIF) */
+const struct b2r2_cpu_yuv_coefs b2r2_cpu_bt601_full = {
+	.y_offset = 0,
+	.cy = 256,
+	.crv = 359,
+	.cgu = 88,
+	.cgv = 183,
+	.cbu = 454,
+};
+
+static inline u32 clamp_u8(s32 v)
+{
+	if (v < 0)
+		return 0;
+	if (v > 255)
+		return 255;
+	return v;
+}
+
+/* x / 255 rounded, exact for x in 0..255*255 */
+static inline u32 div255(u32 x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static void c_rgb565_to_argb8888(u32 *dst, const u16 *src, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		u32 p = src[i];
+		u32 r = (p >> 11) & 0x1f;
+		u32 g = (p >> 5) & 0x3f;
+		u32 b = p & 0x1f;
+
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+		dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+	}
+}
+
+static void c_argb8888_to_rgb565(u16 *dst, const u32 *src, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		u32 p = src[i];
+
+		dst[i] = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) |
+			((p >> 3) & 0x001f);
+	}
+}
+
+static void c_yuv420_to_argb8888(u32 *dst, const u8 *y, const u8 *u,
+		const u8 *v, int n, const struct b2r2_cpu_yuv_coefs *c)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		s32 yy = c->cy * (y[i] - c->y_offset);
+		s32 uu = u[i >> 1] - 128;
+		s32 vv = v[i >> 1] - 128;
+		u32 r = clamp_u8((yy + c->crv * vv + 128) >> 8);
+		u32 g = clamp_u8((yy - c->cgu * uu - c->cgv * vv + 128) >> 8);
+		u32 b = clamp_u8((yy + c->cbu * uu + 128) >> 8);
+
+		dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+	}
+}
+
+static void c_blend_argb8888(u32 *dst, const u32 *src, int n,
+		u32 global_alpha, u32 flags)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		u32 s = src[i];
+		u32 d = dst[i];
+		u32 a = global_alpha;
+		u32 f; /* Factor the source colors are scaled by */
+		u32 ia;
+		u32 out;
+		int shift;
+
+		if (flags & B2R2_CPU_BLEND_PIXEL_ALPHA)
+			a = div255((s >> 24) * global_alpha);
+		f = (flags & B2R2_CPU_BLEND_PREMULT) ? global_alpha : a;
+		ia = 255 - a;
+
+		out = (a + div255((d >> 24) * ia)) << 24;
+		for (shift = 0; shift < 24; shift += 8) {
+			u32 sc = div255(((s >> shift) & 0xff) * f);
+			u32 dc = div255(((d >> shift) & 0xff) * ia);
+
+			out |= clamp_u8(sc + dc) << shift;
+		}
+		dst[i] = out;
+	}
+}
+
+static void c_lerp_rows(u8 *dst, const u8 *a, const u8 *b, int n, u32 frac)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		dst[i] = (a[i] * (256 - frac) + b[i] * frac + 128) >> 8;
+}
+
+static void c_scale_row_argb8888(u32 *dst, const u32 *src, int src_w,
+		int n, u32 x0, u32 step)
+{
+	u32 x = x0;
+	int i;
+
+	for (i = 0; i < n; i++, x += step) {
+		int x1 = x >> 16;
+		u32 f = (x >> 8) & 0xff;
+		u32 p0, p1, out = 0;
+		int shift;
+
+		if (x1 >= src_w - 1) {
+			dst[i] = src[src_w - 1];
+			continue;
+		}
+		p0 = src[x1];
+		p1 = src[x1 + 1];
+		if (f == 0 || p0 == p1) {
+			dst[i] = p0;
+			continue;
+		}
+
+		for (shift = 0; shift < 32; shift += 8) {
+			u32 c0 = (p0 >> shift) & 0xff;
+			u32 c1 = (p1 >> shift) & 0xff;
+
+			out |= ((c0 * (256 - f) + c1 * f + 128) >> 8) << shift;
+		}
+		dst[i] = out;
+	}
+}
+
+const struct b2r2_cpu_kernels b2r2_cpu_kernels_c = {
+	.name = "c",
+	.rgb565_to_argb8888 = c_rgb565_to_argb8888,
+	.argb8888_to_rgb565 = c_argb8888_to_rgb565,
+	.yuv420_to_argb8888 = c_yuv420_to_argb8888,
+	.blend_argb8888 = c_blend_argb8888,
+	.lerp_rows = c_lerp_rows,
+	.scale_row_argb8888 = c_scale_row_argb8888,
+};
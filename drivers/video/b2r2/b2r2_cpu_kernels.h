@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 CPU blit row kernels
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * The kernels work on one line of pixels at a time and make no alignment
+ * assumptions. Every implementation must give bit exact the same result as
+ * the reference C one, tools/b2r2 checks that. This header and the kernel
+ * sources are also built in user space by that test, so they must not
+ * depend on anything but the types below.
+ */
+
+#ifndef _LINUX_DRIVERS_VIDEO_B2R2_CPU_KERNELS_H_
+#define _LINUX_DRIVERS_VIDEO_B2R2_CPU_KERNELS_H_
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int16_t s16;
+typedef int32_t s32;
+#endif
+
+/* blend_argb8888() flags */
+#define B2R2_CPU_BLEND_PIXEL_ALPHA	0x1	/* Use the source alpha */
+#define B2R2_CPU_BLEND_PREMULT		0x2	/* Source is premultiplied */
+
+/*
+ * YCbCr to RGB coefficients, in 8 bit fixed point:
+ *
+ *   R = (cy * (Y - y_offset) + crv * (V - 128) + 128) >> 8
+ *   G = (cy * (Y - y_offset) - cgu * (U - 128) - cgv * (V - 128) + 128) >> 8
+ *   B = (cy * (Y - y_offset) + cbu * (U - 128) + 128) >> 8
+ *
+ * All results are clamped to 0..255.
+ */
+struct b2r2_cpu_yuv_coefs {
+	s16 y_offset;
+	s16 cy;
+	s16 crv;
+	s16 cgu;
+	s16 cgv;
+	s16 cbu;
+};
+
+extern const struct b2r2_cpu_yuv_coefs b2r2_cpu_bt601_video;
+extern const struct b2r2_cpu_yuv_coefs b2r2_cpu_bt601_full;
+
+/**
+ * struct b2r2_cpu_kernels - one implementation of the CPU blit row kernels
+ *
+ * @name: Shown in debugfs
+ * @rgb565_to_argb8888: Expands n pixels, alpha is set to 255
+ * @argb8888_to_rgb565: Packs n pixels, alpha is dropped
+ * @yuv420_to_argb8888: Converts n pixels of one line of a planar 4:2:0
+ *                      image. u[i] and v[i] belong to pixels 2i and 2i+1.
+ * @blend_argb8888: Source over blend of n pixels of src onto dst
+ * @lerp_rows: dst = (a * (256 - frac) + b * frac + 128) >> 8 bytewise,
+ *             frac is 1..255
+ * @scale_row_argb8888: Bilinear horizontal resampling of src (src_w
+ *                      pixels) into n pixels. Pixel i is sampled at
+ *                      (x0 + i * step) in 16.16 fixed point.
+ */
+struct b2r2_cpu_kernels {
+	const char *name;
+
+	void (*rgb565_to_argb8888)(u32 *dst, const u16 *src, int n);
+	void (*argb8888_to_rgb565)(u16 *dst, const u32 *src, int n);
+	void (*yuv420_to_argb8888)(u32 *dst, const u8 *y, const u8 *u,
+			const u8 *v, int n,
+			const struct b2r2_cpu_yuv_coefs *coefs);
+	void (*blend_argb8888)(u32 *dst, const u32 *src, int n,
+			u32 global_alpha, u32 flags);
+	void (*lerp_rows)(u8 *dst, const u8 *a, const u8 *b, int n, u32 frac);
+	void (*scale_row_argb8888)(u32 *dst, const u32 *src, int src_w,
+			int n, u32 x0, u32 step);
+};
+
+extern const struct b2r2_cpu_kernels b2r2_cpu_kernels_c;
+extern const struct b2r2_cpu_kernels b2r2_cpu_kernels_neon;
+
+#endif /* _LINUX_DRIVERS_VIDEO_B2R2_CPU_KERNELS_H_ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 CPU blit NEON row kernels
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). Each kernel does whole vectors
+ * and leaves the tail of the line to the C version, so the results are
+ * exactly the ones of b2r2_cpu_kernels_c.
+ */
+
+#include <arm_neon.h>
+
+#include "b2r2_cpu_kernels.h"
+
+/* x / 255 rounded, x <= 255 * 255 */
+static inline uint8x8_t div255(uint16x8_t x)
+{
+	uint16x8_t t = vaddq_u16(x, vdupq_n_u16(128));
+
+	return vaddhn_u16(t, vshrq_n_u16(t, 8));
+}
+
+static void neon_rgb565_to_argb8888(u32 *dst, const u16 *src, int n)
+{
+	uint8x8x4_t out;
+	int i;
+
+	out.val[3] = vdup_n_u8(0xff);
+	for (i = 0; i + 8 <= n; i += 8) {
+		uint16x8_t p = vld1q_u16(src + i);
+		uint8x8_t r = vand_u8(vshrn_n_u16(p, 8), vdup_n_u8(0xf8));
+		uint8x8_t g = vand_u8(vshrn_n_u16(p, 3), vdup_n_u8(0xfc));
+		uint8x8_t b = vshl_n_u8(vmovn_u16(p), 3);
+
+		out.val[0] = vorr_u8(b, vshr_n_u8(b, 5));
+		out.val[1] = vorr_u8(g, vshr_n_u8(g, 6));
+		out.val[2] = vorr_u8(r, vshr_n_u8(r, 5));
+		vst4_u8((u8 *)(dst + i), out);
+	}
+
+	if (i < n)
+		b2r2_cpu_kernels_c.rgb565_to_argb8888(dst + i, src + i, n - i);
+}
+
+static void neon_argb8888_to_rgb565(u16 *dst, const u32 *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		uint8x8x4_t p = vld4_u8((const u8 *)(src + i));
+		uint16x8_t out = vshll_n_u8(p.val[2], 8);
+
+		out = vsriq_n_u16(out, vshll_n_u8(p.val[1], 8), 5);
+		out = vsriq_n_u16(out, vshll_n_u8(p.val[0], 8), 11);
+		vst1q_u16(dst + i, out);
+	}
+
+	if (i < n)
+		b2r2_cpu_kernels_c.argb8888_to_rgb565(dst + i, src + i, n - i);
+}
+
+static inline uint16x4_t yuv_channel(int32x4_t x)
+{
+	/* (x + 128) >> 8, negative values saturate to 0 */
+	return vqrshrun_n_s32(x, 8);
+}
+
+/* Eight pixels, with the chroma already doubled up */
+static inline void yuv_to_argb_8(u32 *dst, uint8x8_t yb, uint8x8_t ub,
+		uint8x8_t vb, const struct b2r2_cpu_yuv_coefs *c)
+{
+	int16x8_t y = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yb)),
+			vdupq_n_s16(c->y_offset));
+	int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(ub)),
+			vdupq_n_s16(128));
+	int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vb)),
+			vdupq_n_s16(128));
+	int32x4_t yl = vmull_n_s16(vget_low_s16(y), c->cy);
+	int32x4_t yh = vmull_n_s16(vget_high_s16(y), c->cy);
+	int32x4_t rl, rh, gl, gh, bl, bh;
+	uint8x8x4_t out;
+
+	rl = vmlal_n_s16(yl, vget_low_s16(v), c->crv);
+	rh = vmlal_n_s16(yh, vget_high_s16(v), c->crv);
+	gl = vmlsl_n_s16(yl, vget_low_s16(u), c->cgu);
+	gh = vmlsl_n_s16(yh, vget_high_s16(u), c->cgu);
+	gl = vmlsl_n_s16(gl, vget_low_s16(v), c->cgv);
+	gh = vmlsl_n_s16(gh, vget_high_s16(v), c->cgv);
+	bl = vmlal_n_s16(yl, vget_low_s16(u), c->cbu);
+	bh = vmlal_n_s16(yh, vget_high_s16(u), c->cbu);
+
+	out.val[0] = vqmovn_u16(vcombine_u16(yuv_channel(bl),
+			yuv_channel(bh)));
+	out.val[1] = vqmovn_u16(vcombine_u16(yuv_channel(gl),
+			yuv_channel(gh)));
+	out.val[2] = vqmovn_u16(vcombine_u16(yuv_channel(rl),
+			yuv_channel(rh)));
+	out.val[3] = vdup_n_u8(0xff);
+	vst4_u8((u8 *)dst, out);
+}
+
+static void neon_yuv420_to_argb8888(u32 *dst, const u8 *y, const u8 *u,
+		const u8 *v, int n, const struct b2r2_cpu_yuv_coefs *c)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		uint8x16_t yy = vld1q_u8(y + i);
+		uint8x8x2_t uu = vzip_u8(vld1_u8(u + i / 2), vld1_u8(u + i / 2));
+		uint8x8x2_t vv = vzip_u8(vld1_u8(v + i / 2), vld1_u8(v + i / 2));
+
+		yuv_to_argb_8(dst + i, vget_low_u8(yy), uu.val[0], vv.val[0], c);
+		yuv_to_argb_8(dst + i + 8, vget_high_u8(yy), uu.val[1],
+				vv.val[1], c);
+	}
+
+	if (i < n)
+		b2r2_cpu_kernels_c.yuv420_to_argb8888(dst + i, y + i, u + i / 2,
+				v + i / 2, n - i, c);
+}
+
+static void neon_blend_argb8888(u32 *dst, const u32 *src, int n,
+		u32 global_alpha, u32 flags)
+{
+	uint8x8_t ga = vdup_n_u8(global_alpha);
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		uint8x8x4_t s = vld4_u8((const u8 *)(src + i));
+		uint8x8x4_t d = vld4_u8((const u8 *)(dst + i));
+		uint8x8_t a = ga;
+		uint8x8_t f;
+		uint8x8_t ia;
+		int c;
+
+		if (flags & B2R2_CPU_BLEND_PIXEL_ALPHA)
+			a = div255(vmull_u8(s.val[3], ga));
+		f = (flags & B2R2_CPU_BLEND_PREMULT) ? ga : a;
+		ia = vmvn_u8(a);
+
+		for (c = 0; c < 3; c++)
+			d.val[c] = vqadd_u8(div255(vmull_u8(s.val[c], f)),
+					div255(vmull_u8(d.val[c], ia)));
+		d.val[3] = vadd_u8(a, div255(vmull_u8(d.val[3], ia)));
+		vst4_u8((u8 *)(dst + i), d);
+	}
+
+	if (i < n)
+		b2r2_cpu_kernels_c.blend_argb8888(dst + i, src + i, n - i,
+				global_alpha, flags);
+}
+
+static void neon_lerp_rows(u8 *dst, const u8 *a, const u8 *b, int n, u32 frac)
+{
+	uint8x8_t fa = vdup_n_u8(256 - frac);
+	uint8x8_t fb = vdup_n_u8(frac);
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		uint8x16_t va = vld1q_u8(a + i);
+		uint8x16_t vb = vld1q_u8(b + i);
+		uint16x8_t lo = vmull_u8(vget_low_u8(va), fa);
+		uint16x8_t hi = vmull_u8(vget_high_u8(va), fa);
+
+		lo = vmlal_u8(lo, vget_low_u8(vb), fb);
+		hi = vmlal_u8(hi, vget_high_u8(vb), fb);
+		vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8),
+				vrshrn_n_u16(hi, 8)));
+	}
+
+	if (i < n)
+		b2r2_cpu_kernels_c.lerp_rows(dst + i, a + i, b + i, n - i, frac);
+}
+
+/*
+ * The horizontal taps are data dependent gathers that NEON does not help
+ * with; the vertical pass (lerp_rows) carries the bulk of the work.
+ */
+static void neon_scale_row_argb8888(u32 *dst, const u32 *src, int src_w,
+		int n, u32 x0, u32 step)
+{
+	b2r2_cpu_kernels_c.scale_row_argb8888(dst, src, src_w, n, x0, step);
+}
+
+const struct b2r2_cpu_kernels b2r2_cpu_kernels_neon = {
+	.name = "neon",
+	.rgb565_to_argb8888 = neon_rgb565_to_argb8888,
+	.argb8888_to_rgb565 = neon_argb8888_to_rgb565,
+	.yuv420_to_argb8888 = neon_yuv420_to_argb8888,
+	.blend_argb8888 = neon_blend_argb8888,
+	.lerp_rows = neon_lerp_rows,
+	.scale_row_argb8888 = neon_scale_row_argb8888,
+};
@@ -408,6 +408,7 @@ struct b2r2_core_job {
 	struct list_head  list;
 	wait_queue_head_t event;
 	struct work_struct work;
+	bool is_cpu_job;
 
 	/* B2R2 HW data */
 	enum b2r2_core_queue queue;
@@ -571,6 +572,7 @@ struct b2r2_mem_dump {
  * @last_job: The last running job on this b2r2 instance
  * @last_job_chars: Temporary buffer used in printing last_job
  * @prev_node_count: Node cound of last_job
+ * @cpu_blt: The CPU blitter, see b2r2_cpu_blt.c
  */
 struct b2r2_control {
 	struct device                   *dev;
@@ -608,6 +610,9 @@ struct b2r2_control {
 	char                            *last_job_chars;
 	int                             prev_node_count;
 	struct b2r2_mem_dump            dump;
+#ifdef CONFIG_B2R2_CPU_BLT
+	struct b2r2_cpu_blt             *cpu_blt;
+#endif
 };
 
 /* FIXME: The functions below should be removed when we are
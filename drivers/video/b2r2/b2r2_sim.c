@@ -0,0 +1,1104 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 software core
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+/*
+ * Executes B2R2 node lists on the CPU so that node generation can be run,
+ * tested and profiled without a B2R2. The register file is a plain memory
+ * copy of struct b2r2_memory_map that the core driver uses exactly as it
+ * uses the real one. When a job is triggered its node list is walked from
+ * the first to the last node address. Each node is loaded the way the
+ * hardware loads it, i.e. groups 0 and 1 always and the other groups only
+ * when flagged in CIC, the rest of the register state carries over from
+ * the previous node. Then the queue's interrupt is raised back into the
+ * core driver.
+ *
+ * Executed are raster RGB, ARGB, A8 and packed YCbCr formats, source 1
+ * and 2 fetch and color fill, direct fill and copy, bypass, ROPs, plain
+ * and premultiplied blend with global alpha, IVMX and OVMX, the 2D
+ * resizer with the loaded filter coefficients, rotation, scan order, clip
+ * window and plane mask. Nodes needing anything else (planar and macro
+ * block formats, source 3, CLUT, color key, flicker filter, XYL,
+ * clip masks) are skipped and counted as unsupported.
+ *
+ * Buffers and nodes are reached through the kernel linear mapping, so
+ * they must be in lowmem, which holds for the B2R2 node and hwmem pools.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/pfn.h>
+#include <linux/io.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#ifdef CONFIG_DEBUG_FS
+#include <linux/debugfs.h>
+#endif
+
+#include "b2r2_sim.h"
+#include "b2r2_global.h"
+#include "b2r2_hw.h"
+#include "b2r2_debug.h"
+
+/* Stops a node list that does not reach its last node address */
+#define SIM_MAX_NODES 8192
+
+/* Nodes per job histogram, bucket i counts up to 2^i nodes */
+#define SIM_HIST_BUCKETS 10
+
+#define SIM_TY_FMT_MASK (0x1f << B2R2_TY_COLOR_FORM_SHIFT)
+#define SIM_TY_PITCH_MASK 0xffff
+
+#define SIM_INS_SOURCE_1_MASK (0x7 << B2R2_INS_SOURCE_1_SHIFT)
+#define SIM_INS_SOURCE_2_MASK (0x3 << B2R2_INS_SOURCE_2_SHIFT)
+#define SIM_ACK_MODE_MASK (0xf << B2R2_ACK_MODE_SHIFT)
+
+#define SIM_INS_UNSUPPORTED (B2R2_INS_SOURCE_3_FETCH_FROM_MEM | \
+		B2R2_INS_CLUTOP_ENABLED | B2R2_INS_FLICK_FILT_ENABLED | \
+		B2R2_INS_CKEY_ENABLED | B2R2_INS_DEI_ENABLED | \
+		B2R2_INS_XYL_ENABLED | B2R2_INS_DOT_ENABLED | \
+		B2R2_INS_VC1R_ENABLED)
+
+/* Clip window exterior mode */
+#define SIM_CWO_EXTERIOR BIT(31)
+
+/**
+ * struct b2r2_sim_stats - Software core statistics
+ *
+ * @jobs: Jobs executed
+ * @requests: Runs of jobs with the same job id, i.e. tiled requests
+ *            count once
+ * @nodes: Nodes executed
+ * @max_nodes: Most nodes in one job
+ * @unsupported: Nodes skipped as they use unsupported features
+ * @faults: Jobs aborted on an unmappable node, buffer or filter address
+ * @pixels: Target pixels written
+ * @fetched: Source pixels read, filter taps included
+ * @nsec: Time spent executing nodes
+ * @hist: Nodes per job histogram
+ */
+struct b2r2_sim_stats {
+	unsigned long jobs;
+	unsigned long requests;
+	unsigned long nodes;
+	unsigned long max_nodes;
+	unsigned long unsupported;
+	unsigned long faults;
+	u64 pixels;
+	u64 fetched;
+	u64 nsec;
+	unsigned long hist[SIM_HIST_BUCKETS];
+};
+
+/**
+ * struct sim_job - A job waiting to be executed on one queue
+ */
+struct sim_job {
+	bool valid;
+	u32 first;
+	u32 last;
+	u32 its;
+	int job_id;
+};
+
+/**
+ * struct b2r2_sim - Software B2R2 core
+ *
+ * @dev: Device for logging
+ * @regs: The register file
+ * @irq: Interrupt callback
+ * @irq_data: Interrupt callback data
+ * @wq: Executes the node lists, one at a time like the hardware does
+ * @work: The execution work
+ * @lock: Protects @pending and @stats
+ * @pending: Job triggered per queue
+ * @state: Current node register state
+ * @last_job_id: Job id of the last job, for the request count
+ * @stats: Statistics
+ */
+struct b2r2_sim {
+	struct device *dev;
+	struct b2r2_memory_map *regs;
+	void (*irq)(void *data, u32 its);
+	void *irq_data;
+	struct workqueue_struct *wq;
+	struct work_struct work;
+	spinlock_t lock;
+	struct sim_job pending[B2R2_CORE_QUEUE_NO_OF];
+	struct b2r2_link_list state;
+	int last_job_id;
+	struct b2r2_sim_stats stats;
+};
+
+/* A pixel inside the pipeline, alpha in 0..128, c[2] is R or Cr */
+struct sim_px {
+	u32 a;
+	u32 c[3];
+};
+
+/**
+ * struct sim_img - A source or target window
+ *
+ * @base: Virtual address of pixel (0, 0) of the buffer
+ * @pitch: Line length in bytes
+ * @ty: The <S/T>TY register
+ * @fmt: Native color format
+ * @bpp: Bytes per pixel
+ * @x: Start column of the window
+ * @y: Start line of the window
+ * @w: Window width
+ * @h: Window height
+ * @dx: Horizontal scan direction
+ * @dy: Vertical scan direction
+ */
+struct sim_img {
+	u8 *base;
+	u32 pitch;
+	u32 ty;
+	u32 fmt;
+	int bpp;
+	int x;
+	int y;
+	int w;
+	int h;
+	int dx;
+	int dy;
+};
+
+/**
+ * struct sim_filter - One direction of the 2D resizer
+ *
+ * @init: Start position, 1/1024 pixels
+ * @inc: Increment per target pixel, 1/1024 pixels
+ * @color: Filter the color channels, else take the nearest pixel
+ * @alpha: Filter the alpha channel, else take the nearest pixel
+ * @coeffs: Coefficient table, 8 phases of @taps taps
+ * @taps: Taps per phase
+ */
+struct sim_filter {
+	u32 init;
+	u32 inc;
+	bool color;
+	bool alpha;
+	const s8 *coeffs;
+	int taps;
+};
+
+static inline s32 sext(u32 v, int bits)
+{
+	return (s32)(v << (32 - bits)) >> (32 - bits);
+}
+
+static inline u32 clamp_c(s32 v)
+{
+	return clamp_t(s32, v, 0, 255);
+}
+
+/* Returns the linear mapping of len bytes at physical address addr */
+static void *sim_map(u32 addr, size_t len)
+{
+	unsigned long first = PFN_DOWN(addr);
+	unsigned long last = PFN_DOWN(addr + len - 1);
+
+	if (len == 0 || addr + len - 1 < addr)
+		return NULL;
+	if (!pfn_valid(first) || !pfn_valid(last) ||
+			PageHighMem(pfn_to_page(last)))
+		return NULL;
+
+	return phys_to_virt(addr);
+}
+
+static int fmt_bpp(u32 fmt)
+{
+	switch (fmt) {
+	case B2R2_NATIVE_A8:
+		return 1;
+	case B2R2_NATIVE_RGB565:
+	case B2R2_NATIVE_ARGB1555:
+	case B2R2_NATIVE_ARGB4444:
+		return 2;
+	case B2R2_NATIVE_RGB888:
+	case B2R2_NATIVE_ARGB8565:
+	case B2R2_NATIVE_YCBCR888:
+		return 3;
+	case B2R2_NATIVE_ARGB8888:
+	case B2R2_NATIVE_AYCBCR8888:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static u32 read_raw(const u8 *p, int bpp, bool big)
+{
+	u32 v = 0;
+	int i;
+
+	if (big)
+		for (i = 0; i < bpp; i++)
+			v = (v << 8) | p[i];
+	else
+		for (i = bpp - 1; i >= 0; i--)
+			v = (v << 8) | p[i];
+
+	return v;
+}
+
+static void write_raw(u8 *p, int bpp, bool big, u32 v)
+{
+	int i;
+
+	if (big)
+		for (i = bpp - 1; i >= 0; i--, v >>= 8)
+			p[i] = v;
+	else
+		for (i = 0; i < bpp; i++, v >>= 8)
+			p[i] = v;
+}
+
+static inline u32 expand(u32 v, int bits, bool lsb_zero)
+{
+	v <<= 8 - bits;
+	return lsb_zero ? v : v | (v >> bits);
+}
+
+static inline u32 alpha_in(u32 a, u32 ty)
+{
+	if (ty & B2R2_TY_ALPHA_RANGE_255)
+		return (a * 128 + 127) / 255;
+	return min_t(u32, a, 128);
+}
+
+static inline u32 alpha_out(u32 a, u32 ty)
+{
+	if (ty & B2R2_TY_ALPHA_RANGE_255)
+		return (a * 255 + 64) >> 7;
+	return a;
+}
+
+/* Raw pixel value to pipeline pixel */
+static void decode(u32 v, u32 fmt, u32 ty, struct sim_px *px)
+{
+	/* The expansion bit is at the same place in S1TY and S2TY */
+	bool lsb_zero = ty & B2R2_S1TY_RGB_EXPANSION_LSP_ZERO;
+
+	switch (fmt) {
+	case B2R2_NATIVE_RGB565:
+	case B2R2_NATIVE_ARGB8565:
+		px->a = fmt == B2R2_NATIVE_RGB565 ? 128 :
+			alpha_in(v >> 16, ty);
+		px->c[2] = expand((v >> 11) & 0x1f, 5, lsb_zero);
+		px->c[1] = expand((v >> 5) & 0x3f, 6, lsb_zero);
+		px->c[0] = expand(v & 0x1f, 5, lsb_zero);
+		break;
+	case B2R2_NATIVE_ARGB1555:
+		px->a = (v & 0x8000) ? 128 : 0;
+		px->c[2] = expand((v >> 10) & 0x1f, 5, lsb_zero);
+		px->c[1] = expand((v >> 5) & 0x1f, 5, lsb_zero);
+		px->c[0] = expand(v & 0x1f, 5, lsb_zero);
+		break;
+	case B2R2_NATIVE_ARGB4444:
+		px->a = (((v >> 12) & 0xf) * 128 + 7) / 15;
+		px->c[2] = ((v >> 8) & 0xf) * 17;
+		px->c[1] = ((v >> 4) & 0xf) * 17;
+		px->c[0] = (v & 0xf) * 17;
+		break;
+	case B2R2_NATIVE_RGB888:
+	case B2R2_NATIVE_YCBCR888:
+	case B2R2_NATIVE_ARGB8888:
+	case B2R2_NATIVE_AYCBCR8888:
+		px->a = fmt_bpp(fmt) == 3 ? 128 : alpha_in(v >> 24, ty);
+		px->c[2] = (v >> 16) & 0xff;
+		px->c[1] = (v >> 8) & 0xff;
+		px->c[0] = v & 0xff;
+		break;
+	case B2R2_NATIVE_A8:
+		px->a = alpha_in(v & 0xff, ty);
+		px->c[2] = px->c[1] = px->c[0] = 0;
+		break;
+	}
+}
+
+/* Pipeline pixel to raw pixel value */
+static u32 encode(const struct sim_px *px, u32 fmt, u32 ty)
+{
+	switch (fmt) {
+	case B2R2_NATIVE_RGB565:
+	case B2R2_NATIVE_ARGB8565:
+		return (fmt == B2R2_NATIVE_RGB565 ? 0 :
+				alpha_out(px->a, ty) << 16) |
+			((px->c[2] >> 3) << 11) | ((px->c[1] >> 2) << 5) |
+			(px->c[0] >> 3);
+	case B2R2_NATIVE_ARGB1555:
+		return (px->a >= 64 ? 0x8000 : 0) | ((px->c[2] >> 3) << 10) |
+			((px->c[1] >> 3) << 5) | (px->c[0] >> 3);
+	case B2R2_NATIVE_ARGB4444:
+		return (((px->a * 15 + 64) >> 7) << 12) |
+			((px->c[2] >> 4) << 8) | ((px->c[1] >> 4) << 4) |
+			(px->c[0] >> 4);
+	case B2R2_NATIVE_RGB888:
+	case B2R2_NATIVE_YCBCR888:
+		return (px->c[2] << 16) | (px->c[1] << 8) | px->c[0];
+	case B2R2_NATIVE_ARGB8888:
+	case B2R2_NATIVE_AYCBCR8888:
+		return (alpha_out(px->a, ty) << 24) | (px->c[2] << 16) |
+			(px->c[1] << 8) | px->c[0];
+	case B2R2_NATIVE_A8:
+		return alpha_out(px->a, ty);
+	default:
+		return 0;
+	}
+}
+
+static inline u32 pack(const struct sim_px *px)
+{
+	return (px->a << 24) | (px->c[2] << 16) | (px->c[1] << 8) | px->c[0];
+}
+
+static inline void unpack(u32 v, struct sim_px *px)
+{
+	px->a = min_t(u32, v >> 24, 128);
+	px->c[2] = (v >> 16) & 0xff;
+	px->c[1] = (v >> 8) & 0xff;
+	px->c[0] = v & 0xff;
+}
+
+/*
+ * Color space conversion. VMX0..2 are the rows for c[2], c[1] and c[0],
+ * each with 11, 11 and 10 bit signed 2.8 fixed point coefficients for
+ * c[2], c[1] and c[0]. VMX3 holds 10 bit signed offsets for the three
+ * outputs.
+ */
+static void vmx(const struct b2r2_vm *m, struct sim_px *px)
+{
+	const u32 row[3] = { m->B2R2_VMX0, m->B2R2_VMX1, m->B2R2_VMX2 };
+	s32 in[3] = { px->c[2], px->c[1], px->c[0] };
+	int k;
+
+	for (k = 0; k < 3; k++) {
+		s32 sum = sext(row[k] >> 21, 11) * in[0] +
+			sext((row[k] >> 10) & 0x7ff, 11) * in[1] +
+			sext(row[k] & 0x3ff, 10) * in[2];
+		s32 offset = sext((m->B2R2_VMX3 >> (20 - 10 * k)) & 0x3ff,
+				10);
+
+		px->c[2 - k] = clamp_c(((sum + 128) >> 8) + offset);
+	}
+}
+
+/* Foreground over background, global alpha in 0..128 */
+static void blend(struct sim_px *out, const struct sim_px *fg,
+		const struct sim_px *bg, u32 ga, bool premult)
+{
+	u32 a = (fg->a * ga + 64) >> 7;
+	u32 ia = 128 - a;
+	int k;
+
+	for (k = 0; k < 3; k++) {
+		u32 f = (fg->c[k] * (premult ? ga : a) + 64) >> 7;
+
+		out->c[k] = min_t(u32, f + ((bg->c[k] * ia + 64) >> 7), 255);
+	}
+	out->a = a + ((bg->a * ia + 64) >> 7);
+}
+
+/* Logical operation, s is the foreground and d the background */
+static u32 rop(u32 id, u32 s, u32 d)
+{
+	switch (id) {
+	case 0x0:
+		return 0;
+	case 0x1:
+		return s & d;
+	case 0x2:
+		return s & ~d;
+	case 0x3:
+		return s;
+	case 0x4:
+		return ~s & d;
+	case 0x5:
+		return d;
+	case 0x6:
+		return s ^ d;
+	case 0x7:
+		return s | d;
+	case 0x8:
+		return ~(s | d);
+	case 0x9:
+		return ~(s ^ d);
+	case 0xa:
+		return ~d;
+	case 0xb:
+		return s | ~d;
+	case 0xc:
+		return ~s;
+	case 0xd:
+		return ~s | d;
+	case 0xe:
+		return ~(s & d);
+	default:
+		return 0xffffffff;
+	}
+}
+
+/* Sets up a window, returns false if it can not be mapped */
+static bool setup_img(struct sim_img *img, u32 ba, u32 ty, u32 xy, u32 sz)
+{
+	int x0, x1, y0, y1;
+	u32 lo, hi;
+	u8 *virt;
+
+	img->ty = ty;
+	img->fmt = ty & SIM_TY_FMT_MASK;
+	img->bpp = fmt_bpp(img->fmt);
+	img->pitch = ty & SIM_TY_PITCH_MASK;
+	img->x = sext(xy >> B2R2_XY_X_SHIFT, 16);
+	img->y = sext(xy >> B2R2_XY_Y_SHIFT, 16);
+	img->w = (sz >> B2R2_SZ_WIDTH_SHIFT) & 0xfff;
+	img->h = (sz >> B2R2_SZ_HEIGHT_SHIFT) & 0xfff;
+	img->dx = (ty & B2R2_TY_HSO_RIGHT_TO_LEFT) ? -1 : 1;
+	img->dy = (ty & B2R2_TY_VSO_BOTTOM_TO_TOP) ? -1 : 1;
+
+	if (img->w == 0 || img->h == 0)
+		return true;
+
+	x0 = min(img->x, img->x + img->dx * (img->w - 1));
+	x1 = max(img->x, img->x + img->dx * (img->w - 1));
+	y0 = min(img->y, img->y + img->dy * (img->h - 1));
+	y1 = max(img->y, img->y + img->dy * (img->h - 1));
+	if (x0 < 0 || y0 < 0)
+		return false;
+
+	lo = ba + y0 * img->pitch + x0 * img->bpp;
+	hi = ba + y1 * img->pitch + (x1 + 1) * img->bpp;
+	virt = sim_map(lo, hi - lo);
+	if (virt == NULL)
+		return false;
+	img->base = virt - (y0 * img->pitch + x0 * img->bpp);
+
+	return true;
+}
+
+static inline u8 *img_px(const struct sim_img *img, int i, int j)
+{
+	return img->base + (img->y + img->dy * j) * img->pitch +
+		(img->x + img->dx * i) * img->bpp;
+}
+
+/* Reads logical pixel (i, j) of a window, clamped to the window */
+static void img_read(const struct sim_img *img, int i, int j,
+		struct sim_px *px)
+{
+	i = clamp(i, 0, img->w - 1);
+	j = clamp(j, 0, img->h - 1);
+	decode(read_raw(img_px(img, i, j), img->bpp,
+			img->ty & B2R2_TY_ENDIAN_BIG_NOT_LITTLE),
+		img->fmt, img->ty, px);
+}
+
+static bool setup_filter(struct sim_filter *f, bool resize, bool color,
+		bool alpha, u32 inc, u32 init, u32 coeffs, int taps)
+{
+	f->init = resize ? init : 0;
+	f->inc = resize ? inc : 1 << 10;
+	f->color = color;
+	f->alpha = alpha;
+	f->taps = taps;
+	f->coeffs = NULL;
+	if (color || alpha) {
+		f->coeffs = sim_map(coeffs, 8 * taps);
+		if (f->coeffs == NULL)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Filters along one direction. get() returns the pixel at an offset from
+ * the nearest one. The taps are stored highest offset first with the
+ * nearest pixel at taps / 2, and there are 8 phases per pixel.
+ */
+static void apply_filter(const struct sim_filter *f, u32 pos,
+		void (*get)(void *ctx, int n, struct sim_px *px), void *ctx,
+		struct sim_px *out, u64 *fetched)
+{
+	const s8 *c;
+	s32 sum[4] = { 0, 0, 0, 0 };
+	int center = f->taps / 2;
+	int t, k;
+
+	get(ctx, 0, out);
+	(*fetched)++;
+	if (f->coeffs == NULL)
+		return;
+
+	c = f->coeffs + ((pos >> 7) & 7) * f->taps;
+	for (t = 0; t < f->taps; t++) {
+		struct sim_px px;
+
+		get(ctx, center - t, &px);
+		(*fetched)++;
+		for (k = 0; k < 3; k++)
+			sum[k] += c[t] * (s32)px.c[k];
+		sum[3] += c[t] * (s32)px.a;
+	}
+
+	if (f->color)
+		for (k = 0; k < 3; k++)
+			out->c[k] = clamp_c((sum[k] + 32) >> 6);
+	if (f->alpha)
+		out->a = clamp_t(s32, (sum[3] + 32) >> 6, 0, 128);
+}
+
+struct sim_resize_ctx {
+	const struct sim_img *img;
+	const struct sim_filter *h;
+	int row;
+	int col;
+	u32 hpos;
+	u64 *fetched;
+};
+
+static void get_h(void *data, int n, struct sim_px *px)
+{
+	struct sim_resize_ctx *ctx = data;
+
+	img_read(ctx->img, ctx->col + n, ctx->row, px);
+}
+
+static void get_v(void *data, int n, struct sim_px *px)
+{
+	struct sim_resize_ctx *ctx = data;
+	struct sim_resize_ctx hctx = *ctx;
+
+	hctx.row = ctx->row + n;
+	apply_filter(ctx->h, ctx->hpos, get_h, &hctx, px, ctx->fetched);
+}
+
+/* Source 2 at source oriented target position (u, v) through the resizer */
+static void resize_read(const struct sim_img *img,
+		const struct sim_filter *h, const struct sim_filter *v,
+		int u, int w, struct sim_px *px, u64 *fetched)
+{
+	struct sim_resize_ctx ctx;
+	u32 hpos = h->init + u * h->inc;
+	u32 vpos = v->init + w * v->inc;
+
+	ctx.img = img;
+	ctx.h = h;
+	ctx.col = hpos >> 10;
+	ctx.row = vpos >> 10;
+	ctx.hpos = hpos;
+	ctx.fetched = fetched;
+	apply_filter(v, vpos, get_v, &ctx, px, fetched);
+}
+
+static void load_node(struct b2r2_link_list *s,
+		const struct b2r2_link_list *n)
+{
+	u32 cic = n->GROUP0.B2R2_CIC;
+
+	s->GROUP0 = n->GROUP0;
+	s->GROUP1 = n->GROUP1;
+	if (cic & B2R2_CIC_COLOR_FILL)
+		s->GROUP2 = n->GROUP2;
+	if (cic & B2R2_CIC_SOURCE_1)
+		s->GROUP3 = n->GROUP3;
+	if (cic & B2R2_CIC_SOURCE_2)
+		s->GROUP4 = n->GROUP4;
+	if (cic & B2R2_CIC_SOURCE_3)
+		s->GROUP5 = n->GROUP5;
+	if (cic & B2R2_CIC_CLIP_WINDOW)
+		s->GROUP6 = n->GROUP6;
+	if (cic & B2R2_CIC_CLUT)
+		s->GROUP7 = n->GROUP7;
+	if (cic & B2R2_CIC_FILTER_CONTROL)
+		s->GROUP8 = n->GROUP8;
+	if (cic & B2R2_CIC_RESIZE_CHROMA)
+		s->GROUP9 = n->GROUP9;
+	if (cic & B2R2_CIC_RESIZE_LUMA)
+		s->GROUP10 = n->GROUP10;
+	if (cic & B2R2_CIC_FLICKER_COEFF)
+		s->GROUP11 = n->GROUP11;
+	if (cic & B2R2_CIC_COLOR_KEY)
+		s->GROUP12 = n->GROUP12;
+	if (cic & B2R2_CIC_XYL)
+		s->GROUP13 = n->GROUP13;
+	if (cic & B2R2_CIC_SAU)
+		s->GROUP14 = n->GROUP14;
+	if (cic & B2R2_CIC_IVMX)
+		s->GROUP15 = n->GROUP15;
+	if (cic & B2R2_CIC_OVMX)
+		s->GROUP16 = n->GROUP16;
+}
+
+static bool node_supported(const struct b2r2_link_list *s)
+{
+	u32 ins = s->GROUP0.B2R2_INS;
+	u32 s1 = ins & SIM_INS_SOURCE_1_MASK;
+	u32 s2 = ins & SIM_INS_SOURCE_2_MASK;
+
+	if (ins & SIM_INS_UNSUPPORTED)
+		return false;
+
+	switch (s->GROUP0.B2R2_ACK & SIM_ACK_MODE_MASK) {
+	case 0:
+	case B2R2_ACK_MODE_LOGICAL_OPERATION:
+	case B2R2_ACK_MODE_BLEND_NOT_PREMULT:
+	case B2R2_ACK_MODE_BLEND_PREMULT:
+	case B2R2_ACK_MODE_BYPASS_S2_S3:
+		break;
+	default:
+		return false;
+	}
+
+	if (!fmt_bpp(s->GROUP1.B2R2_TTY & SIM_TY_FMT_MASK))
+		return false;
+	if (s1 && s1 != B2R2_INS_SOURCE_1_DIRECT_FILL &&
+			!fmt_bpp(s->GROUP3.B2R2_STY & SIM_TY_FMT_MASK))
+		return false;
+	if (s2 && !fmt_bpp(s->GROUP4.B2R2_STY & SIM_TY_FMT_MASK))
+		return false;
+
+	return true;
+}
+
+/* Clip window test for target position (x, y) */
+static inline bool clipped(const struct b2r2_link_list *s, int x, int y)
+{
+	u32 cwo = s->GROUP6.B2R2_CWO;
+	u32 cws = s->GROUP6.B2R2_CWS;
+	bool inside;
+
+	if (!(s->GROUP0.B2R2_INS & B2R2_INS_RECT_CLIP_ENABLED))
+		return false;
+
+	inside = x >= (int)((cwo >> B2R2_CWO_X_SHIFT) & 0x7fff) &&
+		x <= (int)((cws >> B2R2_CWS_X_SHIFT) & 0x7fff) &&
+		y >= (int)((cwo >> B2R2_CWO_Y_SHIFT) & 0x7fff) &&
+		y <= (int)((cws >> B2R2_CWS_Y_SHIFT) & 0x7fff);
+
+	return (cwo & SIM_CWO_EXTERIOR) ? inside : !inside;
+}
+
+/**
+ * exec_node() - Executes the node in the register state
+ *
+ * Returns 0 if executed, -ENOSYS if unsupported or -EFAULT if an address
+ * could not be mapped
+ */
+static int exec_node(struct b2r2_sim *sim, struct b2r2_sim_stats *st)
+{
+	const struct b2r2_link_list *s = &sim->state;
+	u32 ins = s->GROUP0.B2R2_INS;
+	u32 ack = s->GROUP0.B2R2_ACK;
+	u32 s1_mode = ins & SIM_INS_SOURCE_1_MASK;
+	u32 s2_mode = ins & SIM_INS_SOURCE_2_MASK;
+	u32 mode = ack & SIM_ACK_MODE_MASK;
+	u32 ga = min_t(u32, (ack >> B2R2_ACK_GALPHA_ROPID_SHIFT) & 0xff, 128);
+	u32 fctl = s->GROUP8.B2R2_FCTL;
+	u32 pmk = (ins & B2R2_INS_PLANE_MASK_ENABLED) ?
+		s->GROUP8.B2R2_PMK : 0xffffffff;
+	bool rotate = ins & B2R2_INS_ROTATION_ENABLED;
+	bool resize = ins & B2R2_INS_RESCALE2D_ENABLED;
+	struct sim_img t, s1, s2;
+	struct sim_filter hf, vf;
+	struct sim_px fill1, fill2;
+	bool tbig, s1big;
+	int i, j;
+
+	if (!node_supported(s))
+		return -ENOSYS;
+
+	if (!setup_img(&t, s->GROUP1.B2R2_TBA, s->GROUP1.B2R2_TTY,
+			s->GROUP1.B2R2_TXY, s->GROUP1.B2R2_TSZ))
+		return -EFAULT;
+	tbig = t.ty & B2R2_TY_ENDIAN_BIG_NOT_LITTLE;
+
+	if (s1_mode == B2R2_INS_SOURCE_1_FETCH_FROM_MEM ||
+			s1_mode == B2R2_INS_SOURCE_1_DIRECT_COPY) {
+		/* Source 1 is read pixel for pixel with the target */
+		if (!setup_img(&s1, s->GROUP3.B2R2_SBA, s->GROUP3.B2R2_STY,
+				s->GROUP3.B2R2_SXY, s->GROUP1.B2R2_TSZ))
+			return -EFAULT;
+	}
+	s1big = s->GROUP3.B2R2_STY & B2R2_TY_ENDIAN_BIG_NOT_LITTLE;
+
+	if (s2_mode == B2R2_INS_SOURCE_2_FETCH_FROM_MEM) {
+		if (!setup_img(&s2, s->GROUP4.B2R2_SBA, s->GROUP4.B2R2_STY,
+				s->GROUP4.B2R2_SXY, s->GROUP4.B2R2_SSZ))
+			return -EFAULT;
+		if (s2.w == 0 || s2.h == 0)
+			return 0;
+		if (!setup_filter(&hf, resize &&
+				(fctl & B2R2_FCTL_HF2D_MODE_ENABLE_RESIZER),
+				resize && (fctl &
+				B2R2_FCTL_HF2D_MODE_ENABLE_COLOR_CHANNEL_FILTER),
+				resize && (fctl &
+				B2R2_FCTL_HF2D_MODE_ENABLE_ALPHA_CHANNEL_FILTER),
+				(s->GROUP9.B2R2_RSF >> B2R2_RSF_HSRC_INC_SHIFT) &
+				0xffff,
+				(s->GROUP9.B2R2_RZI >> B2R2_RZI_HSRC_INIT_SHIFT) &
+				0x3ff, s->GROUP9.B2R2_HFP, 8) ||
+			!setup_filter(&vf, resize &&
+				(fctl & B2R2_FCTL_VF2D_MODE_ENABLE_RESIZER),
+				resize && (fctl &
+				B2R2_FCTL_VF2D_MODE_ENABLE_COLOR_CHANNEL_FILTER),
+				resize && (fctl &
+				B2R2_FCTL_VF2D_MODE_ENABLE_ALPHA_CHANNEL_FILTER),
+				(s->GROUP9.B2R2_RSF >> B2R2_RSF_VSRC_INC_SHIFT) &
+				0xffff,
+				(s->GROUP9.B2R2_RZI >> B2R2_RZI_VSRC_INIT_SHIFT) &
+				0x3ff, s->GROUP9.B2R2_VFP, 5))
+			return -EFAULT;
+	}
+
+	memset(&fill1, 0, sizeof(fill1));
+	memset(&fill2, 0, sizeof(fill2));
+	if (s1_mode == B2R2_INS_SOURCE_1_COLOR_FILL_REGISTER)
+		decode(s->GROUP2.B2R2_S1CF, s->GROUP3.B2R2_STY &
+			SIM_TY_FMT_MASK, s->GROUP3.B2R2_STY, &fill1);
+	if (s2_mode == B2R2_INS_SOURCE_2_COLOR_FILL_REGISTER) {
+		decode(s->GROUP2.B2R2_S2CF, s->GROUP4.B2R2_STY &
+			SIM_TY_FMT_MASK, s->GROUP4.B2R2_STY, &fill2);
+		if (ins & B2R2_INS_IVMX_ENABLED)
+			vmx(&s->GROUP15, &fill2);
+	}
+
+	for (j = 0; j < t.h; j++) {
+		for (i = 0; i < t.w; i++) {
+			int tx = t.x + t.dx * i;
+			int ty = t.y + t.dy * j;
+			u8 *tp = img_px(&t, i, j);
+			struct sim_px p1 = fill1, p2 = fill2, out;
+			const struct sim_px *fg = &p2, *bg = &p1;
+			u32 raw;
+
+			if (clipped(s, tx, ty))
+				continue;
+
+			/* Direct operations bypass the pipeline */
+			if (s1_mode == B2R2_INS_SOURCE_1_DIRECT_FILL) {
+				raw = s->GROUP2.B2R2_S1CF;
+				goto store;
+			} else if (s1_mode == B2R2_INS_SOURCE_1_DIRECT_COPY) {
+				raw = read_raw(img_px(&s1, i, j), s1.bpp,
+					s1big);
+				st->fetched++;
+				goto store;
+			}
+
+			if (s1_mode == B2R2_INS_SOURCE_1_FETCH_FROM_MEM) {
+				img_read(&s1, i, j, &p1);
+				st->fetched++;
+			}
+			if (s2_mode == B2R2_INS_SOURCE_2_FETCH_FROM_MEM) {
+				/* Rotation reads the source column by column */
+				if (rotate)
+					resize_read(&s2, &hf, &vf, j, i, &p2,
+						&st->fetched);
+				else
+					resize_read(&s2, &hf, &vf, i, j, &p2,
+						&st->fetched);
+				if (ins & B2R2_INS_IVMX_ENABLED)
+					vmx(&s->GROUP15, &p2);
+			}
+
+			if (ack & B2R2_ACK_SWAP_FG_BG) {
+				fg = &p1;
+				bg = &p2;
+			}
+
+			switch (mode) {
+			case B2R2_ACK_MODE_BYPASS_S2_S3:
+				out = p2;
+				break;
+			case B2R2_ACK_MODE_BLEND_NOT_PREMULT:
+			case B2R2_ACK_MODE_BLEND_PREMULT:
+				blend(&out, fg, bg, ga,
+					mode == B2R2_ACK_MODE_BLEND_PREMULT);
+				break;
+			case B2R2_ACK_MODE_LOGICAL_OPERATION:
+				unpack(rop((ack >> B2R2_ACK_GALPHA_ROPID_SHIFT) &
+					0xf, pack(fg), pack(bg)), &out);
+				break;
+			default:
+				out = p1;
+				break;
+			}
+
+			if (ins & B2R2_INS_OVMX_ENABLED)
+				vmx(&s->GROUP16, &out);
+			raw = encode(&out, t.fmt, t.ty);
+store:
+			if (pmk != 0xffffffff)
+				raw = (raw & pmk) |
+					(read_raw(tp, t.bpp, tbig) & ~pmk);
+			write_raw(tp, t.bpp, tbig, raw);
+			st->pixels++;
+		}
+	}
+
+	return 0;
+}
+
+/* Executes the node list of a job */
+static void run_job(struct b2r2_sim *sim, const struct sim_job *job)
+{
+	struct b2r2_sim_stats st;
+	unsigned long flags;
+	unsigned long n = 0;
+	u32 addr = job->first;
+	ktime_t start = ktime_get();
+	int bucket;
+
+	memset(&st, 0, sizeof(st));
+
+	while (true) {
+		const struct b2r2_link_list *node =
+			sim_map(addr, sizeof(*node));
+		int ret;
+
+		if (node == NULL) {
+			b2r2_log_warn(sim->dev, "%s: bad node address "
+				"0x%08x\n", __func__, addr);
+			st.faults++;
+			break;
+		}
+
+		load_node(&sim->state, node);
+		ret = exec_node(sim, &st);
+		n++;
+		if (ret == -ENOSYS) {
+			st.unsupported++;
+		} else if (ret < 0) {
+			b2r2_log_warn(sim->dev, "%s: bad buffer or filter "
+				"address in node 0x%08x\n", __func__, addr);
+			st.faults++;
+			break;
+		}
+
+		if (addr == job->last)
+			break;
+		if (n >= SIM_MAX_NODES) {
+			b2r2_log_warn(sim->dev, "%s: last node 0x%08x not "
+				"reached\n", __func__, job->last);
+			st.faults++;
+			break;
+		}
+		addr = node->GROUP0.B2R2_NIP;
+	}
+
+	bucket = min_t(int, fls_long(n ? n - 1 : 0), SIM_HIST_BUCKETS - 1);
+
+	spin_lock_irqsave(&sim->lock, flags);
+	sim->stats.jobs++;
+	if (job->job_id != sim->last_job_id)
+		sim->stats.requests++;
+	sim->last_job_id = job->job_id;
+	sim->stats.nodes += n;
+	sim->stats.max_nodes = max(sim->stats.max_nodes, n);
+	sim->stats.unsupported += st.unsupported;
+	sim->stats.faults += st.faults;
+	sim->stats.pixels += st.pixels;
+	sim->stats.fetched += st.fetched;
+	sim->stats.nsec += ktime_to_ns(ktime_sub(ktime_get(), start));
+	sim->stats.hist[bucket]++;
+	spin_unlock_irqrestore(&sim->lock, flags);
+}
+
+static void sim_work(struct work_struct *work)
+{
+	struct b2r2_sim *sim = container_of(work, struct b2r2_sim, work);
+
+	while (true) {
+		struct sim_job job;
+		unsigned long flags;
+		u32 its;
+		int q;
+
+		/* Lower queue index is higher priority */
+		spin_lock_irqsave(&sim->lock, flags);
+		for (q = 0; q < B2R2_CORE_QUEUE_NO_OF; q++)
+			if (sim->pending[q].valid)
+				break;
+		if (q == B2R2_CORE_QUEUE_NO_OF) {
+			spin_unlock_irqrestore(&sim->lock, flags);
+			return;
+		}
+		job = sim->pending[q];
+		sim->pending[q].valid = false;
+		spin_unlock_irqrestore(&sim->lock, flags);
+
+		run_job(sim, &job);
+
+		its = job.its & readl(&sim->regs->BLT_ITM0);
+		if (its)
+			sim->irq(sim->irq_data, its);
+
+		cond_resched();
+	}
+}
+
+void b2r2_sim_trigger(struct b2r2_sim *sim, struct b2r2_core_job *job)
+{
+	struct sim_job *p = &sim->pending[job->queue];
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	if (p->valid)
+		b2r2_log_warn(sim->dev, "%s: queue %d busy\n", __func__,
+			job->queue);
+	p->valid = true;
+	p->first = job->first_node_address;
+	p->last = job->last_node_address;
+	p->its = job->interrupt_context;
+	p->job_id = job->job_id;
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	queue_work(sim->wq, &sim->work);
+}
+
+struct b2r2_memory_map *b2r2_sim_regs(struct b2r2_sim *sim)
+{
+	return sim->regs;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static ssize_t debugfs_sim_read(struct file *filp, char __user *buf,
+		size_t count, loff_t *f_pos)
+{
+	struct b2r2_sim *sim = filp->f_dentry->d_inode->i_private;
+	struct b2r2_sim_stats s;
+	char tmp[768];
+	size_t len = 0;
+	int i;
+
+	spin_lock_irq(&sim->lock);
+	s = sim->stats;
+	spin_unlock_irq(&sim->lock);
+
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"requests    : %lu\n", s.requests);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"jobs        : %lu\n", s.jobs);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"nodes       : %lu\n", s.nodes);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"max nodes   : %lu\n", s.max_nodes);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"unsupported : %lu\n", s.unsupported);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"faults      : %lu\n", s.faults);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"pixels      : %llu\n", (unsigned long long)s.pixels);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"fetched     : %llu\n", (unsigned long long)s.fetched);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"time (us)   : %llu\n",
+		(unsigned long long)div_u64(s.nsec, 1000));
+	/* Hundredths, to show the fraction of a node or tile */
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"nodes/job   : %lu\n", s.jobs ? s.nodes * 100 / s.jobs : 0);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"jobs/req    : %lu\n",
+		s.requests ? s.jobs * 100 / s.requests : 0);
+	len += scnprintf(tmp + len, sizeof(tmp) - len,
+		"(nodes/job and jobs/req in hundredths)\n"
+		"nodes per job histogram:\n");
+	for (i = 0; i < SIM_HIST_BUCKETS; i++)
+		len += scnprintf(tmp + len, sizeof(tmp) - len,
+			"  %s%4lu : %lu\n",
+			i == SIM_HIST_BUCKETS - 1 ? ">" : "<=",
+			i == SIM_HIST_BUCKETS - 1 ? 1UL << (i - 1) : 1UL << i,
+			s.hist[i]);
+
+	return simple_read_from_buffer(buf, count, f_pos, tmp, len);
+}
+
+/* Any write clears the statistics */
+static ssize_t debugfs_sim_write(struct file *filp, const char __user *buf,
+		size_t count, loff_t *f_pos)
+{
+	struct b2r2_sim *sim = filp->f_dentry->d_inode->i_private;
+
+	spin_lock_irq(&sim->lock);
+	memset(&sim->stats, 0, sizeof(sim->stats));
+	spin_unlock_irq(&sim->lock);
+
+	*f_pos += count;
+	return count;
+}
+
+static const struct file_operations debugfs_sim_fops = {
+	.owner = THIS_MODULE,
+	.read  = debugfs_sim_read,
+	.write = debugfs_sim_write,
+};
+
+void b2r2_sim_debugfs_init(struct b2r2_sim *sim, struct dentry *dir)
+{
+	if (!IS_ERR_OR_NULL(dir))
+		debugfs_create_file("sim", 0664, dir, sim, &debugfs_sim_fops);
+}
+#else
+void b2r2_sim_debugfs_init(struct b2r2_sim *sim, struct dentry *dir)
+{
+}
+#endif
+
+struct b2r2_sim *b2r2_sim_create(struct device *dev,
+		void (*irq)(void *data, u32 its), void *data)
+{
+	struct b2r2_sim *sim;
+
+	sim = kzalloc(sizeof(*sim), GFP_KERNEL);
+	if (sim == NULL)
+		return NULL;
+
+	sim->regs = kzalloc(sizeof(*sim->regs), GFP_KERNEL);
+	if (sim->regs == NULL)
+		goto regs_failed;
+
+	sim->wq = create_singlethread_workqueue("b2r2_sim");
+	if (sim->wq == NULL)
+		goto wq_failed;
+
+	sim->dev = dev;
+	sim->irq = irq;
+	sim->irq_data = data;
+	sim->last_job_id = -1;
+	spin_lock_init(&sim->lock);
+	INIT_WORK(&sim->work, sim_work);
+
+	/* The core is always idle between jobs */
+	sim->regs->BLT_STA1 = 0x1;
+
+	dev_info(dev, "using the software B2R2 core\n");
+
+	return sim;
+
+wq_failed:
+	kfree(sim->regs);
+regs_failed:
+	kfree(sim);
+	return NULL;
+}
+
+void b2r2_sim_destroy(struct b2r2_sim *sim)
+{
+	destroy_workqueue(sim->wq);
+	kfree(sim->regs);
+	kfree(sim);
+}
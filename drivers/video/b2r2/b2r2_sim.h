@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2011
+ *
+ * ST-Ericsson B2R2 software core
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ */
+
+#ifndef _LINUX_DRIVERS_VIDEO_B2R2_SIM_H_
+#define _LINUX_DRIVERS_VIDEO_B2R2_SIM_H_
+
+#include <linux/device.h>
+#include <linux/dcache.h>
+
+#include "b2r2_internal.h"
+#include "b2r2_structures.h"
+
+struct b2r2_sim;
+
+/**
+ * b2r2_sim_create() - Creates a software B2R2 core
+ *
+ * @dev: Device used for logging
+ * @irq: Called from process context with the interrupt status bits when a
+ *       job is done, like the hardware raises its interrupt
+ * @data: Passed to @irq
+ *
+ * Returns the core or NULL if out of memory
+ */
+struct b2r2_sim *b2r2_sim_create(struct device *dev,
+		void (*irq)(void *data, u32 its), void *data);
+
+/**
+ * b2r2_sim_destroy() - Waits for running jobs and frees the core
+ */
+void b2r2_sim_destroy(struct b2r2_sim *sim);
+
+/**
+ * b2r2_sim_regs() - Returns the register file of the core
+ *
+ * The register file is plain memory and is to be used in place of the
+ * mapped B2R2 registers.
+ */
+struct b2r2_memory_map *b2r2_sim_regs(struct b2r2_sim *sim);
+
+/**
+ * b2r2_sim_trigger() - Starts executing the node list of a job
+ *
+ * Called where the hardware would be kicked by the LNA write, with the
+ * core lock held. The job's interrupt is raised when the last node has
+ * been executed, if enabled in BLT_ITM0.
+ *
+ * @sim: The core
+ * @job: The job that has just been written to its queue registers
+ */
+void b2r2_sim_trigger(struct b2r2_sim *sim, struct b2r2_core_job *job);
+
+/**
+ * b2r2_sim_debugfs_init() - Adds the "sim" statistics file to @dir
+ */
+void b2r2_sim_debugfs_init(struct b2r2_sim *sim, struct dentry *dir);
+
+#endif /* _LINUX_DRIVERS_VIDEO_B2R2_SIM_H_ */
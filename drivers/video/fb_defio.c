@@ -160,6 +160,244 @@ static int fb_deferred_io_mmap(struct fb_info *info, struct vm_area_struct *vma)
 	return 0;
 }
 
+static u64 fb_damage_area(const struct fb_damage_rect *r)
+{
+	return (u64)r->width * r->height;
+}
+
+static void fb_damage_union(struct fb_damage_rect *r,
+			    const struct fb_damage_rect *other)
+{
+	u32 x2 = max(r->x + r->width, other->x + other->width);
+	u32 y2 = max(r->y + r->height, other->y + other->height);
+
+	r->x = min(r->x, other->x);
+	r->y = min(r->y, other->y);
+	r->width = x2 - r->x;
+	r->height = y2 - r->y;
+}
+
+/*
+ * Pixels that would be flushed needlessly if a and b were merged. It
+ * is negative or zero when they overlap enough that flushing the
+ * union is cheaper than flushing both.
+ */
+static s64 fb_damage_waste(const struct fb_damage_rect *a,
+			   const struct fb_damage_rect *b)
+{
+	struct fb_damage_rect u = *a;
+
+	fb_damage_union(&u, b);
+	return fb_damage_area(&u) - fb_damage_area(a) - fb_damage_area(b);
+}
+
+/*
+ * Adds r to the damage list. Rectangles that overlap or line up with
+ * r are merged into it, and when the list is full r is merged with the
+ * rectangle that adds the least area. Called with damage_lock held.
+ */
+static void fb_damage_add(struct fb_deferred_io *fbdefio,
+			  struct fb_damage_rect r)
+{
+	struct fb_damage_rect *damage = fbdefio->damage;
+	s64 waste, best_waste = 0;
+	int i, best;
+
+again:
+	best = -1;
+	for (i = 0; i < fbdefio->damage_count; i++) {
+		waste = fb_damage_waste(&damage[i], &r);
+		if (waste <= 0) {
+			fb_damage_union(&r, &damage[i]);
+			damage[i] = damage[--fbdefio->damage_count];
+			goto again;
+		}
+		if (best < 0 || waste < best_waste) {
+			best = i;
+			best_waste = waste;
+		}
+	}
+
+	if (fbdefio->damage_count < FB_DAMAGE_RECTS) {
+		damage[fbdefio->damage_count++] = r;
+		return;
+	}
+
+	fb_damage_union(&r, &damage[best]);
+	damage[best] = damage[--fbdefio->damage_count];
+	goto again;
+}
+
+static void fb_deferred_io_add_damage(struct fb_info *info, u32 x, u32 y,
+				      u32 width, u32 height, bool user)
+{
+	struct fb_deferred_io *fbdefio = info->fbdefio;
+	struct fb_damage_rect r;
+	unsigned long flags;
+
+	if (x >= info->var.xres_virtual || y >= info->var.yres_virtual)
+		return;
+
+	r.x = x;
+	r.y = y;
+	r.width = min(width, info->var.xres_virtual - x);
+	r.height = min(height, info->var.yres_virtual - y);
+	if (!r.width || !r.height)
+		return;
+
+	spin_lock_irqsave(&fbdefio->damage_lock, flags);
+	fb_damage_add(fbdefio, r);
+	if (user)
+		fbdefio->user_damage = true;
+	spin_unlock_irqrestore(&fbdefio->damage_lock, flags);
+}
+
+/* adds the lines covering a byte range of the framebuffer */
+static void fb_deferred_io_add_range(struct fb_info *info,
+				     unsigned long start, unsigned long end)
+{
+	u32 line_length = info->fix.line_length;
+
+	if (!line_length) {
+		fb_deferred_io_add_damage(info, 0, 0, info->var.xres_virtual,
+					  info->var.yres_virtual, false);
+		return;
+	}
+
+	start /= line_length;
+	end = DIV_ROUND_UP(end, line_length);
+	fb_deferred_io_add_damage(info, 0, start, info->var.xres_virtual,
+				  end - start, false);
+}
+
+/**
+ * fb_deferred_io_damage - mark an area of the virtual screen as changed
+ * @info: frame buffer
+ * @x: left edge of the area
+ * @y: top edge of the area
+ * @width: width of the area
+ * @height: height of the area
+ *
+ * For drivers using deferred_io_damage, to be called from the drawing
+ * fb_ops. The area is merged into the damage list and passed on with
+ * the next deferred update. Safe to call from atomic context.
+ */
+void fb_deferred_io_damage(struct fb_info *info, u32 x, u32 y,
+			   u32 width, u32 height)
+{
+	struct fb_deferred_io *fbdefio = info->fbdefio;
+
+	if (!fbdefio || !fbdefio->deferred_io_damage)
+		return;
+
+	fb_deferred_io_add_damage(info, x, y, width, height, false);
+	schedule_delayed_work(&info->deferred_work, fbdefio->delay);
+}
+EXPORT_SYMBOL_GPL(fb_deferred_io_damage);
+
+/**
+ * fb_deferred_io_user_damage - handle FBIO_DAMAGE
+ * @info: frame buffer
+ * @rect: area the application has drawn
+ *
+ * Once an application has reported damage, the touched pages are not
+ * turned into damage for that update; it has to report everything it
+ * draws through the mapping. Called with the fb_info lock held.
+ *
+ * Returns 0 or -ENOTTY if the driver does not take damage, -EINVAL if
+ * the area is not within the virtual screen.
+ */
+int fb_deferred_io_user_damage(struct fb_info *info,
+			       const struct fb_damage_rect *rect)
+{
+	struct fb_deferred_io *fbdefio = info->fbdefio;
+
+	if (!fbdefio || !fbdefio->deferred_io_damage)
+		return -ENOTTY;
+
+	if (rect->x >= info->var.xres_virtual ||
+	    rect->y >= info->var.yres_virtual ||
+	    rect->width > info->var.xres_virtual - rect->x ||
+	    rect->height > info->var.yres_virtual - rect->y)
+		return -EINVAL;
+
+	fb_deferred_io_add_damage(info, rect->x, rect->y, rect->width,
+				  rect->height, true);
+	schedule_delayed_work(&info->deferred_work, fbdefio->delay);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(fb_deferred_io_user_damage);
+
+/**
+ * fb_deferred_io_damage_range - mark a byte range as changed
+ * @info: frame buffer
+ * @offset: offset of the range in the frame buffer memory
+ * @len: length of the range
+ *
+ * Like fb_deferred_io_damage() for drivers that write the memory
+ * linearly, e.g. from fb_write. The lines touched by the range are
+ * marked.
+ */
+void fb_deferred_io_damage_range(struct fb_info *info,
+				 unsigned long offset, size_t len)
+{
+	struct fb_deferred_io *fbdefio = info->fbdefio;
+
+	if (!fbdefio || !fbdefio->deferred_io_damage || !len)
+		return;
+
+	fb_deferred_io_add_range(info, offset, offset + len);
+	schedule_delayed_work(&info->deferred_work, fbdefio->delay);
+}
+EXPORT_SYMBOL_GPL(fb_deferred_io_damage_range);
+
+/* passes the touched pages and the damage list to the driver */
+static void fb_deferred_io_flush_damage(struct fb_info *info)
+{
+	struct fb_deferred_io *fbdefio = info->fbdefio;
+	struct fb_damage_rect rects[FB_DAMAGE_RECTS];
+	unsigned long start = 0, end = 0;
+	unsigned long flags;
+	struct page *cur;
+	bool user_damage;
+	int count;
+
+	spin_lock_irqsave(&fbdefio->damage_lock, flags);
+	user_damage = fbdefio->user_damage;
+	fbdefio->user_damage = false;
+	spin_unlock_irqrestore(&fbdefio->damage_lock, flags);
+
+	/*
+	 * An application reporting its damage knows better what it drew
+	 * through the mapping than the page list, which only gives whole
+	 * lines. Otherwise add runs of touched pages as one band each, the
+	 * page list is sorted.
+	 */
+	list_for_each_entry(cur, &fbdefio->pagelist, lru) {
+		unsigned long offset = cur->index << PAGE_SHIFT;
+
+		if (user_damage)
+			break;
+		if (offset != end) {
+			if (end)
+				fb_deferred_io_add_range(info, start, end);
+			start = offset;
+		}
+		end = offset + PAGE_SIZE;
+	}
+	if (end)
+		fb_deferred_io_add_range(info, start, end);
+
+	spin_lock_irqsave(&fbdefio->damage_lock, flags);
+	count = fbdefio->damage_count;
+	memcpy(rects, fbdefio->damage, count * sizeof(rects[0]));
+	fbdefio->damage_count = 0;
+	spin_unlock_irqrestore(&fbdefio->damage_lock, flags);
+
+	if (count)
+		fbdefio->deferred_io_damage(info, rects, count);
+}
+
 /* workqueue callback */
 static void fb_deferred_io_work(struct work_struct *work)
 {
@@ -177,8 +415,11 @@ static void fb_deferred_io_work(struct work_struct *work)
 		unlock_page(cur);
 	}
 
-	/* driver's callback with pagelist */
-	fbdefio->deferred_io(info, &fbdefio->pagelist);
+	/* driver's callback with damage or pagelist */
+	if (fbdefio->deferred_io_damage)
+		fb_deferred_io_flush_damage(info);
+	else
+		fbdefio->deferred_io(info, &fbdefio->pagelist);
 
 	/* clear the list */
 	list_for_each_safe(node, next, &fbdefio->pagelist) {
@@ -193,6 +434,9 @@ void fb_deferred_io_init(struct fb_info *info)
 
 	BUG_ON(!fbdefio);
 	mutex_init(&fbdefio->lock);
+	spin_lock_init(&fbdefio->damage_lock);
+	fbdefio->damage_count = 0;
+	fbdefio->user_damage = false;
 	info->fbops->fb_mmap = fb_deferred_io_mmap;
 	INIT_DELAYED_WORK(&info->deferred_work, fb_deferred_io_work);
 	INIT_LIST_HEAD(&fbdefio->pagelist);
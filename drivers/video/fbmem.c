@@ -1061,6 +1061,9 @@ static long do_fb_ioctl(struct fb_info *info, unsigned int cmd,
 	struct fb_cmap cmap_from;
 	struct fb_cmap_user cmap;
 	struct fb_event event;
+#ifdef CONFIG_FB_DEFERRED_IO
+	struct fb_damage_rect damage;
+#endif
 	void __user *argp = (void __user *)arg;
 	long ret = 0;
 
@@ -1168,6 +1171,19 @@ static long do_fb_ioctl(struct fb_info *info, unsigned int cmd,
 		console_unlock();
 		unlock_fb_info(info);
 		break;
+#ifdef CONFIG_FB_DEFERRED_IO
+	case FBIO_DAMAGE:
+		if (copy_from_user(&damage, argp, sizeof(damage)))
+			return -EFAULT;
+		if (!lock_fb_info(info))
+			return -ENODEV;
+		if (info->fbdefio)
+			ret = fb_deferred_io_user_damage(info, &damage);
+		else
+			ret = -ENOTTY;
+		unlock_fb_info(info);
+		break;
+#endif
 	default:
 		if (!lock_fb_info(info))
 			return -ENODEV;
@@ -1320,6 +1336,7 @@ static long fb_compat_ioctl(struct file *file, unsigned int cmd,
 	case FBIOPAN_DISPLAY:
 	case FBIOGET_CON2FBMAP:
 	case FBIOPUT_CON2FBMAP:
+	case FBIO_DAMAGE:
 		arg = (unsigned long) compat_ptr(arg);
 	case FBIOBLANK:
 		ret = do_fb_ioctl(info, cmd, arg);
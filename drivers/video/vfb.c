@@ -36,6 +36,28 @@ static void *videomemory;
 static u_long videomemorysize = VIDEOMEMSIZE;
 module_param(videomemorysize, ulong, 0);
 
+    /*
+     *  With deferred I/O the damaged areas are copied to a second buffer,
+     *  the way a driver for a panel with its own frame memory would send
+     *  them, and the bytes flushed per frame are counted.
+     */
+
+static int vfb_defio;
+module_param_named(defio, vfb_defio, bool, 0);
+MODULE_PARM_DESC(defio, "Flush damaged areas to a shadow buffer");
+
+static void *vfb_shadow;
+
+struct vfb_flush_stats {
+	unsigned long frames;
+	unsigned long rects;
+	unsigned long long bytes;
+	unsigned long last;
+	unsigned long max;
+};
+
+static struct vfb_flush_stats vfb_stats;
+
 /**********************************************************************
  *
  * Memory management
@@ -122,17 +144,25 @@ static int vfb_pan_display(struct fb_var_screeninfo *var,
 			   struct fb_info *info);
 static int vfb_mmap(struct fb_info *info,
 		    struct vm_area_struct *vma);
+static ssize_t vfb_write(struct fb_info *info, const char __user *buf,
+			 size_t count, loff_t *ppos);
+static void vfb_fillrect(struct fb_info *info,
+			 const struct fb_fillrect *rect);
+static void vfb_copyarea(struct fb_info *info,
+			 const struct fb_copyarea *area);
+static void vfb_imageblit(struct fb_info *info,
+			  const struct fb_image *image);
 
 static struct fb_ops vfb_ops = {
 	.fb_read        = fb_sys_read,
-	.fb_write       = fb_sys_write,
+	.fb_write       = vfb_write,
 	.fb_check_var	= vfb_check_var,
 	.fb_set_par	= vfb_set_par,
 	.fb_setcolreg	= vfb_setcolreg,
 	.fb_pan_display	= vfb_pan_display,
-	.fb_fillrect	= sys_fillrect,
-	.fb_copyarea	= sys_copyarea,
-	.fb_imageblit	= sys_imageblit,
+	.fb_fillrect	= vfb_fillrect,
+	.fb_copyarea	= vfb_copyarea,
+	.fb_imageblit	= vfb_imageblit,
 	.fb_mmap	= vfb_mmap,
 };
 
@@ -286,6 +316,8 @@ static int vfb_set_par(struct fb_info *info)
 {
 	info->fix.line_length = get_line_length(info->var.xres_virtual,
 						info->var.bits_per_pixel);
+	fb_deferred_io_damage(info, 0, 0, info->var.xres_virtual,
+			      info->var.yres_virtual);
 	return 0;
 }
 
@@ -405,9 +437,126 @@ static int vfb_pan_display(struct fb_var_screeninfo *var,
 		info->var.vmode |= FB_VMODE_YWRAP;
 	else
 		info->var.vmode &= ~FB_VMODE_YWRAP;
+	fb_deferred_io_damage(info, info->var.xoffset, info->var.yoffset,
+			      info->var.xres, info->var.yres);
 	return 0;
 }
 
+    /*
+     *  Drawing, marking what is drawn as damaged for deferred I/O
+     */
+
+static ssize_t vfb_write(struct fb_info *info, const char __user *buf,
+			 size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	ret = fb_sys_write(info, buf, count, ppos);
+	if (ret > 0)
+		fb_deferred_io_damage_range(info, *ppos - ret, ret);
+	return ret;
+}
+
+static void vfb_fillrect(struct fb_info *info, const struct fb_fillrect *rect)
+{
+	sys_fillrect(info, rect);
+	fb_deferred_io_damage(info, rect->dx, rect->dy,
+			      rect->width, rect->height);
+}
+
+static void vfb_copyarea(struct fb_info *info, const struct fb_copyarea *area)
+{
+	sys_copyarea(info, area);
+	fb_deferred_io_damage(info, area->dx, area->dy,
+			      area->width, area->height);
+}
+
+static void vfb_imageblit(struct fb_info *info, const struct fb_image *image)
+{
+	sys_imageblit(info, image);
+	fb_deferred_io_damage(info, image->dx, image->dy,
+			      image->width, image->height);
+}
+
+    /*
+     *  Deferred I/O: copy the damaged rectangles to the shadow buffer
+     */
+
+static void vfb_flush(struct fb_info *info, const struct fb_damage_rect *rects,
+		      int count)
+{
+	u32 bpp = info->var.bits_per_pixel;
+	u32 line_length = info->fix.line_length;
+	unsigned long bytes = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		const struct fb_damage_rect *r = &rects[i];
+		u32 start = (r->x * bpp) / 8;
+		u32 len = DIV_ROUND_UP((r->x + r->width) * bpp, 8) - start;
+		u32 offset = r->y * line_length + start;
+		u32 y;
+
+		for (y = 0; y < r->height; y++) {
+			memcpy(vfb_shadow + offset, videomemory + offset, len);
+			offset += line_length;
+		}
+		bytes += len * r->height;
+	}
+
+	vfb_stats.frames++;
+	vfb_stats.rects += count;
+	vfb_stats.bytes += bytes;
+	vfb_stats.last = bytes;
+	vfb_stats.max = max(vfb_stats.max, bytes);
+
+	dev_dbg(info->device, "frame %lu: %d rectangles, %lu bytes\n",
+		vfb_stats.frames, count, bytes);
+}
+
+static struct fb_deferred_io vfb_defio_info = {
+	.delay			= HZ / 50,
+	.deferred_io_damage	= vfb_flush,
+};
+
+static ssize_t vfb_show_flush_stats(struct device *device,
+				    struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(device);
+	struct vfb_flush_stats stats;
+	unsigned long full;
+
+	mutex_lock(&vfb_defio_info.lock);
+	stats = vfb_stats;
+	mutex_unlock(&vfb_defio_info.lock);
+
+	full = info->fix.line_length * info->var.yres;
+	return snprintf(buf, PAGE_SIZE,
+			"frames: %lu\n"
+			"rectangles: %lu\n"
+			"bytes: %llu\n"
+			"bytes/frame: %llu\n"
+			"last frame: %lu\n"
+			"max frame: %lu\n"
+			"full frame: %lu\n",
+			stats.frames, stats.rects, stats.bytes,
+			stats.frames ? div_u64(stats.bytes, stats.frames) : 0,
+			stats.last, stats.max, full);
+}
+
+static ssize_t vfb_store_flush_stats(struct device *device,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	mutex_lock(&vfb_defio_info.lock);
+	memset(&vfb_stats, 0, sizeof(vfb_stats));
+	mutex_unlock(&vfb_defio_info.lock);
+	return count;
+}
+
+static DEVICE_ATTR(flush_stats, S_IRUGO | S_IWUSR, vfb_show_flush_stats,
+		   vfb_store_flush_stats);
+
     /*
      *  Most drivers don't need their own mmap function 
      */
@@ -520,15 +669,33 @@ static int __devinit vfb_probe(struct platform_device *dev)
 	if (retval < 0)
 		goto err1;
 
+	if (vfb_defio) {
+		retval = -ENOMEM;
+		vfb_shadow = vzalloc(videomemorysize);
+		if (!vfb_shadow)
+			goto err2;
+		info->flags |= FBINFO_VIRTFB;
+		info->fbdefio = &vfb_defio_info;
+		fb_deferred_io_init(info);
+	}
+
 	retval = register_framebuffer(info);
 	if (retval < 0)
-		goto err2;
+		goto err3;
 	platform_set_drvdata(dev, info);
 
+	if (vfb_defio && device_create_file(&dev->dev, &dev_attr_flush_stats))
+		dev_warn(&dev->dev, "could not create flush_stats\n");
+
 	printk(KERN_INFO
 	       "fb%d: Virtual frame buffer device, using %ldK of video memory\n",
 	       info->node, videomemorysize >> 10);
 	return 0;
+err3:
+	if (vfb_defio) {
+		fb_deferred_io_cleanup(info);
+		vfree(vfb_shadow);
+	}
 err2:
 	fb_dealloc_cmap(&info->cmap);
 err1:
@@ -543,7 +710,13 @@ static int vfb_remove(struct platform_device *dev)
 	struct fb_info *info = platform_get_drvdata(dev);
 
 	if (info) {
+		if (vfb_defio)
+			device_remove_file(&dev->dev, &dev_attr_flush_stats);
 		unregister_framebuffer(info);
+		if (vfb_defio) {
+			fb_deferred_io_cleanup(info);
+			vfree(vfb_shadow);
+		}
 		rvfree(videomemory, videomemorysize);
 		fb_dealloc_cmap(&info->cmap);
 		framebuffer_release(info);
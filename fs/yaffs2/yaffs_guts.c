@@ -38,6 +38,7 @@
 /* Note YAFFS_GC_GOOD_ENOUGH must be <= YAFFS_GC_PASSIVE_THRESHOLD */
 #define YAFFS_GC_GOOD_ENOUGH 2
 #define YAFFS_GC_PASSIVE_THRESHOLD 4
+#define YAFFS_GC_MAX_AGE 1024
 
 #include "yaffs_ecc.h"
 
@@ -2388,6 +2389,7 @@ void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
 	if (block_no == dev->gc_dirtiest) {
 		dev->gc_dirtiest = 0;
 		dev->gc_pages_in_use = 0;
+		dev->gc_dirtiest_score = 0;
 	}
 
 	if (!bi->needs_retiring) {
@@ -2715,6 +2717,31 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 	return ret_val;
 }
 
+/*
+ * yaffs_gc_block_score() rates a gc candidate for background gc using the
+ * classic cost-benefit measure: reclaimable chunks weighted by block age,
+ * divided by the cost of copying the live chunks off.
+ * Old, cold blocks are preferred over recently written ones with the same
+ * amount of garbage since the data left in them is less likely to die soon,
+ * which keeps write amplification down. Age is measured in block sequence
+ * numbers (yaffs2 only) and capped so that very old blocks don't swamp the
+ * dirtiness term.
+ */
+static unsigned yaffs_gc_block_score(struct yaffs_dev *dev,
+				     struct yaffs_block_info *bi,
+				     int pages_used)
+{
+	unsigned age = 0;
+	unsigned reclaimable = dev->param.chunks_per_block - pages_used;
+
+	if (dev->param.is_yaffs2 && dev->seq_number > bi->seq_number)
+		age = dev->seq_number - bi->seq_number;
+	if (age > YAFFS_GC_MAX_AGE)
+		age = YAFFS_GC_MAX_AGE;
+
+	return (reclaimable * (age + 1) * 16) / (pages_used + 1);
+}
+
 /*
  * FindBlockForgarbageCollection is used to select the dirtiest block (or close enough)
  * for garbage collection.
@@ -2771,6 +2798,7 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 
 	if (!selected) {
 		int pages_used;
+		unsigned score;
 		int n_blocks =
 		    dev->internal_end_block - dev->internal_start_block + 1;
 		if (aggressive) {
@@ -2812,13 +2840,29 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 
 			pages_used = bi->pages_in_use - bi->soft_del_pages;
 
-			if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
-			    pages_used < dev->param.chunks_per_block &&
-			    (dev->gc_dirtiest < 1
-			     || pages_used < dev->gc_pages_in_use)
-			    && yaffs_block_ok_for_gc(dev, bi)) {
+			if (bi->block_state != YAFFS_BLOCK_STATE_FULL ||
+			    pages_used >= dev->param.chunks_per_block ||
+			    !yaffs_block_ok_for_gc(dev, bi))
+				continue;
+
+			if (background && !aggressive) {
+				/* Leisurely: the best cost-benefit among the
+				 * blocks dirty enough to be taken at all. */
+				if (pages_used > threshold)
+					continue;
+				score = yaffs_gc_block_score(dev, bi,
+							     pages_used);
+				if (dev->gc_dirtiest < 1 ||
+				    score > dev->gc_dirtiest_score) {
+					dev->gc_dirtiest = dev->gc_block_finder;
+					dev->gc_pages_in_use = pages_used;
+					dev->gc_dirtiest_score = score;
+				}
+			} else if (dev->gc_dirtiest < 1 ||
+				   pages_used < dev->gc_pages_in_use) {
 				dev->gc_dirtiest = dev->gc_block_finder;
 				dev->gc_pages_in_use = pages_used;
+				dev->gc_dirtiest_score = 0;
 			}
 		}
 
@@ -2859,6 +2903,7 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 
 		dev->gc_dirtiest = 0;
 		dev->gc_pages_in_use = 0;
+		dev->gc_dirtiest_score = 0;
 		dev->gc_not_done = 0;
 		if (dev->refresh_skip > 0)
 			dev->refresh_skip--;
@@ -2891,6 +2936,9 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 	int min_erased;
 	int erased_chunks;
 	int checkpt_block_adjust;
+	u32 copies_before;
+	unsigned long start_jiffies;
+	int collected = 0;
 
 	if (dev->param.gc_control && (dev->param.gc_control(dev) & 1) == 0)
 		return YAFFS_OK;
@@ -2900,6 +2948,9 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 		return YAFFS_OK;
 	}
 
+	copies_before = dev->n_gc_copies;
+	start_jiffies = Y_CURRENT_JIFFIES;
+
 	/* This loop should pass the first time.
 	 * We'll only see looping here if the collection does not increase space.
 	 */
@@ -2959,6 +3010,7 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 				dev->n_erased_blocks, aggressive);
 
 			gc_ok = yaffs_gc_block(dev, dev->gc_block, aggressive);
+			collected = 1;
 		}
 
 		if (dev->n_erased_blocks < (dev->param.n_reserved_blocks)
@@ -2971,6 +3023,17 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 	} while ((dev->n_erased_blocks < dev->param.n_reserved_blocks) &&
 		 (dev->gc_block > 0) && (max_tries < 2));
 
+	/* Account the work so write amplification and stalls can be seen */
+	if (background) {
+		dev->n_bg_gc_copies += dev->n_gc_copies - copies_before;
+	} else if (collected) {
+		/* Blocks with nothing left to copy still stall on the erase */
+		dev->fg_gcs++;
+		dev->n_fg_gc_copies += dev->n_gc_copies - copies_before;
+		dev->fg_gc_stall_ms +=
+		    Y_JIFFIES_TO_MS(Y_CURRENT_JIFFIES - start_jiffies);
+	}
+
 	return aggressive ? gc_ok : YAFFS_OK;
 }
 
@@ -4764,6 +4827,7 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	int init_failed = 0;
 	unsigned x;
 	int bits;
+	unsigned long start_jiffies = Y_CURRENT_JIFFIES;
 
 	yaffs_trace(YAFFS_TRACE_TRACING, "yaffs: yaffs_guts_initialise()" );
 
@@ -4916,6 +4980,11 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	dev->passive_gc_count = 0;
 	dev->oldest_dirty_gc_count = 0;
 	dev->bg_gcs = 0;
+	dev->fg_gcs = 0;
+	dev->n_fg_gc_copies = 0;
+	dev->n_bg_gc_copies = 0;
+	dev->fg_gc_stall_ms = 0;
+	dev->gc_dirtiest_score = 0;
 	dev->gc_block_finder = 0;
 	dev->buffered_block = -1;
 	dev->doing_buffered_block_rewrite = 0;
@@ -4991,10 +5060,20 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!init_failed && !yaffs_create_initial_dir(dev))
 		init_failed = 1;
 
+	dev->mount_checkpt_ms = 0;
+	dev->mount_query_ms = 0;
+	dev->mount_scan_ms = 0;
+	dev->mount_scan_threads = 0;
+
 	if (!init_failed) {
 		/* Now scan the flash. */
 		if (dev->param.is_yaffs2) {
-			if (yaffs2_checkpt_restore(dev)) {
+			unsigned long checkpt_jiffies = Y_CURRENT_JIFFIES;
+			int restored = yaffs2_checkpt_restore(dev);
+
+			dev->mount_checkpt_ms =
+			    Y_JIFFIES_TO_MS(Y_CURRENT_JIFFIES - checkpt_jiffies);
+			if (restored) {
 				yaffs_check_obj_details_loaded(dev->root_dir);
 				yaffs_trace(YAFFS_TRACE_CHECKPOINT | YAFFS_TRACE_MOUNT,
 					"yaffs: restored from checkpoint"
@@ -5063,6 +5142,8 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!dev->is_checkpointed && dev->blocks_in_checkpt > 0)
 		yaffs2_checkpt_invalidate(dev);
 
+	dev->mount_total_ms = Y_JIFFIES_TO_MS(Y_CURRENT_JIFFIES - start_jiffies);
+
 	yaffs_trace(YAFFS_TRACE_TRACING,
 	  "yaffs: yaffs_guts_initialise() done.");
 	return YAFFS_OK;
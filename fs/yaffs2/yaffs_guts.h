@@ -524,6 +524,8 @@ struct yaffs_param {
 
 	int enable_xattr;	/* Enable xattribs */
 
+	int scan_threads;	/* Tag prefetch threads for yaffs2 scan, 0 = none */
+
 	/* NAND access functions (Must be set before calling YAFFS) */
 
 	int (*write_chunk_fn) (struct yaffs_dev * dev,
@@ -547,6 +549,12 @@ struct yaffs_param {
 	int (*query_block_fn) (struct yaffs_dev * dev, int block_no,
 			       enum yaffs_block_state * state,
 			       u32 * seq_number);
+	/* Optional tags-only read that is safe to call from several
+	 * threads at once. Must not touch dev statistics or shared buffers.
+	 * Used by the yaffs2 mount scan to prefetch tags in parallel.
+	 */
+	int (*read_tags_mt_fn) (struct yaffs_dev * dev, int nand_chunk,
+				struct yaffs_ext_tags * tags);
 #endif
 
 	/* The remove_obj_fn function must be supplied by OS flavours that
@@ -667,6 +675,7 @@ struct yaffs_dev {
 	unsigned gc_block_finder;
 	unsigned gc_dirtiest;
 	unsigned gc_pages_in_use;
+	unsigned gc_dirtiest_score;	/* Cost-benefit score of gc_dirtiest (background only) */
 	unsigned gc_not_done;
 	unsigned gc_block;
 	unsigned gc_chunk;
@@ -724,6 +733,10 @@ struct yaffs_dev {
 	u32 oldest_dirty_gc_count;
 	u32 n_gc_blocks;
 	u32 bg_gcs;
+	u32 fg_gcs;		/* gc passes run inline from the write path */
+	u32 n_fg_gc_copies;	/* chunks copied by inline gc */
+	u32 n_bg_gc_copies;	/* chunks copied by background gc */
+	u32 fg_gc_stall_ms;	/* time writers spent stalled in inline gc */
 	u32 n_retired_writes;
 	u32 n_retired_blocks;
 	u32 n_ecc_fixed;
@@ -735,6 +748,13 @@ struct yaffs_dev {
 	u32 refresh_count;
 	u32 cache_hits;
 
+	/* Mount time breakdown, in milliseconds */
+	u32 mount_checkpt_ms;	/* checkpoint restore attempt */
+	u32 mount_query_ms;	/* block state query and sort */
+	u32 mount_scan_ms;	/* tag scan and object table build */
+	u32 mount_total_ms;
+	u32 mount_scan_threads;	/* tag prefetch threads actually used */
+
 };
 
 /* The CheckpointDevice structure holds the device information that changes at runtime and
@@ -97,6 +97,8 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_bg_gc_soft_blocks = 8;
+int yaffs_scan_threads = -1;	/* -1: one per online cpu */
 
 /* Module Parameters */
 module_param(yaffs_trace_mask, uint, 0644);
@@ -104,6 +106,8 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_bg_gc_soft_blocks, uint, 0644);
+module_param(yaffs_scan_threads, int, 0644);
 
 
 #define yaffs_inode_to_obj_lv(iptr) ((iptr)->i_private)
@@ -1560,6 +1564,10 @@ static unsigned yaffs_bg_gc_urgency(struct yaffs_dev *dev)
 		return 0;
 	else if (scattered < (dev->param.chunks_per_block * 2))
 		return 0;
+	else if (dev->n_erased_blocks <
+		 dev->param.n_reserved_blocks + yaffs_bg_gc_soft_blocks)
+		/* Close to forcing writers into inline gc: get ahead of them */
+		return 2;
 	else if (erased_chunks > dev->n_free_chunks / 2)
 		return 0;
 	else if (erased_chunks > dev->n_free_chunks / 4)
@@ -2262,6 +2270,11 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 		param->read_chunk_tags_fn = nandmtd2_read_chunk_tags;
 		param->bad_block_fn = nandmtd2_mark_block_bad;
 		param->query_block_fn = nandmtd2_query_block;
+		if (!param->inband_tags) {
+			param->read_tags_mt_fn = nandmtd2_read_tags_mt;
+			param->scan_threads = (yaffs_scan_threads < 0) ?
+			    num_online_cpus() : yaffs_scan_threads;
+		}
 		yaffs_dev_to_lc(dev)->spare_buffer = 
 		                kmalloc(mtd->oobsize, GFP_NOFS);
 		param->is_yaffs2 = 1;
@@ -2446,6 +2459,16 @@ static char *yaffs_dump_dev_part0(char *buf, struct yaffs_dev *dev)
 	return buf;
 }
 
+/* Flash page writes per host page write, in percent (100 == no gc copies) */
+static unsigned yaffs_write_amp_pct(struct yaffs_dev *dev)
+{
+	u32 host_writes = dev->n_page_writes - dev->n_gc_copies;
+
+	if (!host_writes)
+		return 100;
+	return (u32)div_u64((u64)dev->n_page_writes * 100, host_writes);
+}
+
 static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 {
 	buf +=
@@ -2474,6 +2497,16 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 		    dev->oldest_dirty_gc_count);
 	buf += sprintf(buf, "n_gc_blocks........... %u\n", dev->n_gc_blocks);
 	buf += sprintf(buf, "bg_gcs................ %u\n", dev->bg_gcs);
+	buf += sprintf(buf, "fg_gcs................ %u\n", dev->fg_gcs);
+	buf +=
+	    sprintf(buf, "n_fg_gc_copies........ %u\n", dev->n_fg_gc_copies);
+	buf +=
+	    sprintf(buf, "n_bg_gc_copies........ %u\n", dev->n_bg_gc_copies);
+	buf +=
+	    sprintf(buf, "fg_gc_stall_ms........ %u\n", dev->fg_gc_stall_ms);
+	buf +=
+	    sprintf(buf, "write_amp_pct......... %u\n",
+		    yaffs_write_amp_pct(dev));
 	buf +=
 	    sprintf(buf, "n_retired_writes...... %u\n", dev->n_retired_writes);
 	buf +=
@@ -2492,6 +2525,15 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "n_unlinked_files...... %u\n", dev->n_unlinked_files);
 	buf += sprintf(buf, "refresh_count......... %u\n", dev->refresh_count);
 	buf += sprintf(buf, "n_bg_deletions........ %u\n", dev->n_bg_deletions);
+	buf += sprintf(buf, "\n");
+	buf +=
+	    sprintf(buf, "mount_checkpt_ms...... %u\n", dev->mount_checkpt_ms);
+	buf += sprintf(buf, "mount_query_ms........ %u\n", dev->mount_query_ms);
+	buf += sprintf(buf, "mount_scan_ms......... %u\n", dev->mount_scan_ms);
+	buf += sprintf(buf, "mount_total_ms........ %u\n", dev->mount_total_ms);
+	buf +=
+	    sprintf(buf, "mount_scan_threads.... %u\n",
+		    dev->mount_scan_threads);
 
 	return buf;
 }
@@ -30,6 +30,9 @@
 #include <linux/stat.h>
 #include <linux/sort.h>
 #include <linux/bitops.h>
+#include <linux/kthread.h>
+#include <linux/wait.h>
+#include <linux/completion.h>
 
 #define YCHAR char
 #define YUCHAR unsigned char
@@ -45,6 +48,9 @@
 #define Y_CURRENT_TIME CURRENT_TIME.tv_sec
 #define Y_TIME_CONVERT(x) (x).tv_sec
 
+#define Y_CURRENT_JIFFIES jiffies
+#define Y_JIFFIES_TO_MS(x) jiffies_to_msecs(x)
+
 #define compile_time_assertion(assertion) \
 	({ int x = __builtin_choose_expr(assertion, 0, (void)0); (void) x; })
 
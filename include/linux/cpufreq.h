@@ -372,6 +372,38 @@ extern struct cpufreq_governor cpufreq_gov_smartass2;
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_SAKURACTIVE)
 extern struct cpufreq_governor cpufreq_gov_sakuractive;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sakuractive)
+#elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED)
+extern struct cpufreq_governor cpufreq_gov_sched;
+#define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sched)
+#endif
+
+
+/*********************************************************************
+ *                  SCHEDULER-DRIVEN FREQUENCY SELECTION             *
+ *********************************************************************/
+
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+enum cpufreq_sched_event {
+	CPUFREQ_SCHED_ENQUEUE,
+	CPUFREQ_SCHED_DEQUEUE,
+	CPUFREQ_SCHED_TICK,
+	CPUFREQ_SCHED_IDLE,	/* dequeue that left no fair task queued */
+	CPUFREQ_SCHED_TIMER,	/* a drop waited for down_delay */
+};
+
+/*
+ * Time constant of the busy average the fair scheduling class keeps. A
+ * CPU reported as idle keeps decaying by it until it reports again.
+ */
+#define CPUFREQ_SCHED_BUSY_TAU_NS	(8 * NSEC_PER_MSEC)
+
+/*
+ * Called by the fair scheduling class, with the runqueue lock of @cpu
+ * held, whenever the utilisation of @cpu changes. @util is scaled to
+ * SCHED_LOAD_SCALE.
+ */
+void cpufreq_sched_update(int cpu, unsigned long util,
+			  enum cpufreq_sched_event event);
 #endif
 
 
@@ -39,6 +39,7 @@
 #define FBIOPUT_MODEINFO        0x4617
 #define FBIOGET_DISPINFO        0x4618
 #define FBIO_WAITFORVSYNC	_IOW('F', 0x20, __u32)
+#define FBIO_DAMAGE		_IOW('F', 0x21, struct fb_damage_rect)
 
 #define FB_TYPE_PACKED_PIXELS		0	/* Packed Pixels	*/
 #define FB_TYPE_PLANES			1	/* Non interleaved planes */
@@ -332,6 +333,14 @@ struct fb_vblank {
 	__u32 reserved[4];		/* reserved for future compatibility */
 };
 
+/* Area of the virtual screen written by the application, see FBIO_DAMAGE */
+struct fb_damage_rect {
+	__u32 x;
+	__u32 y;
+	__u32 width;
+	__u32 height;
+};
+
 /* Internal HW accel */
 #define ROP_COPY 0
 #define ROP_XOR  1
@@ -596,6 +605,8 @@ struct fb_pixmap {
 };
 
 #ifdef CONFIG_FB_DEFERRED_IO
+#define FB_DAMAGE_RECTS	8	/* rectangles kept before merging */
+
 struct fb_deferred_io {
 	/* delay between mkwrite and deferred handler */
 	unsigned long delay;
@@ -603,6 +614,17 @@ struct fb_deferred_io {
 	struct list_head pagelist; /* list of touched pages */
 	/* callback */
 	void (*deferred_io)(struct fb_info *info, struct list_head *pagelist);
+	/*
+	 * callback with the damaged rectangles, used instead of deferred_io
+	 * if set. Touched pages are passed as full width bands.
+	 */
+	void (*deferred_io_damage)(struct fb_info *info,
+				   const struct fb_damage_rect *rects,
+				   int count);
+	spinlock_t damage_lock; /* protects the damage list */
+	int damage_count;
+	struct fb_damage_rect damage[FB_DAMAGE_RECTS];
+	bool user_damage; /* damage reported with FBIO_DAMAGE */
 };
 #endif
 
@@ -1045,6 +1067,12 @@ extern void fb_deferred_io_open(struct fb_info *info,
 				struct file *file);
 extern void fb_deferred_io_cleanup(struct fb_info *info);
 extern int fb_deferred_io_fsync(struct file *file, int datasync);
+extern void fb_deferred_io_damage(struct fb_info *info, u32 x, u32 y,
+				  u32 width, u32 height);
+extern void fb_deferred_io_damage_range(struct fb_info *info,
+					unsigned long offset, size_t len);
+extern int fb_deferred_io_user_damage(struct fb_info *info,
+				      const struct fb_damage_rect *rect);
 
 static inline bool fb_be_math(struct fb_info *info)
 {
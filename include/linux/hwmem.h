@@ -115,6 +115,21 @@ enum hwmem_mem_type {
 
 /* User space API */
 
+/**
+ * @brief Values defining memory domain.
+ */
+enum hwmem_domain {
+	/**
+	 * @brief This value specifies the neutral memory domain. Setting this
+	 * domain will syncronize all supported memory domains.
+	 */
+	HWMEM_DOMAIN_SYNC = 0,
+	/**
+	 * @brief This value specifies the CPU memory domain.
+	 */
+	HWMEM_DOMAIN_CPU,
+};
+
 /**
  * @see struct hwmem_region.
  */
@@ -173,6 +188,73 @@ struct hwmem_set_domain_request {
 	struct hwmem_region_us region;
 };
 
+/**
+ * @brief One entry of a batched set domain request.
+ */
+struct hwmem_set_domains_entry {
+	/**
+	 * @brief [in] Identifier of buffer to be prepared. If 0 is specified
+	 * the buffer associated with the current file instance will be used.
+	 */
+	__s32 id;
+	/**
+	 * @brief [in] Flags specifying access mode of the operation.
+	 *
+	 * For details, @see struct hwmem_set_domain_request.
+	 */
+	__u32 access; /* enum hwmem_access */
+	/**
+	 * @brief [in] Domain to switch the buffer to.
+	 */
+	__u32 domain; /* enum hwmem_domain */
+	/**
+	 * @brief [in] The region of bytes to be prepared.
+	 */
+	struct hwmem_region_us region;
+};
+
+/**
+ * @brief Maximum number of entries in a batched set domain request.
+ */
+#define HWMEM_MAX_SET_DOMAINS 64
+
+/**
+ * @brief Batched set domain request data.
+ */
+struct hwmem_set_domains_request {
+	/**
+	 * @brief [in] Number of entries, at most HWMEM_MAX_SET_DOMAINS.
+	 */
+	__u32 count;
+	/**
+	 * @brief [in] Array of <count> entries.
+	 */
+	struct hwmem_set_domains_entry *entries;
+};
+
+/**
+ * @brief Cache maintenance statistics.
+ */
+struct hwmem_cache_stats {
+	/**
+	 * @brief [out] Bytes cleaned by range operations.
+	 */
+	__u64 cleaned_bytes;
+	/**
+	 * @brief [out] Bytes invalidated (flushed) by range operations.
+	 */
+	__u64 invalidated_bytes;
+	/**
+	 * @brief [out] Complete cache flushes done instead of range
+	 * operations.
+	 */
+	__u32 full_flushes;
+	/**
+	 * @brief [out] Number of buffer domain switches.
+	 */
+	__u32 domain_switches;
+};
+
 /**
  * @brief Pin request data.
  */
@@ -368,24 +450,32 @@ struct hwmem_get_info_request {
  */
 #define HWMEM_IMPORT_FD_IOC _IO('W', 12)
 
-#ifdef __KERNEL__
-
-/* Kernel API */
+/**
+ * @brief Prepares several buffers for CPU or hardware access at once.
+ *
+ * Cheaper than one set domain call per buffer: when the cache maintenance
+ * of all the buffers adds up to more than a complete cache flush costs,
+ * the cache is flushed once instead.
+ *
+ * Input is a pointer to a hwmem_set_domains_request struct.
+ *
+ * @return Zero on success, or a negative error code. Nothing is done if
+ * any of the buffers can not be resolved.
+ */
+#define HWMEM_SET_DOMAINS_IOC _IOW('W', 13, struct hwmem_set_domains_request)
 
 /**
- * @brief Values defining memory domain.
+ * @brief Get the cache maintenance done on behalf of this file instance.
+ *
+ * Input is a pointer to a hwmem_cache_stats struct.
+ *
+ * @return Zero on success, or a negative error code.
  */
-enum hwmem_domain {
-	/**
-	 * @brief This value specifies the neutral memory domain. Setting this
-	 * domain will syncronize all supported memory domains.
-	 */
-	HWMEM_DOMAIN_SYNC = 0,
-	/**
-	 * @brief This value specifies the CPU memory domain.
-	 */
-	HWMEM_DOMAIN_CPU,
-};
+#define HWMEM_GET_CACHE_STATS_IOC _IOR('W', 14, struct hwmem_cache_stats)
+
+#ifdef __KERNEL__
+
+/* Kernel API */
 
 struct hwmem_alloc;
 
@@ -475,6 +565,30 @@ void hwmem_release(struct hwmem_alloc *alloc);
 int hwmem_set_domain(struct hwmem_alloc *alloc, enum hwmem_access access,
 		enum hwmem_domain domain, struct hwmem_region *region);
 
+/**
+ * @brief One buffer's part of a batched domain switch.
+ */
+struct hwmem_domain_switch {
+	struct hwmem_alloc *alloc;
+	enum hwmem_access access;
+	enum hwmem_domain domain;
+	/* NULL means the whole buffer */
+	struct hwmem_region *region;
+};
+
+/**
+ * @brief Set the domain of several buffers and prepare them for access.
+ *
+ * @param switches Array of buffers, access modes, domains and regions.
+ * @param count Number of entries in <switches>, at most
+ * HWMEM_MAX_SET_DOMAINS.
+ * @param stats Cache maintenance done is added here. Can be NULL.
+ *
+ * @return Zero on success, or a negative error code.
+ */
+int hwmem_set_domains(struct hwmem_domain_switch *switches, size_t count,
+					struct hwmem_cache_stats *stats);
+
 /**
  * @brief Pins the buffer.
  *
@@ -218,13 +218,16 @@ extern void suspend_device_irqs(void);
 extern void resume_device_irqs(void);
 #ifdef CONFIG_PM_SLEEP
 extern int check_wakeup_irqs(void);
+extern int pm_wakeup_irq(void);
 #else
 static inline int check_wakeup_irqs(void) { return 0; }
+static inline int pm_wakeup_irq(void) { return -1; }
 #endif
 #else
 static inline void suspend_device_irqs(void) { };
 static inline void resume_device_irqs(void) { };
 static inline int check_wakeup_irqs(void) { return 0; }
+static inline int pm_wakeup_irq(void) { return -1; }
 #endif
 
 #if defined(CONFIG_SMP) && defined(CONFIG_GENERIC_HARDIRQS)
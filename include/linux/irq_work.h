@@ -17,4 +17,10 @@ bool irq_work_queue(struct irq_work *entry);
 void irq_work_run(void);
 void irq_work_sync(struct irq_work *entry);
 
+#ifdef CONFIG_IRQ_WORK
+bool irq_work_needs_cpu(void);
+#else
+static inline bool irq_work_needs_cpu(void) { return false; }
+#endif
+
 #endif /* _LINUX_IRQ_WORK_H */
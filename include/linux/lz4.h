@@ -0,0 +1,37 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ *  LZ4 Kernel Interface
+ *
+ *  LZ4 is a byte oriented LZ77 compressor: no entropy coding, a single
+ *  hash table probe per position, and a block format that decompresses
+ *  with little more than memcpy().
+ *
+ *  The block format is the one of the reference implementation,
+ *  http://code.google.com/p/lz4/, so data compressed here decompresses
+ *  with the lz4 tools and vice versa.
+ */
+
+#define LZ4_MEM_COMPRESS	(4096 * sizeof(unsigned int))
+
+/* the most lz4_compress() can expand incompressible data to */
+#define lz4_compressbound(isize)	((isize) + ((isize) / 255) + 16)
+
+/*
+ * This requires 'wrkmem' of size LZ4_MEM_COMPRESS.  *dst_len is the size
+ * of dst on entry, the size of the compressed data on return.  Returns 0,
+ * or -1 if dst is too small.
+ */
+int lz4_compress(const unsigned char *src, size_t src_len,
+		 unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * Safe decompression: never reads past src + src_len nor writes past
+ * dst + *dst_len, whatever src contains.  *dst_len is the size of dst on
+ * entry, the size of the decompressed data on return.  Returns 0, or -1
+ * if src is corrupt or dst is too small.
+ */
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len);
+
+#endif
@@ -198,6 +198,10 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	/* last swap fault, readahead window and hits, see swap_state.c */
+	atomic_long_t swap_readahead_info;
+#endif
 };
 
 struct core_thread {
@@ -330,6 +334,12 @@ struct mm_struct {
 #ifdef CONFIG_CPUMASK_OFFSTACK
 	struct cpumask cpumask_allocation;
 #endif
+#ifdef CONFIG_KSM
+	/* under ksm_thread_mutex, shown in /proc/<pid>/ksm_stat */
+	unsigned long ksm_rmap_items;	/* pages tracked by ksmd */
+	unsigned long ksm_merging_pages; /* pages mapping a ksm page */
+	unsigned long ksm_zero_merged;	/* pages replaced by the zero page */
+#endif
 };
 
 static inline void mm_init_cpumask(struct mm_struct *mm)
@@ -1179,6 +1179,16 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+	/* running share of wall time, for cpufreq (SCHED_LOAD_SCALE based) */
+	unsigned long		util_avg;
+	unsigned long		util_contrib;	/* added to rq while queued */
+	u64			util_woken;
+	u64			util_dequeued;
+	u64			util_sleep;
+	u64			util_exec_start;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
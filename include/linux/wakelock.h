@@ -18,6 +18,8 @@
 
 #include <linux/list.h>
 #include <linux/ktime.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
  * states when active. If the type is set to WAKE_LOCK_SUSPEND, the wake_lock
@@ -26,6 +28,9 @@
  * interrupts will not entered from idle until the wake_locks are released.
  */
 
+/* Hold time histogram buckets: <1ms, then powers of 4 ms up to >=64s */
+#define WAKE_LOCK_HIST_BUCKETS 10
+
 enum {
 	WAKE_LOCK_SUSPEND, /* Prevent suspend */
 	WAKE_LOCK_IDLE,    /* Prevent low power idle */
@@ -35,6 +40,8 @@ enum {
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
+	spinlock_t          lock;
+	struct rb_node      node;
 	int                 flags;
 	const char         *name;
 	unsigned long       expires;
@@ -47,6 +54,12 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		ktime_t         sleep_wait_start;
+		int             prevent_suspend_count;
+		int             suspend_abort_count;
+		int             short_wakeup_count;
+		int             last_wakeup_irq;
+		unsigned int    hold_hist[WAKE_LOCK_HIST_BUCKETS];
 	} stat;
 #endif
 #endif
@@ -61,8 +74,7 @@ void wake_lock_timeout(struct wake_lock *lock, long timeout);
 void wake_unlock(struct wake_lock *lock);
 
 /* wake_lock_active returns a non-zero value if the wake_lock is currently
- * locked. If the wake_lock has a timeout, it does not check the timeout
- * but if the timeout had aready been checked it will return 0.
+ * locked. A wake_lock whose timeout has passed is not active.
  */
 int wake_lock_active(struct wake_lock *lock);
 
@@ -0,0 +1,81 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_sched
+
+#if !defined(_TRACE_CPUFREQ_SCHED_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_SCHED_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(sched_decision,
+	    TP_PROTO(unsigned long cpu_id, unsigned long util,
+		     unsigned long curfreq, unsigned long targfreq,
+		     unsigned long reason),
+	    TP_ARGS(cpu_id, util, curfreq, targfreq, reason),
+
+	    TP_STRUCT__entry(
+		    __field(unsigned long, cpu_id    )
+		    __field(unsigned long, util      )
+		    __field(unsigned long, curfreq   )
+		    __field(unsigned long, targfreq  )
+		    __field(unsigned long, reason    )
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->util = util;
+		    __entry->curfreq = curfreq;
+		    __entry->targfreq = targfreq;
+		    __entry->reason = reason;
+	    ),
+
+	    TP_printk("cpu=%lu util=%lu cur=%lu targ=%lu reason=%s",
+		      __entry->cpu_id, __entry->util, __entry->curfreq,
+		      __entry->targfreq,
+		      __print_symbolic(__entry->reason,
+				       { 0, "enqueue" },
+				       { 1, "dequeue" },
+				       { 2, "tick" },
+				       { 3, "idle" },
+				       { 4, "timer" }))
+);
+
+DEFINE_EVENT(sched_decision, cpufreq_sched_target,
+	    TP_PROTO(unsigned long cpu_id, unsigned long util,
+		     unsigned long curfreq, unsigned long targfreq,
+		     unsigned long reason),
+	    TP_ARGS(cpu_id, util, curfreq, targfreq, reason)
+);
+
+DEFINE_EVENT(sched_decision, cpufreq_sched_notyet,
+	    TP_PROTO(unsigned long cpu_id, unsigned long util,
+		     unsigned long curfreq, unsigned long targfreq,
+		     unsigned long reason),
+	    TP_ARGS(cpu_id, util, curfreq, targfreq, reason)
+);
+
+TRACE_EVENT(cpufreq_sched_set,
+	    TP_PROTO(u32 cpu_id, unsigned long targfreq,
+		     unsigned long actualfreq),
+	    TP_ARGS(cpu_id, targfreq, actualfreq),
+
+	    TP_STRUCT__entry(
+		    __field(          u32, cpu_id    )
+		    __field(unsigned long, targfreq   )
+		    __field(unsigned long, actualfreq )
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = (u32) cpu_id;
+		    __entry->targfreq = targfreq;
+		    __entry->actualfreq = actualfreq;
+	    ),
+
+	    TP_printk("cpu=%u targ=%lu actual=%lu",
+		      __entry->cpu_id, __entry->targfreq,
+		      __entry->actualfreq)
+);
+
+#endif /* _TRACE_CPUFREQ_SCHED_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,91 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM wakelock
+
+#if !defined(_TRACE_WAKELOCK_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_WAKELOCK_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(wake_lock,
+	    TP_PROTO(const char *name, int type, long timeout),
+	    TP_ARGS(name, type, timeout),
+
+	    TP_STRUCT__entry(
+		    __string(name, name)
+		    __field(int,  type    )
+		    __field(long, timeout )
+	    ),
+
+	    TP_fast_assign(
+		    __assign_str(name, name);
+		    __entry->type = type;
+		    __entry->timeout = timeout;
+	    ),
+
+	    TP_printk("name=%s type=%d timeout=%ld",
+		      __get_str(name), __entry->type, __entry->timeout)
+);
+
+TRACE_EVENT(wake_unlock,
+	    TP_PROTO(const char *name, int type, s64 held_ns, int expired),
+	    TP_ARGS(name, type, held_ns, expired),
+
+	    TP_STRUCT__entry(
+		    __string(name, name)
+		    __field(int, type    )
+		    __field(s64, held_ns )
+		    __field(int, expired )
+	    ),
+
+	    TP_fast_assign(
+		    __assign_str(name, name);
+		    __entry->type = type;
+		    __entry->held_ns = held_ns;
+		    __entry->expired = expired;
+	    ),
+
+	    TP_printk("name=%s type=%d held_ns=%lld expired=%d",
+		      __get_str(name), __entry->type,
+		      (long long)__entry->held_ns, __entry->expired)
+);
+
+TRACE_EVENT(wakelock_wakeup,
+	    TP_PROTO(const char *name, int irq, s64 cycle_ns),
+	    TP_ARGS(name, irq, cycle_ns),
+
+	    TP_STRUCT__entry(
+		    __string(name, name)
+		    __field(int, irq      )
+		    __field(s64, cycle_ns )
+	    ),
+
+	    TP_fast_assign(
+		    __assign_str(name, name);
+		    __entry->irq = irq;
+		    __entry->cycle_ns = cycle_ns;
+	    ),
+
+	    TP_printk("name=%s irq=%d cycle_ns=%lld",
+		      __get_str(name), __entry->irq,
+		      (long long)__entry->cycle_ns)
+);
+
+TRACE_EVENT(wakelock_suspend_abort,
+	    TP_PROTO(const char *name),
+	    TP_ARGS(name),
+
+	    TP_STRUCT__entry(
+		    __string(name, name)
+	    ),
+
+	    TP_fast_assign(
+		    __assign_str(name, name);
+	    ),
+
+	    TP_printk("name=%s", __get_str(name))
+);
+
+#endif /* _TRACE_WAKELOCK_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
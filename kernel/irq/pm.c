@@ -13,6 +13,9 @@
 
 #include "internals.h"
 
+/* First wakeup interrupt found pending when the last suspend ended */
+static int last_wakeup_irq = -1;
+
 /**
  * suspend_device_irqs - disable all currently enabled interrupt lines
  *
@@ -26,6 +29,7 @@ void suspend_device_irqs(void)
 	struct irq_desc *desc;
 	int irq;
 
+	last_wakeup_irq = -1;
 	for_each_irq_desc(irq, desc) {
 		unsigned long flags;
 
@@ -54,6 +58,9 @@ static void resume_irqs(bool want_early)
 			continue;
 
 		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (last_wakeup_irq < 0 && desc->istate & IRQS_PENDING &&
+		    irqd_is_wakeup_set(&desc->irq_data))
+			last_wakeup_irq = irq;
 		__enable_irq(desc, irq, true);
 		raw_spin_unlock_irqrestore(&desc->lock, flags);
 	}
@@ -94,6 +101,19 @@ void resume_device_irqs(void)
 }
 EXPORT_SYMBOL_GPL(resume_device_irqs);
 
+/**
+ * pm_wakeup_irq - interrupt that woke the system from the last suspend
+ *
+ * Returns the first wakeup interrupt that was found pending when the
+ * interrupt lines were re-enabled on resume, or -1 if none was (level
+ * triggered lines do not latch a pending state while disabled).
+ */
+int pm_wakeup_irq(void)
+{
+	return last_wakeup_irq;
+}
+EXPORT_SYMBOL_GPL(pm_wakeup_irq);
+
 /**
  * check_wakeup_irqs - check if any wake-up interrupts are pending
  */
@@ -13,8 +13,11 @@
  *
  */
 
+#include <linux/interrupt.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/platform_device.h>
+#include <linux/rbtree.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
 #include <linux/syscalls.h> /* sys_sync */
@@ -24,6 +27,8 @@
 #endif
 #include "power.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/wakelock.h>
 
 #ifdef CONFIG_SVNET_WHITELIST
 #include <linux/delay.h>
@@ -41,16 +46,48 @@ enum {
 static int debug_mask = DEBUG_EXIT_SUSPEND | DEBUG_WAKEUP;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+#ifdef CONFIG_WAKELOCK_STAT
+/* A wakeup this soon after entering suspend is counted as a short cycle */
+static int short_wakeup_ms = 1000;
+module_param_named(short_wakeup_ms, short_wakeup_ms, int,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+#endif
+
 #define WAKE_LOCK_TYPE_MASK              (0x0f)
 #define WAKE_LOCK_INITIALIZED            (1U << 8)
 #define WAKE_LOCK_ACTIVE                 (1U << 9)
 #define WAKE_LOCK_AUTO_EXPIRE            (1U << 10)
-#define WAKE_LOCK_PREVENTING_SUSPEND     (1U << 11)
 
+/*
+ * list_lock only protects the list of all wake locks, which is walked for
+ * statistics and debug output. Taking and releasing a wake lock is
+ * serialized by the per-lock spinlock; lock order is list_lock, then
+ * wake_lock->lock, then wake_lock_type->timeout_lock.
+ *
+ * expire_lock serializes deciding whether suspend locks are left with
+ * updating the expire timer and queueing the suspend work on it, so that
+ * a decision is never acted on after a newer one. It nests outside
+ * timeout_lock.
+ */
 static DEFINE_SPINLOCK(list_lock);
-static LIST_HEAD(inactive_locks);
-static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
-static int current_event_num;
+static LIST_HEAD(all_locks);
+static DEFINE_SPINLOCK(expire_lock);
+
+/*
+ * Active locks without a timeout are only counted. Active locks with a
+ * timeout are kept in an rbtree ordered by expiry, so has_wake_lock() is
+ * O(1) while any untimed lock is held and O(log n) otherwise. Expired
+ * locks are pruned from the tree by has_wake_lock(); the lock itself
+ * notices the expiry the next time it is used.
+ */
+struct wake_lock_type {
+	atomic_t untimed;
+	spinlock_t timeout_lock;
+	struct rb_root timeouts;
+};
+static struct wake_lock_type wake_lock_types[WAKE_LOCK_TYPE_COUNT];
+
+static DEFINE_PER_CPU(unsigned int, suspend_event_count);
 struct workqueue_struct *suspend_work_queue;
 struct wake_lock main_wake_lock;
 suspend_state_t requested_suspend_state = PM_SUSPEND_MEM;
@@ -64,7 +101,7 @@ static unsigned suspend_short_count;
 
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
-static ktime_t last_sleep_time_update;
+static ktime_t suspend_entry_time;
 static int wait_for_wakeup;
 
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
@@ -89,6 +126,68 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 	return 1;
 }
 
+/*
+ * The sleep wait clock only runs while suspend is requested, that is
+ * while main_wake_lock is not held. A suspend lock reads it when it is
+ * taken and again when it is released; the difference is how long it held
+ * off suspend. Only main_wake_lock starts and stops the clock, so the
+ * accounting is O(1) for every other lock.
+ */
+static DEFINE_SEQLOCK(sleep_wait_seq);
+static ktime_t sleep_wait_total;	/* of all finished runs */
+static ktime_t sleep_wait_since;	/* start of the current run */
+static int sleep_waiting;
+
+static ktime_t sleep_wait_clock(ktime_t now)
+{
+	ktime_t clock;
+	unsigned seq;
+
+	do {
+		seq = read_seqbegin(&sleep_wait_seq);
+		clock = sleep_wait_total;
+		if (sleep_waiting && now.tv64 > sleep_wait_since.tv64)
+			clock = ktime_add(clock,
+					  ktime_sub(now, sleep_wait_since));
+	} while (read_seqretry(&sleep_wait_seq, seq));
+	return clock;
+}
+
+static void update_sleep_wait_stats(int waiting)
+{
+	unsigned long irqflags;
+	ktime_t now = ktime_get();
+
+	write_seqlock_irqsave(&sleep_wait_seq, irqflags);
+	if (sleep_waiting != waiting) {
+		if (sleep_waiting)
+			sleep_wait_total = ktime_add(sleep_wait_total,
+					ktime_sub(now, sleep_wait_since));
+		sleep_waiting = waiting;
+		sleep_wait_since = now;
+	}
+	write_sequnlock_irqrestore(&sleep_wait_seq, irqflags);
+}
+
+/* Caller holds lock->lock; the lock has just become active */
+static void wake_lock_stat_start(struct wake_lock *lock)
+{
+	lock->stat.last_time = ktime_get();
+	lock->stat.sleep_wait_start = sleep_wait_clock(lock->stat.last_time);
+}
+
+/*
+ * How long an active suspend lock has held off suspend until now, which
+ * can be no longer than it has been active.
+ */
+static ktime_t prevent_suspend_delta(struct wake_lock *lock, ktime_t now,
+				     ktime_t active)
+{
+	ktime_t delta = ktime_sub(sleep_wait_clock(now),
+				  lock->stat.sleep_wait_start);
+
+	return delta.tv64 > active.tv64 ? active : delta;
+}
 
 static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 {
@@ -111,9 +210,10 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 		else
 			expire_count++;
 		total_time = ktime_add(total_time, add_time);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)
+		if ((lock->flags & WAKE_LOCK_TYPE_MASK) == WAKE_LOCK_SUSPEND)
 			prevent_suspend_time = ktime_add(prevent_suspend_time,
-					ktime_sub(now, last_sleep_time_update));
+					prevent_suspend_delta(lock, now,
+							      add_time));
 		if (add_time.tv64 > max_time.tv64)
 			max_time = add_time;
 	}
@@ -132,22 +232,104 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	unsigned long irqflags;
 	struct wake_lock *lock;
 	int ret;
-	int type;
 
 	spin_lock_irqsave(&list_lock, irqflags);
 
 	ret = seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
 			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
-	list_for_each_entry(lock, &inactive_locks, link)
+	list_for_each_entry(lock, &all_locks, link) {
+		spin_lock(&lock->lock);
 		ret = print_lock_stat(m, lock);
-	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
-		list_for_each_entry(lock, &active_wake_locks[type], link)
-			ret = print_lock_stat(m, lock);
+		spin_unlock(&lock->lock);
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
 	return 0;
 }
 
+static int print_lock_cost(struct seq_file *m, struct wake_lock *lock)
+{
+	int i;
+
+	seq_printf(m, "\"%s\"\t%d\t%d\t%d\t%d\t%d\t%d",
+		   lock->name, lock->stat.count,
+		   lock->stat.prevent_suspend_count,
+		   lock->stat.suspend_abort_count, lock->stat.wakeup_count,
+		   lock->stat.short_wakeup_count, lock->stat.last_wakeup_irq);
+	for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+		seq_printf(m, "\t%u", lock->stat.hold_hist[i]);
+	return seq_putc(m, '\n');
+}
+
+/*
+ * Where the time goes: how often each lock held off a requested suspend
+ * or aborted one in progress, how many resumes it was the first lock
+ * taken after (and how many of those came less than short_wakeup_ms
+ * after entering suspend), the wakeup IRQ of its last resume, and a
+ * histogram of its hold times.
+ */
+static int wakelock_cost_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	seq_puts(m, "name\tcount\tprevent_count\tabort_count\twake_count"
+		 "\tshort_wake_count\twake_irq\t<1ms\t<4ms\t<16ms\t<64ms"
+		 "\t<256ms\t<1s\t<4s\t<16s\t<64s\t>=64s\n");
+	list_for_each_entry(lock, &all_locks, link) {
+		spin_lock(&lock->lock);
+		print_lock_cost(m, lock);
+		spin_unlock(&lock->lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
+/* <1ms, then one bucket per power of 4 milliseconds */
+static int hold_hist_bucket(ktime_t duration)
+{
+	s64 ms = ktime_to_ms(duration);
+
+	if (ms < 1)
+		return 0;
+	return min_t(int, 1 + ilog2(ms) / 2, WAKE_LOCK_HIST_BUCKETS - 1);
+}
+
+/* First suspend lock taken after a resume: charge the wakeup to it */
+static void wake_lock_charge_wakeup(struct wake_lock *lock)
+{
+	ktime_t cycle = ktime_sub(ktime_get_boottime(), suspend_entry_time);
+	int irq = pm_wakeup_irq();
+
+	if (debug_mask & DEBUG_WAKEUP)
+		pr_info("wakeup wake lock: %s, irq %d\n", lock->name, irq);
+	lock->stat.wakeup_count++;
+	lock->stat.last_wakeup_irq = irq;
+	if (ktime_to_ms(cycle) < short_wakeup_ms)
+		lock->stat.short_wakeup_count++;
+	trace_wakelock_wakeup(lock->name, irq, ktime_to_ns(cycle));
+}
+
+/* Suspend was aborted: blame every suspend lock still held */
+static void wake_lock_charge_abort(void)
+{
+	struct wake_lock *lock;
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &all_locks, link) {
+		if ((lock->flags & WAKE_LOCK_TYPE_MASK) != WAKE_LOCK_SUSPEND)
+			continue;
+		spin_lock(&lock->lock);
+		if (wake_lock_active(lock)) {
+			lock->stat.suspend_abort_count++;
+			trace_wakelock_suspend_abort(lock->name);
+		}
+		spin_unlock(&lock->lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -165,63 +347,89 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
+	lock->stat.hold_hist[hold_hist_bucket(duration)]++;
+	trace_wake_unlock(lock->name, lock->flags & WAKE_LOCK_TYPE_MASK,
+			  ktime_to_ns(duration), expired);
 	lock->stat.last_time = ktime_get();
-	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-		duration = ktime_sub(now, last_sleep_time_update);
-		lock->stat.prevent_suspend_time = ktime_add(
-			lock->stat.prevent_suspend_time, duration);
-		lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
+	if ((lock->flags & WAKE_LOCK_TYPE_MASK) == WAKE_LOCK_SUSPEND) {
+		duration = prevent_suspend_delta(lock, now, duration);
+		if (duration.tv64 > 0) {
+			lock->stat.prevent_suspend_time = ktime_add(
+				lock->stat.prevent_suspend_time, duration);
+			lock->stat.prevent_suspend_count++;
+		}
 	}
 }
+#endif
 
-static void update_sleep_wait_stats_locked(int done)
+
+static unsigned int current_event_num(void)
 {
-	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
-	int expired;
-
-	now = ktime_get();
-	elapsed = ktime_sub(now, last_sleep_time_update);
-	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
-		expired = get_expired_time(lock, &etime);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-			if (expired)
-				add = ktime_sub(etime, last_sleep_time_update);
-			else
-				add = elapsed;
-			lock->stat.prevent_suspend_time = ktime_add(
-				lock->stat.prevent_suspend_time, add);
-		}
-		if (done || expired)
-			lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
+	unsigned int sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(suspend_event_count, cpu);
+	return sum;
+}
+
+/* Caller must hold wt->timeout_lock */
+static void timeout_insert(struct wake_lock_type *wt, struct wake_lock *lock)
+{
+	struct rb_node **p = &wt->timeouts.rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *l;
+
+	while (*p) {
+		parent = *p;
+		l = rb_entry(parent, struct wake_lock, node);
+		if (time_before(lock->expires, l->expires))
+			p = &parent->rb_left;
 		else
-			lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
+			p = &parent->rb_right;
 	}
-	last_sleep_time_update = now;
+	rb_link_node(&lock->node, parent, p);
+	rb_insert_color(&lock->node, &wt->timeouts);
 }
-#endif
 
+/* Caller must hold wt->timeout_lock */
+static void timeout_remove(struct wake_lock_type *wt, struct wake_lock *lock)
+{
+	if (RB_EMPTY_NODE(&lock->node))
+		return;
+	rb_erase(&lock->node, &wt->timeouts);
+	RB_CLEAR_NODE(&lock->node);
+}
 
-static void expire_wake_lock(struct wake_lock *lock)
+/* Drop an active lock from its type's accounting. Caller holds lock->lock */
+static void wake_lock_deactivate(struct wake_lock *lock)
 {
-#ifdef CONFIG_WAKELOCK_STAT
-	wake_unlock_stat_locked(lock, 1);
-#endif
-	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
-	list_add(&lock->link, &inactive_locks);
-	if (debug_mask & (DEBUG_WAKE_LOCK | DEBUG_EXPIRE))
-		pr_info("expired wake lock %s\n", lock->name);
+	struct wake_lock_type *wt;
+
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	wt = &wake_lock_types[lock->flags & WAKE_LOCK_TYPE_MASK];
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
+		spin_lock(&wt->timeout_lock);
+		timeout_remove(wt, lock);
+		spin_unlock(&wt->timeout_lock);
+	} else {
+		atomic_dec(&wt->untimed);
+	}
 }
 
-/* Caller must acquire the list_lock spinlock */
 static void print_active_locks(int type)
 {
 	struct wake_lock *lock;
 	bool print_expired = true;
+	unsigned long irqflags;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry(lock, &active_wake_locks[type], link) {
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &all_locks, link) {
+		if ((lock->flags & WAKE_LOCK_TYPE_MASK) != type ||
+		    !(lock->flags & WAKE_LOCK_ACTIVE))
+			continue;
 		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
 			long timeout = lock->expires - jiffies;
 			if (timeout > 0)
@@ -235,36 +443,50 @@ static void print_active_locks(int type)
 				print_expired = false;
 		}
 	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
-static long has_wake_lock_locked(int type)
+static long has_wake_lock_type(int type)
 {
-	struct wake_lock *lock, *n;
+	struct wake_lock_type *wt;
+	struct wake_lock *lock;
+	struct rb_node *n;
+	unsigned long irqflags;
 	long max_timeout = 0;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	wt = &wake_lock_types[type];
+	if (atomic_read(&wt->untimed))
+		return -1;
+
+	spin_lock_irqsave(&wt->timeout_lock, irqflags);
+	while ((n = rb_first(&wt->timeouts))) {
+		lock = rb_entry(n, struct wake_lock, node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		timeout_remove(wt, lock);
+		if (debug_mask & (DEBUG_WAKE_LOCK | DEBUG_EXPIRE))
+			pr_info("expired wake lock %s\n", lock->name);
 	}
+	n = rb_last(&wt->timeouts);
+	if (n)
+		max_timeout = rb_entry(n, struct wake_lock, node)->expires -
+			      jiffies;
+	spin_unlock_irqrestore(&wt->timeout_lock, irqflags);
+
+	/* an untimed lock may have been taken while we looked at the tree */
+	if (atomic_read(&wt->untimed))
+		return -1;
 	return max_timeout;
 }
 
 long has_wake_lock(int type)
 {
 	long ret;
-	unsigned long irqflags;
-	spin_lock_irqsave(&list_lock, irqflags);
-	ret = has_wake_lock_locked(type);
+
+	ret = has_wake_lock_type(type);
 	if (ret && (debug_mask & DEBUG_WAKEUP) && type == WAKE_LOCK_SUSPEND)
 		print_active_locks(type);
-	spin_unlock_irqrestore(&list_lock, irqflags);
 	return ret;
 }
 
@@ -284,6 +506,9 @@ static void suspend(struct work_struct *work)
 	if (has_wake_lock(WAKE_LOCK_SUSPEND)) {
 		if (debug_mask & DEBUG_SUSPEND)
 			pr_info("suspend: abort suspend\n");
+#ifdef CONFIG_WAKELOCK_STAT
+		wake_lock_charge_abort();
+#endif
 		return;
 	}
 
@@ -313,7 +538,7 @@ static void suspend(struct work_struct *work)
 	}
 #endif
 
-	entry_event_num = current_event_num;
+	entry_event_num = current_event_num();
 	sys_sync();
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("suspend: enter suspend\n");
@@ -353,7 +578,7 @@ static void suspend(struct work_struct *work)
 		suspend_short_count = 0;
 	}
 
-	if (current_event_num == entry_event_num) {
+	if (current_event_num() == entry_event_num) {
 		if (debug_mask & DEBUG_SUSPEND)
 			pr_info("suspend: pm_suspend returned with no event\n");
 		wake_lock_timeout(&unknown_wakeup, HZ / 2);
@@ -367,15 +592,15 @@ static void expire_wake_locks(unsigned long data)
 	unsigned long irqflags;
 	if (debug_mask & DEBUG_EXPIRE)
 		pr_info("expire_wake_locks: start\n");
-	spin_lock_irqsave(&list_lock, irqflags);
 	if (debug_mask & DEBUG_SUSPEND)
 		print_active_locks(WAKE_LOCK_SUSPEND);
-	has_lock = has_wake_lock_locked(WAKE_LOCK_SUSPEND);
+	spin_lock_irqsave(&expire_lock, irqflags);
+	has_lock = has_wake_lock_type(WAKE_LOCK_SUSPEND);
 	if (debug_mask & DEBUG_EXPIRE)
 		pr_info("expire_wake_locks: done, has_lock %ld\n", has_lock);
 	if (has_lock == 0)
 		queue_work(suspend_work_queue, &suspend_work);
-	spin_unlock_irqrestore(&list_lock, irqflags);
+	spin_unlock_irqrestore(&expire_lock, irqflags);
 }
 static DEFINE_TIMER(expire_timer, expire_wake_locks, 0, 0);
 
@@ -383,6 +608,9 @@ static int power_suspend_late(struct device *dev)
 {
 	int ret = has_wake_lock(WAKE_LOCK_SUSPEND) ? -EAGAIN : 0;
 #ifdef CONFIG_WAKELOCK_STAT
+	if (ret)
+		wake_lock_charge_abort();
+	suspend_entry_time = ktime_get_boottime();
 	wait_for_wakeup = !ret;
 #endif
 	if (debug_mask & DEBUG_SUSPEND)
@@ -420,12 +648,19 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	lock->stat.prevent_suspend_count = 0;
+	lock->stat.suspend_abort_count = 0;
+	lock->stat.short_wakeup_count = 0;
+	lock->stat.last_wakeup_irq = -1;
+	memset(lock->stat.hold_hist, 0, sizeof(lock->stat.hold_hist));
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
+	spin_lock_init(&lock->lock);
+	RB_CLEAR_NODE(&lock->node);
 	INIT_LIST_HEAD(&lock->link);
 	spin_lock_irqsave(&list_lock, irqflags);
-	list_add(&lock->link, &inactive_locks);
+	list_add(&lock->link, &all_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_init);
@@ -433,10 +668,16 @@ EXPORT_SYMBOL(wake_lock_init);
 void wake_lock_destroy(struct wake_lock *lock)
 {
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	int i;
+#endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
-	lock->flags &= ~WAKE_LOCK_INITIALIZED;
+	spin_lock(&lock->lock);
+	wake_lock_deactivate(lock);
+	lock->flags &= ~(WAKE_LOCK_INITIALIZED | WAKE_LOCK_ACTIVE |
+			 WAKE_LOCK_AUTO_EXPIRE);
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
 		deleted_wake_locks.stat.count += lock->stat.count;
@@ -450,86 +691,120 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		deleted_wake_locks.stat.prevent_suspend_count +=
+			lock->stat.prevent_suspend_count;
+		deleted_wake_locks.stat.suspend_abort_count +=
+			lock->stat.suspend_abort_count;
+		deleted_wake_locks.stat.wakeup_count +=
+			lock->stat.wakeup_count;
+		deleted_wake_locks.stat.short_wakeup_count +=
+			lock->stat.short_wakeup_count;
+		for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+			deleted_wake_locks.stat.hold_hist[i] +=
+				lock->stat.hold_hist[i];
 	}
 #endif
+	spin_unlock(&lock->lock);
 	list_del(&lock->link);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_destroy);
 
+/*
+ * Start the expire timer for the last timed suspend lock, or kick the
+ * suspend work if none is left. Called without any wake lock spinlock.
+ */
+static void wake_lock_update_expire(struct wake_lock *lock, const char *who)
+{
+	unsigned long irqflags;
+	long expire_in;
+
+	spin_lock_irqsave(&expire_lock, irqflags);
+	expire_in = has_wake_lock_type(WAKE_LOCK_SUSPEND);
+	if (expire_in > 0) {
+		if (debug_mask & DEBUG_EXPIRE)
+			pr_info("%s: %s, start expire timer, %ld\n",
+				who, lock->name, expire_in);
+		mod_timer(&expire_timer, jiffies + expire_in);
+	} else {
+		if (del_timer(&expire_timer))
+			if (debug_mask & DEBUG_EXPIRE)
+				pr_info("%s: %s, stop expire timer\n",
+					who, lock->name);
+		if (expire_in == 0)
+			queue_work(suspend_work_queue, &suspend_work);
+	}
+	spin_unlock_irqrestore(&expire_lock, irqflags);
+}
+
 static void wake_lock_internal(
 	struct wake_lock *lock, long timeout, int has_timeout)
 {
 	int type;
 	unsigned long irqflags;
-	long expire_in;
+	struct wake_lock_type *wt;
+	int was_untimed;
 
-	spin_lock_irqsave(&list_lock, irqflags);
+#ifdef CONFIG_WAKELOCK_STAT
+	if (lock == &main_wake_lock)
+		update_sleep_wait_stats(0);
+#endif
+	spin_lock_irqsave(&lock->lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	BUG_ON(!(lock->flags & WAKE_LOCK_INITIALIZED));
+	wt = &wake_lock_types[type];
+	trace_wake_lock(lock->name, type, has_timeout ? timeout : -1);
 #ifdef CONFIG_WAKELOCK_STAT
-	if (type == WAKE_LOCK_SUSPEND && wait_for_wakeup) {
-		if (debug_mask & DEBUG_WAKEUP)
-			pr_info("wakeup wake lock: %s\n", lock->name);
-		wait_for_wakeup = 0;
-		lock->stat.wakeup_count++;
-	}
+	if (type == WAKE_LOCK_SUSPEND && wait_for_wakeup &&
+	    xchg(&wait_for_wakeup, 0))
+		wake_lock_charge_wakeup(lock);
 	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
 	    (long)(lock->expires - jiffies) <= 0) {
 		wake_unlock_stat_locked(lock, 0);
-		lock->stat.last_time = ktime_get();
+		wake_lock_stat_start(lock);
 	}
 #endif
+	was_untimed = (lock->flags & WAKE_LOCK_ACTIVE) &&
+		      !(lock->flags & WAKE_LOCK_AUTO_EXPIRE);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
-		lock->stat.last_time = ktime_get();
+		wake_lock_stat_start(lock);
 #endif
 	}
-	list_del(&lock->link);
 	if (has_timeout) {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d, timeout %ld.%03lu\n",
 				lock->name, type, timeout / HZ,
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
+		spin_lock(&wt->timeout_lock);
+		timeout_remove(wt, lock);
 		lock->expires = jiffies + timeout;
+		timeout_insert(wt, lock);
+		spin_unlock(&wt->timeout_lock);
+		if (was_untimed)
+			atomic_dec(&wt->untimed);
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
-		list_add_tail(&lock->link, &active_wake_locks[type]);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
+		if (!was_untimed)
+			atomic_inc(&wt->untimed);
+		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
+			spin_lock(&wt->timeout_lock);
+			timeout_remove(wt, lock);
+			spin_unlock(&wt->timeout_lock);
+		}
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
-		list_add(&lock->link, &active_wake_locks[type]);
 	}
+	spin_unlock_irqrestore(&lock->lock, irqflags);
+
 	if (type == WAKE_LOCK_SUSPEND) {
-		current_event_num++;
-#ifdef CONFIG_WAKELOCK_STAT
-		if (lock == &main_wake_lock)
-			update_sleep_wait_stats_locked(1);
-		else if (!wake_lock_active(&main_wake_lock))
-			update_sleep_wait_stats_locked(0);
-#endif
-		if (has_timeout)
-			expire_in = has_wake_lock_locked(type);
-		else
-			expire_in = -1;
-		if (expire_in > 0) {
-			if (debug_mask & DEBUG_EXPIRE)
-				pr_info("wake_lock: %s, start expire timer, "
-					"%ld\n", lock->name, expire_in);
-			mod_timer(&expire_timer, jiffies + expire_in);
-		} else {
-			if (del_timer(&expire_timer))
-				if (debug_mask & DEBUG_EXPIRE)
-					pr_info("wake_lock: %s, stop expire timer\n",
-						lock->name);
-			if (expire_in == 0)
-				queue_work(suspend_work_queue, &suspend_work);
-		}
+		irqsafe_cpu_inc(suspend_event_count);
+		wake_lock_update_expire(lock, "wake_lock");
 	}
-	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
 void wake_lock(struct wake_lock *lock)
@@ -548,46 +823,40 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
-	spin_lock_irqsave(&list_lock, irqflags);
+	spin_lock_irqsave(&lock->lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 0);
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	wake_lock_deactivate(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
-	list_add(&lock->link, &inactive_locks);
+	spin_unlock_irqrestore(&lock->lock, irqflags);
+
 	if (type == WAKE_LOCK_SUSPEND) {
-		long has_lock = has_wake_lock_locked(type);
-		if (has_lock > 0) {
-			if (debug_mask & DEBUG_EXPIRE)
-				pr_info("wake_unlock: %s, start expire timer, "
-					"%ld\n", lock->name, has_lock);
-			mod_timer(&expire_timer, jiffies + has_lock);
-		} else {
-			if (del_timer(&expire_timer))
-				if (debug_mask & DEBUG_EXPIRE)
-					pr_info("wake_unlock: %s, stop expire "
-						"timer\n", lock->name);
-			if (has_lock == 0)
-				queue_work(suspend_work_queue, &suspend_work);
-		}
+		wake_lock_update_expire(lock, "wake_unlock");
 		if (lock == &main_wake_lock) {
 			if (debug_mask & DEBUG_SUSPEND)
 				print_active_locks(WAKE_LOCK_SUSPEND);
 #ifdef CONFIG_WAKELOCK_STAT
-			update_sleep_wait_stats_locked(0);
+			update_sleep_wait_stats(1);
 #endif
 		}
 	}
-	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_unlock);
 
 int wake_lock_active(struct wake_lock *lock)
 {
-	return !!(lock->flags & WAKE_LOCK_ACTIVE);
+	int flags = ACCESS_ONCE(lock->flags);
+
+	if (!(flags & WAKE_LOCK_ACTIVE))
+		return 0;
+	if ((flags & WAKE_LOCK_AUTO_EXPIRE) &&
+	    (long)(ACCESS_ONCE(lock->expires) - jiffies) <= 0)
+		return 0;
+	return 1;
 }
 EXPORT_SYMBOL(wake_lock_active);
 
@@ -604,13 +873,29 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_cost_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_cost_show, NULL);
+}
+
+static const struct file_operations wakelock_cost_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_cost_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
-		INIT_LIST_HEAD(&active_wake_locks[i]);
+	for (i = 0; i < ARRAY_SIZE(wake_lock_types); i++) {
+		atomic_set(&wake_lock_types[i].untimed, 0);
+		spin_lock_init(&wake_lock_types[i].timeout_lock);
+		wake_lock_types[i].timeouts = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -641,6 +926,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelock_cost", S_IRUGO, NULL, &wakelock_cost_fops);
 #endif
 
 	return 0;
@@ -662,6 +948,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelock_cost", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
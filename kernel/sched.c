@@ -483,6 +483,13 @@ struct rq {
 	struct cfs_rq cfs;
 	struct rt_rq rt;
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+	/* cpufreq utilisation, see update_rq_util() */
+	unsigned long util_queued;
+	unsigned long util_busy_avg;
+	u64 util_update;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
 	struct list_head leaf_cfs_rq_list;
@@ -2845,6 +2852,15 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+	p->se.util_avg			= 0;
+	p->se.util_contrib		= 0;
+	p->se.util_woken		= 0;
+	p->se.util_dequeued		= 0;
+	p->se.util_sleep		= 0;
+	p->se.util_exec_start		= 0;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
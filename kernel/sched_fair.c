@@ -23,6 +23,7 @@
 #include <linux/latencytop.h>
 #include <linux/sched.h>
 #include <linux/cpumask.h>
+#include <linux/cpufreq.h>
 
 /*
  * Targeted preemption latency for CPU-bound tasks:
@@ -1316,6 +1317,117 @@ static inline void hrtick_update(struct rq *rq)
 }
 #endif
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHED
+/*
+ * Utilisation tracking for the scheduler-driven cpufreq governor.
+ *
+ * Each task keeps a running average of the share of wall time it spent
+ * executing over its recent run/sleep cycles, updated when it goes to
+ * sleep. While queued, that share is added to the runqueue, so the
+ * frequency can follow a heavy task the moment it wakes up or migrates
+ * instead of waiting for an idle-time sample. A decaying average of how
+ * busy the runqueue has been covers tasks that never sleep and new tasks
+ * that have no history yet.
+ */
+static void update_rq_util(struct rq *rq)
+{
+	s64 delta = rq->clock - rq->util_update;
+	long diff;
+
+	if (delta <= 0)
+		return;
+
+	rq->util_update = rq->clock;
+	if (delta > (1LL << 30))
+		delta = 1LL << 30;
+
+	diff = (rq->cfs.nr_running ? SCHED_LOAD_SCALE : 0) -
+		(long)rq->util_busy_avg;
+	rq->util_busy_avg = (long)rq->util_busy_avg +
+		div_s64((s64)diff * delta, delta + CPUFREQ_SCHED_BUSY_TAU_NS);
+}
+
+static unsigned long rq_util(struct rq *rq)
+{
+	unsigned long util = max(rq->util_queued, rq->util_busy_avg);
+
+	return min_t(unsigned long, util, SCHED_LOAD_SCALE);
+}
+
+static void util_enqueue_task(struct rq *rq, struct task_struct *p,
+			      int wakeup)
+{
+	struct sched_entity *se = &p->se;
+
+	if (wakeup) {
+		s64 slept = rq->clock - se->util_dequeued;
+
+		se->util_sleep = slept > 0 ? slept : 0;
+		se->util_woken = rq->clock;
+		se->util_exec_start = se->sum_exec_runtime;
+	}
+
+	se->util_contrib = se->util_avg;
+	rq->util_queued += se->util_contrib;
+
+	cpufreq_sched_update(cpu_of(rq), rq_util(rq), CPUFREQ_SCHED_ENQUEUE);
+}
+
+static void util_dequeue_task(struct rq *rq, struct task_struct *p,
+			      int sleep)
+{
+	struct sched_entity *se = &p->se;
+
+	rq->util_queued -= min(se->util_contrib, rq->util_queued);
+	se->util_contrib = 0;
+
+	if (sleep) {
+		u64 exec = se->sum_exec_runtime - se->util_exec_start;
+		s64 awake = rq->clock - se->util_woken;
+		u64 period = se->util_sleep + (awake > 0 ? awake : 0);
+		unsigned long sample = SCHED_LOAD_SCALE;
+
+		if (period > exec)
+			sample = div64_u64(exec * SCHED_LOAD_SCALE, period);
+
+		se->util_avg = (se->util_avg * 3 + sample) >> 2;
+		se->util_dequeued = rq->clock;
+	}
+
+	/*
+	 * With nothing left to run the tick may stop, so the governor has to
+	 * decay the busy average of this CPU on its own from here on.
+	 */
+	cpufreq_sched_update(cpu_of(rq), rq_util(rq), rq->cfs.nr_running ?
+			     CPUFREQ_SCHED_DEQUEUE : CPUFREQ_SCHED_IDLE);
+}
+
+/* Only called with a fair task running, so never for an idle CPU */
+static void util_tick(struct rq *rq)
+{
+	update_rq_util(rq);
+	cpufreq_sched_update(cpu_of(rq), rq_util(rq), CPUFREQ_SCHED_TICK);
+}
+#else /* !CONFIG_CPU_FREQ_GOV_SCHED */
+static inline void update_rq_util(struct rq *rq)
+{
+}
+
+static inline void
+util_enqueue_task(struct rq *rq, struct task_struct *p, int wakeup)
+{
+}
+
+static inline void
+util_dequeue_task(struct rq *rq, struct task_struct *p, int sleep)
+{
+}
+
+static inline void util_tick(struct rq *rq)
+{
+}
+#endif
+
 /*
  * The enqueue_task method is called before nr_running is
  * increased. Here we update the fair scheduling stats and
@@ -1326,6 +1438,9 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 {
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
+	int wakeup = flags & ENQUEUE_WAKEUP;
+
+	update_rq_util(rq);
 
 	for_each_sched_entity(se) {
 		if (se->on_rq)
@@ -1342,6 +1457,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		update_cfs_shares(cfs_rq);
 	}
 
+	util_enqueue_task(rq, p, wakeup);
 	hrtick_update(rq);
 }
 
@@ -1358,6 +1474,8 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct sched_entity *se = &p->se;
 	int task_sleep = flags & DEQUEUE_SLEEP;
 
+	update_rq_util(rq);
+
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, flags);
@@ -1382,6 +1500,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		update_cfs_shares(cfs_rq);
 	}
 
+	util_dequeue_task(rq, p, task_sleep);
 	hrtick_update(rq);
 }
 
@@ -4120,6 +4239,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	util_tick(rq);
 }
 
 /*
@@ -26,15 +26,16 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/init.h>
+#include <linux/cache.h>
 #include <asm/atomic.h>
 #include "crc32defs.h"
-#if CRC_LE_BITS == 8
+#if CRC_LE_BITS > 8
 # define tole(x) __constant_cpu_to_le32(x)
 #else
 # define tole(x) (x)
 #endif
 
-#if CRC_BE_BITS == 8
+#if CRC_BE_BITS > 8
 # define tobe(x) __constant_cpu_to_be32(x)
 #else
 # define tobe(x) (x)
@@ -42,29 +43,38 @@
 #include "crc32table.h"
 
 MODULE_AUTHOR("Matt Domsch <Matt_Domsch@dell.com>");
-MODULE_DESCRIPTION("Ethernet CRC32 calculations");
+MODULE_DESCRIPTION("Various CRC32 calculations");
 MODULE_LICENSE("GPL");
 
-#if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
+#if CRC_LE_BITS > 8 || CRC_BE_BITS > 8
 
+/*
+ * Slicing: xor a word of data into the crc, and look each of its bytes up
+ * in the table for the number of bytes that follow it in the block.  With
+ * 8 bytes at a time, the lookups for the second word do not depend on the
+ * first, so the CPU does both at once.  The crc is kept in the byte order
+ * of the data, which is why the tables are too.
+ */
 static inline u32
-crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
+crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256],
+	   const int bits)
 {
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC4 (tab[3][(q) & 255] ^ tab[2][(q >> 8) & 255] ^ \
+		   tab[1][(q >> 16) & 255] ^ tab[0][(q >> 24) & 255])
+#  define DO_CRC8 (tab[7][(q) & 255] ^ tab[6][(q >> 8) & 255] ^ \
+		   tab[5][(q >> 16) & 255] ^ tab[4][(q >> 24) & 255])
 # else
 #  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC4 (tab[0][(q) & 255] ^ tab[1][(q >> 8) & 255] ^ \
+		   tab[2][(q >> 16) & 255] ^ tab[3][(q >> 24) & 255])
+#  define DO_CRC8 (tab[4][(q) & 255] ^ tab[5][(q >> 8) & 255] ^ \
+		   tab[6][(q >> 16) & 255] ^ tab[7][(q >> 24) & 255])
 # endif
 	const u32 *b;
 	size_t    rem_len;
+	u32       q;
 
 	/* Align it */
 	if (unlikely((long)buf & 3 && len)) {
@@ -72,99 +82,137 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 			DO_CRC(*buf++);
 		} while ((--len) && ((long)buf)&3);
 	}
-	rem_len = len & 3;
 	/* load data 32 bits wide, xor data 32 bits wide. */
-	len = len >> 2;
 	b = (const u32 *)buf;
-	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+	if (bits == 64) {
+		rem_len = len & 7;
+		for (len >>= 3; len; --len) {
+			q = crc ^ *b++;
+			crc = DO_CRC8;
+			q = *b++;
+			crc ^= DO_CRC4;
+		}
+	} else {
+		rem_len = len & 3;
+		for (len >>= 2; len; --len) {
+			q = crc ^ *b++;
+			crc = DO_CRC4;
+		}
 	}
-	len = rem_len;
 	/* And the last few bytes */
-	if (len) {
-		u8 *p = (u8 *)(b + 1) - 1;
-		do {
-			DO_CRC(*++p); /* use pre increment for speed */
-		} while (--len);
-	}
+	buf = (unsigned char const *)b;
+	for (len = rem_len; len; --len)
+		DO_CRC(*buf++);
 	return crc;
 #undef DO_CRC
 #undef DO_CRC4
+#undef DO_CRC8
 }
 #endif
-/**
- * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
- * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
- *	other uses, or the previous crc32 value if computing incrementally.
- * @p: pointer to buffer over which CRC is run
- * @len: length of buffer @p
- */
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len);
 
-#if CRC_LE_BITS == 1
 /*
- * In fact, the table-based code will work in this case, but it can be
- * simplified by inlining the table in ?: form.
+ * Little-endian CRC with any polynomial, and its table: both crc32_le()
+ * and __crc32c_le() are this.
  */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+static inline u32 __pure
+crc32_le_generic(u32 crc, unsigned char const *p, size_t len,
+		 const u32 (*tab)[256], u32 polynomial)
 {
+#if CRC_LE_BITS == 1
+	/*
+	 * In fact, the table-based code will work in this case, but it can
+	 * be simplified by inlining the table in ?: form.
+	 */
 	int i;
 	while (len--) {
 		crc ^= *p++;
 		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
 	}
-	return crc;
-}
-#else				/* Table-based approach */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
-{
-# if CRC_LE_BITS == 8
-	const u32      (*tab)[] = crc32table_le;
-
-	crc = __cpu_to_le32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	return __le32_to_cpu(crc);
-# elif CRC_LE_BITS == 4
+#elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
 	}
-	return crc;
-# elif CRC_LE_BITS == 2
+#elif CRC_LE_BITS == 4
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 4) ^ tab[0][crc & 15];
+		crc = (crc >> 4) ^ tab[0][crc & 15];
+	}
+#elif CRC_LE_BITS == 8
+	/* aka Sarwate algorithm */
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 8) ^ tab[0][crc & 255];
 	}
+#else
+	crc = __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, tab, CRC_LE_BITS);
+	crc = __le32_to_cpu(crc);
+#endif
 	return crc;
-# endif
 }
-#endif
 
 /**
- * crc32_be() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
+ * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
  * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
  *	other uses, or the previous crc32 value if computing incrementally.
  * @p: pointer to buffer over which CRC is run
  * @len: length of buffer @p
  */
-u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len);
+#if CRC_LE_BITS == 1
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRCPOLY_LE);
+}
+#else
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32table_le, CRCPOLY_LE);
+}
+#endif
 
-#if CRC_BE_BITS == 1
-/*
- * In fact, the table-based code will work in this case, but it can be
- * simplified by inlining the table in ?: form.
+/**
+ * __crc32c_le() - Calculate the little-endian CRC32c (Castagnoli)
+ * @crc: seed value for computation.  ~0 for iSCSI, btrfs and ext4, or
+ *	the previous value if computing incrementally.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ *
+ * This is what the "crc32c" crypto algorithm runs; most users should
+ * go through it, or libcrc32c, to get the CPU's crc32 instruction where
+ * there is one.
  */
+#if CRC_LE_BITS == 1
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRC32C_POLY_LE);
+}
+#else
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32ctable_le, CRC32C_POLY_LE);
+}
+#endif
 
+/**
+ * crc32_be() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
+ * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
+ *	other uses, or the previous crc32 value if computing incrementally.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ */
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
+#if CRC_BE_BITS == 1
+	/*
+	 * In fact, the table-based code will work in this case, but it can
+	 * be simplified by inlining the table in ?: form.
+	 */
 	int i;
 	while (len--) {
 		crc ^= *p++ << 24;
@@ -173,40 +221,182 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 			    (crc << 1) ^ ((crc & 0x80000000) ? CRCPOLY_BE :
 					  0);
 	}
+#elif CRC_BE_BITS == 2
+	while (len--) {
+		crc ^= *p++ << 24;
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+	}
+#elif CRC_BE_BITS == 4
+	while (len--) {
+		crc ^= *p++ << 24;
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+	}
+#elif CRC_BE_BITS == 8
+	while (len--) {
+		crc ^= *p++ << 24;
+		crc = (crc << 8) ^ crc32table_be[0][crc >> 24];
+	}
+#else
+	crc = __cpu_to_be32(crc);
+	crc = crc32_body(crc, p, len, crc32table_be, CRC_BE_BITS);
+	crc = __be32_to_cpu(crc);
+#endif
 	return crc;
 }
 
-#else				/* Table-based approach */
-u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
+EXPORT_SYMBOL(crc32_le);
+EXPORT_SYMBOL(__crc32c_le);
+EXPORT_SYMBOL(crc32_be);
+
+#ifdef CONFIG_CRC32_SELFTEST
+
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
+
+/* the check values of the catalogued CRCs, over "123456789" */
+#define CRC32_CHECK_LE	0xcbf43926	/* CRC-32, inverted */
+#define CRC32_CHECK_BE	0x0376e6e7	/* CRC-32/MPEG-2 */
+#define CRC32C_CHECK	0xe3069283	/* CRC-32C, inverted */
+
+/* all lengths up to this at every alignment, against the bitwise code */
+#define CRC32_TEST_LEN	256
+#define CRC32_BENCH_BYTES	(4 << 20)
+
+static u32 __init crc32_le_bitwise(u32 crc, unsigned char const *p,
+				   size_t len, u32 polynomial)
 {
-# if CRC_BE_BITS == 8
-	const u32      (*tab)[] = crc32table_be;
+	int i;
 
-	crc = __cpu_to_be32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	return __be32_to_cpu(crc);
-# elif CRC_BE_BITS == 4
 	while (len--) {
-		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
 	}
 	return crc;
-# elif CRC_BE_BITS == 2
+}
+
+static u32 __init crc32_be_bitwise(u32 crc, unsigned char const *p,
+				   size_t len)
+{
+	int i;
+
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		for (i = 0; i < 8; i++)
+			crc = (crc << 1) ^
+			      ((crc & 0x80000000) ? CRCPOLY_BE : 0);
 	}
 	return crc;
-# endif
 }
-#endif
 
-EXPORT_SYMBOL(crc32_le);
-EXPORT_SYMBOL(crc32_be);
+static int __init crc32_test(unsigned char *buf)
+{
+	static const unsigned char check[] __initconst = "123456789";
+	unsigned int align, len, errors = 0;
+	u32 seed = 0x2545f491;
+	unsigned char *p;
+
+	if ((crc32_le(~0, check, 9) ^ ~0) != CRC32_CHECK_LE) {
+		pr_err("crc32: crc32_le check value wrong\n");
+		errors++;
+	}
+	if (crc32_be(~0, check, 9) != CRC32_CHECK_BE) {
+		pr_err("crc32: crc32_be check value wrong\n");
+		errors++;
+	}
+	if ((__crc32c_le(~0, check, 9) ^ ~0) != CRC32C_CHECK) {
+		pr_err("crc32: __crc32c_le check value wrong\n");
+		errors++;
+	}
+
+	for (len = 0; len < PAGE_SIZE + 8; len++) {
+		seed = seed * 1103515245 + 12345;
+		buf[len] = seed >> 16;
+	}
+
+	for (align = 0; align < 8; align++) {
+		p = buf + align;
+		for (len = 0; len <= CRC32_TEST_LEN; len++) {
+			seed = seed * 1103515245 + 12345;
+			if (crc32_le(seed, p, len) !=
+			    crc32_le_bitwise(seed, p, len, CRCPOLY_LE) ||
+			    crc32_be(seed, p, len) !=
+			    crc32_be_bitwise(seed, p, len) ||
+			    __crc32c_le(seed, p, len) !=
+			    crc32_le_bitwise(seed, p, len, CRC32C_POLY_LE)) {
+				pr_err("crc32: mismatch, length %u offset %u\n",
+				       len, align);
+				errors++;
+			}
+		}
+	}
+
+	if (errors)
+		pr_err("crc32: self-test failed, %u errors\n", errors);
+	else
+		pr_info("crc32: self-test passed (%d bit)\n", CRC_LE_BITS);
+	return errors ? -EINVAL : 0;
+}
+
+static void __init crc32_bench_one(const char *name,
+		u32 (*fn)(u32, unsigned char const *, size_t),
+		unsigned char *buf, size_t len)
+{
+	unsigned int i, loops = CRC32_BENCH_BYTES / len;
+	ktime_t start;
+	u64 ns;
+	u32 crc = 0;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		crc = fn(crc, buf, len);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start)) ? : 1;
+
+	/* bytes per ns * 1000 = MB/s */
+	pr_info("crc32: %-11s %5zu bytes: %6llu MB/s (%08x)\n", name, len,
+		div64_u64((u64)loops * len * 1000, ns), crc);
+}
+
+static void __init crc32_bench(unsigned char *buf)
+{
+	static const size_t lens[] __initconst = { 64, 512, PAGE_SIZE };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		crc32_bench_one("crc32_le", crc32_le, buf, lens[i]);
+		crc32_bench_one("crc32_be", crc32_be, buf, lens[i]);
+		crc32_bench_one("__crc32c_le", __crc32c_le, buf, lens[i]);
+	}
+}
+
+static int __init crc32_selftest(void)
+{
+	unsigned char *buf;
+	int err;
+
+	buf = kmalloc(PAGE_SIZE + 8, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	err = crc32_test(buf);
+	if (!err)
+		crc32_bench(buf);
+
+	kfree(buf);
+	return err;
+}
+
+static void __exit crc32_exit(void)
+{
+}
+
+module_init(crc32_selftest);
+module_exit(crc32_exit);
+#endif /* CONFIG_CRC32_SELFTEST */
 
 /*
  * A brief CRC tutorial.
@@ -0,0 +1,164 @@
+/*
+ * LZ4 decompressor for the Linux kernel and the pre-boot environment.
+ *
+ * Decompresses the legacy lz4 stream format, as written by "lz4c -l": a
+ * 4-byte magic number followed by blocks, each a 4-byte little endian
+ * compressed size and an LZ4 block of at most 8 MiB of data.  The stream
+ * has no end marker; it ends with the input, or with the 4-byte size that
+ * the kernel build appends to compressed kernel images.  Further magic
+ * numbers, from concatenated streams, are skipped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_LEGACY_MAGIC	0x184c2102
+#define LZ4_LEGACY_BLOCK_SIZE	(8 << 20)
+/* the header of a block, and the smallest block: a single token */
+#define LZ4_BLOCK_MIN		(4 + 1)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	u32 chunk;
+	size_t dst_len;
+	int size;
+	u8 *in_buf, *out_buf;
+	int ret = -1;
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_LEGACY_BLOCK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(lz4_compressbound(LZ4_LEGACY_BLOCK_SIZE));
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+	}
+
+	if (posp)
+		*posp = 0;
+
+	if (fill)
+		in_len = fill(in_buf, 4);
+	if (in_len < 4 || get_unaligned_le32(in_buf) != LZ4_LEGACY_MAGIC) {
+		error("invalid header");
+		goto exit_2;
+	}
+	if (!fill) {
+		in_buf += 4;
+		in_len -= 4;
+	}
+	if (posp)
+		*posp += 4;
+
+	for (;;) {
+		/* read compressed block size */
+		if (fill) {
+			in_len = fill(in_buf, 4);
+			if (in_len <= 0)
+				break;
+		} else if (in_len < LZ4_BLOCK_MIN) {
+			/* the end, or the size appended to kernel images */
+			break;
+		}
+		if (in_len < 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		chunk = get_unaligned_le32(in_buf);
+		/* zero padding after the last block ends the stream too */
+		if (chunk == 0)
+			break;
+		if (!fill) {
+			in_buf += 4;
+			in_len -= 4;
+		}
+		if (posp)
+			*posp += 4;
+		if (chunk == LZ4_LEGACY_MAGIC)
+			continue;
+
+		if (chunk > lz4_compressbound(LZ4_LEGACY_BLOCK_SIZE)) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		if (fill) {
+			size = fill(in_buf, chunk);
+			if (size < 0 || (u32)size < chunk) {
+				error("file corrupted");
+				goto exit_2;
+			}
+		} else if ((u32)in_len < chunk) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		/* decompress */
+		dst_len = LZ4_LEGACY_BLOCK_SIZE;
+		if (lz4_decompress_safe(in_buf, chunk, out_buf, &dst_len)) {
+			error("Compressed data violation");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, dst_len) != (int)dst_len)
+			goto exit_2;
+		if (output)
+			out_buf += dst_len;
+		if (posp)
+			*posp += chunk;
+
+		if (!fill) {
+			in_buf += chunk;
+			in_len -= chunk;
+		}
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,176 @@
+/*
+ *  LZ4 Compressor
+ *
+ *  Based on the LZ4 block format and compression algorithm by Yann Collet,
+ *  http://code.google.com/p/lz4/
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/bitops.h>
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+#include "lz4defs.h"
+
+static inline u32 lz4_hash(u32 seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/* how many of the low addressed bytes of two words are the same */
+static inline unsigned lz4_common_bytes(unsigned long diff)
+{
+#ifdef __BIG_ENDIAN
+	return (BITS_PER_LONG - 1 - __fls(diff)) >> 3;
+#else
+	return __ffs(diff) >> 3;
+#endif
+}
+
+/* length of the match at ip and ref, up to limit */
+static inline const unsigned char *lz4_count(const unsigned char *ip,
+					const unsigned char *ref,
+					const unsigned char *limit)
+{
+	unsigned long diff;
+
+	while (likely(ip < limit - (sizeof(long) - 1))) {
+		diff = lz4_read_word(ref) ^ lz4_read_word(ip);
+		if (diff)
+			return ip + lz4_common_bytes(diff);
+		ip += sizeof(long);
+		ref += sizeof(long);
+	}
+	while (ip < limit && *ref == *ip) {
+		ip++;
+		ref++;
+	}
+	return ip;
+}
+
+static inline unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		 unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *table = wrkmem;
+	const unsigned char *ip = src, *anchor = src, *ref;
+	const unsigned char * const iend = src + src_len;
+	const unsigned char * const mflimit = iend - MFLIMIT;
+	const unsigned char * const matchlimit = iend - LASTLITERALS;
+	unsigned char *op = dst, *token;
+	unsigned char * const oend = dst + *dst_len;
+	size_t len;
+	u32 h;
+
+	BUILD_BUG_ON(LZ4_HASH_SIZE * sizeof(u32) > LZ4_MEM_COMPRESS);
+	if (src_len < MINLENGTH)
+		goto last_literals;
+	memset(table, 0, LZ4_HASH_SIZE * sizeof(u32));
+
+	table[lz4_hash(lz4_read32(ip))] = 0;
+	ip++;
+
+	for (;;) {
+		unsigned attempts = (1U << LZ4_SKIP_TRIGGER) + 3;
+		const unsigned char *next = ip;
+
+		/* find a match, stepping faster through incompressible data */
+		do {
+			ip = next;
+			next = ip + (attempts++ >> LZ4_SKIP_TRIGGER);
+			if (unlikely(ip > mflimit))
+				goto last_literals;
+			h = lz4_hash(lz4_read32(ip));
+			ref = src + table[h];
+			table[h] = ip - src;
+		} while (ip - ref > MAX_DISTANCE ||
+			 lz4_read32(ref) != lz4_read32(ip));
+
+		/* extend backwards */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		/* literals: token, length, literals and offset */
+		len = ip - anchor;
+		if (unlikely((size_t)(oend - op) <
+			     1 + len / 255 + 1 + len + 2))
+			return -1;
+		token = op++;
+		if (len >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			op = lz4_put_length(op, len - RUN_MASK);
+		} else
+			*token = len << ML_BITS;
+		memcpy(op, anchor, len);
+		op += len;
+
+		for (;;) {
+			/* match */
+			put_unaligned_le16(ip - ref, op);
+			op += 2;
+			anchor = ip + MINMATCH;
+			ip = lz4_count(anchor, ref + MINMATCH, matchlimit);
+			len = ip - anchor;
+			/* length, and token and offset of a next match */
+			if (unlikely((size_t)(oend - op) < len / 255 + 1 + 3))
+				return -1;
+			if (len >= ML_MASK) {
+				*token += ML_MASK;
+				op = lz4_put_length(op, len - ML_MASK);
+			} else
+				*token += len;
+
+			anchor = ip;
+			if (ip > mflimit)
+				goto last_literals;
+
+			table[lz4_hash(lz4_read32(ip - 2))] = ip - 2 - src;
+
+			/* another match right away: no literals */
+			h = lz4_hash(lz4_read32(ip));
+			ref = src + table[h];
+			table[h] = ip - src;
+			if (ip - ref > MAX_DISTANCE ||
+			    lz4_read32(ref) != lz4_read32(ip))
+				break;
+			token = op++;
+			*token = 0;
+		}
+		ip++;
+	}
+
+last_literals:
+	len = iend - anchor;
+	if (unlikely((size_t)(oend - op) < 1 + len / 255 + 1 + len))
+		return -1;
+	if (len >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, len - RUN_MASK);
+	} else
+		*op++ = len << ML_BITS;
+	memcpy(op, anchor, len);
+	op += len;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
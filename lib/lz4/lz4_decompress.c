@@ -0,0 +1,146 @@
+/*
+ *  LZ4 Decompressor
+ *
+ *  Based on the LZ4 block format by Yann Collet,
+ *  http://code.google.com/p/lz4/
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+#include <linux/types.h>
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+#include "lz4defs.h"
+
+/*
+ * For a match less than 8 bytes back, i.e. a run of a repeated 1 to 7
+ * byte pattern: the smallest multiple of the distance that is at least 8.
+ */
+static const unsigned char lz4_run_dist[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+
+/* an extended length: bytes to add to it until one is not 255 */
+#define LZ4_GET_LENGTH(len)						\
+	do {								\
+		unsigned s;						\
+		do {							\
+			if (unlikely(ip >= iend))			\
+				goto error;				\
+			s = *ip++;					\
+			len += s;					\
+		} while (s == 255);					\
+	} while (0)
+
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len)
+{
+	const unsigned char *ip = src, *ref;
+	const unsigned char * const iend = src + src_len;
+	unsigned char *op = dst, *cpy;
+	unsigned char * const oend = dst + *dst_len;
+	size_t len, offset;
+	unsigned token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> ML_BITS;
+		if (len == RUN_MASK)
+			LZ4_GET_LENGTH(len);
+		if (unlikely(len > (size_t)(iend - ip) ||
+			     len > (size_t)(oend - op)))
+			goto error;
+		cpy = op + len;
+		if (likely((size_t)(iend - ip) - len >= 8 &&
+			   (size_t)(oend - op) - len >= 8)) {
+			/* may copy up to 7 bytes too many on either side */
+			do {
+				lz4_copy8(op, ip);
+				op += 8;
+				ip += 8;
+			} while (op < cpy);
+			ip -= op - cpy;
+			op = cpy;
+		} else {
+			/* the last literals, or close to the end of dst */
+			while (cpy - op >= 8) {
+				lz4_copy8(op, ip);
+				op += 8;
+				ip += 8;
+			}
+			while (op < cpy)
+				*op++ = *ip++;
+		}
+		/* only the last sequence has no match */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (unlikely(iend - ip < 2))
+			goto error;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(offset == 0 || offset > (size_t)(op - dst)))
+			goto error;
+		ref = op - offset;
+		len = token & ML_MASK;
+		if (len == ML_MASK)
+			LZ4_GET_LENGTH(len);
+		len += MINMATCH;
+		if (unlikely(len > (size_t)(oend - op)))
+			goto error;
+		cpy = op + len;
+		if (offset < 8 && likely((size_t)(oend - op) >= 8)) {
+			/*
+			 * A run: once the first 8 bytes are copied one at a
+			 * time, the pattern repeats from any multiple of
+			 * offset back.  op may pass cpy here, never oend.
+			 */
+			op[0] = ref[0];
+			op[1] = ref[1];
+			op[2] = ref[2];
+			op[3] = ref[3];
+			op[4] = ref[4];
+			op[5] = ref[5];
+			op[6] = ref[6];
+			op[7] = ref[7];
+			op += 8;
+			ref = op - lz4_run_dist[offset];
+		}
+		/* now ref is 8 or more bytes behind op, or less than 8 are left */
+		if (likely((size_t)(oend - cpy) >= 8)) {
+			while (op < cpy) {
+				lz4_copy8(op, ref);
+				op += 8;
+				ref += 8;
+			}
+		} else {
+			while (cpy - op >= 8) {
+				lz4_copy8(op, ref);
+				op += 8;
+				ref += 8;
+			}
+			while (op < cpy)
+				*op++ = *ref++;
+		}
+		op = cpy;
+	}
+
+	*dst_len = op - dst;
+	return 0;
+
+error:
+	return -1;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress_safe);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
@@ -0,0 +1,58 @@
+/*
+ *  lz4defs.h -- LZ4 format constants and unaligned access helpers
+ *
+ *  Based on the LZ4 block format by Yann Collet,
+ *  http://code.google.com/p/lz4/
+ */
+
+#define MINMATCH	4
+#define COPYLENGTH	8
+#define LASTLITERALS	5
+/* no match may start less than MFLIMIT bytes from the end */
+#define MFLIMIT		(COPYLENGTH + MINMATCH)
+#define MINLENGTH	(MFLIMIT + 1)
+#define MAX_DISTANCE	65535
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define LZ4_HASH_LOG	12
+#define LZ4_HASH_SIZE	(1U << LZ4_HASH_LOG)
+/* after 2^LZ4_SKIP_TRIGGER misses in a row, probe further apart */
+#define LZ4_SKIP_TRIGGER	6
+
+#if defined(__BIG_ENDIAN) && defined(__LITTLE_ENDIAN)
+#error "conflicting endian definitions"
+#endif
+
+/*
+ * Accesses through packed structs are single loads and stores where the
+ * CPU handles unaligned accesses, and byte accesses elsewhere; unlike
+ * ARM's get_unaligned(), which always goes a byte at a time.
+ */
+struct lz4_una_u32 { u32 x; } __attribute__((packed));
+struct lz4_una_ulong { unsigned long x; } __attribute__((packed));
+
+static inline u32 lz4_read32(const void *p)
+{
+	return ((const struct lz4_una_u32 *)p)->x;
+}
+
+static inline unsigned long lz4_read_word(const void *p)
+{
+	return ((const struct lz4_una_ulong *)p)->x;
+}
+
+static inline void lz4_copy8(void *dst, const void *src)
+{
+#if BITS_PER_LONG == 64
+	((struct lz4_una_ulong *)dst)->x =
+		((const struct lz4_una_ulong *)src)->x;
+#else
+	((struct lz4_una_u32 *)dst)->x = ((const struct lz4_una_u32 *)src)->x;
+	((struct lz4_una_u32 *)dst + 1)->x =
+		((const struct lz4_una_u32 *)src + 1)->x;
+#endif
+}
@@ -25,6 +25,14 @@
 #define NEED_OP(x)      if (!HAVE_OP(x)) goto output_overrun
 #define TEST_LB(m_pos)  if ((m_pos) < out) goto lookbehind_overrun
 
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+/*
+ * For a match less than 8 bytes back, i.e. a run of a repeated 1 to 7
+ * byte pattern: the smallest multiple of the distance that is at least 8.
+ */
+static const unsigned char lzo_run_dist[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+#endif
+
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			  unsigned char *out, size_t *out_len)
 {
@@ -181,6 +189,32 @@ copy_literal_run:
 					*op++ = *m_pos++;
 				} while (op < oe);
 			}
+		} else if (likely(HAVE_OP(t + 15))) {
+			unsigned char *oe = op + t;
+			size_t dist = op - m_pos;
+
+			/*
+			 * A run: once the first 8 bytes are copied one at a
+			 * time, the pattern repeats from any multiple of dist
+			 * back, so copy 8 bytes at a time from one that is at
+			 * least 8 back.
+			 */
+			op[0] = m_pos[0];
+			op[1] = m_pos[1];
+			op[2] = m_pos[2];
+			op[3] = m_pos[3];
+			op[4] = m_pos[4];
+			op[5] = m_pos[5];
+			op[6] = m_pos[6];
+			op[7] = m_pos[7];
+			op += 8;
+			m_pos = op - lzo_run_dist[dist];
+			while (op < oe) {
+				COPY8(op, m_pos);
+				op += 8;
+				m_pos += 8;
+			}
+			op = oe;
 		} else
 #endif
 		{
@@ -12,10 +12,23 @@
  */
 
 
+/*
+ * ARM does not select HAVE_EFFICIENT_UNALIGNED_ACCESS, but from ARMv6 on
+ * ldr and str take any address, so the word copy fast paths are turned
+ * on here for it. ldrd, ldm and their stores still fault on addresses
+ * that are not word aligned, and the compiler may merge two plain u32
+ * accesses into one of them, so each word is moved with its own ldr and
+ * str.
+ */
 #if 1 && defined(__arm__) && ((__LINUX_ARM_ARCH__ >= 6) || defined(__ARM_FEATURE_UNALIGNED))
 #define CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS 1
-#define COPY4(dst, src)	\
-		* (u32 *) (void *) (dst) = * (const u32 *) (const void *) (src)
+#define COPY4(dst, src)	do {						\
+		u32 __v;						\
+		asm volatile("ldr %0, %1" : "=r" (__v)			\
+			     : "m" (*(const u32 *)(const void *)(src)));	\
+		asm volatile("str %1, %0"				\
+			     : "=m" (*(u32 *)(void *)(dst)) : "r" (__v));	\
+	} while (0)
 #else
 #define COPY4(dst, src)	\
 		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
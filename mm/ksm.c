@@ -78,6 +78,12 @@
  *    take 10 attempts to find a page in the unstable tree, once it is found,
  *    it is secured in the stable tree.  (When we scan a new page, we first
  *    compare it against the stable tree, and then against the unstable tree.)
+ *
+ * Both trees are sorted by the hash of the pages first, and by their
+ * contents only among pages of equal hash: so walking down a tree mostly
+ * compares two integers, without touching the pages in the tree at all.
+ * The hash is taken over a sample of each page: enough to tell pages
+ * apart and notice most changes, for a fraction of the memory traffic.
  */
 
 /**
@@ -86,12 +92,18 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @merged: pages merged so far in this scan of the mm
+ * @backoff: full scans skipped between two scans of the mm, 2^n - 1
+ * @scanned: set once the mm has been scanned in full
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	unsigned long merged;
+	unsigned int backoff;
+	bool scanned;
 };
 
 /**
@@ -115,11 +127,13 @@ struct ksm_scan {
  * @node: rb node of this ksm page in the stable tree
  * @hlist: hlist head of rmap_items using this ksm page
  * @kpfn: page frame number of this ksm page
+ * @checksum: hash of this ksm page, its first key in the stable tree
  */
 struct stable_node {
 	struct rb_node node;
 	struct hlist_head hlist;
 	unsigned long kpfn;
+	u32 checksum;
 };
 
 /**
@@ -128,7 +142,8 @@ struct stable_node {
  * @anon_vma: pointer to anon_vma for this mm,address, when in stable tree
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
- * @oldchecksum: previous checksum of the page at that virtual address
+ * @oldchecksum: previous checksum of the page at that virtual address,
+ *	its first key in the unstable tree
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -151,6 +166,7 @@ struct rmap_item {
 #define SEQNR_MASK	0x0ff	/* low bits of unstable tree seqnr */
 #define UNSTABLE_FLAG	0x100	/* is a node of the unstable tree */
 #define STABLE_FLAG	0x200	/* is listed from the stable tree */
+#define ZERO_FLAG	0x400	/* was replaced by the zero page */
 
 /* The stable and unstable tree heads */
 static struct rb_root root_stable_tree = RB_ROOT;
@@ -189,6 +205,32 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Percent of a CPU ksmd may use, instead of sleep_millisecs if not 0 */
+static unsigned int ksm_thread_cpu_budget;
+
+/* The number of page slots merged into ksm pages since boot */
+static unsigned long ksm_pages_merged;
+
+/* The number of pages replaced by the zero page since boot */
+static unsigned long ksm_zero_pages_merged;
+
+/* Whether to map pages found to be all zeroes to the zero page */
+static unsigned int ksm_use_zero_pages = 1;
+
+/* checksum of an all-zero page, see calc_checksum() */
+static u32 zero_checksum __read_mostly;
+
+/*
+ * Most full scans an mm that merged nothing may be skipped, going from
+ * one to 3, 7... each time it still merges nothing; 0 scans every mm
+ * every time. Bounded below SEQNR_MASK by KSM_MAX_SKIP_SCANS.
+ */
+#define KSM_MAX_SKIP_SCANS	31
+static unsigned int ksm_max_skip_scans = 7;
+
+/* CPU time ksmd spent scanning, in nanoseconds */
+static unsigned long long ksm_scan_cpu_ns;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -247,6 +289,7 @@ static inline struct rmap_item *alloc_rmap_item(void)
 static inline void free_rmap_item(struct rmap_item *rmap_item)
 {
 	ksm_rmap_items--;
+	rmap_item->mm->ksm_rmap_items--;
 	rmap_item->mm = NULL;	/* debug safety */
 	kmem_cache_free(rmap_item_cache, rmap_item);
 }
@@ -453,6 +496,7 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
@@ -540,6 +584,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -554,12 +599,16 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 		 * than left over from before.
 		 */
 		age = (unsigned char)(ksm_scan.seqnr - rmap_item->address);
-		BUG_ON(age > 1);
+		BUG_ON(age > KSM_MAX_SKIP_SCANS + 1);
 		if (!age)
 			rb_erase(&rmap_item->node, &root_unstable_tree);
 
 		ksm_pages_unshared--;
 		rmap_item->address &= PAGE_MASK;
+
+	} else if (rmap_item->address & ZERO_FLAG) {
+		rmap_item->mm->ksm_zero_merged--;
+		rmap_item->address &= PAGE_MASK;
 	}
 out:
 	cond_resched();		/* we're called from many long loops */
@@ -669,13 +718,24 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * Words hashed by calc_checksum(): one per cache line of 64 bytes at a
+ * different offset in each, so as to catch counters and such at the
+ * start of a structure as well as changes in the middle of a line.
+ */
+#define KSM_HASH_SAMPLE		64
+#define KSM_HASH_STRIDE		(PAGE_SIZE / 4 / KSM_HASH_SAMPLE)
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	u32 sample[KSM_HASH_SAMPLE];
+	u32 *addr = kmap_atomic(page, KM_USER0);
+	int i;
+
+	for (i = 0; i < KSM_HASH_SAMPLE; i++)
+		sample[i] = addr[i * KSM_HASH_STRIDE + i % KSM_HASH_STRIDE];
 	kunmap_atomic(addr, KM_USER0);
-	return checksum;
+	return jhash2(sample, KSM_HASH_SAMPLE, 17);
 }
 
 static int memcmp_pages(struct page *page1, struct page *page2)
@@ -756,7 +816,7 @@ out:
  * replace_page - replace page in vma by new ksm page
  * @vma:      vma that holds the pte pointing to page
  * @page:     the page we are replacing by kpage
- * @kpage:    the ksm page we replace page by
+ * @kpage:    the ksm page we replace page by, or the zero page
  * @orig_pte: the original value of the pte
  *
  * Returns 0 on success, -EFAULT on failure.
@@ -769,6 +829,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -796,12 +857,20 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (kpage != ZERO_PAGE(addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/* mapped like do_anonymous_page() does on a read fault */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -943,6 +1012,42 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - replace an all-zero page by the zero page,
+ * without a ksm page or a node in the trees: a write fault then gives
+ * the address a page of its own again, as after a read fault on memory
+ * never written to. Mlocked pages are left alone.
+ *
+ * This function returns 0 if the page was replaced, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page,
+				    ZERO_PAGE(rmap_item->address));
+	if (!err) {
+		rmap_item->address |= ZERO_FLAG;
+		ksm_zero_pages_merged++;
+		mm->ksm_zero_merged++;
+	}
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -983,7 +1088,7 @@ static struct page *try_to_merge_two_pages(struct rmap_item *rmap_item,
  * This function returns the stable tree node of identical content if found,
  * NULL otherwise.
  */
-static struct page *stable_tree_search(struct page *page)
+static struct page *stable_tree_search(struct page *page, u32 checksum)
 {
 	struct rb_node *node = root_stable_tree.rb_node;
 	struct stable_node *stable_node;
@@ -1000,6 +1105,14 @@ static struct page *stable_tree_search(struct page *page)
 
 		cond_resched();
 		stable_node = rb_entry(node, struct stable_node, node);
+		if (checksum != stable_node->checksum) {
+			if (checksum < stable_node->checksum)
+				node = node->rb_left;
+			else
+				node = node->rb_right;
+			continue;
+		}
+
 		tree_page = get_ksm_page(stable_node);
 		if (!tree_page)
 			return NULL;
@@ -1031,6 +1144,10 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	struct rb_node **new = &root_stable_tree.rb_node;
 	struct rb_node *parent = NULL;
 	struct stable_node *stable_node;
+	u32 checksum;
+
+	/* kpage is write-protected by now, unlike when it was scanned */
+	checksum = calc_checksum(kpage);
 
 	while (*new) {
 		struct page *tree_page;
@@ -1038,6 +1155,15 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 
 		cond_resched();
 		stable_node = rb_entry(*new, struct stable_node, node);
+		if (checksum != stable_node->checksum) {
+			parent = *new;
+			if (checksum < stable_node->checksum)
+				new = &parent->rb_left;
+			else
+				new = &parent->rb_right;
+			continue;
+		}
+
 		tree_page = get_ksm_page(stable_node);
 		if (!tree_page)
 			return NULL;
@@ -1070,6 +1196,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	INIT_HLIST_HEAD(&stable_node->hlist);
 
 	stable_node->kpfn = page_to_pfn(kpage);
+	stable_node->checksum = checksum;
 	set_page_stable_node(kpage, stable_node);
 
 	return stable_node;
@@ -1087,7 +1214,8 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
  * to the currently scanned page, NULL otherwise.
  *
  * This function does both searching and inserting, because they share
- * the same walking algorithm in an rbtree.
+ * the same walking algorithm in an rbtree. The key of rmap_item is its
+ * oldchecksum, just found to be the checksum of page.
  */
 static
 struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
@@ -1105,6 +1233,15 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 
 		cond_resched();
 		tree_rmap_item = rb_entry(*new, struct rmap_item, node);
+		if (rmap_item->oldchecksum != tree_rmap_item->oldchecksum) {
+			parent = *new;
+			if (rmap_item->oldchecksum < tree_rmap_item->oldchecksum)
+				new = &parent->rb_left;
+			else
+				new = &parent->rb_right;
+			continue;
+		}
+
 		tree_page = get_mergeable_page(tree_rmap_item);
 		if (IS_ERR_OR_NULL(tree_page))
 			return NULL;
@@ -1152,10 +1289,12 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 	rmap_item->head = stable_node;
 	rmap_item->address |= STABLE_FLAG;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
+	rmap_item->mm->ksm_merging_pages++;
 
-	if (rmap_item->hlist.next)
+	if (rmap_item->hlist.next) {
 		ksm_pages_sharing++;
-	else
+		ksm_pages_merged++;
+	} else
 		ksm_pages_shared++;
 }
 
@@ -1179,8 +1318,10 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	checksum = calc_checksum(page);
+
 	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
+	kpage = stable_tree_search(page, checksum);
 	if (kpage) {
 		err = try_to_merge_with_ksm_page(rmap_item, page, kpage);
 		if (!err) {
@@ -1191,6 +1332,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
+			ksm_scan.mm_slot->merged++;
 		}
 		put_page(kpage);
 		return;
@@ -1202,12 +1344,18 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
 	}
 
+	/* All zeroes: share the zero page rather than a ksm page */
+	if (ksm_use_zero_pages && checksum == zero_checksum &&
+	    !try_to_merge_zero_page(rmap_item, page)) {
+		ksm_scan.mm_slot->merged++;
+		return;
+	}
+
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
 	if (tree_rmap_item) {
@@ -1227,6 +1375,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
+				ksm_scan.mm_slot->merged++;
 			}
 			unlock_page(kpage);
 
@@ -1265,6 +1414,7 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	if (rmap_item) {
 		/* It has already been zeroed */
 		rmap_item->mm = mm_slot->mm;
+		rmap_item->mm->ksm_rmap_items++;
 		rmap_item->address = addr;
 		rmap_item->rmap_list = *rmap_list;
 		*rmap_list = rmap_item;
@@ -1272,6 +1422,72 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Steps the scan over the rmap_item of an address still mapping the zero
+ * page it was merged into, freeing older ones as get_next_rmap_item()
+ * does: so the mm stays charged with it in ksm_zero_merged until the
+ * address is written to or unmapped.
+ */
+static void scan_keep_zero_rmap_item(unsigned long addr)
+{
+	struct rmap_item *rmap_item;
+
+	while ((rmap_item = *ksm_scan.rmap_list)) {
+		if ((rmap_item->address & PAGE_MASK) == addr) {
+			if (rmap_item->address & ZERO_FLAG)
+				ksm_scan.rmap_list = &rmap_item->rmap_list;
+			return;
+		}
+		if (rmap_item->address > addr)
+			return;
+		*ksm_scan.rmap_list = rmap_item->rmap_list;
+		remove_rmap_item_from_tree(rmap_item);
+		free_rmap_item(rmap_item);
+	}
+}
+
+/*
+ * Updates how many full scans the mm of @slot sits out between two of
+ * its own, after a scan of it that merged @slot->merged pages: none
+ * while it merges, then 1, 3, 7... up to max_skip_scans while it does
+ * not. The first scan of an mm only takes checksums and never counts.
+ */
+static void ksm_slot_scanned(struct mm_slot *slot)
+{
+	unsigned int max_skip = ACCESS_ONCE(ksm_max_skip_scans);
+
+	if (!slot->scanned)
+		slot->scanned = true;
+	else if (slot->merged || !max_skip)
+		slot->backoff = 0;
+	else if (slot->backoff * 2 + 1 <= max_skip)
+		slot->backoff = slot->backoff * 2 + 1;
+	else
+		while (slot->backoff > max_skip)	/* max_skip was lowered */
+			slot->backoff >>= 1;
+	slot->merged = 0;
+}
+
+/*
+ * Moves the scan cursor from @slot over the mm_slots sitting this full
+ * scan out, and returns the first one to scan, or ksm_mm_head. An mm is
+ * scanned when seqnr is a multiple of backoff + 1, a power of two: all
+ * the mms backed off alike come up in the same full scans and so meet
+ * in the unstable tree. Only the slot under the cursor is safe from
+ * __ksm_exit(), so the cursor is moved along with each step.
+ */
+static struct mm_slot *ksm_skip_slots(struct mm_slot *slot)
+{
+	while (slot != &ksm_mm_head && (ksm_scan.seqnr & slot->backoff) &&
+	       !ksm_test_exit(slot->mm)) {
+		spin_lock(&ksm_mmlist_lock);
+		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		ksm_scan.mm_slot = slot;
+		spin_unlock(&ksm_mmlist_lock);
+	}
+	return slot;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1308,6 +1524,12 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		 */
 		if (slot == &ksm_mm_head)
 			return NULL;
+		slot = ksm_skip_slots(slot);
+		if (slot == &ksm_mm_head) {
+			/* every mm sat this one out */
+			ksm_scan.seqnr++;
+			return NULL;
+		}
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
@@ -1352,6 +1574,8 @@ next_mm:
 				up_read(&mm->mmap_sem);
 				return rmap_item;
 			}
+			if (*page == ZERO_PAGE(ksm_scan.address))
+				scan_keep_zero_rmap_item(ksm_scan.address);
 			put_page(*page);
 			ksm_scan.address += PAGE_SIZE;
 			cond_resched();
@@ -1367,6 +1591,7 @@ next_mm:
 	 * because there were no VM_MERGEABLE vmas with such addresses.
 	 */
 	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
+	ksm_slot_scanned(slot);
 
 	spin_lock(&ksm_mmlist_lock);
 	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
@@ -1395,7 +1620,7 @@ next_mm:
 	}
 
 	/* Repeat until we've completed scanning the whole list */
-	slot = ksm_scan.mm_slot;
+	slot = ksm_skip_slots(ksm_scan.mm_slot);
 	if (slot != &ksm_mm_head)
 		goto next_mm;
 
@@ -1428,22 +1653,55 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * Time to sleep after a batch that took @cpu_ns of CPU, so as to keep
+ * ksmd within cpu_budget percent of a CPU, or sleep_millisecs without.
+ * Sleeps shorter than a jiffy are owed in @owed_ns until they add up.
+ */
+static unsigned long ksmd_sleep_jiffies(u64 cpu_ns, u64 *owed_ns)
+{
+	unsigned int budget = ACCESS_ONCE(ksm_thread_cpu_budget);
+	unsigned long sleep;
+	u64 slept_ns;
+
+	if (!budget) {
+		*owed_ns = 0;
+		return msecs_to_jiffies(ksm_thread_sleep_millisecs);
+	}
+
+	cpu_ns *= 100 - budget;
+	do_div(cpu_ns, budget);
+	*owed_ns += cpu_ns;
+	sleep = nsecs_to_jiffies(*owed_ns);
+	slept_ns = (u64)jiffies_to_usecs(sleep) * NSEC_PER_USEC;
+	*owed_ns = *owed_ns > slept_ns ? *owed_ns - slept_ns : 0;
+	return sleep;
+}
+
 static int ksm_scan_thread(void *nothing)
 {
+	unsigned long long start;
+	u64 cpu_ns, owed_ns = 0;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
+		cpu_ns = 0;
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
+		if (ksmd_should_run()) {
+			start = task_sched_runtime(current);
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			cpu_ns = task_sched_runtime(current) - start;
+			ksm_scan_cpu_ns += cpu_ns;
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				ksmd_sleep_jiffies(cpu_ns, &owed_ns));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1872,6 +2130,75 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t cpu_budget_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_cpu_budget);
+}
+
+static ssize_t cpu_budget_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long percent;
+	int err;
+
+	err = strict_strtoul(buf, 10, &percent);
+	if (err || percent > 100)
+		return -EINVAL;
+
+	ksm_thread_cpu_budget = percent;
+
+	return count;
+}
+KSM_ATTR(cpu_budget);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = value;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t max_skip_scans_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_max_skip_scans);
+}
+
+static ssize_t max_skip_scans_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long scans;
+	int err;
+
+	err = strict_strtoul(buf, 10, &scans);
+	if (err || scans > KSM_MAX_SKIP_SCANS)
+		return -EINVAL;
+
+	ksm_max_skip_scans = scans;
+
+	return count;
+}
+KSM_ATTR(max_skip_scans);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1966,15 +2293,61 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
+static ssize_t scan_cpu_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	unsigned long long msecs = ksm_scan_cpu_ns;
+
+	do_div(msecs, NSEC_PER_MSEC);
+	return sprintf(buf, "%llu\n", msecs);
+}
+KSM_ATTR_RO(scan_cpu_msecs);
+
+static ssize_t merged_per_cpu_sec_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	unsigned long long msecs = ksm_scan_cpu_ns;
+	unsigned long long rate;
+
+	do_div(msecs, NSEC_PER_MSEC);
+	if (!msecs)
+		return sprintf(buf, "0\n");
+	rate = (unsigned long long)ksm_pages_merged * MSEC_PER_SEC;
+	do_div(rate, msecs);
+	return sprintf(buf, "%llu\n", rate);
+}
+KSM_ATTR_RO(merged_per_cpu_sec);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&cpu_budget_attr.attr,
+	&use_zero_pages_attr.attr,
+	&max_skip_scans_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&zero_pages_merged_attr.attr,
+	&scan_cpu_msecs_attr.attr,
+	&merged_per_cpu_sec_attr.attr,
 	NULL,
 };
 
@@ -1993,6 +2366,8 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
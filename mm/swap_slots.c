@@ -0,0 +1,204 @@
+/*
+ * mm/swap_slots.c
+ *
+ * Copyright (C) ST-Ericsson SA 2011
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * Per-cpu caches of swap slots.
+ *
+ * Every swap entry allocated for the swap cache and every one freed took
+ * swap_lock, which with a swap device as fast as zram is what reclaim
+ * on several CPUs ends up waiting for. Instead, each CPU takes swap
+ * entries SWAP_SLOTS_CACHE_SIZE at a time from get_swap_pages() and
+ * hands them out from its cache, and collects the entries whose last
+ * user went away to free them SWAP_SLOTS_CACHE_SIZE at a time.
+ *
+ * Slots in the caches look allocated to the rest of the swap code: with
+ * only SWAP_HAS_CACHE set in the swap map and no page in the swap cache.
+ * So the caches are only used while there is enough free swap that
+ * holding back up to 2 * SWAP_SLOTS_CACHE_SIZE slots per CPU does not
+ * matter, and are emptied for swapoff.
+ */
+
+#include <linux/swap_slots.h>
+#include <linux/cpu.h>
+#include <linux/percpu.h>
+#include <linux/module.h>
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+
+/* serializes enabling/disabling and activation of the caches */
+static DEFINE_MUTEX(swap_slots_cache_mutex);
+/* false before init and while any swapoff is in try_to_unuse() */
+bool swap_slot_cache_enabled;
+/* disable_swap_slots_cache() calls not yet undone, one until init */
+static int swap_slot_cache_disabled = 1;
+/* false when free swap is short */
+static bool swap_slot_cache_active;
+
+#define use_swap_slot_cache (swap_slot_cache_active && swap_slot_cache_enabled)
+
+static void drain_slots_cache_cpu(unsigned int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+	mutex_lock(&cache->alloc_lock);
+	if (cache->nr) {
+		swapcache_free_entries(cache->slots + cache->cur, cache->nr);
+		cache->cur = 0;
+		cache->nr = 0;
+	}
+	mutex_unlock(&cache->alloc_lock);
+
+	spin_lock(&cache->free_lock);
+	if (cache->n_ret) {
+		swapcache_free_entries(cache->slots_ret, cache->n_ret);
+		cache->n_ret = 0;
+	}
+	spin_unlock(&cache->free_lock);
+}
+
+/*
+ * Called with the CPU hotplug lock and then swap_slots_cache_mutex held,
+ * in that order, after the caches are turned off, so that nothing is
+ * added to a cache once it is drained.
+ */
+static void drain_slots_cache(void)
+{
+	unsigned int cpu;
+
+	for_each_online_cpu(cpu)
+		drain_slots_cache_cpu(cpu);
+}
+
+void disable_swap_slots_cache(void)
+{
+	get_online_cpus();
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slot_cache_disabled++;
+	swap_slot_cache_enabled = false;
+	swap_slot_cache_active = false;
+	drain_slots_cache();
+	mutex_unlock(&swap_slots_cache_mutex);
+	put_online_cpus();
+}
+
+/*
+ * Swapoffs can overlap, so the caches only come back on when the last
+ * one that turned them off is done with try_to_unuse().
+ */
+void enable_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	if (!WARN_ON(swap_slot_cache_disabled <= 0) &&
+	    !--swap_slot_cache_disabled)
+		swap_slot_cache_enabled = true;
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+/* Turns the caches on or off by how much swap is free */
+static bool check_cache_active(void)
+{
+	long pages;
+
+	if (!swap_slot_cache_enabled)
+		return false;
+
+	pages = nr_swap_pages;
+	if (!swap_slot_cache_active) {
+		if (pages > num_online_cpus() *
+		    THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE) {
+			mutex_lock(&swap_slots_cache_mutex);
+			if (swap_slot_cache_enabled)
+				swap_slot_cache_active = true;
+			mutex_unlock(&swap_slots_cache_mutex);
+		}
+	} else if (pages < num_online_cpus() *
+		   THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE) {
+		get_online_cpus();
+		mutex_lock(&swap_slots_cache_mutex);
+		swap_slot_cache_active = false;
+		drain_slots_cache();
+		mutex_unlock(&swap_slots_cache_mutex);
+		put_online_cpus();
+	}
+
+	return swap_slot_cache_active;
+}
+
+/*
+ * Called after the last user of @entry has gone away, with swap_lock
+ * dropped: frees @entry with the next batch of this CPU.
+ */
+void free_swap_slot(swp_entry_t entry)
+{
+	struct swap_slots_cache *cache;
+
+	/* migrating to another CPU afterwards is fine, the lock is held */
+	cache = __this_cpu_ptr(&swp_slots);
+	spin_lock(&cache->free_lock);
+	if (use_swap_slot_cache) {
+		if (cache->n_ret >= SWAP_SLOTS_CACHE_SIZE) {
+			swapcache_free_entries(cache->slots_ret, cache->n_ret);
+			cache->n_ret = 0;
+		}
+		cache->slots_ret[cache->n_ret++] = entry;
+		spin_unlock(&cache->free_lock);
+		return;
+	}
+	spin_unlock(&cache->free_lock);
+
+	swapcache_free_entries(&entry, 1);
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	if (check_cache_active()) {
+		cache = __this_cpu_ptr(&swp_slots);
+		mutex_lock(&cache->alloc_lock);
+		if (use_swap_slot_cache) {
+			if (!cache->nr) {
+				cache->cur = 0;
+				cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE,
+							   cache->slots);
+			}
+			if (cache->nr) {
+				entry = cache->slots[cache->cur++];
+				cache->nr--;
+				mutex_unlock(&cache->alloc_lock);
+				return entry;
+			}
+		}
+		mutex_unlock(&cache->alloc_lock);
+	}
+
+	get_swap_pages(1, &entry);
+	return entry;
+}
+
+static int __cpuinit swap_slots_cpu_callback(struct notifier_block *nfb,
+			unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_slots_cache_cpu((unsigned long)hcpu);
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_init(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+		mutex_init(&cache->alloc_lock);
+		spin_lock_init(&cache->free_lock);
+	}
+	hotcpu_notifier(swap_slots_cpu_callback, 0);
+	enable_swap_slots_cache();
+	return 0;
+}
+module_init(swap_slots_init);
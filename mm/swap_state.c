@@ -19,6 +19,9 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/swap_slots.h>
+#include <linux/blkdev.h>
+#include <linux/log2.h>
 
 #include <asm/pgtable.h>
 
@@ -133,6 +136,9 @@ void __delete_from_swap_cache(struct page *page)
 	total_swapcache_pages--;
 	__dec_zone_page_state(page, NR_FILE_PAGES);
 	INC_CACHE_INFO(del_total);
+	/* read ahead and never faulted in */
+	if (TestClearPageReadahead(page))
+		__count_vm_event(SWAP_RA_MISS);
 }
 
 /**
@@ -254,20 +260,76 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * VMA based swap readahead
+ *
+ * Slots next to each other in the swap area were often written out
+ * together, but on a fast device like zram there is no seek to save, and
+ * reading them only pays off if they are faulted in soon. So when a page
+ * is faulted from swap, the swap entries of its virtual neighbours in
+ * the VMA are read instead, and how far depends on how well that worked
+ * for the VMA so far: each VMA keeps the address of its last swap fault,
+ * the window used then and how many of the pages read ahead have been
+ * hit since, packed in one word.
+ */
+int sysctl_swap_vma_readahead __read_mostly = 1;
+
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Largest window, whatever page_cluster says, to bound the pte copy */
+#define SWAP_RA_MAX_ORDER	5
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * @vma and @addr, if known, are the faulting user mapping and address:
+ * a page found there that was read ahead counts as a readahead hit of
+ * the VMA.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			unsigned long addr)
 {
 	struct page *page;
+	int readahead = 0;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* under writeback the flag means PG_reclaim */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			readahead = 1;
+		}
+	}
+
+	if (page && vma && sysctl_swap_vma_readahead) {
+		unsigned long ra_val;
+		unsigned long win, hits;
+
+		ra_val = atomic_long_read(&vma->swap_readahead_info);
+		win = SWAP_RA_WIN(ra_val);
+		hits = SWAP_RA_HITS(ra_val);
+		if (readahead && hits < SWAP_RA_HITS_MAX)
+			hits++;
+		atomic_long_set(&vma->swap_readahead_info,
+				SWAP_RA_VAL(addr, win, hits));
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -279,12 +341,14 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			int *new_page_read)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_read = 0;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -311,6 +375,15 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		if (err)
 			break;
 
+		/*
+		 * A slot without users is one being allocated or freed, or
+		 * one sitting in a per-cpu slot cache, where it can stay a
+		 * while: swapcache_prepare() would fail with -EEXIST until
+		 * then. Swapoff disables the caches and has to wait instead.
+		 */
+		if (!__swp_swapcount(entry) && swap_slot_cache_enabled)
+			break;
+
 		/*
 		 * Swap entry may have been freed since our caller observed it.
 		 */
@@ -335,6 +408,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_read = 1;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -352,6 +426,42 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	int new_page_read;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+}
+
+/*
+ * Starts reading @entry. If it is read @ahead of its use, the page is
+ * marked so that a later fault on it counts as a hit. Returns 0 if out
+ * of memory.
+ */
+static int swap_readahead_one(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			int ahead)
+{
+	struct page *page;
+	int new_page_read;
+
+	/* nothing to read from a free slot */
+	if (!__swp_swapcount(entry))
+		return 1;
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+	if (!page)
+		return 0;
+	if (new_page_read && ahead) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+	return 1;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -375,7 +485,6 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	int nr_pages;
-	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
 
@@ -389,12 +498,128 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (!swap_readahead_one(swp_entry(swp_type(entry), offset),
+					gfp_mask, vma, addr,
+					offset != swp_offset(entry)))
+			break;
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
+
+/*
+ * Next readahead window of a VMA: it grows with the pages of the last
+ * window that were hit, and two faults in a row on neighbouring pages
+ * read two pages even without hits. It shrinks by half at most per
+ * fault, so that one random access does not undo a sequential run.
+ */
+static unsigned int swap_ra_window(unsigned long prev_pfn, unsigned long pfn,
+			unsigned int hits, unsigned int max_win,
+			unsigned int prev_win)
+{
+	unsigned int win;
+
+	win = hits + 2;
+	if (win == 2) {
+		if (pfn != prev_pfn + 1 && pfn != prev_pfn - 1)
+			win = 1;
+	} else {
+		win = roundup_pow_of_two(win);
+	}
+
+	if (win > max_win)
+		win = max_win;
+	if (win < prev_win / 2)
+		win = prev_win / 2;
+
+	return win;
+}
+
+/**
+ * swap_vma_readahead - swap in a page and its virtual neighbours
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: faulting address
+ * @pmd: pmd of @addr
+ *
+ * Returns the struct page for entry and addr, after queueing the read of
+ * the swapped out pages around @addr, within @vma and the page table of
+ * @addr. The window follows the direction of the faults and adapts to
+ * the readahead hits of the VMA, see swap_ra_window(). Falls back to
+ * swapin_readahead() if disabled by vm.swap_vma_readahead.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[1 << SWAP_RA_MAX_ORDER];
+	unsigned long ra_val, pfn, prev_pfn, start, end, left;
+	unsigned int max_win, win, prev_win, hits, i, nr;
+	struct blk_plug plug;
+	pte_t *pte;
+
+	if (!sysctl_swap_vma_readahead)
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+
+	max_win = 1 << min(page_cluster, SWAP_RA_MAX_ORDER);
+	pfn = PFN_DOWN(addr);
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	prev_pfn = PFN_DOWN(SWAP_RA_ADDR(ra_val));
+	prev_win = SWAP_RA_WIN(ra_val);
+	hits = SWAP_RA_HITS(ra_val);
+
+	win = max_win > 1 ?
+		swap_ra_window(prev_pfn, pfn, hits, max_win, prev_win) : 1;
+	atomic_long_set(&vma->swap_readahead_info,
+			SWAP_RA_VAL(addr, win, 0));
+	if (win == 1)
+		goto skip;
+
+	/* ahead of the faults in their direction, around them otherwise */
+	if (pfn == prev_pfn + 1)
+		left = 0;
+	else if (pfn == prev_pfn - 1)
+		left = win - 1;
+	else
+		left = (win - 1) / 2;
+
+	start = max(PFN_DOWN(vma->vm_start), PFN_DOWN(addr & PMD_MASK));
+	if (pfn - start > left)
+		start = pfn - left;
+	end = min3(pfn - left + win, PFN_DOWN(vma->vm_end),
+		   PFN_DOWN((addr & PMD_MASK) + PMD_SIZE));
+	nr = end - start;
+
+	/* a snapshot: the entries are checked again when read */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		swp_entry_t ra_entry;
+
+		if (start + i == pfn) {
+			ra_entry = entry;
+		} else {
+			if (pte_none(ptes[i]) || pte_present(ptes[i]) ||
+			    pte_file(ptes[i]))
+				continue;
+			ra_entry = pte_to_swp_entry(ptes[i]);
+			if (unlikely(non_swap_entry(ra_entry)))
+				continue;
+		}
+		if (!swap_readahead_one(ra_entry, gfp_mask, vma,
+					(start + i) << PAGE_SHIFT,
+					start + i != pfn))
 			break;
-		page_cache_release(page);
 	}
+	blk_finish_plug(&plug);
 	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
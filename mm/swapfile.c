@@ -36,6 +36,7 @@
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
 #include <linux/swapops.h>
+#include <linux/swap_slots.h>
 #include <linux/page_cgroup.h>
 
 static bool swap_count_continued(struct swap_info_struct *, pgoff_t,
@@ -409,14 +410,14 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/* Called with swap_lock held, which scan_swap_map() may drop for a while */
+static swp_entry_t __get_swap_page(void)
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
 
-	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
 	nr_swap_pages--;
@@ -438,19 +439,34 @@ swp_entry_t get_swap_page(void)
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
 		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
+		if (offset)
 			return swp_entry(type, offset);
-		}
 		next = swap_list.next;
 	}
 
 	nr_swap_pages++;
 noswap:
-	spin_unlock(&swap_lock);
 	return (swp_entry_t) {0};
 }
 
+/*
+ * Allocates up to @n swap entries for the swap cache into @entries, all
+ * under one hold of swap_lock. Returns how many were allocated.
+ */
+int get_swap_pages(int n, swp_entry_t entries[])
+{
+	int i;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < n; i++) {
+		entries[i] = __get_swap_page();
+		if (!entries[i].val)
+			break;
+	}
+	spin_unlock(&swap_lock);
+	return i;
+}
+
 /* The only caller of this function is now susupend routine */
 swp_entry_t get_swap_page_of_type(int type)
 {
@@ -543,28 +559,72 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 		mem_cgroup_uncharge_swap(entry);
 
 	usage = count | has_cache;
-	p->swap_map[offset] = usage;
-
-	/* free if no reference */
-	if (!usage) {
-		struct gendisk *disk = p->bdev->bd_disk;
-		if (offset < p->lowest_bit)
-			p->lowest_bit = offset;
-		if (offset > p->highest_bit)
-			p->highest_bit = offset;
-		if (swap_list.next >= 0 &&
-		    p->prio > swap_info[swap_list.next]->prio)
-			swap_list.next = p->type;
-		nr_swap_pages++;
-		p->inuse_pages--;
-		if ((p->flags & SWP_BLKDEV) &&
-				disk->fops->swap_slot_free_notify)
-			disk->fops->swap_slot_free_notify(p->bdev, offset);
-	}
+
+	/*
+	 * With no reference left, the slot is kept busy by the cache bit
+	 * until the caller hands it to free_swap_slot() with swap_lock
+	 * dropped, for it to be freed in a batch.
+	 */
+	p->swap_map[offset] = usage ? usage : SWAP_HAS_CACHE;
 
 	return usage;
 }
 
+/* Called with swap_lock held */
+static void swap_slot_free(struct swap_info_struct *p, unsigned long offset)
+{
+	struct gendisk *disk = p->bdev->bd_disk;
+
+	VM_BUG_ON(p->swap_map[offset] != SWAP_HAS_CACHE);
+	p->swap_map[offset] = 0;
+	if (offset < p->lowest_bit)
+		p->lowest_bit = offset;
+	if (offset > p->highest_bit)
+		p->highest_bit = offset;
+	if (swap_list.next >= 0 &&
+	    p->prio > swap_info[swap_list.next]->prio)
+		swap_list.next = p->type;
+	nr_swap_pages++;
+	p->inuse_pages--;
+	if ((p->flags & SWP_BLKDEV) &&
+			disk->fops->swap_slot_free_notify)
+		disk->fops->swap_slot_free_notify(p->bdev, offset);
+}
+
+/*
+ * Frees @n swap entries left with only SWAP_HAS_CACHE and no page in the
+ * swap cache: unused ones from get_swap_pages(), or ones that the last
+ * swap_free() or swapcache_free() passed to free_swap_slot().
+ */
+void swapcache_free_entries(swp_entry_t *entries, int n)
+{
+	int i;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < n; i++)
+		swap_slot_free(swap_info[swp_type(entries[i])],
+			       swp_offset(entries[i]));
+	spin_unlock(&swap_lock);
+}
+
+/*
+ * Number of users of a swap entry, without SWAP_HAS_CACHE, read without
+ * swap_lock: racy unless the caller holds a reference.
+ */
+int __swp_swapcount(swp_entry_t entry)
+{
+	struct swap_info_struct *p;
+	unsigned long type = swp_type(entry);
+	unsigned long offset = swp_offset(entry);
+
+	if (type >= nr_swapfiles)
+		return 0;
+	p = swap_info[type];
+	if (!(p->flags & SWP_USED) || offset >= p->max)
+		return 0;
+	return swap_count(p->swap_map[offset]);
+}
+
 /*
  * Caller has made sure that the swapdevice corresponding to entry
  * is still around or has not been recycled.
@@ -572,11 +632,14 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 void swap_free(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
+	unsigned char usage;
 
 	p = swap_info_get(entry);
 	if (p) {
-		swap_entry_free(p, entry, 1);
+		usage = swap_entry_free(p, entry, 1);
 		spin_unlock(&swap_lock);
+		if (!usage)
+			free_swap_slot(entry);
 	}
 }
 
@@ -594,6 +657,8 @@ void swapcache_free(swp_entry_t entry, struct page *page)
 		if (page)
 			mem_cgroup_uncharge_swapcache(page, entry, count != 0);
 		spin_unlock(&swap_lock);
+		if (!count)
+			free_swap_slot(entry);
 	}
 }
 
@@ -687,13 +752,15 @@ int free_swap_and_cache(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
 	struct page *page = NULL;
+	unsigned char usage;
 
 	if (non_swap_entry(entry))
 		return 1;
 
 	p = swap_info_get(entry);
 	if (p) {
-		if (swap_entry_free(p, entry, 1) == SWAP_HAS_CACHE) {
+		usage = swap_entry_free(p, entry, 1);
+		if (usage == SWAP_HAS_CACHE) {
 			page = find_get_page(&swapper_space, entry.val);
 			if (page && !trylock_page(page)) {
 				page_cache_release(page);
@@ -701,6 +768,8 @@ int free_swap_and_cache(swp_entry_t entry)
 			}
 		}
 		spin_unlock(&swap_lock);
+		if (!usage)
+			free_swap_slot(entry);
 	}
 	if (page) {
 		/*
@@ -1613,9 +1682,15 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/*
+	 * Slots waiting in the per-cpu caches look in use to try_to_unuse(),
+	 * so flush them and free directly until it is done.
+	 */
+	disable_swap_slots_cache();
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
+	enable_swap_slots_cache();
 
 	if (err) {
 		/*
@@ -0,0 +1,377 @@
+/*
+ * b2r2_cpu_test.c - checks and times the B2R2 CPU blitter row kernels
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The C kernels are checked against straightforward floating point
+ * models: exact where the kernel promises exact rounding, within one
+ * step for the color conversion. When built with NEON=1 the NEON kernels
+ * must give bit exact the same output as the C ones, for all lengths up
+ * to a few vectors and all start alignments, so the vector bodies, the
+ * scalar tails and the hand over between them are all covered. Run under
+ * qemu-arm when no ARM board is at hand.
+ *
+ * With -b each kernel is timed on full HD lines.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "b2r2_cpu_kernels.h"
+
+#define MAX_N		80	/* Longest line checked */
+#define MAX_OFS		4	/* Start alignments checked, in elements */
+#define BENCH_W		1920
+
+static unsigned int seed = 1;
+static unsigned int rounds = 20;
+static int failures;
+
+static const struct b2r2_cpu_kernels *impls[] = {
+	&b2r2_cpu_kernels_c,
+#ifdef B2R2_CPU_TEST_NEON
+	&b2r2_cpu_kernels_neon,
+#endif
+};
+
+#define NR_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+static const struct b2r2_cpu_yuv_coefs *coefs[] = {
+	&b2r2_cpu_bt601_video,
+	&b2r2_cpu_bt601_full,
+};
+
+static void fill_random(void *buf, size_t len)
+{
+	uint8_t *p = buf;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		p[i] = rand_r(&seed);
+}
+
+static void fail(const char *kernel, const char *impl, int n, int ofs,
+		int i, uint32_t got, uint32_t want)
+{
+	if (failures++ < 20)
+		fprintf(stderr, "%s (%s): n %d ofs %d pixel %d: got %#x, "
+			"want %#x\n", kernel, impl, n, ofs, i, got, want);
+}
+
+static int clamp(double v)
+{
+	if (v < 0)
+		return 0;
+	if (v > 255)
+		return 255;
+	return (int)v;
+}
+
+/* C kernels against models */
+
+static void check_model(void)
+{
+	const struct b2r2_cpu_kernels *k = &b2r2_cpu_kernels_c;
+	uint32_t s[256], d[256], out[256];
+	uint16_t p565[256];
+	uint8_t a[256], b[256], l[256];
+	uint8_t y[256], u[128], v[128];
+	unsigned int i, j, frac;
+
+	/* RGB565 round trip is lossless */
+	for (i = 0; i < 65536; i += 256) {
+		for (j = 0; j < 256; j++)
+			p565[j] = i + j;
+		k->rgb565_to_argb8888(out, p565, 256);
+		k->argb8888_to_rgb565((uint16_t *)d, out, 256);
+		for (j = 0; j < 256; j++)
+			if (((uint16_t *)d)[j] != i + j ||
+					(out[j] >> 24) != 0xff)
+				fail("rgb565 round trip", "c", 256, 0, j,
+					((uint16_t *)d)[j], i + j);
+	}
+
+	/* Blend: exact rounding of the premultiplied and straight equations */
+	for (i = 0; i < rounds * 16; i++) {
+		uint32_t ga = rand_r(&seed) & 0xff;
+		uint32_t flags = rand_r(&seed) & 3;
+
+		fill_random(s, sizeof(s));
+		fill_random(d, sizeof(d));
+		memcpy(out, d, sizeof(d));
+		k->blend_argb8888(out, s, 256, ga, flags);
+
+		for (j = 0; j < 256; j++) {
+			double sa = (s[j] >> 24) / 255.0;
+			double alpha = ga / 255.0;
+			double f;
+			uint32_t want;
+			int shift;
+
+			if (flags & B2R2_CPU_BLEND_PIXEL_ALPHA)
+				alpha = floor(sa * ga + 0.5) / 255.0;
+			f = (flags & B2R2_CPU_BLEND_PREMULT) ? ga / 255.0 :
+				alpha;
+
+			want = (uint32_t)(alpha * 255 + 0.5 + floor(
+				(d[j] >> 24) * (1 - alpha) + 0.5)) << 24;
+			for (shift = 0; shift < 24; shift += 8) {
+				double sc = floor(((s[j] >> shift) & 0xff) *
+					f + 0.5);
+				double dc = floor(((d[j] >> shift) & 0xff) *
+					(1 - alpha) + 0.5);
+
+				want |= clamp(sc + dc) << shift;
+			}
+			if (out[j] != want)
+				fail("blend", "c", 256, 0, j, out[j], want);
+		}
+	}
+
+	/* Lerp */
+	for (frac = 1; frac < 256; frac++) {
+		fill_random(a, sizeof(a));
+		fill_random(b, sizeof(b));
+		k->lerp_rows(l, a, b, 256, frac);
+		for (j = 0; j < 256; j++) {
+			int want = floor((a[j] * (256.0 - frac) +
+				b[j] * (double)frac) / 256 + 0.5);
+
+			if (l[j] != want)
+				fail("lerp", "c", 256, frac, j, l[j], want);
+		}
+	}
+
+	/* YUV to RGB within one step of the exact BT.601 result */
+	for (i = 0; i < rounds; i++) {
+		fill_random(y, sizeof(y));
+		fill_random(u, sizeof(u));
+		fill_random(v, sizeof(v));
+
+		for (j = 0; j < 2; j++) {
+			const struct b2r2_cpu_yuv_coefs *c = coefs[j];
+			double ys = c->y_offset ? 255.0 / 219 : 1;
+			double cs = c->y_offset ? 255.0 / 224 : 1;
+			unsigned int x;
+
+			k->yuv420_to_argb8888(out, y, u, v, 256, c);
+			for (x = 0; x < 256; x++) {
+				double yy = (y[x] - c->y_offset) * ys;
+				double cb = (u[x / 2] - 128) * cs;
+				double cr = (v[x / 2] - 128) * cs;
+				int want[3] = {
+					clamp(floor(yy + 1.772 * cb + 0.5)),
+					clamp(floor(yy - 0.344136 * cb -
+						0.714136 * cr + 0.5)),
+					clamp(floor(yy + 1.402 * cr + 0.5)),
+				};
+				int ch;
+
+				for (ch = 0; ch < 3; ch++) {
+					int got = (out[x] >> (ch * 8)) & 0xff;
+
+					if (abs(got - want[ch]) > 1)
+						fail("yuv420", "c", 256, j, x,
+							out[x], want[ch]);
+				}
+			}
+		}
+	}
+}
+
+/* Every implementation against the C one */
+
+static void check_impl(const struct b2r2_cpu_kernels *k)
+{
+	const struct b2r2_cpu_kernels *ref = &b2r2_cpu_kernels_c;
+	static uint32_t s[MAX_N + MAX_OFS], d[MAX_N + MAX_OFS];
+	static uint32_t o1[MAX_N + MAX_OFS], o2[MAX_N + MAX_OFS];
+	static uint16_t p[MAX_N + MAX_OFS], q1[MAX_N + MAX_OFS],
+		q2[MAX_N + MAX_OFS];
+	static uint8_t y[MAX_N + MAX_OFS], u[MAX_N], v[MAX_N];
+	static uint8_t a[4 * MAX_N + MAX_OFS], b[4 * MAX_N + MAX_OFS];
+	static uint8_t l1[4 * MAX_N + MAX_OFS], l2[4 * MAX_N + MAX_OFS];
+	unsigned int r;
+	int n, ofs, i;
+
+	for (r = 0; r < rounds; r++) {
+		fill_random(s, sizeof(s));
+		fill_random(d, sizeof(d));
+		fill_random(p, sizeof(p));
+		fill_random(y, sizeof(y));
+		fill_random(u, sizeof(u));
+		fill_random(v, sizeof(v));
+		fill_random(a, sizeof(a));
+		fill_random(b, sizeof(b));
+
+		for (n = 0; n <= MAX_N; n++) {
+			for (ofs = 0; ofs < MAX_OFS; ofs++) {
+				uint32_t ga = rand_r(&seed) & 0xff;
+				uint32_t flags = rand_r(&seed) & 3;
+				uint32_t frac = 1 + rand_r(&seed) % 255;
+				int c = rand_r(&seed) & 1;
+
+				k->rgb565_to_argb8888(o1 + ofs, p + ofs, n);
+				ref->rgb565_to_argb8888(o2 + ofs, p + ofs, n);
+				for (i = 0; i < n; i++)
+					if (o1[ofs + i] != o2[ofs + i])
+						fail("rgb565_to_argb8888",
+							k->name, n, ofs, i,
+							o1[ofs + i],
+							o2[ofs + i]);
+
+				k->argb8888_to_rgb565(q1 + ofs, s + ofs, n);
+				ref->argb8888_to_rgb565(q2 + ofs, s + ofs, n);
+				for (i = 0; i < n; i++)
+					if (q1[ofs + i] != q2[ofs + i])
+						fail("argb8888_to_rgb565",
+							k->name, n, ofs, i,
+							q1[ofs + i],
+							q2[ofs + i]);
+
+				k->yuv420_to_argb8888(o1 + ofs, y + ofs, u, v,
+					n, coefs[c]);
+				ref->yuv420_to_argb8888(o2 + ofs, y + ofs, u,
+					v, n, coefs[c]);
+				for (i = 0; i < n; i++)
+					if (o1[ofs + i] != o2[ofs + i])
+						fail("yuv420_to_argb8888",
+							k->name, n, ofs, i,
+							o1[ofs + i],
+							o2[ofs + i]);
+
+				memcpy(o1, d, sizeof(d));
+				memcpy(o2, d, sizeof(d));
+				k->blend_argb8888(o1 + ofs, s + ofs, n, ga,
+					flags);
+				ref->blend_argb8888(o2 + ofs, s + ofs, n, ga,
+					flags);
+				for (i = 0; i < n; i++)
+					if (o1[ofs + i] != o2[ofs + i])
+						fail("blend_argb8888", k->name,
+							n, ofs, i, o1[ofs + i],
+							o2[ofs + i]);
+
+				k->lerp_rows(l1 + ofs, a + ofs, b + ofs, 4 * n,
+					frac);
+				ref->lerp_rows(l2 + ofs, a + ofs, b + ofs,
+					4 * n, frac);
+				for (i = 0; i < 4 * n; i++)
+					if (l1[ofs + i] != l2[ofs + i])
+						fail("lerp_rows", k->name,
+							n, ofs, i, l1[ofs + i],
+							l2[ofs + i]);
+
+				if (n < 2)
+					continue;
+				k->scale_row_argb8888(o1, s + ofs, n, MAX_N,
+					0, (n << 16) / MAX_N);
+				ref->scale_row_argb8888(o2, s + ofs, n, MAX_N,
+					0, (n << 16) / MAX_N);
+				for (i = 0; i < MAX_N; i++)
+					if (o1[i] != o2[i])
+						fail("scale_row_argb8888",
+							k->name, n, ofs, i,
+							o1[i], o2[i]);
+			}
+		}
+	}
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench(const struct b2r2_cpu_kernels *k)
+{
+	static uint32_t s[BENCH_W], d[BENCH_W];
+	static uint16_t p[BENCH_W];
+	static uint8_t y[BENCH_W], u[BENCH_W / 2], v[BENCH_W / 2];
+	unsigned int lines = 1080 * rounds / 4;
+	unsigned int i;
+	double t;
+
+	fill_random(s, sizeof(s));
+	fill_random(d, sizeof(d));
+	fill_random(p, sizeof(p));
+	fill_random(y, sizeof(y));
+
+#define BENCH(what, call) do { \
+		t = now_us(); \
+		for (i = 0; i < lines; i++) \
+			call; \
+		t = now_us() - t; \
+		printf("%-6s %-22s %8.1f Mpixels/s\n", k->name, what, \
+			(double)lines * BENCH_W / t); \
+	} while (0)
+
+	BENCH("rgb565_to_argb8888", k->rgb565_to_argb8888(d, p, BENCH_W));
+	BENCH("argb8888_to_rgb565", k->argb8888_to_rgb565(p, s, BENCH_W));
+	BENCH("yuv420_to_argb8888", k->yuv420_to_argb8888(d, y, u, v,
+		BENCH_W, &b2r2_cpu_bt601_video));
+	BENCH("blend_argb8888", k->blend_argb8888(d, s, BENCH_W, 200,
+		B2R2_CPU_BLEND_PIXEL_ALPHA | B2R2_CPU_BLEND_PREMULT));
+	BENCH("lerp_rows", k->lerp_rows((uint8_t *)d, (uint8_t *)s,
+		(uint8_t *)d, 4 * BENCH_W, 77));
+	BENCH("scale_row_argb8888", k->scale_row_argb8888(d, s, 1280,
+		BENCH_W, 0, (1280 << 16) / BENCH_W));
+#undef BENCH
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -r <rounds>  random rounds (default %u)\n"
+		"  -s <seed>    random seed (default %u)\n"
+		"  -b           time the kernels as well\n",
+		prog, rounds, seed);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int do_bench = 0;
+	unsigned int i;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:s:bh")) != -1) {
+		switch (c) {
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			do_bench = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	check_model();
+	for (i = 1; i < NR_IMPLS; i++)
+		check_impl(impls[i]);
+
+	printf("%s: %d failures (%u implementations)\n",
+		failures ? "FAIL" : "PASS", failures, (unsigned int)NR_IMPLS);
+
+	if (do_bench)
+		for (i = 0; i < NR_IMPLS; i++)
+			bench(impls[i]);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,590 @@
+/*
+ * b2r2_sim_test.c - checks and times blits on the B2R2 software core
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Meant for a host without B2R2 hardware, with the b2r2 module built with
+ * CONFIG_B2R2_SIM and loaded with sim=1. Blits are requested through
+ * /dev/b2r2_blt on physically addressed buffers. Each buffer is one huge
+ * page, which is physically contiguous, and its address is looked up in
+ * /proc/self/pagemap, so the test must run as root with a few huge pages
+ * reserved:
+ *
+ *   echo 8 > /proc/sys/vm/nr_hugepages
+ *   modprobe b2r2 sim=1 && ./b2r2_sim_test
+ *
+ * First, the results of blits that must be bit exact are compared with
+ * the expected images: fills, copies, flips, a 180 degree rotation, a 90
+ * and 270 degree rotation round trip and a clipped copy.
+ *
+ * Then a set of typical blits (scaling, rotation, YCbCr to RGB, blending)
+ * is run -n times each. The node split statistics the software core keeps
+ * in core/sim in debugfs are cleared before each and printed after it:
+ * nodes per job and jobs (tiles) per request are what the node splitting
+ * is to be benchmarked and regression tested on.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../include/video/b2r2_blt.h"
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB	0x40000
+#endif
+
+#define NR_BUFS		3
+#define PAGEMAP_PRESENT	(1ULL << 63)
+#define PAGEMAP_PFN	((1ULL << 55) - 1)
+
+struct buf {
+	uint8_t *virt;
+	uint32_t paddr;
+};
+
+static const char *device = "/dev/b2r2_blt";
+static const char *sim_file = "/sys/kernel/debug/b2r2/core/sim";
+static unsigned int rounds = 20;
+static unsigned int seed = 1;
+static int failures;
+
+static int fd;
+static size_t huge_size = 2 << 20;
+static struct buf bufs[NR_BUFS];
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void read_huge_size(void)
+{
+	FILE *f = fopen("/proc/meminfo", "r");
+	char line[128];
+	unsigned long kb;
+
+	if (f == NULL)
+		return;
+	while (fgets(line, sizeof(line), f) != NULL)
+		if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+			huge_size = (size_t)kb << 10;
+	fclose(f);
+}
+
+/*
+ * Maps huge pages until NR_BUFS of them are below 4GiB, which the 32 bit
+ * B2R2 addresses can reach.
+ */
+static int alloc_bufs(void)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	int pagemap;
+	int n = 0, tries;
+
+	pagemap = open("/proc/self/pagemap", O_RDONLY);
+	if (pagemap < 0) {
+		perror("/proc/self/pagemap");
+		return -1;
+	}
+
+	for (tries = 0; n < NR_BUFS && tries < 8 * NR_BUFS; tries++) {
+		uint8_t *virt;
+		uint64_t entry, paddr;
+
+		virt = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (virt == MAP_FAILED) {
+			perror("mmap of a huge page, are any reserved");
+			break;
+		}
+		memset(virt, 0, huge_size);
+
+		if (pread(pagemap, &entry, sizeof(entry),
+			  (uintptr_t)virt / page_size * sizeof(entry)) !=
+				sizeof(entry) || !(entry & PAGEMAP_PRESENT) ||
+				!(entry & PAGEMAP_PFN)) {
+			fprintf(stderr, "no physical address in pagemap, "
+				"not root?\n");
+			break;
+		}
+		paddr = (entry & PAGEMAP_PFN) * page_size;
+		if (paddr + huge_size > 1ULL << 32) {
+			/* Kept mapped, so that it is not handed out again */
+			continue;
+		}
+
+		bufs[n].virt = virt;
+		bufs[n].paddr = paddr;
+		n++;
+	}
+
+	close(pagemap);
+	if (n < NR_BUFS) {
+		fprintf(stderr, "need %d huge pages below 4GiB, got %d\n",
+			NR_BUFS, n);
+		return -1;
+	}
+	return 0;
+}
+
+static int fmt_bpp(enum b2r2_blt_fmt fmt)
+{
+	switch (fmt) {
+	case B2R2_BLT_FMT_32_BIT_ARGB8888:
+		return 4;
+	case B2R2_BLT_FMT_16_BIT_RGB565:
+	case B2R2_BLT_FMT_CB_Y_CR_Y:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static void set_img(struct b2r2_blt_img *img, struct buf *buf,
+		enum b2r2_blt_fmt fmt, int width, int height)
+{
+	memset(img, 0, sizeof(*img));
+	img->fmt = fmt;
+	img->buf.type = B2R2_BLT_PTR_PHYSICAL;
+	img->buf.offset = buf->paddr;
+	img->buf.len = huge_size;
+	img->width = width;
+	img->height = height;
+	img->pitch = width * fmt_bpp(fmt);
+}
+
+static void set_rect(struct b2r2_blt_rect *rect, int x, int y, int width,
+		int height)
+{
+	rect->x = x;
+	rect->y = y;
+	rect->width = width;
+	rect->height = height;
+}
+
+static void init_req(struct b2r2_blt_req *req)
+{
+	memset(req, 0, sizeof(*req));
+	req->size = sizeof(*req);
+	req->global_alpha = 255;
+}
+
+static int blit(struct b2r2_blt_req *req)
+{
+	int ret = ioctl(fd, B2R2_BLT_IOC, req);
+
+	if (ret < 0)
+		return -errno;
+	return 0;
+}
+
+static void fill_random(struct buf *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf->virt[i] = rand_r(&seed);
+}
+
+static const uint8_t *pixel(const struct b2r2_blt_img *img,
+		const struct buf *buf, int x, int y)
+{
+	return buf->virt + y * img->pitch + x * fmt_bpp(img->fmt);
+}
+
+/*
+ * Compares dst with the expected image: inside rect pixel (x, y) must be
+ * what expect() returns, outside it dst must still equal the saved copy.
+ */
+static void check(const char *name, const struct b2r2_blt_img *dst,
+		const uint8_t *before, const struct b2r2_blt_rect *rect,
+		const uint8_t *(*expect)(int x, int y, const void *arg),
+		const void *arg)
+{
+	int bpp = fmt_bpp(dst->fmt);
+	int x, y, bad = 0;
+
+	for (y = 0; y < dst->height; y++) {
+		for (x = 0; x < dst->width; x++) {
+			const uint8_t *got = pixel(dst, &bufs[2], x, y);
+			const uint8_t *want;
+
+			if (x >= rect->x && x < rect->x + rect->width &&
+			    y >= rect->y && y < rect->y + rect->height)
+				want = expect(x - rect->x, y - rect->y, arg);
+			else
+				want = before + y * dst->pitch + x * bpp;
+
+			if (memcmp(got, want, bpp) == 0)
+				continue;
+			if (bad++ == 0)
+				fprintf(stderr, "%s: first wrong pixel at "
+					"(%d, %d)\n", name, x, y);
+		}
+	}
+
+	if (bad) {
+		fprintf(stderr, "%s: %d wrong pixels\n", name, bad);
+		failures++;
+	}
+}
+
+struct copy_arg {
+	const struct b2r2_blt_img *src;
+	const uint8_t *src_pixels;
+	struct b2r2_blt_rect src_rect;
+	enum b2r2_blt_transform transform;
+};
+
+static const uint8_t *expect_fill(int x, int y, const void *arg)
+{
+	(void)x;
+	(void)y;
+	return arg;
+}
+
+/* Source pixel that lands on (x, y) of the destination rectangle */
+static const uint8_t *expect_copy(int x, int y, const void *arg)
+{
+	const struct copy_arg *c = arg;
+	int w = c->src_rect.width, h = c->src_rect.height;
+	int sx = x, sy = y;
+
+	switch (c->transform) {
+	case B2R2_BLT_TRANSFORM_FLIP_H:
+		sx = w - 1 - x;
+		break;
+	case B2R2_BLT_TRANSFORM_FLIP_V:
+		sy = h - 1 - y;
+		break;
+	case B2R2_BLT_TRANSFORM_CCW_ROT_180:
+		sx = w - 1 - x;
+		sy = h - 1 - y;
+		break;
+	default:
+		break;
+	}
+
+	return c->src_pixels + (c->src_rect.y + sy) * c->src->pitch +
+		(c->src_rect.x + sx) * fmt_bpp(c->src->fmt);
+}
+
+static void run_copy(const char *name, enum b2r2_blt_fmt fmt,
+		enum b2r2_blt_transform transform, bool clip)
+{
+	struct b2r2_blt_req req;
+	struct copy_arg arg;
+	struct b2r2_blt_rect changed;
+	static uint8_t src_copy[1 << 20], before[1 << 20];
+	int ret;
+
+	init_req(&req);
+	req.transform = transform;
+	set_img(&req.src_img, &bufs[0], fmt, 176, 144);
+	set_img(&req.dst_img, &bufs[2], fmt, 208, 160);
+	set_rect(&req.src_rect, 9, 5, 150, 110);
+	set_rect(&req.dst_rect, 31, 17, 150, 110);
+	changed = req.dst_rect;
+	if (clip) {
+		req.flags |= B2R2_BLT_FLAG_DESTINATION_CLIP;
+		set_rect(&req.dst_clip_rect, 40, 30, 100, 60);
+		changed = req.dst_clip_rect;
+	}
+
+	fill_random(&bufs[0], req.src_img.pitch * req.src_img.height);
+	fill_random(&bufs[2], req.dst_img.pitch * req.dst_img.height);
+	memcpy(src_copy, bufs[0].virt, req.src_img.pitch * req.src_img.height);
+	memcpy(before, bufs[2].virt, req.dst_img.pitch * req.dst_img.height);
+
+	ret = blit(&req);
+	if (ret < 0) {
+		fprintf(stderr, "%s: blit failed: %s\n", name, strerror(-ret));
+		failures++;
+		return;
+	}
+
+	arg.src = &req.src_img;
+	arg.src_pixels = src_copy;
+	arg.src_rect = req.src_rect;
+	arg.transform = transform;
+	if (clip) {
+		/* Clipping keeps the mapping of the unclipped rectangle */
+		arg.src_rect.x += changed.x - req.dst_rect.x;
+		arg.src_rect.y += changed.y - req.dst_rect.y;
+	}
+	check(name, &req.dst_img, before, &changed, expect_copy, &arg);
+}
+
+static void run_fill(void)
+{
+	static const uint8_t argb[4] = { 0x10, 0x20, 0x40, 0x80 };
+	static uint8_t before[1 << 20];
+	struct b2r2_blt_req req;
+	int ret;
+
+	init_req(&req);
+	req.flags = B2R2_BLT_FLAG_SOURCE_FILL;
+	req.src_color = 0x80402010;
+	set_img(&req.dst_img, &bufs[2], B2R2_BLT_FMT_32_BIT_ARGB8888, 208,
+		160);
+	set_rect(&req.dst_rect, 13, 7, 150, 90);
+	req.src_img.fmt = req.dst_img.fmt;
+
+	fill_random(&bufs[2], req.dst_img.pitch * req.dst_img.height);
+	memcpy(before, bufs[2].virt, req.dst_img.pitch * req.dst_img.height);
+
+	ret = blit(&req);
+	if (ret < 0) {
+		fprintf(stderr, "fill: blit failed: %s\n", strerror(-ret));
+		failures++;
+		return;
+	}
+	/* Little endian in memory: B, G, R, A */
+	check("fill", &req.dst_img, before, &req.dst_rect, expect_fill, argb);
+}
+
+/* Rotating by 90 and then by 270 degrees must give back the source */
+static void run_rotate_round_trip(void)
+{
+	struct b2r2_blt_req req;
+	struct b2r2_blt_img src;
+	size_t len;
+	int y, ret, bad = 0;
+
+	init_req(&req);
+	req.transform = B2R2_BLT_TRANSFORM_CCW_ROT_90;
+	set_img(&req.src_img, &bufs[0], B2R2_BLT_FMT_32_BIT_ARGB8888, 176, 144);
+	set_img(&req.dst_img, &bufs[1], B2R2_BLT_FMT_32_BIT_ARGB8888, 144, 176);
+	set_rect(&req.src_rect, 0, 0, 176, 144);
+	set_rect(&req.dst_rect, 0, 0, 144, 176);
+	src = req.src_img;
+	len = src.pitch * src.height;
+	fill_random(&bufs[0], len);
+
+	ret = blit(&req);
+	if (ret == 0) {
+		req.transform = B2R2_BLT_TRANSFORM_CCW_ROT_270;
+		set_img(&req.src_img, &bufs[1], B2R2_BLT_FMT_32_BIT_ARGB8888,
+			144, 176);
+		set_img(&req.dst_img, &bufs[2], B2R2_BLT_FMT_32_BIT_ARGB8888,
+			176, 144);
+		set_rect(&req.src_rect, 0, 0, 144, 176);
+		set_rect(&req.dst_rect, 0, 0, 176, 144);
+		ret = blit(&req);
+	}
+	if (ret < 0) {
+		fprintf(stderr, "rotate 90/270: blit failed: %s\n",
+			strerror(-ret));
+		failures++;
+		return;
+	}
+
+	for (y = 0; y < src.height; y++)
+		if (memcmp(pixel(&src, &bufs[0], 0, y),
+			   pixel(&src, &bufs[2], 0, y), src.width * 4))
+			bad++;
+	if (bad) {
+		fprintf(stderr, "rotate 90/270: %d wrong lines\n", bad);
+		failures++;
+	}
+}
+
+static void run_checks(void)
+{
+	run_fill();
+	run_copy("copy ARGB8888", B2R2_BLT_FMT_32_BIT_ARGB8888,
+		 B2R2_BLT_TRANSFORM_NONE, false);
+	run_copy("copy RGB565", B2R2_BLT_FMT_16_BIT_RGB565,
+		 B2R2_BLT_TRANSFORM_NONE, false);
+	run_copy("flip H", B2R2_BLT_FMT_32_BIT_ARGB8888,
+		 B2R2_BLT_TRANSFORM_FLIP_H, false);
+	run_copy("flip V", B2R2_BLT_FMT_32_BIT_ARGB8888,
+		 B2R2_BLT_TRANSFORM_FLIP_V, false);
+	run_copy("rotate 180", B2R2_BLT_FMT_32_BIT_ARGB8888,
+		 B2R2_BLT_TRANSFORM_CCW_ROT_180, false);
+	run_copy("clipped copy", B2R2_BLT_FMT_32_BIT_ARGB8888,
+		 B2R2_BLT_TRANSFORM_NONE, true);
+	run_rotate_round_trip();
+}
+
+struct bench {
+	const char *name;
+	enum b2r2_blt_fmt src_fmt;
+	int src_w, src_h;
+	enum b2r2_blt_fmt dst_fmt;
+	int dst_w, dst_h;
+	enum b2r2_blt_transform transform;
+	enum b2r2_blt_flag flags;
+};
+
+static const struct bench benches[] = {
+	{ "fill 800x480 ARGB8888", 0, 0, 0,
+	  B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480, 0,
+	  B2R2_BLT_FLAG_SOURCE_FILL },
+	{ "copy 800x480 ARGB8888", B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480,
+	  B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480, 0, 0 },
+	{ "ARGB8888 to RGB565 800x480", B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480,
+	  B2R2_BLT_FMT_16_BIT_RGB565, 800, 480, 0, 0 },
+	{ "scale 640x480 to 800x480", B2R2_BLT_FMT_32_BIT_ARGB8888, 640, 480,
+	  B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480, 0, 0 },
+	{ "scale 800x480 to 176x144", B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480,
+	  B2R2_BLT_FMT_32_BIT_ARGB8888, 176, 144, 0, 0 },
+	{ "rotate 90 480x800 RGB565", B2R2_BLT_FMT_16_BIT_RGB565, 480, 800,
+	  B2R2_BLT_FMT_16_BIT_RGB565, 800, 480,
+	  B2R2_BLT_TRANSFORM_CCW_ROT_90, 0 },
+	{ "CbYCrY 640x480 to ARGB8888 800x480", B2R2_BLT_FMT_CB_Y_CR_Y, 640,
+	  480, B2R2_BLT_FMT_32_BIT_ARGB8888, 800, 480, 0, 0 },
+	{ "blend ARGB8888 onto RGB565 800x480", B2R2_BLT_FMT_32_BIT_ARGB8888,
+	  800, 480, B2R2_BLT_FMT_16_BIT_RGB565, 800, 480, 0,
+	  B2R2_BLT_FLAG_PER_PIXEL_ALPHA_BLEND },
+};
+
+static void print_sim_stats(void)
+{
+	char text[1024], *hist;
+	ssize_t len;
+	int sim;
+
+	sim = open(sim_file, O_RDONLY);
+	if (sim < 0)
+		return;
+	len = read(sim, text, sizeof(text) - 1);
+	close(sim);
+	if (len <= 0)
+		return;
+	text[len] = '\0';
+
+	/* The summary lines only, not the histogram */
+	hist = strstr(text, "(nodes/job");
+	if (hist != NULL)
+		*hist = '\0';
+	printf("%s", text);
+}
+
+static void clear_sim_stats(void)
+{
+	int sim = open(sim_file, O_WRONLY);
+
+	if (sim < 0)
+		return;
+	if (write(sim, "0", 1) != 1)
+		perror(sim_file);
+	close(sim);
+}
+
+static void run_benches(void)
+{
+	unsigned int i, r;
+
+	if (access(sim_file, R_OK) != 0)
+		fprintf(stderr, "%s: %s, no node statistics\n", sim_file,
+			strerror(errno));
+
+	for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		const struct bench *b = &benches[i];
+		struct b2r2_blt_req req;
+		uint64_t t0, ns;
+		int ret = 0;
+
+		init_req(&req);
+		req.flags = b->flags;
+		req.transform = b->transform;
+		req.src_color = 0xff808080;
+		if (b->src_fmt) {
+			set_img(&req.src_img, &bufs[0], b->src_fmt, b->src_w,
+				b->src_h);
+			set_rect(&req.src_rect, 0, 0, b->src_w, b->src_h);
+			fill_random(&bufs[0],
+				    req.src_img.pitch * req.src_img.height);
+		} else {
+			req.src_img.fmt = b->dst_fmt;
+		}
+		set_img(&req.dst_img, &bufs[2], b->dst_fmt, b->dst_w, b->dst_h);
+		set_rect(&req.dst_rect, 0, 0, b->dst_w, b->dst_h);
+
+		clear_sim_stats();
+		t0 = now_ns();
+		for (r = 0; r < rounds && ret == 0; r++)
+			ret = blit(&req);
+		ns = now_ns() - t0;
+
+		if (ret < 0) {
+			printf("%s: blit failed: %s\n", b->name,
+			       strerror(-ret));
+			failures++;
+			continue;
+		}
+		printf("%s: %llu us per blit\n", b->name,
+		       (unsigned long long)(ns / rounds / 1000));
+		print_sim_stats();
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-d device] [-s debugfs sim file] "
+		"[-n rounds] [-r seed]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:s:n:r:")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = optarg;
+			break;
+		case 's':
+			sim_file = optarg;
+			break;
+		case 'n':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (rounds == 0) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	fd = open(device, O_RDWR);
+	if (fd < 0) {
+		perror(device);
+		return 1;
+	}
+	read_huge_size();
+	if (huge_size < (2 << 20) || alloc_bufs() < 0)
+		return 1;
+
+	run_checks();
+	if (failures)
+		printf("%d checks failed\n", failures);
+	else
+		printf("all checks passed\n");
+
+	run_benches();
+
+	close(fd);
+	return failures ? 1 : 0;
+}
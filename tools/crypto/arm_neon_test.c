@@ -0,0 +1,527 @@
+/*
+ * arm_neon_test.c - checks and times the ARM NEON crypto code
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The models are first checked against the FIPS-197, FIPS 180-2 and GCM
+ * examples. The bit-sliced AES, the SHA-256 block function and GHASH of
+ * arch/arm/crypto are then checked against the models for random keys
+ * and data, in place and out of place. Without NEON=1 only the C parts
+ * are built and checked: the models and the plain C SHA-256 fallback.
+ * Run under qemu-arm when no ARM board is at hand.
+ *
+ * With -b each implementation is timed against its model.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aesbs.h"
+#include "ghash_neon.h"
+#include "sha256_neon.h"
+
+#define BENCH_BYTES	(1 << 16)
+
+static unsigned int seed = 1;
+static unsigned int rounds = 200;
+static int failures;
+static int checks;
+
+static void fill_random(u8 *p, size_t n)
+{
+	while (n--)
+		*p++ = rand_r(&seed);
+}
+
+static void check(int ok, const char *what, int i)
+{
+	checks++;
+	if (!ok && failures++ < 20)
+		printf("FAIL: %s (case %d)\n", what, i);
+}
+
+static void hex(u8 *out, const char *s)
+{
+	while (*s) {
+		sscanf(s, "%2hhx", out++);
+		s += 2;
+	}
+}
+
+/* AES model, straight from FIPS-197 */
+
+static u8 sbox[256], inv_sbox[256];
+
+static u8 gmul(u8 a, u8 b)
+{
+	u8 r = 0;
+
+	while (b) {
+		if (b & 1)
+			r ^= a;
+		a = (a << 1) ^ (a & 0x80 ? 0x1b : 0);
+		b >>= 1;
+	}
+	return r;
+}
+
+static void aes_init(void)
+{
+	int x, y, i;
+
+	for (x = 0; x < 256; x++) {
+		u8 inv = 0, s, r;
+
+		for (y = 1; y < 256 && x; y++)
+			if (gmul(x, y) == 1)
+				inv = y;
+		s = r = inv;
+		for (i = 0; i < 4; i++) {
+			r = (r << 1) | (r >> 7);
+			s ^= r;
+		}
+		sbox[x] = s ^ 0x63;
+		inv_sbox[sbox[x]] = x;
+	}
+}
+
+static u32 sub_word(u32 w)
+{
+	return sbox[w & 0xff] | sbox[(w >> 8) & 0xff] << 8 |
+		sbox[(w >> 16) & 0xff] << 16 | (u32)sbox[w >> 24] << 24;
+}
+
+/* round keys as little endian words, like crypto_aes_expand_key() */
+static int aes_expand(u32 *rk, const u8 *key, int key_len)
+{
+	int nk = key_len / 4, nr = nk + 6, i;
+	u8 rcon = 1;
+
+	for (i = 0; i < nk; i++)
+		rk[i] = key[4 * i] | key[4 * i + 1] << 8 |
+			key[4 * i + 2] << 16 | (u32)key[4 * i + 3] << 24;
+	for (i = nk; i < 4 * (nr + 1); i++) {
+		u32 t = rk[i - 1];
+
+		if (i % nk == 0) {
+			t = sub_word((t >> 8) | (t << 24)) ^ rcon;
+			rcon = gmul(rcon, 2);
+		} else if (nk > 6 && i % nk == 4) {
+			t = sub_word(t);
+		}
+		rk[i] = rk[i - nk] ^ t;
+	}
+	return nr;
+}
+
+static void add_round_key(u8 *s, const u32 *rk)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		s[i] ^= rk[i / 4] >> (8 * (i % 4));
+}
+
+static void aes_encrypt_model(const u32 *rk, int nr, u8 *out, const u8 *in)
+{
+	u8 s[16], t[16];
+	int r, c, i;
+
+	memcpy(s, in, 16);
+	add_round_key(s, rk);
+	for (r = 1; r <= nr; r++) {
+		for (i = 0; i < 16; i++)	/* SubBytes, ShiftRows */
+			t[i] = sbox[s[(i + 4 * (i % 4)) % 16]];
+		for (c = 0; c < 4 && r < nr; c++) {
+			u8 *a = t + 4 * c, b[4];
+
+			for (i = 0; i < 4; i++)
+				b[i] = gmul(a[i], 2) ^ gmul(a[(i + 1) % 4], 3) ^
+					a[(i + 2) % 4] ^ a[(i + 3) % 4];
+			memcpy(a, b, 4);
+		}
+		memcpy(s, t, 16);
+		add_round_key(s, rk + 4 * r);
+	}
+	memcpy(out, s, 16);
+}
+
+static void aes_decrypt_model(const u32 *rk, int nr, u8 *out, const u8 *in)
+{
+	u8 s[16], t[16];
+	int r, c, i;
+
+	memcpy(s, in, 16);
+	for (r = nr; r >= 1; r--) {
+		add_round_key(s, rk + 4 * r);
+		for (c = 0; c < 4 && r < nr; c++) {
+			u8 *a = s + 4 * c, b[4];
+
+			for (i = 0; i < 4; i++)
+				b[i] = gmul(a[i], 14) ^ gmul(a[(i + 1) % 4], 11) ^
+					gmul(a[(i + 2) % 4], 13) ^
+					gmul(a[(i + 3) % 4], 9);
+			memcpy(a, b, 4);
+		}
+		for (i = 0; i < 16; i++)	/* InvShiftRows, InvSubBytes */
+			t[(i + 4 * (i % 4)) % 16] = inv_sbox[s[i]];
+		memcpy(s, t, 16);
+	}
+	add_round_key(s, rk);
+	memcpy(out, s, 16);
+}
+
+/* SHA-256 and GHASH models */
+
+static void sha256_model(u8 *digest, const u8 *msg, size_t len)
+{
+	u32 state[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	u8 block[128];
+	size_t full = len & ~(size_t)63, rest = len - full, pad;
+	int i;
+
+	sha256_blocks_c(state, msg, full / 64);
+	memset(block, 0, sizeof(block));
+	memcpy(block, msg + full, rest);
+	block[rest] = 0x80;
+	pad = rest < 56 ? 64 : 128;
+	for (i = 0; i < 8; i++)
+		block[pad - 1 - i] = (uint64_t)len * 8 >> (8 * i);
+	sha256_blocks_c(state, block, pad / 64);
+
+	for (i = 0; i < 32; i++)
+		digest[i] = state[i / 4] >> (24 - 8 * (i % 4));
+}
+
+/* GCM multiplication as specified, bit by bit */
+static void gf128_mul_model(u8 *x, const u8 *y)
+{
+	u8 z[16] = { 0 }, v[16];
+	int i, j, carry;
+
+	memcpy(v, y, 16);
+	for (i = 0; i < 128; i++) {
+		if (x[i / 8] & (0x80 >> (i % 8)))
+			for (j = 0; j < 16; j++)
+				z[j] ^= v[j];
+		carry = v[15] & 1;
+		for (j = 15; j > 0; j--)
+			v[j] = (v[j] >> 1) | (v[j - 1] << 7);
+		v[0] >>= 1;
+		if (carry)
+			v[0] ^= 0xe1;
+	}
+	memcpy(x, z, 16);
+}
+
+static void ghash_model(u8 *dg, const u8 *src, int blocks, const u8 *h)
+{
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i++)
+			dg[i] ^= src[i];
+		gf128_mul_model(dg, h);
+		src += 16;
+	}
+}
+
+/* FIPS-197 appendix C: the same plaintext under 128, 192 and 256 bit keys */
+static const char *aes_kat_key[] = {
+	"000102030405060708090a0b0c0d0e0f",
+	"000102030405060708090a0b0c0d0e0f1011121314151617",
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+};
+static const char *aes_kat_pt = "00112233445566778899aabbccddeeff";
+static const char *aes_kat_ct[] = {
+	"69c4e0d86a7b0430d8cdb78070b4c55a",
+	"dda97ca4864cdfe06eaf70a0ec0d7191",
+	"8ea2b7ca516745bfeafc49904b496089",
+};
+
+static void test_aes_model(void)
+{
+	u8 key[32], pt[16], ct[16], out[16];
+	u32 rk[60];
+	int i, nr;
+
+	for (i = 0; i < 3; i++) {
+		hex(key, aes_kat_key[i]);
+		hex(pt, aes_kat_pt);
+		hex(ct, aes_kat_ct[i]);
+		nr = aes_expand(rk, key, 16 + 8 * i);
+		aes_encrypt_model(rk, nr, out, pt);
+		check(!memcmp(out, ct, 16), "aes model encrypt vector", i);
+		aes_decrypt_model(rk, nr, out, ct);
+		check(!memcmp(out, pt, 16), "aes model decrypt vector", i);
+	}
+}
+
+/*
+ * GCM test cases 1 and 2 (all zero key and IV, no or one all zero
+ * plaintext block), through the AES and GHASH models
+ */
+static void test_ghash_model(void)
+{
+	static const char *kat_tag[] = {
+		"58e2fccefa7e3061367f1d57a4e7455a",
+		"ab6e47d42cec13bdf53a67b21257bddf",
+	};
+	u8 key[16] = { 0 }, h[16] = { 0 }, ctr[16] = { 0 };
+	u8 c[16], lens[16], dg[16], ek0[16], tag[16];
+	u32 rk[44];
+	int i, j, nr;
+
+	nr = aes_expand(rk, key, 16);
+	aes_encrypt_model(rk, nr, h, h);
+	ctr[15] = 1;
+	aes_encrypt_model(rk, nr, ek0, ctr);
+
+	for (i = 0; i < 2; i++) {
+		memset(dg, 0, sizeof(dg));
+		memset(lens, 0, sizeof(lens));
+		if (i) {
+			ctr[15] = 2;
+			aes_encrypt_model(rk, nr, c, ctr);	/* P = 0 */
+			ghash_model(dg, c, 1, h);
+			lens[15] = 128;		/* bit length of C */
+		}
+		ghash_model(dg, lens, 1, h);
+		for (j = 0; j < 16; j++)
+			dg[j] ^= ek0[j];
+		hex(tag, kat_tag[i]);
+		check(!memcmp(dg, tag, 16), "gcm model tag vector", i);
+	}
+}
+
+static void test_sha256(void)
+{
+	static const struct {
+		const char *msg;
+		const char *digest;
+	} kat[] = {
+		{ "abc", "ba7816bf8f01cfea414140de5dae2223"
+			 "b00361a396177a9cb410ff61f20015ad" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+			 "248d6a61d20638b8e5c026930c3e6039"
+			 "a33ce45964ff2167f6ecedd419db06c1" },
+	};
+	u8 digest[32], expected[32];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		sha256_model(digest, (const u8 *)kat[i].msg,
+			     strlen(kat[i].msg));
+		hex(expected, kat[i].digest);
+		check(!memcmp(digest, expected, 32), "sha256 c vector", i);
+	}
+
+#ifdef ARM_NEON_TEST
+	for (i = 0; i < (int)rounds; i++) {
+		u8 data[8 * 64];
+		u32 s1[8], s2[8];
+		int blocks = 1 + i % 8;
+
+		fill_random(data, sizeof(data));
+		fill_random((u8 *)s1, sizeof(s1));
+		memcpy(s2, s1, sizeof(s1));
+		sha256_blocks_c(s1, data, blocks);
+		sha256_neon_blocks(s2, data, blocks);
+		check(!memcmp(s1, s2, sizeof(s1)), "sha256 neon", i);
+	}
+#endif
+}
+
+#ifdef ARM_NEON_TEST
+static void test_aes(void)
+{
+	u8 key[32], pt[16 * AESBS_PARALLEL], ct[16 * AESBS_PARALLEL];
+	u8 out[16 * AESBS_PARALLEL], expected[16];
+	struct aesbs_key bskey;
+	u32 rk[60];
+	int i, b, nr;
+
+	for (i = 0; i < 3; i++) {
+		hex(key, aes_kat_key[i]);
+		nr = aes_expand(rk, key, 16 + 8 * i);
+		aesbs_convert_key(&bskey, rk, nr);
+		for (b = 0; b < AESBS_PARALLEL; b++)
+			hex(pt + 16 * b, aes_kat_pt);
+		hex(expected, aes_kat_ct[i]);
+		aesbs_encrypt8(&bskey, ct, pt);
+		for (b = 0; b < AESBS_PARALLEL; b++)
+			check(!memcmp(ct + 16 * b, expected, 16),
+			      "aes vector encrypt", i);
+		aesbs_decrypt8(&bskey, out, ct);
+		check(!memcmp(out, pt, sizeof(pt)), "aes vector decrypt", i);
+	}
+
+	for (i = 0; i < (int)rounds; i++) {
+		int key_len = 16 + 8 * (i % 3);
+
+		fill_random(key, key_len);
+		fill_random(pt, sizeof(pt));
+		nr = aes_expand(rk, key, key_len);
+		aesbs_convert_key(&bskey, rk, nr);
+
+		aesbs_encrypt8(&bskey, ct, pt);
+		for (b = 0; b < AESBS_PARALLEL; b++) {
+			aes_encrypt_model(rk, nr, expected, pt + 16 * b);
+			check(!memcmp(ct + 16 * b, expected, 16),
+			      "aes encrypt", i);
+			aes_decrypt_model(rk, nr, out, expected);
+			check(!memcmp(out, pt + 16 * b, 16),
+			      "aes decrypt model", i);
+		}
+
+		memcpy(out, ct, sizeof(ct));
+		aesbs_decrypt8(&bskey, out, out);
+		check(!memcmp(out, pt, sizeof(pt)), "aes decrypt in place", i);
+	}
+}
+
+static void test_ghash(void)
+{
+	u8 h[16], data[16 * 16], dg1[16], dg2[16];
+	u64 k[2];
+	int i;
+
+	for (i = 0; i < (int)rounds; i++) {
+		int blocks = 1 + i % 16;
+
+		fill_random(h, sizeof(h));
+		fill_random(data, sizeof(data));
+		fill_random(dg1, sizeof(dg1));
+		if (i < 4) {		/* single bit keys */
+			memset(h, 0, sizeof(h));
+			h[i * 5] = 0x80 >> i;
+		}
+		memcpy(dg2, dg1, sizeof(dg1));
+		ghash_model(dg1, data, blocks, h);
+		ghash_neon_key(k, h);
+		ghash_neon_update(dg2, data, blocks, k);
+		check(!memcmp(dg1, dg2, 16), "ghash neon", i);
+	}
+}
+#endif
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH(what, bytes, stmt)					\
+	do {								\
+		double t0 = now(), t;					\
+		int n = 0;						\
+									\
+		do {							\
+			stmt;						\
+			n++;						\
+			t = now() - t0;					\
+		} while (t < 0.5);					\
+		printf("%-24s %8.1f MB/s\n", what,			\
+		       (double)(bytes) * n / t / 1e6);			\
+	} while (0)
+
+static void bench(void)
+{
+	static u8 buf[BENCH_BYTES], out[BENCH_BYTES];
+	u32 state[8] = { 0 };
+	int i;
+#ifdef ARM_NEON_TEST
+	struct aesbs_key bskey;
+	u8 key[16], h[16], dg[16] = { 0 };
+	u32 rk[60];
+	u64 k[2];
+	int nr;
+
+	fill_random(key, sizeof(key));
+	fill_random(h, sizeof(h));
+	nr = aes_expand(rk, key, 16);
+	aesbs_convert_key(&bskey, rk, nr);
+	ghash_neon_key(k, h);
+#endif
+
+	fill_random(buf, sizeof(buf));
+
+	BENCH("sha256 c", BENCH_BYTES,
+	      sha256_blocks_c(state, buf, BENCH_BYTES / 64));
+#ifdef ARM_NEON_TEST
+	BENCH("sha256 neon", BENCH_BYTES,
+	      sha256_neon_blocks(state, buf, BENCH_BYTES / 64));
+	BENCH("aes-128 model", 4096,
+	      for (i = 0; i < 4096; i += 16)
+		      aes_encrypt_model(rk, nr, out + i, buf + i));
+	BENCH("aes-128 bs encrypt", BENCH_BYTES,
+	      for (i = 0; i < BENCH_BYTES; i += 16 * AESBS_PARALLEL)
+		      aesbs_encrypt8(&bskey, out + i, buf + i));
+	BENCH("aes-128 bs decrypt", BENCH_BYTES,
+	      for (i = 0; i < BENCH_BYTES; i += 16 * AESBS_PARALLEL)
+		      aesbs_decrypt8(&bskey, out + i, buf + i));
+	BENCH("ghash model", 4096, ghash_model(dg, buf, 4096 / 16, h));
+	BENCH("ghash neon", BENCH_BYTES,
+	      ghash_neon_update(dg, buf, BENCH_BYTES / 16, k));
+#endif
+	(void)i;
+	(void)out;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bn:s:")) != -1) {
+		switch (opt) {
+		case 'b':
+			do_bench = 1;
+			break;
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-n rounds] [-s seed]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	aes_init();
+	test_aes_model();
+	test_ghash_model();
+	test_sha256();
+#ifdef ARM_NEON_TEST
+	test_aes();
+	test_ghash();
+#endif
+
+	if (failures) {
+		printf("%d of %d checks failed\n", failures, checks);
+		return 1;
+	}
+#ifdef ARM_NEON_TEST
+	printf("all %d checks passed\n", checks);
+#else
+	printf("all %d checks of the C code passed, NEON code not built\n",
+	       checks);
+#endif
+
+	if (do_bench)
+		bench();
+	return 0;
+}
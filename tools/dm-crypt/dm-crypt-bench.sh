@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+# dm-crypt-bench.sh - dm-crypt throughput against the number of CPUs
+#
+# Copyright (C) 2011 ST-Ericsson SA
+#
+# License terms: GNU General Public License (GPL), version 2.
+#
+# Maps a RAM disk (brd) through dm-crypt and times direct sequential
+# writes and reads through the mapping with 1, 2, ... all CPUs online,
+# with and without the parallel conversion, so that the cost of the
+# cipher and the gain of splitting bios over the CPUs are seen without
+# any disk in the way. CPUs taken offline are brought back at the end.
+#
+# usage: dm-crypt-bench.sh [cipher [size_mb [block_kb]]]
+#   e.g. dm-crypt-bench.sh aes-cbc-essiv:sha256 256 1024
+
+CIPHER=${1:-aes-cbc-essiv:sha256}
+SIZE_MB=${2:-256}
+BS_KB=${3:-1024}
+KEY=0123456789abcdef0123456789abcdef
+NAME=crypt_bench
+PARAM=/sys/module/dm_crypt/parameters/parallel_sectors
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ "$(id -u)" = 0 ] || die "must be run as root"
+which dmsetup >/dev/null || die "dmsetup not found"
+
+modprobe brd rd_nr=1 rd_size=$((SIZE_MB * 1024)) 2>/dev/null
+[ -b /dev/ram0 ] || die "no /dev/ram0, is brd available?"
+modprobe dm-crypt 2>/dev/null
+[ -f $PARAM ] || die "dm-crypt has no parallel_sectors parameter"
+
+ORIG_PARAM=$(cat $PARAM)
+CPUS=$(ls -d /sys/devices/system/cpu/cpu[0-9]* | wc -l)
+
+set_cpus() {
+	for c in /sys/devices/system/cpu/cpu[1-9]*; do
+		n=${c##*cpu}
+		[ -f $c/online ] || continue
+		if [ $n -lt $1 ]; then
+			echo 1 > $c/online
+		else
+			echo 0 > $c/online
+		fi
+	done
+}
+
+cleanup() {
+	dmsetup remove $NAME 2>/dev/null
+	set_cpus $CPUS
+	echo $ORIG_PARAM > $PARAM
+}
+trap cleanup EXIT INT TERM
+
+# MB/s of a dd run, from the byte count and the elapsed seconds it prints
+rate() {
+	dd "$@" 2>&1 | awk '/bytes/ { printf "%.1f", $1 / $(NF - 3) / 1000000 }'
+}
+
+run() {
+	dmsetup remove $NAME 2>/dev/null
+	echo "0 $(blockdev --getsz /dev/ram0) crypt $CIPHER $KEY 0 /dev/ram0 0" |
+		dmsetup create $NAME || die "dmsetup create failed"
+
+	count=$((SIZE_MB * 1024 / BS_KB))
+	w=$(rate if=/dev/zero of=/dev/mapper/$NAME bs=${BS_KB}k count=$count \
+		oflag=direct)
+	r=$(rate if=/dev/mapper/$NAME of=/dev/null bs=${BS_KB}k count=$count \
+		iflag=direct)
+	printf "%-6s %-10s %10s %10s\n" $1 $2 $w $r
+}
+
+echo "$CIPHER, $SIZE_MB MB in blocks of $BS_KB KB"
+printf "%-6s %-10s %10s %10s\n" cpus mode "write MB/s" "read MB/s"
+
+n=1
+while [ $n -le $CPUS ]; do
+	set_cpus $n
+	echo 0 > $PARAM
+	run $n serial
+	echo $ORIG_PARAM > $PARAM
+	[ $ORIG_PARAM = 0 ] && echo 16 > $PARAM
+	run $n parallel
+	n=$((n + 1))
+done
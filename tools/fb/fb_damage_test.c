@@ -0,0 +1,288 @@
+/*
+ * fb_damage_test.c - measures the bytes flushed per frame by deferred I/O
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Draws a few typical update patterns through the mapping of a vfb
+ * loaded with defio=1, reports the drawn areas with FBIO_DAMAGE (or not,
+ * to see what page tracking alone gives), flushes every frame with
+ * fsync() and reads back from flush_stats how many bytes vfb copied to
+ * its shadow buffer. Each pattern is printed with its bytes per frame
+ * and how that compares to flushing whole frames.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+
+#ifndef FBIO_DAMAGE
+struct fb_damage_rect {
+	__u32 x;
+	__u32 y;
+	__u32 width;
+	__u32 height;
+};
+
+#define FBIO_DAMAGE		_IOW('F', 0x21, struct fb_damage_rect)
+#endif
+
+#define CURSOR		16
+#define GLYPH_W		8
+#define GLYPH_H		16
+
+struct flush_stats {
+	unsigned long frames;
+	unsigned long rects;
+	unsigned long long bytes;
+	unsigned long full;
+};
+
+static const char *dev_path = "/dev/fb0";
+static const char *stats_path = "/sys/devices/platform/vfb.0/flush_stats";
+static unsigned int frames = 60;
+static int fd;
+static uint8_t *fb;
+static struct fb_var_screeninfo var;
+static struct fb_fix_screeninfo fix;
+static unsigned int frame;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static void read_stats(struct flush_stats *stats)
+{
+	char buf[512];
+	char *line;
+	FILE *f;
+	size_t n;
+
+	f = fopen(stats_path, "r");
+	if (!f)
+		die(stats_path);
+	n = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[n] = '\0';
+
+	memset(stats, 0, sizeof(*stats));
+	for (line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+		sscanf(line, "frames: %lu", &stats->frames);
+		sscanf(line, "rectangles: %lu", &stats->rects);
+		sscanf(line, "bytes: %llu", &stats->bytes);
+		sscanf(line, "full frame: %lu", &stats->full);
+	}
+}
+
+static void reset_stats(void)
+{
+	FILE *f;
+
+	f = fopen(stats_path, "w");
+	if (!f)
+		die(stats_path);
+	fputs("0\n", f);
+	fclose(f);
+}
+
+static void fill(unsigned int x, unsigned int y, unsigned int w,
+		unsigned int h, uint8_t value)
+{
+	unsigned int bytes = var.bits_per_pixel / 8;
+	unsigned int i;
+
+	for (i = 0; i < h; i++)
+		memset(fb + (y + i) * fix.line_length + x * bytes, value,
+			w * bytes);
+}
+
+static void damage(unsigned int x, unsigned int y, unsigned int w,
+		unsigned int h)
+{
+	struct fb_damage_rect rect = { x, y, w, h };
+
+	if (ioctl(fd, FBIO_DAMAGE, &rect))
+		die("FBIO_DAMAGE");
+}
+
+/* Flushes the frame and waits for vfb to have copied it */
+static void flush(unsigned int expected)
+{
+	struct timespec delay = { 0, 1000000 };
+	struct flush_stats stats;
+	int i;
+
+	/* fb_deferred_io_fsync() may return 1 when it has queued the work */
+	if (fsync(fd) < 0)
+		die("fsync");
+
+	for (i = 0; i < 1000; i++) {
+		read_stats(&stats);
+		if (stats.frames >= expected)
+			return;
+		nanosleep(&delay, NULL);
+	}
+	fprintf(stderr, "frame %u not flushed\n", expected);
+	exit(1);
+}
+
+/* 16x16 cursor moving diagonally */
+static void draw_cursor(int report)
+{
+	unsigned int x = (frame * 5) % (var.xres - CURSOR - 5);
+	unsigned int y = (frame * 3) % (var.yres - CURSOR - 3);
+
+	fill(x, y, CURSOR, CURSOR, 0);
+	fill(x + 5, y + 3, CURSOR, CURSOR, 0xff);
+	if (report) {
+		damage(x, y, CURSOR, CURSOR);
+		damage(x + 5, y + 3, CURSOR, CURSOR);
+	}
+}
+
+static void draw_cursor_damage(void)
+{
+	draw_cursor(1);
+}
+
+static void draw_cursor_pages(void)
+{
+	draw_cursor(0);
+}
+
+/* one glyph typed per frame plus a blinking text cursor */
+static void draw_text(void)
+{
+	unsigned int cols = var.xres / GLYPH_W - 1;
+	unsigned int x = (frame % cols) * GLYPH_W;
+	unsigned int y = ((frame / cols) * GLYPH_H) % (var.yres - GLYPH_H);
+
+	fill(x, y, GLYPH_W, GLYPH_H, frame);
+	fill(x + GLYPH_W, y, 1, GLYPH_H, frame & 1 ? 0xff : 0);
+	damage(x, y, GLYPH_W + 1, GLYPH_H);
+}
+
+/* status icons in two opposite corners */
+static void draw_corners(void)
+{
+	fill(0, 0, 24, 24, frame);
+	fill(var.xres - 24, var.yres - 24, 24, 24, frame);
+	damage(0, 0, 24, 24);
+	damage(var.xres - 24, var.yres - 24, 24, 24);
+}
+
+/* video playing in a window */
+static void draw_video(void)
+{
+	unsigned int w = var.xres / 2;
+	unsigned int h = var.yres / 2;
+
+	fill(var.xres / 4, var.yres / 4, w, h, frame);
+	damage(var.xres / 4, var.yres / 4, w, h);
+}
+
+static void draw_full(void)
+{
+	fill(0, 0, var.xres, var.yres, frame);
+	damage(0, 0, var.xres, var.yres);
+}
+
+static const struct {
+	const char *name;
+	void (*draw)(void);
+} patterns[] = {
+	{ "cursor", draw_cursor_damage },
+	{ "cursor (pages)", draw_cursor_pages },
+	{ "text", draw_text },
+	{ "corners", draw_corners },
+	{ "video", draw_video },
+	{ "full", draw_full },
+};
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d device] [-s flush_stats] [-n frames]\n", prog);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	struct flush_stats stats;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:s:n:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev_path = optarg;
+			break;
+		case 's':
+			stats_path = optarg;
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			if (!frames)
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	fd = open(dev_path, O_RDWR);
+	if (fd < 0)
+		die(dev_path);
+	if (ioctl(fd, FBIOGET_VSCREENINFO, &var) ||
+			ioctl(fd, FBIOGET_FSCREENINFO, &fix))
+		die("FBIOGET_*SCREENINFO");
+	if (var.bits_per_pixel < 8 || var.xres < 64 || var.yres < 64) {
+		fprintf(stderr, "%ux%u %u bpp not supported\n",
+			var.xres, var.yres, var.bits_per_pixel);
+		return 1;
+	}
+
+	fb = mmap(NULL, fix.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fd, 0);
+	if (fb == MAP_FAILED)
+		die("mmap");
+
+	/* settle whatever was pending */
+	fsync(fd);
+	usleep(100000);
+
+	printf("%ux%u %u bpp, %u frames per pattern\n",
+		var.xres, var.yres, var.bits_per_pixel, frames);
+	printf("%-16s %10s %12s %8s\n", "pattern", "rects", "bytes/frame",
+		"of full");
+
+	for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		reset_stats();
+		for (frame = 0; frame < frames; frame++) {
+			patterns[i].draw();
+			flush(frame + 1);
+		}
+
+		read_stats(&stats);
+		printf("%-16s %10.2f %12llu %7.2f%%\n", patterns[i].name,
+			(double)stats.rects / stats.frames,
+			stats.bytes / stats.frames,
+			stats.full ? 100.0 * stats.bytes / stats.frames /
+				stats.full : 0.0);
+	}
+
+	munmap(fb, fix.smem_len);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * cona_test.c - host test for the hwmem contiguous allocator
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * drivers/misc/hwmem/contig_alloc.c is built into this program with the
+ * stub headers in include/. A table of slots is churned like
+ * hwmem_stress does it: a random slot's buffer is freed if it is live,
+ * else a buffer of random size is allocated into it. Every -c operations
+ * the instance is checked:
+ *  - the areas tile the region in address order, none crosses a 64MiB
+ *    boundary and no two free areas are adjacent (coalescing);
+ *  - every free area is in the bin of its size, every bin entry is a
+ *    free area, and bit n of bin_map is set iff bin n is not empty;
+ *  - the areas in use are the live buffers plus one guard page below
+ *    each 64MiB boundary.
+ *
+ * The same churn is then run with the best fit scan over all areas that
+ * cona_alloc() did before the bins, and the allocation times compared.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../drivers/misc/hwmem/contig_alloc.c"
+
+int cona_verbose;
+
+static unsigned long nr_ops = 400000;
+static unsigned long region_mb = 200;
+static unsigned int nr_slots = 512;
+static unsigned int small_pages = 16;
+static unsigned int large_pages = 2048;
+static unsigned int large_pct = 33;
+static unsigned long check_every = 1;
+static unsigned int seed = 1;
+
+/* A 64MiB aligned region start, as the U8500 hwmem regions have */
+#define REGION_PADDR	0x10000000
+
+struct run_stats {
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long fails;
+	unsigned long checks;
+	unsigned long errors;
+	uint64_t alloc_ns;
+	uint64_t max_alloc_ns;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* The search cona_alloc() did before the bins: best fit over all areas */
+static struct alloc *list_scan_alloc(struct instance *instance, size_t size)
+{
+	size_t best_diff = ~(size_t)0;
+	struct alloc *alloc = NULL, *i;
+
+	list_for_each_entry(i, &instance->alloc_list, list) {
+		size_t diff = i->size - size;
+		if (i->in_use || i->size < size)
+			continue;
+		if (diff < best_diff) {
+			alloc = i;
+			best_diff = diff;
+		}
+	}
+	if (alloc == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	/* Split as cona_alloc() does, which keeps the bins checkable */
+	if (size < alloc->size)
+		return split_allocation(instance, alloc, size);
+	bin_remove(instance, alloc);
+	alloc->in_use = true;
+	return alloc;
+}
+
+static void check_error(struct run_stats *stats, unsigned long op,
+		const char *what, struct alloc *alloc)
+{
+	stats->errors++;
+	if (stats->errors > 10)
+		return;
+	fprintf(stderr, "op %lu: %s", op, what);
+	if (alloc != NULL)
+		fprintf(stderr, " (area 0x%08x, %zu bytes, %s)", alloc->paddr,
+			alloc->size, alloc->in_use ? "used" : "free");
+	fprintf(stderr, "\n");
+}
+
+static void check_instance(struct instance *instance, struct run_stats *stats,
+		unsigned long op, size_t live_bytes)
+{
+	phys_addr_t pos = instance->region_paddr;
+	size_t used = 0;
+	unsigned long nr_free = 0, nr_binned = 0, nr_guards = 0;
+	struct alloc *alloc, *prev = NULL;
+	int bin;
+
+	stats->checks++;
+
+	list_for_each_entry(alloc, &instance->alloc_list, list) {
+		if (alloc->paddr != pos)
+			check_error(stats, op, "hole or overlap", alloc);
+		if (alloc->size == 0 || alloc->size % PAGE_SIZE)
+			check_error(stats, op, "bad size", alloc);
+		if ((alloc->paddr ^ (alloc->paddr + alloc->size - 1)) &
+				~(SZ_64M - 1))
+			check_error(stats, op, "crosses 64MiB", alloc);
+		if (prev != NULL && !prev->in_use && !alloc->in_use)
+			check_error(stats, op, "not coalesced", alloc);
+
+		if (alloc->in_use) {
+			used += alloc->size;
+			/* The guard page below each 64MiB boundary */
+			if (alloc->size == PAGE_SIZE &&
+			    !((alloc->paddr + PAGE_SIZE) & (SZ_64M - 1)))
+				nr_guards++;
+		} else {
+			nr_free++;
+		}
+
+		pos = alloc->paddr + alloc->size;
+		prev = alloc;
+	}
+	if (pos != instance->region_paddr + instance->region_size)
+		check_error(stats, op, "areas do not end at the region end",
+			    NULL);
+
+	for (bin = 0; bin < CONA_NR_BINS; bin++) {
+		if (list_empty(&instance->bins[bin]) ==
+				test_bit(bin, &instance->bin_map))
+			check_error(stats, op, "bin_map out of sync", NULL);
+
+		list_for_each_entry(alloc, &instance->bins[bin], free_list) {
+			if (alloc->in_use)
+				check_error(stats, op, "used area in a bin",
+					    alloc);
+			if (size_to_bin(alloc->size) != bin)
+				check_error(stats, op, "area in wrong bin",
+					    alloc);
+			nr_binned++;
+		}
+	}
+	if (nr_binned != nr_free)
+		check_error(stats, op, "free areas missing from the bins",
+			    NULL);
+
+	/* Guards are never freed, so no live buffer can take their place */
+	if (nr_guards != (instance->region_paddr + instance->region_size - 1) /
+			SZ_64M - instance->region_paddr / SZ_64M)
+		check_error(stats, op, "guard pages lost", NULL);
+	if (used != live_bytes + nr_guards * PAGE_SIZE)
+		check_error(stats, op, "used size does not match live buffers",
+			    NULL);
+}
+
+static size_t random_size(void)
+{
+	unsigned int pages;
+
+	if ((unsigned int)(rand() % 100) < large_pct)
+		pages = 1 + rand() % large_pages;
+	else
+		pages = 1 + rand() % small_pages;
+	return (size_t)pages * PAGE_SIZE;
+}
+
+static int run(bool list_scan, struct run_stats *stats)
+{
+	struct instance *instance;
+	struct alloc **slots;
+	size_t live_bytes = 0;
+	unsigned long op;
+	unsigned int i;
+
+	memset(stats, 0, sizeof(*stats));
+	srand(seed);
+
+	instance = cona_create(list_scan ? "list scan" : "bins", REGION_PADDR,
+			       region_mb << 20);
+	if (IS_ERR(instance)) {
+		fprintf(stderr, "cona_create failed: %ld\n",
+			PTR_ERR(instance));
+		return -1;
+	}
+
+	slots = calloc(nr_slots, sizeof(*slots));
+	if (slots == NULL)
+		return -1;
+
+	for (op = 0; op < nr_ops; op++) {
+		struct alloc **slot = &slots[rand() % nr_slots];
+
+		if (*slot != NULL) {
+			live_bytes -= cona_get_alloc_size(*slot);
+			cona_free(instance, *slot);
+			*slot = NULL;
+			stats->frees++;
+		} else {
+			size_t size = random_size();
+			struct alloc *alloc;
+			uint64_t t0, ns;
+
+			t0 = now_ns();
+			if (list_scan)
+				alloc = list_scan_alloc(instance, size);
+			else
+				alloc = cona_alloc(instance, size);
+			ns = now_ns() - t0;
+
+			stats->alloc_ns += ns;
+			if (ns > stats->max_alloc_ns)
+				stats->max_alloc_ns = ns;
+			stats->allocs++;
+
+			if (IS_ERR(alloc)) {
+				stats->fails++;
+			} else {
+				if (cona_get_alloc_size(alloc) != size)
+					check_error(stats, op, "wrong size",
+						    alloc);
+				live_bytes += size;
+				*slot = alloc;
+			}
+		}
+
+		if (check_every && (op + 1) % check_every == 0)
+			check_instance(instance, stats, op, live_bytes);
+	}
+
+	/* Everything freed must coalesce back to the initial layout */
+	for (i = 0; i < nr_slots; i++)
+		if (slots[i] != NULL)
+			cona_free(instance, slots[i]);
+	check_instance(instance, stats, op, 0);
+
+	clean_alloc_list(instance);
+	free(slots);
+	return 0;
+}
+
+static void print_stats(const char *name, const struct run_stats *stats)
+{
+	printf("%-9s: %lu allocs (%lu failed), %lu frees, %lu checks, "
+	       "%lu errors\n", name, stats->allocs, stats->fails,
+	       stats->frees, stats->checks, stats->errors);
+	printf("%-9s  alloc mean %llu ns, max %llu ns\n", "",
+	       stats->allocs ? (unsigned long long)(stats->alloc_ns /
+						    stats->allocs) : 0ULL,
+	       (unsigned long long)stats->max_alloc_ns);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-n ops] [-m region MiB] [-t slots] [-s small pages]\n"
+		"       [-l large pages] [-p large %%] [-c check every n ops, "
+		"0 for never]\n"
+		"       [-r seed] [-v]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct run_stats bins, scan;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:m:t:s:l:p:c:r:v")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			region_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			nr_slots = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			small_pages = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			large_pages = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			large_pct = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			check_every = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			cona_verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (nr_slots == 0 || small_pages == 0 || large_pages == 0 ||
+	    region_mb == 0 || region_mb > 2048) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (run(false, &bins) < 0 || run(true, &scan) < 0)
+		return 1;
+
+	print_stats("bins", &bins);
+	print_stats("list scan", &scan);
+	if (bins.alloc_ns)
+		printf("list scan / bins alloc time: %.1f\n",
+		       (double)scan.alloc_ns / bins.alloc_ns);
+
+	return bins.errors || scan.errors ? 1 : 0;
+}
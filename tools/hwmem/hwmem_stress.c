@@ -0,0 +1,287 @@
+/*
+ * hwmem_stress.c - allocator stress test for the hwmem driver
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Each thread opens the hwmem device and keeps a table of live buffers.
+ * Every step picks a random slot: a live buffer is released, an empty
+ * slot gets a new buffer of random size. Sizes are drawn from a mix of
+ * small (texture/command buffer like) and large (frame buffer/camera
+ * like) requests, so the run ages the contiguous allocator the way a
+ * long uptime does. Allocation latency is reported as a histogram, and
+ * the allocator's own view (fragmentation, bins, kernel side latency)
+ * can be dumped from debugfs afterwards.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../include/linux/hwmem.h"
+
+#define LAT_BUCKETS 16	/* <1us, then powers of two */
+
+static const char *device = "/dev/" HWMEM_DEFAULT_DEVICE_NAME;
+static const char *debugfs_file;
+static unsigned int nr_threads = 1;
+static unsigned long nr_ops = 100000;
+static unsigned int nr_slots = 256;
+static unsigned int small_pages = 16;
+static unsigned int large_pages = 2048;
+static unsigned int large_pct = 33;
+static unsigned int mem_type = HWMEM_MEM_CONTIGUOUS_SYS;
+static unsigned int seed = 1;
+
+struct thread_stats {
+	pthread_t thread;
+	unsigned int id;
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long fails;
+	uint64_t alloc_ns;
+	uint64_t max_alloc_ns;
+	unsigned long lat_hist[LAT_BUCKETS];
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int lat_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int b = 0;
+
+	while (us && b < LAT_BUCKETS - 1) {
+		us >>= 1;
+		b++;
+	}
+	return b;
+}
+
+static void *stress_thread(void *arg)
+{
+	struct thread_stats *st = arg;
+	struct hwmem_alloc_request req;
+	unsigned int rnd = seed + st->id;
+	unsigned long op;
+	int *slots;
+	int fd;
+	unsigned int i;
+
+	fd = open(device, O_RDWR);
+	if (fd < 0) {
+		perror(device);
+		return NULL;
+	}
+
+	slots = calloc(nr_slots, sizeof(*slots));
+	if (!slots) {
+		close(fd);
+		return NULL;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.flags = HWMEM_ALLOC_HINT_WRITE_COMBINE | HWMEM_ALLOC_HINT_UNCACHED;
+	req.default_access = HWMEM_ACCESS_READ | HWMEM_ACCESS_WRITE;
+	req.mem_type = mem_type;
+
+	for (op = 0; op < nr_ops; op++) {
+		unsigned int slot = rand_r(&rnd) % nr_slots;
+		unsigned int pages;
+		uint64_t t0, dt;
+		int id;
+
+		if (slots[slot] > 0) {
+			if (ioctl(fd, HWMEM_RELEASE_IOC, slots[slot]) < 0)
+				perror("HWMEM_RELEASE_IOC");
+			slots[slot] = 0;
+			st->frees++;
+			continue;
+		}
+
+		if ((unsigned int)(rand_r(&rnd) % 100) < large_pct)
+			pages = 1 + rand_r(&rnd) % large_pages;
+		else
+			pages = 1 + rand_r(&rnd) % small_pages;
+		req.size = pages * getpagesize();
+
+		t0 = now_ns();
+		id = ioctl(fd, HWMEM_ALLOC_IOC, &req);
+		dt = now_ns() - t0;
+
+		if (id <= 0) {
+			st->fails++;
+			continue;
+		}
+
+		slots[slot] = id;
+		st->allocs++;
+		st->alloc_ns += dt;
+		if (dt > st->max_alloc_ns)
+			st->max_alloc_ns = dt;
+		st->lat_hist[lat_bucket(dt)]++;
+	}
+
+	for (i = 0; i < nr_slots; i++)
+		if (slots[i] > 0)
+			ioctl(fd, HWMEM_RELEASE_IOC, slots[i]);
+
+	free(slots);
+	close(fd);
+	return NULL;
+}
+
+static void dump_debugfs(void)
+{
+	char buf[4096];
+	FILE *f;
+
+	f = fopen(debugfs_file, "r");
+	if (!f) {
+		perror(debugfs_file);
+		return;
+	}
+
+	/* Skip the per area lines, print the summary */
+	while (fgets(buf, sizeof(buf), f))
+		if (strncmp(buf, "paddr:", 6))
+			fputs(buf, stdout);
+
+	fclose(f);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -d <dev>      hwmem device (default %s)\n"
+		"  -t <threads>  concurrent clients (default %u)\n"
+		"  -n <ops>      operations per thread (default %lu)\n"
+		"  -k <slots>    live buffers per thread at most (default %u)\n"
+		"  -s <pages>    largest small request (default %u)\n"
+		"  -l <pages>    largest large request (default %u)\n"
+		"  -p <percent>  share of large requests (default %u)\n"
+		"  -m <type>     hwmem_mem_type (default %u, contiguous)\n"
+		"  -r <seed>     random seed (default %u)\n"
+		"  -D <file>     debugfs allocs file to dump afterwards, e.g.\n"
+		"                /sys/kernel/debug/cona/hwmem_cona_allocs\n",
+		prog, device, nr_threads, nr_ops, nr_slots, small_pages,
+		large_pages, large_pct, mem_type, seed);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct thread_stats *st;
+	struct thread_stats total;
+	uint64_t t0, elapsed;
+	unsigned int i;
+	int b;
+	int c;
+
+	while ((c = getopt(argc, argv, "d:t:n:k:s:l:p:m:r:D:h")) != -1) {
+		switch (c) {
+		case 'd':
+			device = optarg;
+			break;
+		case 't':
+			nr_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nr_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			nr_slots = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			small_pages = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			large_pages = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			large_pct = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			mem_type = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			debugfs_file = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!nr_threads || !nr_slots || !small_pages || !large_pages)
+		usage(argv[0]);
+
+	st = calloc(nr_threads, sizeof(*st));
+	if (!st)
+		return 1;
+
+	t0 = now_ns();
+	for (i = 0; i < nr_threads; i++) {
+		st[i].id = i;
+		if (pthread_create(&st[i].thread, NULL, stress_thread, &st[i])) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(st[i].thread, NULL);
+		total.allocs += st[i].allocs;
+		total.frees += st[i].frees;
+		total.fails += st[i].fails;
+		total.alloc_ns += st[i].alloc_ns;
+		if (st[i].max_alloc_ns > total.max_alloc_ns)
+			total.max_alloc_ns = st[i].max_alloc_ns;
+		for (b = 0; b < LAT_BUCKETS; b++)
+			total.lat_hist[b] += st[i].lat_hist[b];
+	}
+	elapsed = now_ns() - t0;
+
+	printf("threads %u, %.3f s: %lu allocs, %lu frees, %lu failed\n",
+	       nr_threads, elapsed / 1e9, total.allocs, total.frees,
+	       total.fails);
+	if (total.allocs)
+		printf("alloc latency: avg %.1f us, max %.1f us\n",
+		       total.alloc_ns / 1e3 / total.allocs,
+		       total.max_alloc_ns / 1e3);
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		if (!total.lat_hist[b])
+			continue;
+		if (b == 0)
+			printf("  <1 us\t\t%lu\n", total.lat_hist[b]);
+		else if (b == LAT_BUCKETS - 1)
+			printf("  >=%u us\t%lu\n", 1U << (b - 1),
+			       total.lat_hist[b]);
+		else
+			printf("  <%u us\t%lu\n", 1U << b, total.lat_hist[b]);
+	}
+
+	if (debugfs_file)
+		dump_debugfs();
+
+	free(st);
+	return total.allocs ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ * Just enough of the kernel headers to build
+ * drivers/misc/hwmem/contig_alloc.c in userspace, without CONFIG_DEBUG_FS
+ * and CONFIG_FLATMEM. The other headers under include/ only pull this
+ * one in. Locking is a no-op: the test is single threaded.
+ */
+#ifndef _TOOLS_HWMEM_KERNEL_H
+#define _TOOLS_HWMEM_KERNEL_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint32_t u32;
+/* As on the U8500 */
+typedef u32 phys_addr_t;
+
+#define PAGE_SHIFT	12
+#define PAGE_SIZE	(1UL << PAGE_SHIFT)
+#define SZ_64M		0x04000000
+
+#define BITS_PER_LONG	(__SIZEOF_LONG__ * 8)
+
+#define min_t(type, x, y)	((type)(x) < (type)(y) ? (type)(x) : (type)(y))
+#define max(x, y)		((x) > (y) ? (x) : (y))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+/* printk and friends, printed only with cona_verbose set */
+extern int cona_verbose;
+
+static inline void cona_printk(const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!cona_verbose)
+		return;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+#define KERN_WARNING	""
+#define printk		cona_printk
+#define pr_info		cona_printk
+#define pr_err		cona_printk
+
+/* err.h */
+#define MAX_ERRNO	4095
+#define IS_ERR_VALUE(x)	((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return IS_ERR_VALUE((unsigned long)ptr);
+}
+
+/* slab.h */
+#define GFP_KERNEL	0
+
+static inline void *kzalloc(size_t size, int flags)
+{
+	(void)flags;
+	return calloc(1, size);
+}
+
+static inline void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+/* mutex.h */
+struct mutex {
+	int locked;
+};
+
+#define DEFINE_MUTEX(m)		struct mutex m = { 0 }
+#define mutex_init(m)		((m)->locked = 0)
+#define mutex_lock(m)		((m)->locked++)
+#define mutex_unlock(m)		((m)->locked--)
+
+/* log2.h */
+#define ilog2(n)	((int)(BITS_PER_LONG - 1 - __builtin_clzl(n)))
+
+/* bitops.h */
+static inline void __set_bit(int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline int test_bit(int nr, const unsigned long *addr)
+{
+	return (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1;
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+		unsigned long size, unsigned long offset)
+{
+	for (; offset < size; offset++)
+		if (test_bit(offset, addr))
+			return offset;
+	return size;
+}
+
+/* list.h */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+		struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new,
+		struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+	list_entry((ptr)->next, type, member)
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_entry(pos->member.next, typeof(*pos), member))
+
+/* vmalloc.h: the region is never touched, only its address is kept */
+#define VM_IOREMAP	0x00000001
+
+struct vm_struct {
+	void *addr;
+	unsigned long size;
+};
+
+static inline struct vm_struct *get_vm_area(unsigned long size,
+		unsigned long flags)
+{
+	struct vm_struct *area = kzalloc(sizeof(*area), GFP_KERNEL);
+
+	(void)flags;
+	if (area != NULL) {
+		area->addr = (void *)0x40000000UL;
+		area->size = size;
+	}
+	return area;
+}
+
+static inline struct vm_struct *remove_vm_area(const void *addr)
+{
+	(void)addr;
+	return NULL;
+}
+
+/* pasr.h */
+#define pasr_put(paddr, size) do {} while (0)
+#define pasr_get(paddr, size) do {} while (0)
+
+#endif
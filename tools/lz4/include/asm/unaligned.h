@@ -0,0 +1,28 @@
+#ifndef _TOOLS_LZ4_UNALIGNED_H
+#define _TOOLS_LZ4_UNALIGNED_H
+
+#include <linux/kernel.h>
+
+static inline u16 get_unaligned_le16(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8;
+}
+
+static inline u32 get_unaligned_le32(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8 | b[2] << 16 | (u32)b[3] << 24;
+}
+
+static inline void put_unaligned_le16(u16 val, void *p)
+{
+	u8 *b = p;
+
+	b[0] = val;
+	b[1] = val >> 8;
+}
+
+#endif
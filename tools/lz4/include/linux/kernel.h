@@ -0,0 +1,41 @@
+/*
+ * Just enough of <linux/kernel.h> and <linux/bitops.h> to build lib/lz4
+ * in userspace. Only freestanding headers are used: the C library's
+ * <endian.h> would define both __LITTLE_ENDIAN and __BIG_ENDIAN, which
+ * lz4defs.h refuses.
+ */
+#ifndef _TOOLS_LZ4_KERNEL_H
+#define _TOOLS_LZ4_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define __LITTLE_ENDIAN 1234
+#else
+#define __BIG_ENDIAN 4321
+#endif
+
+#define BITS_PER_LONG	(__SIZEOF_LONG__ * 8)
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+#define BUILD_BUG_ON(c)	((void)sizeof(char[1 - 2 * !!(c)]))
+
+static inline unsigned long __ffs(unsigned long word)
+{
+	return __builtin_ctzl(word);
+}
+
+static inline unsigned long __fls(unsigned long word)
+{
+	return BITS_PER_LONG - 1 - __builtin_clzl(word);
+}
+
+#endif
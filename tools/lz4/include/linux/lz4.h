@@ -0,0 +1,2 @@
+#include <stddef.h>
+#include "../../../../include/linux/lz4.h"
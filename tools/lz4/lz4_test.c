@@ -0,0 +1,416 @@
+/*
+ * lz4_test.c - checks and times lib/lz4 against the reference liblz4
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Buffers of zeros, short repeated patterns, text, random bytes and a mix
+ * of those (and pages of a file given with -f) are compressed with
+ * lib/lz4 into buffers of exactly lz4_compressbound() bytes, which must
+ * always be enough, and decompressed with both lib/lz4 and liblz4; and
+ * the output of liblz4's compressor is decompressed with lib/lz4. Then
+ * compression into too small buffers must fail cleanly, and corrupted or
+ * truncated streams must decompress to an error or, where liblz4 accepts
+ * them too, to the same data. All buffers end at a PROT_NONE page, so
+ * reading or writing past them crashes the test.
+ *
+ * With -b, compression and decompression of 4 KiB pages are timed for
+ * both.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../include/linux/lz4.h"
+
+typedef uint8_t u8;
+
+/* liblz4, declared here so that only the library itself is needed */
+int LZ4_compress_default(const char *src, char *dst, int src_size,
+			 int dst_capacity);
+int LZ4_decompress_safe(const char *src, char *dst, int compressed_size,
+			int dst_capacity);
+
+#define MAX_LEN		(1 << 17)
+#define PAGE		4096
+#define BENCH_BYTES	(1 << 20)
+
+enum { ZEROS, RUNS, TEXT, RANDOM, MIXED, FILE_PAGES, NKINDS };
+
+static const char * const kind_name[NKINDS] = {
+	"zeros", "runs", "text", "random", "mixed", "file",
+};
+
+static unsigned int seed = 1;
+static unsigned int rounds = 2000;
+static int failures;
+static u8 *file_data;
+static size_t file_len;
+static int nkinds = FILE_PAGES;
+
+static u8 wrkmem[LZ4_MEM_COMPRESS];
+
+static void check(int ok, const char *what, int i)
+{
+	if (!ok && failures++ < 20)
+		printf("FAIL: %s (case %d)\n", what, i);
+}
+
+static unsigned int rnd(unsigned int n)
+{
+	return n ? rand_r(&seed) % n : 0;
+}
+
+/* len bytes ending right before an inaccessible page */
+static u8 *guarded(size_t len)
+{
+	size_t size = (len + PAGE - 1) / PAGE * PAGE;
+	u8 *p;
+
+	p = mmap(NULL, size + PAGE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED || mprotect(p + size, PAGE, PROT_NONE)) {
+		perror("mmap");
+		exit(2);
+	}
+	return p + size - len;
+}
+
+static void unguard(u8 *p, size_t len)
+{
+	size_t size = (len + PAGE - 1) / PAGE * PAGE;
+
+	munmap(p + len - size, size + PAGE);
+}
+
+static void gen(int kind, u8 *p, size_t len)
+{
+	static const char * const words[] = {
+		"the ", "page ", "cache ", "swap ", "zram ", "of ", "and ",
+		"compressed ", "\n", "0x0000 ", "struct ", "return ",
+	};
+	size_t i, n, off;
+	unsigned int period;
+	u8 pat[8];
+
+	switch (kind) {
+	case ZEROS:
+		memset(p, 0, len);
+		break;
+	case RUNS:
+		for (i = 0; i < len; i += n) {
+			period = 1 + rnd(7);
+			for (n = 0; n < period; n++)
+				pat[n] = rnd(4) ? 0 : rand_r(&seed);
+			n = 1 + rnd(300);
+			if (n > len - i)
+				n = len - i;
+			for (off = 0; off < n; off++)
+				p[i + off] = pat[off % period];
+		}
+		break;
+	case TEXT:
+		for (i = 0; i < len; i += n) {
+			const char *w = words[rnd(sizeof(words) /
+						  sizeof(words[0]))];
+
+			n = strlen(w);
+			if (n > len - i)
+				n = len - i;
+			memcpy(p + i, w, n);
+		}
+		break;
+	case RANDOM:
+		for (i = 0; i < len; i++)
+			p[i] = rand_r(&seed);
+		break;
+	case MIXED:
+		for (i = 0; i < len; i += n) {
+			n = 1 + rnd(2000);
+			if (n > len - i)
+				n = len - i;
+			gen(rnd(MIXED), p + i, n);
+		}
+		break;
+	case FILE_PAGES:
+		off = rnd(file_len / PAGE) * PAGE;
+		for (i = 0; i < len; i += n) {
+			n = file_len - off < len - i ? file_len - off : len - i;
+			memcpy(p + i, file_data + off, n);
+			off = 0;
+		}
+		break;
+	}
+}
+
+static void test_roundtrip(void)
+{
+	u8 *src, *c, *out;
+	size_t len, clen, olen, bound;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < rounds; i++) {
+		len = i & 1 ? PAGE : rnd(MAX_LEN + 1);
+		bound = lz4_compressbound(len);
+		src = guarded(len);
+		c = guarded(bound);
+		out = guarded(len);
+		gen(i % nkinds, src, len);
+
+		clen = bound;
+		ret = lz4_compress(src, len, c, &clen, wrkmem);
+		check(ret == 0 && clen <= bound, "compress", i);
+
+		olen = len;
+		ret = lz4_decompress_safe(c, clen, out, &olen);
+		check(ret == 0 && olen == len && !memcmp(out, src, len),
+		      "decompress", i);
+		ret = LZ4_decompress_safe((char *)c, (char *)out, clen, len);
+		check(ret == (int)len && !memcmp(out, src, len),
+		      "liblz4 decompress", i);
+
+		/* liblz4's output */
+		clen = LZ4_compress_default((char *)src, (char *)c, len, bound);
+		check(clen > 0 || len == 0, "liblz4 compress", i);
+		olen = len;
+		ret = lz4_decompress_safe(c, clen, out, &olen);
+		check(ret == 0 && olen == len && !memcmp(out, src, len),
+		      "decompress liblz4 output", i);
+
+		unguard(out, len);
+		unguard(c, bound);
+		unguard(src, len);
+	}
+}
+
+/* compression into a buffer too small for it must fail, not overflow */
+static void test_short_dst(void)
+{
+	static u8 src[MAX_LEN], c[lz4_compressbound(MAX_LEN)];
+	u8 *dst, *out;
+	size_t len, clen, cap, olen;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < rounds; i++) {
+		len = 1 + rnd(i & 1 ? PAGE : MAX_LEN);
+		gen(i % nkinds, src, len);
+		clen = sizeof(c);
+		lz4_compress(src, len, c, &clen, wrkmem);
+
+		cap = rnd(clen + 1);
+		dst = guarded(cap);
+		olen = cap;
+		ret = lz4_compress(src, len, dst, &olen, wrkmem);
+		check(ret == -1 || (cap == clen && olen == clen),
+		      "compress into too small a buffer", i);
+		unguard(dst, cap);
+
+		cap = rnd(len);
+		out = guarded(cap);
+		olen = cap;
+		ret = lz4_decompress_safe(c, clen, out, &olen);
+		check(ret == -1, "decompress into too small a buffer", i);
+		unguard(out, cap);
+	}
+}
+
+/* decompresses with both, which must agree when both succeed */
+static void compare_decompress(const u8 *c, size_t clen, size_t cap, int i)
+{
+	u8 *in, *out1, *out2;
+	size_t olen1 = cap;
+	int ret1, ret2;
+
+	in = guarded(clen);
+	memcpy(in, c, clen);
+	out1 = guarded(cap);
+	out2 = guarded(cap);
+
+	ret1 = lz4_decompress_safe(in, clen, out1, &olen1);
+	ret2 = LZ4_decompress_safe((char *)in, (char *)out2, clen, cap);
+	check(ret1 == 0 || ret1 == -1, "corrupt stream: result", i);
+	check(ret1 || olen1 <= cap, "corrupt stream: length", i);
+	check(ret1 || ret2 < 0 ||
+	      (olen1 == (size_t)ret2 && !memcmp(out1, out2, olen1)),
+	      "corrupt stream: output differs from liblz4", i);
+
+	unguard(out2, cap);
+	unguard(out1, cap);
+	unguard(in, clen);
+}
+
+static void test_corrupt(void)
+{
+	static u8 src[MAX_LEN], c[lz4_compressbound(MAX_LEN)];
+	size_t len, clen, n, off;
+	unsigned int i;
+
+	for (i = 0; i < rounds; i++) {
+		len = 1 + rnd(i & 1 ? PAGE : MAX_LEN);
+		gen(i % nkinds, src, len);
+		clen = sizeof(c);
+		lz4_compress(src, len, c, &clen, wrkmem);
+
+		switch (i % 3) {
+		case 0:		/* flipped bits */
+			for (n = 1 + rnd(8); n; n--)
+				c[rnd(clen)] ^= 1 << rnd(8);
+			break;
+		case 1:		/* random bytes */
+			off = rnd(clen);
+			for (n = rnd(16); n && off < clen; n--)
+				c[off++] = rand_r(&seed);
+			break;
+		case 2:		/* truncated */
+			clen = rnd(clen);
+			break;
+		}
+		compare_decompress(c, clen, len + rnd(64), i);
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH(what, kind, bytes, stmt)					\
+	do {								\
+		double t0 = now(), t;					\
+		int n = 0;						\
+									\
+		do {							\
+			stmt;						\
+			n++;						\
+			t = now() - t0;					\
+		} while (t < 0.5);					\
+		printf("%-8s %-20s %8.1f MB/s\n", kind, what,		\
+		       (double)(bytes) * n / t / 1e6);			\
+	} while (0)
+
+/* compresses or decompresses BENCH_BYTES a page at a time, like zram */
+static void bench(void)
+{
+	static u8 src[BENCH_BYTES], out[BENCH_BYTES];
+	static u8 c[BENCH_BYTES / PAGE][lz4_compressbound(PAGE)];
+	static size_t clen[BENCH_BYTES / PAGE];
+	size_t i, total, olen;
+	int kind;
+
+	for (kind = 0; kind < nkinds; kind++) {
+		for (i = 0; i < BENCH_BYTES; i += PAGE)
+			gen(kind == MIXED ? (int)rnd(MIXED) : kind, src + i,
+			    PAGE);
+		total = 0;
+		for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			clen[i] = sizeof(c[i]);
+			lz4_compress(src + i * PAGE, PAGE, c[i], &clen[i],
+				     wrkmem);
+			total += clen[i];
+		}
+		printf("%-8s ratio %.3f\n", kind_name[kind],
+		       (double)total / BENCH_BYTES);
+
+		BENCH("compress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = sizeof(c[i]);
+			      lz4_compress(src + i * PAGE, PAGE, c[i], &olen,
+					   wrkmem);
+		      });
+		BENCH("liblz4 compress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++)
+			      LZ4_compress_default((char *)src + i * PAGE,
+						   (char *)c[i], PAGE,
+						   sizeof(c[i])));
+		/* liblz4's output was left in c[] */
+		for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			clen[i] = sizeof(c[i]);
+			lz4_compress(src + i * PAGE, PAGE, c[i], &clen[i],
+				     wrkmem);
+		}
+		BENCH("decompress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = PAGE;
+			      lz4_decompress_safe(c[i], clen[i],
+						  out + i * PAGE, &olen);
+		      });
+		BENCH("liblz4 decompress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++)
+			      LZ4_decompress_safe((char *)c[i],
+						  (char *)out + i * PAGE,
+						  clen[i], PAGE));
+	}
+}
+
+static void load_file(const char *name)
+{
+	FILE *f = fopen(name, "rb");
+	size_t n;
+
+	if (f == NULL) {
+		perror(name);
+		exit(2);
+	}
+	file_data = malloc(64 << 20);
+	n = fread(file_data, 1, 64 << 20, f);
+	fclose(f);
+	file_len = n / PAGE * PAGE;
+	if (file_len == 0) {
+		fprintf(stderr, "%s: less than a page\n", name);
+		exit(2);
+	}
+	nkinds = NKINDS;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bf:n:s:")) != -1) {
+		switch (opt) {
+		case 'b':
+			do_bench = 1;
+			break;
+		case 'f':
+			load_file(optarg);
+			break;
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-b] [-f file] [-n rounds] [-s seed]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	test_roundtrip();
+	test_short_dst();
+	test_corrupt();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("all tests passed\n");
+
+	if (do_bench)
+		bench();
+	return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef _TOOLS_LZO_UNALIGNED_H
+#define _TOOLS_LZO_UNALIGNED_H
+
+#include <linux/kernel.h>
+
+#define get_unaligned(p)						\
+	(((const struct { __typeof__(*(p)) __v; }			\
+	   __attribute__((packed)) *)(p))->__v)
+#define put_unaligned(v, p)						\
+	do {								\
+		__typeof__(*(p)) __v = (v);				\
+		memcpy((p), &__v, sizeof(__v));				\
+	} while (0)
+
+static inline u16 get_unaligned_le16(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8;
+}
+
+static inline u32 get_unaligned_le32(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8 | b[2] << 16 | (u32)b[3] << 24;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Just enough of <linux/kernel.h> to build lib/lzo in userspace. Only
+ * freestanding headers are used: the C library's <endian.h> would define
+ * both __LITTLE_ENDIAN and __BIG_ENDIAN, which lzodefs.h refuses.
+ */
+#ifndef _TOOLS_LZO_KERNEL_H
+#define _TOOLS_LZO_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define __LITTLE_ENDIAN 1234
+#else
+#define __BIG_ENDIAN 4321
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS 1
+#endif
+#if defined(__arm__) && defined(__ARM_ARCH)
+#define __LINUX_ARM_ARCH__ __ARM_ARCH
+#endif
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+#define noinline	__attribute__((noinline))
+#define BUILD_BUG_ON(c)	((void)sizeof(char[1 - 2 * !!(c)]))
+
+#endif
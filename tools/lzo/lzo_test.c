@@ -0,0 +1,379 @@
+/*
+ * lzo_test.c - checks and times lib/lzo against an earlier version of it
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * The Makefile links lib/lzo as it is and, with base_ prefixed names, as
+ * of an earlier commit. Buffers of zeros, short repeated patterns, text,
+ * random bytes and a mix of those (and pages of a file given with -f)
+ * are compressed with both compressors, which must agree byte for byte,
+ * and decompressed with both decompressors. Then the compressed streams
+ * are corrupted, truncated and decompressed into too small buffers, and
+ * both decompressors must still return the same result and output. All
+ * buffers end at a PROT_NONE page, so reading or writing past them
+ * crashes the test.
+ *
+ * With -b, compression and decompression of 4 KiB pages are timed for
+ * both versions.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../include/linux/lzo.h"
+
+typedef uint8_t u8;
+
+int base_lzo1x_1_compress(const unsigned char *src, size_t src_len,
+			  unsigned char *dst, size_t *dst_len, void *wrkmem);
+int base_lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
+			       unsigned char *dst, size_t *dst_len);
+
+#define MAX_LEN		(1 << 17)
+#define PAGE		4096
+#define BENCH_BYTES	(1 << 20)
+
+enum { ZEROS, RUNS, TEXT, RANDOM, MIXED, FILE_PAGES, NKINDS };
+
+static const char * const kind_name[NKINDS] = {
+	"zeros", "runs", "text", "random", "mixed", "file",
+};
+
+static unsigned int seed = 1;
+static unsigned int rounds = 2000;
+static int failures;
+static u8 *file_data;
+static size_t file_len;
+static int nkinds = FILE_PAGES;
+
+static u8 wrkmem[LZO1X_1_MEM_COMPRESS];
+
+static void check(int ok, const char *what, int i)
+{
+	if (!ok && failures++ < 20)
+		printf("FAIL: %s (case %d)\n", what, i);
+}
+
+static unsigned int rnd(unsigned int n)
+{
+	return n ? rand_r(&seed) % n : 0;
+}
+
+/* len bytes ending right before an inaccessible page */
+static u8 *guarded(size_t len)
+{
+	size_t size = (len + PAGE - 1) / PAGE * PAGE;
+	u8 *p;
+
+	p = mmap(NULL, size + PAGE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED || mprotect(p + size, PAGE, PROT_NONE)) {
+		perror("mmap");
+		exit(2);
+	}
+	return p + size - len;
+}
+
+static void unguard(u8 *p, size_t len)
+{
+	size_t size = (len + PAGE - 1) / PAGE * PAGE;
+
+	munmap(p + len - size, size + PAGE);
+}
+
+static void gen(int kind, u8 *p, size_t len)
+{
+	static const char * const words[] = {
+		"the ", "page ", "cache ", "swap ", "zram ", "of ", "and ",
+		"compressed ", "\n", "0x0000 ", "struct ", "return ",
+	};
+	size_t i, n, off;
+	unsigned int period;
+	u8 pat[8];
+
+	switch (kind) {
+	case ZEROS:
+		memset(p, 0, len);
+		break;
+	case RUNS:
+		for (i = 0; i < len; i += n) {
+			period = 1 + rnd(7);
+			for (n = 0; n < period; n++)
+				pat[n] = rnd(4) ? 0 : rand_r(&seed);
+			n = 1 + rnd(300);
+			if (n > len - i)
+				n = len - i;
+			for (off = 0; off < n; off++)
+				p[i + off] = pat[off % period];
+		}
+		break;
+	case TEXT:
+		for (i = 0; i < len; i += n) {
+			const char *w = words[rnd(sizeof(words) /
+						  sizeof(words[0]))];
+
+			n = strlen(w);
+			if (n > len - i)
+				n = len - i;
+			memcpy(p + i, w, n);
+		}
+		break;
+	case RANDOM:
+		for (i = 0; i < len; i++)
+			p[i] = rand_r(&seed);
+		break;
+	case MIXED:
+		for (i = 0; i < len; i += n) {
+			n = 1 + rnd(2000);
+			if (n > len - i)
+				n = len - i;
+			gen(rnd(MIXED), p + i, n);
+		}
+		break;
+	case FILE_PAGES:
+		off = rnd(file_len / PAGE) * PAGE;
+		for (i = 0; i < len; i += n) {
+			n = file_len - off < len - i ? file_len - off : len - i;
+			memcpy(p + i, file_data + off, n);
+			off = 0;
+		}
+		break;
+	}
+}
+
+static void test_roundtrip(void)
+{
+	u8 *src, *c1, *c2, *out;
+	size_t len, clen1, clen2, olen;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < rounds; i++) {
+		len = i & 1 ? PAGE : rnd(MAX_LEN + 1);
+		src = guarded(len);
+		c1 = guarded(lzo1x_worst_compress(len));
+		c2 = guarded(lzo1x_worst_compress(len));
+		gen(i % nkinds, src, len);
+
+		clen1 = lzo1x_worst_compress(len);
+		ret = lzo1x_1_compress(src, len, c1, &clen1, wrkmem);
+		check(ret == LZO_E_OK, "compress", i);
+		clen2 = lzo1x_worst_compress(len);
+		ret = base_lzo1x_1_compress(src, len, c2, &clen2, wrkmem);
+		check(ret == LZO_E_OK, "base compress", i);
+		check(clen1 == clen2 && !memcmp(c1, c2, clen1),
+		      "compressed data differs from base", i);
+
+		out = guarded(len);
+		olen = len;
+		ret = lzo1x_decompress_safe(c1, clen1, out, &olen);
+		check(ret == LZO_E_OK && olen == len && !memcmp(out, src, len),
+		      "decompress", i);
+		olen = len;
+		ret = base_lzo1x_decompress_safe(c1, clen1, out, &olen);
+		check(ret == LZO_E_OK && olen == len && !memcmp(out, src, len),
+		      "base decompress", i);
+		unguard(out, len);
+
+		unguard(c2, lzo1x_worst_compress(len));
+		unguard(c1, lzo1x_worst_compress(len));
+		unguard(src, len);
+	}
+}
+
+/* decompresses with both versions, which must agree */
+static void compare_decompress(const u8 *c, size_t clen, size_t cap, int i)
+{
+	u8 *in, *out1, *out2;
+	size_t olen1 = cap, olen2 = cap;
+	int ret1, ret2;
+
+	in = guarded(clen);
+	memcpy(in, c, clen);
+	out1 = guarded(cap);
+	out2 = guarded(cap);
+
+	ret1 = lzo1x_decompress_safe(in, clen, out1, &olen1);
+	ret2 = base_lzo1x_decompress_safe(in, clen, out2, &olen2);
+	check(ret1 == ret2, "corrupt stream: result differs from base", i);
+	check(olen1 == olen2 && olen1 <= cap && !memcmp(out1, out2, olen1),
+	      "corrupt stream: output differs from base", i);
+
+	unguard(out2, cap);
+	unguard(out1, cap);
+	unguard(in, clen);
+}
+
+static void test_corrupt(void)
+{
+	static u8 src[MAX_LEN], c[lzo1x_worst_compress(MAX_LEN)];
+	size_t len, clen, cap, n, off;
+	unsigned int i;
+
+	for (i = 0; i < rounds; i++) {
+		len = 1 + rnd(i & 1 ? PAGE : MAX_LEN);
+		gen(i % nkinds, src, len);
+		clen = sizeof(c);
+		lzo1x_1_compress(src, len, c, &clen, wrkmem);
+
+		/* intact, into too small a buffer */
+		compare_decompress(c, clen, rnd(len), i);
+
+		switch (i % 3) {
+		case 0:		/* flipped bits */
+			for (n = 1 + rnd(8); n; n--)
+				c[rnd(clen)] ^= 1 << rnd(8);
+			break;
+		case 1:		/* random bytes */
+			off = rnd(clen);
+			for (n = rnd(16); n && off < clen; n--)
+				c[off++] = rand_r(&seed);
+			break;
+		case 2:		/* truncated */
+			clen = rnd(clen);
+			break;
+		}
+		cap = len + rnd(64);
+		compare_decompress(c, clen, cap, i);
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH(what, kind, bytes, stmt)					\
+	do {								\
+		double t0 = now(), t;					\
+		int n = 0;						\
+									\
+		do {							\
+			stmt;						\
+			n++;						\
+			t = now() - t0;					\
+		} while (t < 0.5);					\
+		printf("%-8s %-20s %8.1f MB/s\n", kind, what,		\
+		       (double)(bytes) * n / t / 1e6);			\
+	} while (0)
+
+/* compresses or decompresses BENCH_BYTES a page at a time, like zram */
+static void bench(void)
+{
+	static u8 src[BENCH_BYTES], out[BENCH_BYTES];
+	static u8 c[BENCH_BYTES / PAGE][lzo1x_worst_compress(PAGE)];
+	static size_t clen[BENCH_BYTES / PAGE];
+	size_t i, total, olen;
+	int kind;
+
+	for (kind = 0; kind < nkinds; kind++) {
+		for (i = 0; i < BENCH_BYTES; i += PAGE)
+			gen(kind == MIXED ? (int)rnd(MIXED) : kind, src + i,
+			    PAGE);
+		total = 0;
+		for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			clen[i] = sizeof(c[i]);
+			lzo1x_1_compress(src + i * PAGE, PAGE, c[i], &clen[i],
+					 wrkmem);
+			total += clen[i];
+		}
+		printf("%-8s ratio %.3f\n", kind_name[kind],
+		       (double)total / BENCH_BYTES);
+
+		BENCH("compress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = sizeof(c[i]);
+			      lzo1x_1_compress(src + i * PAGE, PAGE, c[i],
+					       &olen, wrkmem);
+		      });
+		BENCH("base compress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = sizeof(c[i]);
+			      base_lzo1x_1_compress(src + i * PAGE, PAGE, c[i],
+						    &olen, wrkmem);
+		      });
+		BENCH("decompress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = PAGE;
+			      lzo1x_decompress_safe(c[i], clen[i],
+						    out + i * PAGE, &olen);
+		      });
+		BENCH("base decompress", kind_name[kind], BENCH_BYTES,
+		      for (i = 0; i < BENCH_BYTES / PAGE; i++) {
+			      olen = PAGE;
+			      base_lzo1x_decompress_safe(c[i], clen[i],
+							 out + i * PAGE, &olen);
+		      });
+	}
+}
+
+static void load_file(const char *name)
+{
+	FILE *f = fopen(name, "rb");
+	size_t n;
+
+	if (f == NULL) {
+		perror(name);
+		exit(2);
+	}
+	file_data = malloc(64 << 20);
+	n = fread(file_data, 1, 64 << 20, f);
+	fclose(f);
+	file_len = n / PAGE * PAGE;
+	if (file_len == 0) {
+		fprintf(stderr, "%s: less than a page\n", name);
+		exit(2);
+	}
+	nkinds = NKINDS;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bf:n:s:")) != -1) {
+		switch (opt) {
+		case 'b':
+			do_bench = 1;
+			break;
+		case 'f':
+			load_file(optarg);
+			break;
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-b] [-f file] [-n rounds] [-s seed]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	test_roundtrip();
+	test_corrupt();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("all tests passed\n");
+
+	if (do_bench)
+		bench();
+	return 0;
+}
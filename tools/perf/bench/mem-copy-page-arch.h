@@ -0,0 +1,22 @@
+
+#ifdef ARCH_X86_64
+
+#define COPY_PAGE_FN(fn, name, desc)		\
+	extern void fn(void *, const void *);
+
+#include "mem-copy-page-x86-64-asm-def.h"
+
+#undef COPY_PAGE_FN
+
+#endif
+
+#ifdef ARCH_ARM
+
+#define COPY_PAGE_FN(fn, name, desc)		\
+	extern void fn(void *, const void *);
+
+#include "mem-copy-page-arm-asm-def.h"
+
+#undef COPY_PAGE_FN
+
+#endif
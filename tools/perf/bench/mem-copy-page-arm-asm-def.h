@@ -0,0 +1,8 @@
+
+COPY_PAGE_FN(__copy_page_arm,
+	"arm",
+	"LDM/STM copy_page() in arch/arm/lib/copy_page.S")
+
+COPY_PAGE_FN(__copy_page_neon,
+	"neon",
+	"NEON copy_page() in arch/arm/lib/mem-neon.S (needs NEON)")
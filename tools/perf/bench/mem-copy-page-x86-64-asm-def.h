@@ -0,0 +1,8 @@
+
+COPY_PAGE_FN(copy_page,
+	"x86-64-unrolled",
+	"unrolled copy_page() in arch/x86/lib/copy_page_64.S")
+
+COPY_PAGE_FN(copy_page_c,
+	"x86-64-rep",
+	"rep movsq copy_page() in arch/x86/lib/copy_page_64.S")
@@ -0,0 +1,141 @@
+/*
+ * mem-copy-page.c
+ *
+ * copy_page: Copying whole pages in various ways, as the kernel does on
+ * copy-on-write and migration
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "sweep.h"
+#include "mem-copy-page-arch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the kernel routines all copy 4KB pages */
+#define COPY_PAGE_SIZE	4096
+
+static const char	*routine	= "default";
+static struct sweep	sweep		= {
+	.length_str	= "1MB",
+	.min_length	= COPY_PAGE_SIZE,
+};
+
+static const struct option options[] = {
+	OPT_SWEEP(sweep),
+	OPT_STRING('r', "routine", &routine, "default",
+		    "Specify routine to copy pages with"),
+	OPT_END()
+};
+
+typedef void (*copy_page_t)(void *, const void *);
+
+struct routine {
+	const char *name;
+	const char *desc;
+	copy_page_t fn;
+};
+
+static void copy_page_memcpy(void *to, const void *from)
+{
+	memcpy(to, from, COPY_PAGE_SIZE);
+}
+
+static struct routine routines[] = {
+	{ "default",
+	  "memcpy() of a page, with memcpy() provided by glibc",
+	  copy_page_memcpy },
+#ifdef ARCH_X86_64
+
+#define COPY_PAGE_FN(fn, name, desc) { name, desc, fn },
+#include "mem-copy-page-x86-64-asm-def.h"
+#undef COPY_PAGE_FN
+
+#endif
+#ifdef ARCH_ARM
+
+#define COPY_PAGE_FN(fn, name, desc) { name, desc, fn },
+#include "mem-copy-page-arm-asm-def.h"
+#undef COPY_PAGE_FN
+
+#endif
+
+	{ NULL,
+	  NULL,
+	  NULL   }
+};
+
+static const char * const bench_mem_copy_page_usage[] = {
+	"perf bench mem copy_page <options>",
+	NULL
+};
+
+static copy_page_t copy_page_fn;
+static char *from, *to;
+
+static void do_copy_page(size_t len)
+{
+	size_t off;
+
+	for (off = 0; off < len; off += COPY_PAGE_SIZE)
+		copy_page_fn(to + off, from + off);
+}
+
+static char *alloc_pages(size_t len)
+{
+	void *p;
+
+	if (posix_memalign(&p, COPY_PAGE_SIZE, len))
+		die("memory allocation failed - maybe length is too large?\n");
+	memset(p, 0, len);
+	return p;
+}
+
+int bench_mem_copy_page(int argc, const char **argv,
+			const char *prefix __used)
+{
+	size_t len;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_copy_page_usage, 0);
+
+	/* whole pages only */
+	len = sweep_length(&sweep) & ~(size_t)(COPY_PAGE_SIZE - 1);
+	if (!len) {
+		fprintf(stderr, "Invalid length:%s (at least %d)\n",
+			sweep.length_str, COPY_PAGE_SIZE);
+		return 1;
+	}
+
+	for (i = 0; routines[i].name; i++) {
+		if (!strcmp(routines[i].name, routine))
+			break;
+	}
+	if (!routines[i].name) {
+		printf("Unknown routine:%s\n", routine);
+		printf("Available routines...\n");
+		for (i = 0; routines[i].name; i++) {
+			printf("\t%s ... %s\n",
+			       routines[i].name, routines[i].desc);
+		}
+		return 1;
+	}
+	copy_page_fn = routines[i].fn;
+
+	from = alloc_pages(len);
+	to = alloc_pages(len);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Copying %zu Pages ...\n\n", len / COPY_PAGE_SIZE);
+
+	sweep_run(&sweep, len, do_copy_page);
+
+	free(from);
+	free(to);
+	return 0;
+}
@@ -0,0 +1,8 @@
+
+MEMCPY_FN(__memcpy_arm,
+	"arm",
+	"LDM/STM memcpy() in arch/arm/lib/memcpy.S")
+
+MEMCPY_FN(__memcpy_neon,
+	"neon",
+	"NEON memcpy() in arch/arm/lib/mem-neon.S (needs NEON)")
@@ -0,0 +1,8 @@
+
+MEMSET_FN(__memset_arm,
+	"arm",
+	"STM memset() in arch/arm/lib/memset.S")
+
+MEMSET_FN(__memset_neon,
+	"neon",
+	"NEON memset() in arch/arm/lib/mem-neon.S (needs NEON)")
@@ -0,0 +1,118 @@
+/*
+ * mem-memset.c
+ *
+ * memset: Simple memory fill in various ways, over one length or a
+ * sweep of them
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "sweep.h"
+#include "mem-memset-arch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char	*routine	= "default";
+static struct sweep	sweep		= {
+	.length_str	= "1MB",
+	.min_length	= 16,
+};
+
+static const struct option options[] = {
+	OPT_SWEEP(sweep),
+	OPT_STRING('r', "routine", &routine, "default",
+		    "Specify routine to fill memory with"),
+	OPT_END()
+};
+
+typedef void *(*memset_t)(void *, int, size_t);
+
+struct routine {
+	const char *name;
+	const char *desc;
+	memset_t fn;
+};
+
+static struct routine routines[] = {
+	{ "default",
+	  "Default memset() provided by glibc",
+	  memset },
+#ifdef ARCH_X86_64
+
+#define MEMSET_FN(fn, name, desc) { name, desc, fn },
+#include "mem-memset-x86-64-asm-def.h"
+#undef MEMSET_FN
+
+#endif
+#ifdef ARCH_ARM
+
+#define MEMSET_FN(fn, name, desc) { name, desc, fn },
+#include "mem-memset-arm-asm-def.h"
+#undef MEMSET_FN
+
+#endif
+
+	{ NULL,
+	  NULL,
+	  NULL   }
+};
+
+static const char * const bench_mem_memset_usage[] = {
+	"perf bench mem memset <options>",
+	NULL
+};
+
+static memset_t memset_fn;
+static void *buf;
+
+static void do_memset(size_t len)
+{
+	memset_fn(buf, 0, len);
+}
+
+int bench_mem_memset(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	size_t len;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_memset_usage, 0);
+
+	len = sweep_length(&sweep);
+	if (!len) {
+		fprintf(stderr, "Invalid length:%s\n", sweep.length_str);
+		return 1;
+	}
+
+	for (i = 0; routines[i].name; i++) {
+		if (!strcmp(routines[i].name, routine))
+			break;
+	}
+	if (!routines[i].name) {
+		printf("Unknown routine:%s\n", routine);
+		printf("Available routines...\n");
+		for (i = 0; routines[i].name; i++) {
+			printf("\t%s ... %s\n",
+			       routines[i].name, routines[i].desc);
+		}
+		return 1;
+	}
+	memset_fn = routines[i].fn;
+
+	buf = zalloc(len);
+	if (!buf)
+		die("memory allocation failed - maybe length is too large?\n");
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Setting %s Bytes ...\n\n", sweep.length_str);
+
+	sweep_run(&sweep, len, do_memset);
+
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,14 @@
+
+/* lib/checksum.c, built under this name by the Makefile */
+extern u32 csum_partial_generic(const void *, int, u32);
+
+#ifdef ARCH_ARM
+
+#define CSUM_FN(fn, name, desc)		\
+	extern u32 fn(const void *, int, u32);
+
+#include "net-csum-arm-asm-def.h"
+
+#undef CSUM_FN
+
+#endif
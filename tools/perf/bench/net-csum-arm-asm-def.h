@@ -0,0 +1,4 @@
+
+CSUM_FN(__csum_partial_arm,
+	"arm",
+	"csum_partial() in arch/arm/lib/csumpartial.S")
@@ -0,0 +1,156 @@
+/*
+ * net-csum.c
+ *
+ * csum: The Internet checksum of a buffer, csum_partial(), in various
+ * ways, over one length or a sweep of them
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "sweep.h"
+#include "net-csum-arch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+static const char	*routine	= "generic";
+static unsigned int	offset;
+static struct sweep	sweep		= {
+	.length_str	= "1MB",
+	.min_length	= 64,
+};
+
+static const struct option options[] = {
+	OPT_SWEEP(sweep),
+	OPT_STRING('r', "routine", &routine, "generic",
+		    "Specify routine to checksum with"),
+	OPT_UINTEGER('o', "offset", &offset,
+		     "Start this many bytes into the buffer, to misalign it"),
+	OPT_END()
+};
+
+typedef u32 (*csum_t)(const void *, int, u32);
+
+struct routine {
+	const char *name;
+	const char *desc;
+	csum_t fn;
+};
+
+static struct routine routines[] = {
+	{ "generic",
+	  "csum_partial() in lib/checksum.c",
+	  csum_partial_generic },
+#ifdef ARCH_ARM
+
+#define CSUM_FN(fn, name, desc) { name, desc, fn },
+#include "net-csum-arm-asm-def.h"
+#undef CSUM_FN
+
+#endif
+
+	{ NULL,
+	  NULL,
+	  NULL   }
+};
+
+static const char * const bench_net_csum_usage[] = {
+	"perf bench net csum <options>",
+	NULL
+};
+
+static csum_t csum_fn;
+static unsigned char *buf;
+static u32 sum;
+
+static void do_csum(size_t len)
+{
+	sum = csum_fn(buf + offset, len, sum);
+}
+
+/* partial sums may differ between routines, their 16-bit folds may not */
+static u16 csum_fold16(u32 csum)
+{
+	csum = (csum & 0xffff) + (csum >> 16);
+	csum = (csum & 0xffff) + (csum >> 16);
+	return csum;
+}
+
+static int csum_check_one(size_t len)
+{
+	u32 seed = 0x12345678;
+
+	if (csum_fold16(csum_fn(buf + offset, len, seed)) ==
+	    csum_fold16(csum_partial_generic(buf + offset, len, seed)))
+		return 0;
+
+	fprintf(stderr, "%s gets length %zu wrong\n", routine, len);
+	return -1;
+}
+
+/* every length up to 256 and the full one, against lib/checksum.c */
+static int csum_check(size_t max)
+{
+	size_t len;
+
+	for (len = 0; len <= 256 && len < max; len++)
+		if (csum_check_one(len))
+			return -1;
+	return csum_check_one(max);
+}
+
+int bench_net_csum(int argc, const char **argv,
+		   const char *prefix __used)
+{
+	size_t i, len;
+	int r;
+
+	argc = parse_options(argc, argv, options,
+			     bench_net_csum_usage, 0);
+
+	len = sweep_length(&sweep);
+	if (!len || len > INT_MAX) {
+		fprintf(stderr, "Invalid length:%s\n", sweep.length_str);
+		return 1;
+	}
+
+	for (r = 0; routines[r].name; r++) {
+		if (!strcmp(routines[r].name, routine))
+			break;
+	}
+	if (!routines[r].name) {
+		printf("Unknown routine:%s\n", routine);
+		printf("Available routines...\n");
+		for (r = 0; routines[r].name; r++) {
+			printf("\t%s ... %s\n",
+			       routines[r].name, routines[r].desc);
+		}
+		return 1;
+	}
+	csum_fn = routines[r].fn;
+
+	buf = malloc(offset + len);
+	if (!buf)
+		die("memory allocation failed - maybe length is too large?\n");
+	srand(1);
+	for (i = 0; i < offset + len; i++)
+		buf[i] = rand();
+
+	if (csum_check(len)) {
+		free(buf);
+		return 1;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Checksumming %s Bytes at offset %u ...\n\n",
+		       sweep.length_str, offset);
+
+	sweep_run(&sweep, len, do_csum);
+
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * sweep.c
+ *
+ * Timing a routine over one buffer length, or over all powers of two up
+ * to it, in Clock/Byte or bytes/sec
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/header.h"
+#include "bench.h"
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <errno.h>
+
+#define K 1024
+
+/* by default, each length is run this many bytes' worth */
+#define SWEEP_BYTES	(64 * K * K)
+
+static int clock_fd = -1;
+
+static struct perf_event_attr clock_attr = {
+	.type		= PERF_TYPE_HARDWARE,
+	.config		= PERF_COUNT_HW_CPU_CYCLES
+};
+
+static void init_clock(void)
+{
+	if (clock_fd >= 0)
+		return;
+
+	clock_fd = sys_perf_event_open(&clock_attr, getpid(), -1, -1, 0);
+
+	if (clock_fd < 0 && errno == ENOSYS)
+		die("No CONFIG_PERF_EVENTS=y kernel support configured?\n");
+	else
+		BUG_ON(clock_fd < 0);
+}
+
+static u64 get_clock(void)
+{
+	int ret;
+	u64 clk;
+
+	ret = read(clock_fd, &clk, sizeof(u64));
+	BUG_ON(ret != sizeof(u64));
+
+	return clk;
+}
+
+static double timeval2double(struct timeval *ts)
+{
+	return (double)ts->tv_sec +
+		(double)ts->tv_usec / (double)1000000;
+}
+
+static void print_length(size_t len)
+{
+	if (len < K || len % K)
+		printf(" %8zuB ", len);
+	else if (len < K * K || len % (K * K))
+		printf(" %7zuKB ", len / K);
+	else
+		printf(" %7zuMB ", len / K / K);
+}
+
+static void print_bps(double x)
+{
+	if (x < K)
+		printf(" %14lf B/Sec", x);
+	else if (x < K * K)
+		printf(" %14lf KB/Sec", x / K);
+	else if (x < K * K * K)
+		printf(" %14lf MB/Sec", x / K / K);
+	else
+		printf(" %14lf GB/Sec", x / K / K / K);
+}
+
+size_t sweep_length(const struct sweep *s)
+{
+	s64 len = perf_atoll(s->length_str);
+
+	return len > 0 ? (size_t)len : 0;
+}
+
+/* Clock/Byte or bytes/sec for len bytes */
+static double sweep_one(const struct sweep *s, sweep_fn_t fn, size_t len)
+{
+	struct timeval tv_start, tv_end, tv_diff;
+	unsigned int i, loops = s->iterations;
+	u64 clock_start, clock_end;
+
+	if (!loops)
+		loops = len < SWEEP_BYTES ? SWEEP_BYTES / len : 1;
+
+	/* fault the buffers in and warm the caches */
+	fn(len);
+
+	if (s->use_clock) {
+		clock_start = get_clock();
+		for (i = 0; i < loops; i++)
+			fn(len);
+		clock_end = get_clock();
+		return (double)(clock_end - clock_start) /
+			((double)len * loops);
+	}
+
+	BUG_ON(gettimeofday(&tv_start, NULL));
+	for (i = 0; i < loops; i++)
+		fn(len);
+	BUG_ON(gettimeofday(&tv_end, NULL));
+
+	timersub(&tv_end, &tv_start, &tv_diff);
+	return (double)len * loops / timeval2double(&tv_diff);
+}
+
+void sweep_run(const struct sweep *s, size_t max, sweep_fn_t fn)
+{
+	size_t len;
+	double result;
+
+	if (s->use_clock)
+		init_clock();
+
+	len = s->sweep && s->min_length < max ? s->min_length : max;
+	for (;;) {
+		result = sweep_one(s, fn, len);
+
+		switch (bench_format) {
+		case BENCH_FORMAT_DEFAULT:
+			if (s->sweep)
+				print_length(len);
+			if (s->use_clock)
+				printf(" %14lf Clock/Byte\n", result);
+			else {
+				print_bps(result);
+				printf("\n");
+			}
+			break;
+		case BENCH_FORMAT_SIMPLE:
+			if (s->sweep)
+				printf("%zu ", len);
+			printf("%lf\n", result);
+			break;
+		default:
+			/* reaching this means there's some disaster: */
+			die("unknown format: %d\n", bench_format);
+			break;
+		}
+
+		if (len == max)
+			break;
+		len = len * 2 < max ? len * 2 : max;
+	}
+}
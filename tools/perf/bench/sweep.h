@@ -0,0 +1,42 @@
+#ifndef BENCH_SWEEP_H
+#define BENCH_SWEEP_H
+
+/*
+ * sweep.h
+ *
+ * Timing a routine over one buffer length, or over all powers of two up
+ * to it, for the mem and net suites
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct sweep {
+	const char	*length_str;	/* the length, or the largest one */
+	size_t		min_length;	/* where --sweep starts */
+	bool		sweep;
+	bool		use_clock;	/* Clock/Byte rather than bytes/sec */
+	unsigned int	iterations;	/* per length; 0 for 64MB worth */
+};
+
+/* the options every suite using a sweep takes */
+#define OPT_SWEEP(s)							\
+	OPT_STRING('l', "length", &(s).length_str, "1MB",		\
+		   "Specify length of memory to work on. "		\
+		   "available unit: B, KB, MB, GB (upper and lower)"),	\
+	OPT_BOOLEAN('s', "sweep", &(s).sweep,				\
+		    "Measure all powers of two up to the length"),	\
+	OPT_UINTEGER('i', "iterations", &(s).iterations,		\
+		     "Specify number of runs per length"),		\
+	OPT_BOOLEAN('c', "clock", &(s).use_clock,			\
+		    "Use CPU clock for measuring")
+
+/* runs the routine under test once over the first len bytes */
+typedef void (*sweep_fn_t)(size_t len);
+
+/* the length given, or 0 if it is not a valid one */
+extern size_t sweep_length(const struct sweep *s);
+/* max is sweep_length(), or what the suite can do of it */
+extern void sweep_run(const struct sweep *s, size_t max, sweep_fn_t fn);
+
+#endif /* BENCH_SWEEP_H */
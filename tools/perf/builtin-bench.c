@@ -13,6 +13,7 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  net   ... network checksumming
  *
  */
 
@@ -52,12 +53,28 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "memset",
+	  "Simple memory fill in various ways",
+	  bench_mem_memset },
+	{ "copy_page",
+	  "Copying whole pages in various ways",
+	  bench_mem_copy_page },
 	suite_all,
 	{ NULL,
 	  NULL,
 	  NULL             }
 };
 
+static struct bench_suite net_suites[] = {
+	{ "csum",
+	  "Internet checksum of a buffer in various ways",
+	  bench_net_csum },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL           }
+};
+
 struct bench_subsys {
 	const char *name;
 	const char *summary;
@@ -71,6 +88,9 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "net",
+	  "network checksumming",
+	  net_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },
@@ -0,0 +1,40 @@
+
+#ifndef PERF_ASM_ASSEMBLER_H
+#define PERF_ASM_ASSEMBLER_H
+
+/*
+ * assembler.h ... dummy header file for including arch/arm/lib/memcpy.S,
+ * memset.S, copy_page.S, csumpartial.S and mem-neon.S, for ARMv7 userspace
+ */
+
+#define __LINUX_ARM_ARCH__	7
+
+#define PLD(code...)	code
+#define CALGN(code...)
+#define W(instr)	instr
+
+#ifndef __ARMEB__
+#define pull		lsr
+#define push		lsl
+#define get_byte_0	lsl #0
+#define get_byte_1	lsr #8
+#define get_byte_2	lsr #16
+#define get_byte_3	lsr #24
+#define put_byte_0	lsl #0
+#define put_byte_1	lsl #8
+#define put_byte_2	lsl #16
+#define put_byte_3	lsl #24
+#else
+#define pull		lsl
+#define push		lsr
+#define get_byte_0	lsr #24
+#define get_byte_1	lsr #16
+#define get_byte_2	lsr #8
+#define get_byte_3	lsl #0
+#define put_byte_0	lsl #24
+#define put_byte_1	lsl #16
+#define put_byte_2	lsl #8
+#define put_byte_3	lsl #0
+#endif
+
+#endif	/* PERF_ASM_ASSEMBLER_H */
@@ -0,0 +1,12 @@
+
+#ifndef PERF_ASM_CACHE_H
+#define PERF_ASM_CACHE_H
+
+/*
+ * cache.h ... dummy header file for including arch/arm/lib/copy_page.S;
+ * the line size of the Cortex-A8 and A9
+ */
+
+#define L1_CACHE_BYTES	32
+
+#endif	/* PERF_ASM_CACHE_H */
@@ -2,8 +2,12 @@
 #ifndef PERF_CPUFEATURE_H
 #define PERF_CPUFEATURE_H
 
-/* cpufeature.h ... dummy header file for including arch/x86/lib/memcpy_64.S */
+/*
+ * cpufeature.h ... dummy header file for including arch/x86/lib/memcpy_64.S,
+ * memset_64.S and copy_page_64.S
+ */
 
 #define X86_FEATURE_REP_GOOD 0
+#define X86_FEATURE_ERMS 0
 
 #endif	/* PERF_CPUFEATURE_H */
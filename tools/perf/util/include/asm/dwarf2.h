@@ -2,10 +2,18 @@
 #ifndef PERF_DWARF2_H
 #define PERF_DWARF2_H
 
-/* dwarf2.h ... dummy header file for including arch/x86/lib/memcpy_64.S */
+/*
+ * dwarf2.h ... dummy header file for including arch/x86/lib/memcpy_64.S,
+ * memset_64.S and copy_page_64.S
+ */
 
 #define CFI_STARTPROC
 #define CFI_ENDPROC
+#define CFI_REMEMBER_STATE
+#define CFI_RESTORE_STATE
+#define CFI_ADJUST_CFA_OFFSET	#
+#define CFI_REL_OFFSET		#
+#define CFI_RESTORE		#
 
 #endif	/* PERF_DWARF2_H */
 
@@ -2,7 +2,11 @@
 #ifndef PERF_LINUX_LINKAGE_H_
 #define PERF_LINUX_LINKAGE_H_
 
-/* linkage.h ... for including arch/x86/lib/memcpy_64.S */
+/* linkage.h ... for including arch/x86/lib/memcpy_64.S and friends */
+
+#ifdef __ASSEMBLY__
+#define ALIGN	.p2align 4
+#endif
 
 #define ENTRY(name)				\
 	.globl name;				\
@@ -0,0 +1,47 @@
+
+#ifndef PERF_NET_CHECKSUM_H
+#define PERF_NET_CHECKSUM_H
+
+/* checksum.h ... dummy header file for including lib/checksum.c */
+
+#include <string.h>
+#include <errno.h>
+#include <linux/types.h>
+
+/*
+ * lib/checksum.c tells the byte order by which of these is defined, as
+ * with the kernel's byteorder headers. glibc's <endian.h> defines both,
+ * so it stays out of lib/checksum.c and the compiler says which applies.
+ */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#ifndef __LITTLE_ENDIAN
+#define __LITTLE_ENDIAN 1234
+#endif
+#else
+#ifndef __BIG_ENDIAN
+#define __BIG_ENDIAN 4321
+#endif
+#endif
+
+#define __force
+#ifndef __user
+#define __user
+#endif
+
+typedef __u32 u32;
+typedef __u16 __sum16;
+typedef __u32 __wsum;
+typedef __u32 __be32;
+
+#define __copy_from_user(to, from, n)	(memcpy(to, from, n), 0)
+
+__sum16 ip_fast_csum(const void *iph, unsigned int ihl);
+__wsum csum_partial(const void *buff, int len, __wsum sum);
+__sum16 ip_compute_csum(const void *buff, int len);
+__wsum csum_partial_copy_from_user(const void __user *src, void *dst,
+				   int len, __wsum sum, int *csum_err);
+__wsum csum_partial_copy(const void *src, void *dst, int len, __wsum sum);
+__wsum csum_tcpudp_nofold(__be32 saddr, __be32 daddr, unsigned short len,
+			  unsigned short proto, __wsum sum);
+
+#endif	/* PERF_NET_CHECKSUM_H */
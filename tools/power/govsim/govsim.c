@@ -0,0 +1,904 @@
+/*
+ * govsim -- replay recorded CPU load traces through models of the
+ * cpufreq governors and compare them offline.
+ *
+ * Copyright (C) 2013
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * The platform is modelled after drivers/cpufreq/dbx500-cpufreq.c: all
+ * CPUs share one clock (CPUFREQ_SHARED_TYPE_ALL) and the frequency table
+ * is the db8500 ARM OPP table from arch/arm/mach-ux500/devices-db8500.c,
+ * with the MAX_OPP entry filled in as db8500_prcmu_update_freq() does.
+ *
+ * The governor decision functions below are transcriptions of the
+ * sampling paths of the in-tree governors, fed with the same load
+ * arithmetic as drivers/cpufreq/cpufreq_governor.c.
+ *
+ * Trace format, one burst of work per line:
+ *
+ *	<release_us> <cpu> <busy_us> [<deadline_us>]
+ *
+ * busy_us is the time the burst kept the CPU busy at the frequency it was
+ * recorded at ("freq <khz>" line, default: the highest OPP). A burst with
+ * a deadline is a frame; it misses if it completes more than deadline_us
+ * after its release, or not at all by the end of the run. Latencies only
+ * cover the frames that completed. Lines starting with '#' are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define MAX_CPUS	4
+#define MAX_OPPS	8
+#define STEP_US		100ULL
+#define HZ		100
+#define JIFFY_US	(1000000 / HZ)
+
+/* energy model: P = Ceff * V^2 * f while busy, plus leakage * V always */
+#define CEFF_PF		500	/* per CPU, picofarad */
+#define LEAK_UA_PER_MV	50	/* per CPU, microamps per millivolt */
+
+enum relation { RELATION_L, RELATION_H };
+
+struct opp {
+	unsigned int khz;
+	unsigned int mv;
+};
+
+struct platform {
+	const char *name;
+	struct opp opp[MAX_OPPS];
+	int nr_opps;
+};
+
+/*
+ * ARM OPPs: EXTCLK (200 MHz), 50% (400 MHz), 100% (800 MHz) and MAX_OPP,
+ * whose frequency depends on the PRCMU firmware project. Voltages are
+ * nominal Varm values.
+ */
+static struct platform platforms[] = {
+	{
+		.name = "db8500",
+		.opp = { { 200000, 1000 }, { 400000, 1000 },
+			 { 800000, 1200 }, { 1000000, 1350 } },
+		.nr_opps = 4,
+	},
+	{
+		.name = "db8520",
+		.opp = { { 200000, 1000 }, { 400000, 1000 },
+			 { 800000, 1200 }, { 1150000, 1350 } },
+		.nr_opps = 4,
+	},
+	{
+		.name = "db8500-nomax",
+		.opp = { { 200000, 1000 }, { 400000, 1000 },
+			 { 800000, 1200 } },
+		.nr_opps = 3,
+	},
+};
+
+struct burst {
+	unsigned long long release;
+	unsigned long long deadline;	/* absolute, 0 = none */
+	unsigned long long work;	/* kHz * us */
+	int cpu;
+	int finished;
+};
+
+struct trace {
+	struct burst *b;
+	int nr;
+	int alloc;
+	int nr_cpus;
+	unsigned long long end;
+};
+
+/* idle accounting as exposed by get_cpu_{idle,iowait}_time_us() */
+struct load_snap {
+	unsigned long long wall;
+	unsigned long long idle;
+};
+
+struct cpu_state {
+	int head;		/* oldest burst that may still be pending */
+	int next;		/* next burst of the trace to look at */
+	int cur;		/* burst running, -1 if idle */
+	unsigned long long done;
+	unsigned long long idle_us;
+	unsigned long long busy_us;
+	int queued;		/* released, not completed */
+	struct load_snap prev;
+	/* used by the 'sched' model */
+	unsigned long long util;	/* 0..1024 */
+};
+
+struct sim {
+	const struct platform *plat;
+	const struct trace *tr;
+	unsigned long long now;
+	int nr_cpus;
+	struct cpu_state cpu[MAX_CPUS];
+	unsigned int cur;		/* current frequency, kHz */
+	unsigned int min, max;
+	unsigned long long last_change;
+	/* results */
+	unsigned long long residency[MAX_OPPS];
+	unsigned long long energy_nj;
+	unsigned int transitions;
+	unsigned int frames;
+	unsigned int misses;
+	unsigned long long latency_sum;
+	unsigned long long latency_max;
+};
+
+struct governor {
+	const char *name;
+	void (*start)(struct sim *s);
+	/* returns the next sampling time, in usecs from now */
+	unsigned long long (*sample)(struct sim *s);
+};
+
+static int verbose;
+
+/************************** helpers ************************/
+
+static int opp_index(const struct platform *p, unsigned int khz)
+{
+	int i;
+
+	for (i = 0; i < p->nr_opps; i++)
+		if (p->opp[i].khz == khz)
+			return i;
+	return 0;
+}
+
+/* cpufreq_frequency_table_target() */
+static unsigned int table_target(struct sim *s, unsigned int target,
+				 enum relation rel)
+{
+	const struct platform *p = s->plat;
+	int i;
+
+	if (target < s->min)
+		target = s->min;
+	if (target > s->max)
+		target = s->max;
+
+	if (rel == RELATION_L) {
+		for (i = 0; i < p->nr_opps; i++)
+			if (p->opp[i].khz >= target)
+				return p->opp[i].khz;
+		return s->max;
+	}
+
+	for (i = p->nr_opps - 1; i >= 0; i--)
+		if (p->opp[i].khz <= target)
+			return p->opp[i].khz;
+	return s->min;
+}
+
+/* __cpufreq_driver_target() */
+static void driver_target(struct sim *s, unsigned int target,
+			  enum relation rel)
+{
+	unsigned int f = table_target(s, target, rel);
+
+	if (f == s->cur)
+		return;
+	if (verbose > 1)
+		fprintf(stderr, "%10llu: %u -> %u kHz\n", s->now, s->cur, f);
+	s->cur = f;
+	s->last_change = s->now;
+	s->transitions++;
+}
+
+/* cpufreq_gov_calc_load() */
+static unsigned int calc_load(unsigned long long wall, unsigned long long idle)
+{
+	if (!wall || idle >= wall)
+		return 0;
+	return (unsigned int)(100 * (wall - idle) / wall);
+}
+
+static void snap(struct sim *s, int cpu, struct load_snap *ls)
+{
+	ls->wall = s->now;
+	ls->idle = s->cpu[cpu].idle_us;
+}
+
+/* cpufreq_gov_load_update() */
+static unsigned int load_update(struct sim *s, int cpu, struct load_snap *prev)
+{
+	struct load_snap now;
+	unsigned int load;
+
+	snap(s, cpu, &now);
+	load = calc_load(now.wall - prev->wall, now.idle - prev->idle);
+	*prev = now;
+	return load;
+}
+
+static int nr_queued(struct sim *s)
+{
+	int i, n = 0;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		n += s->cpu[i].queued;
+	return n;
+}
+
+/************************** performance / powersave ************************/
+
+static void performance_start(struct sim *s)
+{
+	driver_target(s, s->max, RELATION_H);
+}
+
+static void powersave_start(struct sim *s)
+{
+	driver_target(s, s->min, RELATION_L);
+}
+
+static unsigned long long static_sample(struct sim *s)
+{
+	return 1000000;
+}
+
+/************************** ondemand ************************/
+
+#define OD_SAMPLING_RATE	20000
+#define OD_UP_THRESHOLD		80
+#define OD_DOWN_DIFFERENTIAL	10
+
+static void ondemand_start(struct sim *s)
+{
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		snap(s, i, &s->cpu[i].prev);
+}
+
+static unsigned long long ondemand_sample(struct sim *s)
+{
+	unsigned int max_load_freq = 0;
+	unsigned int load;
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++) {
+		load = load_update(s, i, &s->cpu[i].prev);
+		if (load * s->cur > max_load_freq)
+			max_load_freq = load * s->cur;
+	}
+
+	if (max_load_freq > OD_UP_THRESHOLD * s->cur) {
+		driver_target(s, s->max, RELATION_H);
+	} else if (max_load_freq <
+		   (OD_UP_THRESHOLD - OD_DOWN_DIFFERENTIAL) * s->cur) {
+		driver_target(s, max_load_freq /
+			      (OD_UP_THRESHOLD - OD_DOWN_DIFFERENTIAL),
+			      RELATION_L);
+	}
+
+	return OD_SAMPLING_RATE;
+}
+
+/************************** interactive ************************/
+
+#define IA_TIMER_RATE		20000
+#define IA_GO_HISPEED_LOAD	85
+#define IA_MIN_SAMPLE_TIME	30000
+#define IA_ABOVE_HISPEED_DELAY	IA_TIMER_RATE
+
+static struct {
+	struct load_snap change[MAX_CPUS];
+	unsigned int hispeed_freq;
+	unsigned int target_freq;
+	unsigned int floor_freq;
+	unsigned long long floor_validate_time;
+	unsigned long long freq_change_time;
+} ia;
+
+static void interactive_start(struct sim *s)
+{
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++) {
+		snap(s, i, &s->cpu[i].prev);
+		ia.change[i] = s->cpu[i].prev;
+	}
+	ia.hispeed_freq = s->max;
+	ia.target_freq = s->cur;
+	ia.floor_freq = s->cur;
+	ia.floor_validate_time = s->now;
+	ia.freq_change_time = s->now;
+}
+
+/* cpufreq_interactive_get_target(), jump boost policy */
+static unsigned int interactive_get_target(struct sim *s, unsigned int load)
+{
+	unsigned int target;
+
+	if (load >= IA_GO_HISPEED_LOAD) {
+		if (ia.target_freq <= s->min) {
+			target = ia.hispeed_freq;
+		} else {
+			target = s->max * load / 100;
+			if (target < ia.hispeed_freq)
+				target = ia.hispeed_freq;
+			if (ia.target_freq == ia.hispeed_freq &&
+			    target > ia.hispeed_freq &&
+			    s->now - ia.freq_change_time <
+			    IA_ABOVE_HISPEED_DELAY)
+				target = ia.target_freq;
+		}
+	} else {
+		target = s->max * load / 100;
+	}
+
+	return target < s->max ? target : s->max;
+}
+
+static unsigned long long interactive_sample(struct sim *s)
+{
+	unsigned int new_freq = 0;
+	unsigned int load, since_change, f;
+	struct load_snap now;
+	int i;
+
+	/* the policy runs at the highest speed any of its CPUs asks for */
+	for (i = 0; i < s->nr_cpus; i++) {
+		load = load_update(s, i, &s->cpu[i].prev);
+		snap(s, i, &now);
+		since_change = calc_load(now.wall - ia.change[i].wall,
+					 now.idle - ia.change[i].idle);
+		if (since_change > load)
+			load = since_change;
+		f = table_target(s, interactive_get_target(s, load),
+				 RELATION_H);
+		if (f > new_freq)
+			new_freq = f;
+	}
+
+	if (new_freq < ia.floor_freq &&
+	    s->now - ia.floor_validate_time < IA_MIN_SAMPLE_TIME)
+		return IA_TIMER_RATE;
+
+	ia.floor_freq = new_freq;
+	ia.floor_validate_time = s->now;
+
+	if (new_freq != ia.target_freq) {
+		ia.target_freq = new_freq;
+		driver_target(s, new_freq, RELATION_H);
+		ia.freq_change_time = s->now;
+		for (i = 0; i < s->nr_cpus; i++)
+			snap(s, i, &ia.change[i]);
+	}
+
+	return IA_TIMER_RATE;
+}
+
+/************************** smartassV2 ************************/
+
+#define SA_AWAKE_IDEAL_FREQ	972000
+#define SA_RAMP_UP_STEP		270000
+#define SA_RAMP_DOWN_STEP	270000
+#define SA_MAX_CPU_LOAD		50
+#define SA_MIN_CPU_LOAD		25
+#define SA_UP_RATE_US		48000
+#define SA_DOWN_RATE_US		99000
+#define SA_SAMPLE_RATE		(2 * JIFFY_US)
+
+static void smartass_start(struct sim *s)
+{
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		snap(s, i, &s->cpu[i].prev);
+}
+
+/*
+ * target_freq(): if the preferred relation lands on the current frequency,
+ * retry with the other one so a ramp always moves by at least one OPP.
+ */
+static void smartass_target(struct sim *s, unsigned int new_freq,
+			    unsigned int old, enum relation rel)
+{
+	unsigned int f;
+
+	if (new_freq == old)
+		return;
+	f = table_target(s, new_freq, rel);
+	if (f == old) {
+		if (new_freq > old && rel == RELATION_H)
+			f = table_target(s, new_freq, RELATION_L);
+		else if (new_freq < old && rel == RELATION_L)
+			f = table_target(s, new_freq, RELATION_H);
+	}
+	driver_target(s, f, rel);
+}
+
+static unsigned long long smartass_sample(struct sim *s)
+{
+	unsigned int ideal = SA_AWAKE_IDEAL_FREQ;
+	unsigned int old = s->cur;
+	unsigned int load = 0, l;
+	int no_idle = 0;
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++) {
+		unsigned long long idle = s->cpu[i].idle_us -
+					  s->cpu[i].prev.idle;
+
+		l = load_update(s, i, &s->cpu[i].prev);
+		if (l > load)
+			load = l;
+		if (!idle)
+			no_idle = 1;
+	}
+
+	if (load > SA_MAX_CPU_LOAD || no_idle) {
+		/* ramping up needs another runnable task than the kworker */
+		if (old >= s->max || !nr_queued(s))
+			return SA_SAMPLE_RATE;
+		if (old >= ideal && !no_idle &&
+		    s->now - s->last_change < SA_UP_RATE_US)
+			return SA_SAMPLE_RATE;
+
+		if (old < ideal)
+			smartass_target(s, ideal, old, RELATION_L);
+		else if (SA_RAMP_UP_STEP)
+			smartass_target(s, old + SA_RAMP_UP_STEP, old,
+					RELATION_H);
+		else
+			smartass_target(s, s->max, old, RELATION_H);
+	} else if (load < SA_MIN_CPU_LOAD && old > s->min &&
+		   (old > ideal ||
+		    s->now - s->last_change >= SA_DOWN_RATE_US)) {
+		if (old > ideal)
+			smartass_target(s, ideal, old, RELATION_H);
+		else if (SA_RAMP_DOWN_STEP)
+			smartass_target(s, old - SA_RAMP_DOWN_STEP, old,
+					RELATION_L);
+		else
+			smartass_target(s, old * load / SA_MAX_CPU_LOAD, old,
+					RELATION_L);
+	}
+
+	return SA_SAMPLE_RATE;
+}
+
+/************************** sakuractive / abyssplug ************************/
+
+#define HP_SAMPLING_PERIOD	100000
+#define HP_UP_THRESHOLD		80
+#define HP_DOWN_DIFFERENTIAL	10
+
+static int hp_first;
+
+static void hotplug_start(struct sim *s)
+{
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		snap(s, i, &s->cpu[i].prev);
+	hp_first = 1;
+}
+
+/*
+ * dbs_check_cpu(). CPU hotplug is not modelled: the auxiliary CPU stays
+ * online, so only the frequency half of the policy is evaluated.
+ */
+static unsigned long long hotplug_sample(struct sim *s)
+{
+	unsigned int max_load = 0, load;
+	unsigned int max_load_freq;
+	int i;
+
+	/* the first sample is deferred by boost_timeout (30 periods) */
+	if (hp_first) {
+		hp_first = 0;
+		for (i = 0; i < s->nr_cpus; i++)
+			snap(s, i, &s->cpu[i].prev);
+		return 30 * HP_SAMPLING_PERIOD;
+	}
+
+	for (i = 0; i < s->nr_cpus; i++) {
+		load = load_update(s, i, &s->cpu[i].prev);
+		if (load > max_load)
+			max_load = load;
+	}
+	max_load_freq = max_load * s->cur;
+
+	if (max_load > HP_UP_THRESHOLD) {
+		driver_target(s, s->max, RELATION_H);
+		return HP_SAMPLING_PERIOD;
+	}
+
+	if (max_load_freq <
+	    (HP_UP_THRESHOLD - HP_DOWN_DIFFERENTIAL) * s->cur &&
+	    s->cur > s->min)
+		driver_target(s, max_load_freq /
+			      (HP_UP_THRESHOLD - HP_DOWN_DIFFERENTIAL),
+			      RELATION_L);
+
+	return HP_SAMPLING_PERIOD;
+}
+
+/************************** sched ************************/
+
+#define SCHED_LOAD_SCALE	1024
+#define SCHED_UTIL_TAU_US	8000
+#define SCHED_HEADROOM		25
+#define SCHED_DOWN_DELAY	20000
+
+static unsigned long long sched_raise_time;
+
+static void sched_start(struct sim *s)
+{
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		s->cpu[i].util = 0;
+	sched_raise_time = s->now;
+}
+
+/*
+ * cpufreq_sched_update(). The scheduler reports on every enqueue, dequeue
+ * and tick; evaluating every simulation step is the same to within a step.
+ */
+static unsigned long long sched_sample(struct sim *s)
+{
+	unsigned long long max_util = 0, f;
+	unsigned int new_freq;
+	int i;
+
+	for (i = 0; i < s->nr_cpus; i++)
+		if (s->cpu[i].util > max_util)
+			max_util = s->cpu[i].util;
+
+	f = (unsigned long long)s->max * max_util * (100 + SCHED_HEADROOM);
+	f /= 100 * SCHED_LOAD_SCALE;
+	new_freq = table_target(s, (unsigned int)f, RELATION_L);
+
+	if (new_freq < s->cur &&
+	    s->now - sched_raise_time < SCHED_DOWN_DELAY)
+		return STEP_US;
+	if (new_freq > s->cur)
+		sched_raise_time = s->now;
+	driver_target(s, new_freq, RELATION_L);
+
+	return STEP_US;
+}
+
+static struct governor governors[] = {
+	{ "performance", performance_start, static_sample },
+	{ "powersave", powersave_start, static_sample },
+	{ "ondemand", ondemand_start, ondemand_sample },
+	{ "interactive", interactive_start, interactive_sample },
+	{ "smartassV2", smartass_start, smartass_sample },
+	{ "sakuractive", hotplug_start, hotplug_sample },
+	{ "sched", sched_start, sched_sample },
+};
+
+#define NR_GOVERNORS (sizeof(governors) / sizeof(governors[0]))
+
+/************************** simulation ************************/
+
+static void step_cpu(struct sim *s, int c)
+{
+	struct cpu_state *cs = &s->cpu[c];
+	const struct trace *tr = s->tr;
+	unsigned long long budget = s->cur * STEP_US;
+	unsigned long long running = 0;
+
+	/* release bursts due by now into the run queue */
+	while (cs->next < tr->nr && tr->b[cs->next].release <= s->now) {
+		if (tr->b[cs->next].cpu == c)
+			cs->queued++;
+		cs->next++;
+	}
+
+	while (budget && cs->queued) {
+		const struct burst *b;
+		unsigned long long left, use;
+
+		if (cs->cur < 0) {
+			/* FIFO: oldest released burst for this CPU */
+			while (tr->b[cs->head].cpu != c ||
+			       tr->b[cs->head].finished)
+				cs->head++;
+			cs->cur = cs->head;
+			cs->done = 0;
+		}
+
+		b = &tr->b[cs->cur];
+		left = b->work - cs->done;
+		use = left < budget ? left : budget;
+		cs->done += use;
+		budget -= use;
+		running += use;
+
+		if (cs->done >= b->work) {
+			unsigned long long fin = s->now +
+				(running + s->cur - 1) / s->cur;
+			unsigned long long lat = fin - b->release;
+
+			if (b->deadline) {
+				s->frames++;
+				s->latency_sum += lat;
+				if (lat > s->latency_max)
+					s->latency_max = lat;
+				if (fin > b->deadline)
+					s->misses++;
+			}
+			tr->b[cs->cur].finished = 1;
+			cs->queued--;
+			cs->cur = -1;
+		}
+	}
+
+	running = (running + s->cur - 1) / s->cur;
+	if (running > STEP_US)
+		running = STEP_US;
+	cs->busy_us += running;
+	cs->idle_us += STEP_US - running;
+
+	/* PELT-like utilisation for the 'sched' model */
+	cs->util += ((long long)(running * SCHED_LOAD_SCALE / STEP_US) -
+		     (long long)cs->util) * (long long)STEP_US /
+		    SCHED_UTIL_TAU_US;
+
+	{
+		const struct opp *o = &s->plat->opp[opp_index(s->plat,
+							       s->cur)];
+		unsigned long long mv = o->mv;
+
+		/* pF * mV^2 * kHz * us = 1e-12 * 1e-6 * 1e3 * 1e-6 J */
+		s->energy_nj += CEFF_PF * mv * mv / 1000 * s->cur / 1000 *
+				running / 1000000;
+		/* uA/mV * mV * mV * us = 1e-6 * 1e-3 * 1e-6 J */
+		s->energy_nj += LEAK_UA_PER_MV * mv * mv * STEP_US / 1000000;
+	}
+}
+
+static void restore_trace(const struct trace *tr)
+{
+	int i;
+
+	for (i = 0; i < tr->nr; i++)
+		tr->b[i].finished = 0;
+}
+
+static void run(const struct platform *p, const struct trace *tr,
+		struct governor *g)
+{
+	struct sim s;
+	unsigned long long next_sample, total = 0;
+	unsigned long long end = tr->end + 1000000;
+	int c, i;
+
+	memset(&s, 0, sizeof(s));
+	s.plat = p;
+	s.tr = tr;
+	s.nr_cpus = tr->nr_cpus;
+	s.min = p->opp[0].khz;
+	s.max = p->opp[p->nr_opps - 1].khz;
+	s.cur = s.max;	/* the boot loader leaves the CPU at full speed */
+	for (c = 0; c < s.nr_cpus; c++)
+		s.cpu[c].cur = -1;
+
+	restore_trace(tr);
+	g->start(&s);
+	next_sample = 0;
+
+	for (s.now = 0; s.now < end; s.now += STEP_US) {
+		if (s.now >= next_sample)
+			next_sample = s.now + g->sample(&s);
+
+		s.residency[opp_index(p, s.cur)] += STEP_US;
+		for (c = 0; c < s.nr_cpus; c++)
+			step_cpu(&s, c);
+	}
+
+	/* frames due within the window that never completed missed too */
+	for (i = 0; i < tr->nr; i++) {
+		if (tr->b[i].deadline && tr->b[i].deadline < end &&
+		    !tr->b[i].finished) {
+			s.frames++;
+			s.misses++;
+		}
+	}
+
+	for (i = 0; i < p->nr_opps; i++)
+		total += s.residency[i];
+
+	printf("%-12s %10.1f %6u/%-6u %8.2f %8.2f %6u ", g->name,
+	       s.energy_nj / 1e6, s.misses, s.frames,
+	       s.frames ? s.latency_sum / 1000.0 / s.frames : 0.0,
+	       s.latency_max / 1000.0, s.transitions);
+	for (i = 0; i < p->nr_opps; i++)
+		printf(" %5.1f", 100.0 * s.residency[i] / total);
+	printf("\n");
+}
+
+/************************** trace input ************************/
+
+static void add_burst(struct trace *tr, unsigned long long rel, int cpu,
+		      unsigned long long work, unsigned long long dl)
+{
+	struct burst *b;
+
+	if (tr->nr == tr->alloc) {
+		tr->alloc = tr->alloc ? 2 * tr->alloc : 1024;
+		tr->b = realloc(tr->b, tr->alloc * sizeof(*tr->b));
+		if (!tr->b) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	b = &tr->b[tr->nr++];
+	b->release = rel;
+	b->cpu = cpu;
+	b->work = work;
+	b->deadline = dl ? rel + dl : 0;
+	if (cpu + 1 > tr->nr_cpus)
+		tr->nr_cpus = cpu + 1;
+	if (rel + work / 200000 > tr->end)
+		tr->end = rel + work / 200000;
+}
+
+static int cmp_burst(const void *a, const void *b)
+{
+	const struct burst *x = a, *y = b;
+
+	if (x->release != y->release)
+		return x->release < y->release ? -1 : 1;
+	return x->cpu - y->cpu;
+}
+
+static int read_trace(FILE *f, struct trace *tr, unsigned int rec_khz)
+{
+	char line[256];
+	int lineno = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long long rel, busy, dl = 0;
+		unsigned int khz;
+		int cpu, n;
+
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "freq %u", &khz) == 1) {
+			rec_khz = khz;
+			continue;
+		}
+		n = sscanf(line, "%llu %d %llu %llu", &rel, &cpu, &busy, &dl);
+		if (n < 3 || cpu < 0 || cpu >= MAX_CPUS) {
+			fprintf(stderr, "line %d: malformed\n", lineno);
+			return -EINVAL;
+		}
+		add_burst(tr, rel, cpu, busy * rec_khz, dl);
+	}
+
+	qsort(tr->b, tr->nr, sizeof(*tr->b), cmp_burst);
+	return 0;
+}
+
+/*
+ * A 60 fps UI workload: each frame renders on CPU0 (with a random cost
+ * around 6 ms at the top OPP) and kicks a short helper burst on CPU1,
+ * plus sparse background work on both CPUs.
+ */
+static void synth_trace(struct trace *tr, unsigned int seconds,
+			unsigned int rec_khz)
+{
+	unsigned long long t, period = 16667;
+	unsigned int seed = 1;
+
+	for (t = 0; t < seconds * 1000000ULL; t += period) {
+		unsigned long long cost;
+
+		seed = seed * 1103515245 + 12345;
+		cost = 3000 + (seed >> 16) % 6000;
+		add_burst(tr, t, 0, cost * rec_khz, period);
+		add_burst(tr, t + cost / 2, 1, 800 * rec_khz, 0);
+		if (((seed >> 8) & 15) == 0)
+			add_burst(tr, t + 4000, 1, 20000 * rec_khz, 0);
+	}
+	qsort(tr->b, tr->nr, sizeof(*tr->b), cmp_burst);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: govsim [-v] [-p platform] [-g governor,...] "
+		"[-f rec_khz] [-S seconds | trace-file]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const struct platform *p = &platforms[0];
+	struct trace tr = { 0 };
+	const char *govs = NULL;
+	unsigned int rec_khz = 0, synth = 0;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vp:g:f:S:")) != -1) {
+		switch (opt) {
+		case 'v':
+			verbose++;
+			break;
+		case 'p':
+			for (i = 0; i < sizeof(platforms) /
+					sizeof(platforms[0]); i++)
+				if (!strcmp(optarg, platforms[i].name))
+					break;
+			if (i == sizeof(platforms) / sizeof(platforms[0]))
+				usage();
+			p = &platforms[i];
+			break;
+		case 'g':
+			govs = optarg;
+			break;
+		case 'f':
+			rec_khz = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			synth = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (!rec_khz)
+		rec_khz = p->opp[p->nr_opps - 1].khz;
+
+	if (synth) {
+		synth_trace(&tr, synth, rec_khz);
+	} else if (optind < argc) {
+		FILE *f = fopen(argv[optind], "r");
+
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+		if (read_trace(f, &tr, rec_khz))
+			return 1;
+		fclose(f);
+	} else {
+		if (read_trace(stdin, &tr, rec_khz))
+			return 1;
+	}
+
+	if (!tr.nr) {
+		fprintf(stderr, "empty trace\n");
+		return 1;
+	}
+
+	printf("platform %s, %d cpus, %d bursts, %.3f s\n", p->name,
+	       tr.nr_cpus, tr.nr, tr.end / 1e6);
+	printf("%-12s %10s %13s %8s %8s %6s  residency %%:", "governor",
+	       "energy mJ", "miss/frames", "avg ms", "max ms", "trans");
+	for (i = 0; i < (unsigned int)p->nr_opps; i++)
+		printf(" %5u", p->opp[i].khz / 1000);
+	printf("\n");
+
+	for (i = 0; i < NR_GOVERNORS; i++) {
+		if (govs && !strstr(govs, governors[i].name))
+			continue;
+		run(p, &tr, &governors[i]);
+	}
+
+	free(tr.b);
+	return 0;
+}
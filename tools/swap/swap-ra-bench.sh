@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# swap-ra-bench.sh - hit rate of swap readahead, cluster vs VMA based
+#
+# Copyright (C) 2011 ST-Ericsson SA
+#
+# License terms: GNU General Public License (GPL), version 2.
+#
+# Swaps to a zram device from swap_hog in a memory cgroup limited to
+# half of its working set, once with vm.swap_vma_readahead=0 (readahead
+# of the swap slots around the faulting one) and once with it set to 1
+# (readahead of the pages around the faulting address in the VMA). For
+# each it prints how fast swap_hog went, the pages swapped in, and from
+# /proc/vmstat the pages read ahead and how many of those were faulted
+# in (swap_ra_hit) or dropped unused (swap_ra_miss).
+#
+# usage: swap-ra-bench.sh [size_mb [passes]]
+
+SIZE_MB=${1:-64}
+PASSES=${2:-10}
+HOG=$(dirname $0)/swap_hog
+CG=/tmp/swap-ra-bench
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ "$(id -u)" = 0 ] || die "must be run as root"
+[ -x $HOG ] || die "$HOG not found, run make first"
+[ -f /proc/sys/vm/swap_vma_readahead ] ||
+	die "no vm.swap_vma_readahead in this kernel"
+
+modprobe zram num_devices=1 2>/dev/null
+[ -b /dev/zram0 ] || die "no /dev/zram0, is zram available?"
+grep -q ^/dev/zram0 /proc/swaps && die "/dev/zram0 already in use for swap"
+
+old_ra=$(cat /proc/sys/vm/swap_vma_readahead)
+
+cleanup() {
+	echo $old_ra > /proc/sys/vm/swap_vma_readahead
+	[ -d $CG/bench ] && rmdir $CG/bench
+	mountpoint -q $CG && umount $CG
+	[ -d $CG ] && rmdir $CG
+	swapoff /dev/zram0 2>/dev/null
+	echo 1 > /sys/block/zram0/reset
+}
+trap cleanup EXIT INT TERM
+
+echo $((SIZE_MB * 2 << 20)) > /sys/block/zram0/disksize
+mkswap /dev/zram0 >/dev/null || die "mkswap failed"
+swapon -p 32767 /dev/zram0 || die "swapon failed"
+
+mkdir -p $CG
+mount -t cgroup -o memory none $CG || die "no memory cgroup"
+mkdir $CG/bench
+echo $((SIZE_MB / 2))M > $CG/bench/memory.limit_in_bytes
+
+vmstat_field() {
+	awk -v f=$1 '$1 == f { print $2 }' /proc/vmstat
+}
+
+echo "$SIZE_MB MB, $PASSES passes, memory limit $((SIZE_MB / 2)) MB"
+
+for vma_ra in 0 1; do
+	echo $vma_ra > /proc/sys/vm/swap_vma_readahead
+
+	in=$(vmstat_field pswpin)
+	ra=$(vmstat_field swap_ra)
+	hit=$(vmstat_field swap_ra_hit)
+	miss=$(vmstat_field swap_ra_miss)
+
+	rate=$(sh -c "echo \$\$ > $CG/bench/tasks && \
+		exec $HOG $SIZE_MB $PASSES")
+
+	in=$(($(vmstat_field pswpin) - in))
+	ra=$(($(vmstat_field swap_ra) - ra))
+	hit=$(($(vmstat_field swap_ra_hit) - hit))
+	miss=$(($(vmstat_field swap_ra_miss) - miss))
+
+	echo
+	echo "swap_vma_readahead=$vma_ra: $rate pages/s touched," \
+		"pswpin $in"
+	echo "swap_ra $ra, swap_ra_hit $hit, swap_ra_miss $miss," \
+		"hit rate $([ $ra -gt 0 ] && echo $((hit * 100 / ra))% || echo -)"
+done
@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+# swap-slots-bench.sh - swap_lock contention of parallel swapping to zram
+#
+# Copyright (C) 2011 ST-Ericsson SA
+#
+# License terms: GNU General Public License (GPL), version 2.
+#
+# Swaps to a zram device from one swap_hog per CPU, all in a memory
+# cgroup limited to half of their working sets, and prints how fast they
+# went along with the lock_stat line of swap_lock: contentions, wait
+# times and acquisitions. Run on kernels with and without the per-cpu
+# swap slot cache to compare. Needs CONFIG_LOCK_STAT.
+#
+# usage: swap-slots-bench.sh [size_mb_per_hog [passes]]
+
+SIZE_MB=${1:-64}
+PASSES=${2:-10}
+HOG=$(dirname $0)/swap_hog
+CG=/tmp/swap-slots-bench
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ "$(id -u)" = 0 ] || die "must be run as root"
+[ -x $HOG ] || die "$HOG not found, run make first"
+[ -f /proc/lock_stat ] || die "no /proc/lock_stat, needs CONFIG_LOCK_STAT"
+
+CPUS=$(grep -c ^processor /proc/cpuinfo)
+
+modprobe zram num_devices=1 2>/dev/null
+[ -b /dev/zram0 ] || die "no /dev/zram0, is zram available?"
+grep -q ^/dev/zram0 /proc/swaps && die "/dev/zram0 already in use for swap"
+
+cleanup() {
+	[ -d $CG/bench ] && rmdir $CG/bench
+	mountpoint -q $CG && umount $CG
+	[ -d $CG ] && rmdir $CG
+	swapoff /dev/zram0 2>/dev/null
+	echo 1 > /sys/block/zram0/reset
+}
+trap cleanup EXIT INT TERM
+
+echo $((SIZE_MB * CPUS * 2 << 20)) > /sys/block/zram0/disksize
+mkswap /dev/zram0 >/dev/null || die "mkswap failed"
+swapon -p 32767 /dev/zram0 || die "swapon failed"
+
+mkdir -p $CG
+mount -t cgroup -o memory none $CG || die "no memory cgroup"
+mkdir $CG/bench
+echo $((SIZE_MB * CPUS / 2))M > $CG/bench/memory.limit_in_bytes
+
+vmstat_field() {
+	awk -v f=$1 '$1 == f { print $2 }' /proc/vmstat
+}
+
+echo "$CPUS x $SIZE_MB MB, $PASSES passes, memory limit $((SIZE_MB * CPUS / 2)) MB"
+
+in=$(vmstat_field pswpin)
+out=$(vmstat_field pswpout)
+echo 0 > /proc/lock_stat
+echo 1 > /proc/sys/kernel/lock_stat
+
+start=$(date +%s.%N)
+n=0
+while [ $n -lt $CPUS ]; do
+	sh -c "echo \$\$ > $CG/bench/tasks && exec $HOG $SIZE_MB $PASSES" \
+		> /tmp/swap_hog.$n &
+	n=$((n + 1))
+done
+wait
+end=$(date +%s.%N)
+
+echo 0 > /proc/sys/kernel/lock_stat
+
+total=0
+n=0
+while [ $n -lt $CPUS ]; do
+	total=$((total + $(cat /tmp/swap_hog.$n)))
+	rm -f /tmp/swap_hog.$n
+	n=$((n + 1))
+done
+
+echo "elapsed $(echo "$end - $start" | bc) s, $total pages/s touched"
+echo "pswpin $(($(vmstat_field pswpin) - in))," \
+	"pswpout $(($(vmstat_field pswpout) - out))"
+echo
+sed -n '/class name/p' /proc/lock_stat
+grep -A 3 ' swap_lock:' /proc/lock_stat
@@ -0,0 +1,60 @@
+/*
+ * swap_hog.c - keeps a working set larger than its memory cgroup allows
+ *
+ * Copyright (C) 2011 ST-Ericsson SA
+ *
+ * License terms: GNU General Public License (GPL), version 2.
+ *
+ * Maps size_mb of anonymous memory and writes one word of every page,
+ * pass after pass, so that with a memory limit below size_mb every pass
+ * swaps most of the pages out and back in. Prints the pages touched per
+ * second.
+ *
+ * usage: swap_hog size_mb passes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size, page, i;
+	unsigned int passes, pass;
+	volatile unsigned long *mem;
+	double start;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s size_mb passes\n", argv[0]);
+		return 2;
+	}
+	size = strtoul(argv[1], NULL, 0) << 20;
+	passes = strtoul(argv[2], NULL, 0);
+	page = sysconf(_SC_PAGESIZE);
+
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	start = now();
+	for (pass = 0; pass < passes; pass++)
+		for (i = 0; i < size; i += page)
+			/* different contents per page, zram would keep zeroes */
+			mem[i / sizeof(*mem)] = i ^ pass;
+
+	printf("%.0f\n", (double)passes * (size / page) / (now() - start));
+	return 0;
+}
@@ -0,0 +1,111 @@
+#!/bin/sh
+#
+# zcache-churn.sh - page cache churn through zcache, per compressor
+#
+# Copyright (C) 2011 ST-Ericsson SA
+#
+# License terms: GNU General Public License (GPL), version 2.
+#
+# Fills a filesystem with files twice the size of a memory cgroup limit
+# and reads them over and over from inside that cgroup, so that the page
+# cache keeps going to cleancache and coming back from it. The
+# filesystem is mounted again for every compressor so that its zcache
+# pool starts empty and uses that compressor. Prints how fast the reads
+# went, the cleancache counters and the pool_stats line of the pool:
+# failed puts, evictions and count/mean ns/max ns of puts, hits and
+# misses.
+#
+# Needs a kernel booted with "zcache", CONFIG_CGROUP_MEM_RES_CTLR and a
+# scratch block device with a filesystem that uses cleancache (ext3,
+# ext4, btrfs or ocfs2); everything on it is lost.
+#
+# usage: zcache-churn.sh <blockdev> [size_mb [passes [max_age [comp...]]]]
+#
+# max_age is written to /sys/kernel/mm/zcache/eph_max_age, 0 leaves the
+# zbud pages to the shrinker.
+
+DEV=$1
+SIZE_MB=${2:-256}
+PASSES=${3:-5}
+MAX_AGE=${4:-0}
+[ $# -gt 4 ] && shift 4 || set -- lzo deflate
+ZC=/sys/kernel/mm/zcache
+CC=/sys/kernel/mm/cleancache
+MNT=/tmp/zcache-churn
+CG=/tmp/zcache-churn-cg
+NFILES=16
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+[ "$(id -u)" = 0 ] || die "must be run as root"
+[ -b "$DEV" ] || die "usage: $0 <blockdev> [size_mb [passes [max_age [comp...]]]]"
+[ -d $ZC ] || die "no $ZC, boot with zcache"
+grep -q "^$DEV " /proc/mounts && die "$DEV is mounted"
+
+cleanup() {
+	mountpoint -q $MNT && umount $MNT
+	[ -d $MNT ] && rmdir $MNT
+	[ -d $CG/bench ] && rmdir $CG/bench
+	mountpoint -q $CG && umount $CG
+	[ -d $CG ] && rmdir $CG
+	echo $old_age > $ZC/eph_max_age
+	echo $old_comp > $ZC/eph_compressor
+}
+old_age=$(cat $ZC/eph_max_age)
+old_comp=$(cat $ZC/eph_compressor)
+trap cleanup EXIT INT TERM
+
+mkdir -p $MNT $CG
+mount -t cgroup -o memory none $CG || die "no memory cgroup"
+mkdir $CG/bench
+echo $((SIZE_MB / 2))M > $CG/bench/memory.limit_in_bytes
+
+mount $DEV $MNT || die "can't mount $DEV"
+n=0
+while [ $n -lt $NFILES ]; do
+	dd if=/dev/urandom of=$MNT/f.tmp bs=512K count=$((SIZE_MB / NFILES)) \
+		2>/dev/null
+	# half random, half text: something for the compressors to do
+	(cat $MNT/f.tmp; base64 $MNT/f.tmp | head -c $((SIZE_MB / NFILES << 19))) \
+		| head -c $((SIZE_MB / NFILES << 20)) > $MNT/f.$n
+	n=$((n + 1))
+done
+rm -f $MNT/f.tmp
+umount $MNT
+
+echo $MAX_AGE > $ZC/eph_max_age
+echo "$SIZE_MB MB in $NFILES files, $PASSES passes," \
+	"memory limit $((SIZE_MB / 2)) MB, eph_max_age $MAX_AGE"
+
+for comp in "$@"; do
+	echo $comp > $ZC/eph_compressor || continue
+	before=" $(cut -d' ' -f1 $ZC/pool_stats | tr '\n' ' ')"
+	mount $DEV $MNT || die "can't mount $DEV"
+	pool=""
+	for id in $(cut -d' ' -f1 $ZC/pool_stats); do
+		case "$before" in *" $id "*) ;; *) pool=$id ;; esac
+	done
+
+	gets=$(cat $CC/succ_gets)
+	misses=$(cat $CC/failed_gets)
+	puts=$(cat $CC/puts)
+	cold=$(cat $ZC/evicted_cold_pages)
+
+	start=$(date +%s.%N)
+	sh -c "echo \$\$ > $CG/bench/tasks &&
+		for p in \$(seq $PASSES); do cat $MNT/f.* > /dev/null; done"
+	end=$(date +%s.%N)
+
+	echo
+	echo "$comp: $(echo "$SIZE_MB * $PASSES / ($end - $start)" | bc) MB/s"
+	echo "  cleancache puts $(($(cat $CC/puts) - puts))," \
+		"hits $(($(cat $CC/succ_gets) - gets))," \
+		"misses $(($(cat $CC/failed_gets) - misses))," \
+		"cold evictions $(($(cat $ZC/evicted_cold_pages) - cold))"
+	[ -n "$pool" ] && grep "^$pool " $ZC/pool_stats | sed 's/^/  pool /'
+
+	umount $MNT
+done